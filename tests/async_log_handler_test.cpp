@@ -0,0 +1,205 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/async_log_handler.h" // API under test
+#include "tinfra/logger.h"
+#include "tinfra/stream.h"
+#include "tinfra/thread.h"
+#include "tinfra/time.h"
+#include "tinfra/fmt.h"
+
+#include "tinfra/test.h" // test infra
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+SUITE(tinfra)
+{
+    using tinfra::async_log_handler;
+    using tinfra::generic_log_handler;
+    using tinfra::log_handler;
+    using tinfra::log_record;
+
+    static log_record make_record(tinfra::log_level level, const char* component, const char* message)
+    {
+        log_record r;
+        r.level = level;
+        r.component = component;
+        r.message = message;
+        r.timestamp = 1234567890;
+        r.location.filename = 0;
+        r.location.line = 0;
+        r.location.name = 0;
+        return r;
+    }
+
+    static void log_samples(log_handler& h)
+    {
+        h.log(make_record(tinfra::LL_INFO, "", "simple"));
+        h.log(make_record(tinfra::LL_ERROR, "comp", "with component"));
+        log_record r = make_record(tinfra::LL_WARNING, "comp", "first line\r\nsecond line\n");
+        r.location.filename = "foo.cpp";
+        r.location.line = 42;
+        r.location.name = "bar";
+        h.log(r);
+        // long lines are written directly from ring
+        const std::string long_message = std::string(300, 'a') + "\nshort\n" + std::string(400, 'b');
+        h.log(make_record(tinfra::LL_INFO, "comp", long_message.c_str()));
+        h.log(make_record(tinfra::LL_INFO, "", "after long"));
+    }
+
+    TEST(async_log_handler_same_format_as_generic)
+    {
+        std::string expected;
+        {
+            std::auto_ptr<tinfra::output_stream> out = tinfra::create_memory_output_stream(expected);
+            generic_log_handler generic(*out);
+            log_samples(generic);
+        }
+
+        std::string result;
+        {
+            std::auto_ptr<tinfra::output_stream> out = tinfra::create_memory_output_stream(result);
+            async_log_handler async(*out);
+            log_samples(async);
+            async.flush();
+            CHECK_EQUAL(expected, result);
+        }
+        CHECK_EQUAL(expected, result);
+    }
+
+    static async_log_handler* mt_handler = 0;
+
+    static void* log_from_thread(void*)
+    {
+        tinfra::logger log("mt", *mt_handler);
+        for( int i = 0; i < 1000; ++i )
+            log.info("message");
+        return 0;
+    }
+
+    TEST(async_log_handler_threads)
+    {
+        std::string result;
+        std::auto_ptr<tinfra::output_stream> out = tinfra::create_memory_output_stream(result);
+        {
+            async_log_handler async(*out, tinfra::LOG_OVERFLOW_BLOCK, 4096);
+            mt_handler = &async;
+            tinfra::thread::thread_set ts;
+            for( int i = 0; i < 4; ++i )
+                ts.start(&log_from_thread, (void*)0);
+            ts.join();
+            async.flush();
+            CHECK_EQUAL(4000, std::count(result.begin(), result.end(), '\n'));
+            CHECK_EQUAL(0u, async.dropped());
+            mt_handler = 0;
+        }
+    }
+
+    /// output that blocks until released
+    struct gated_output_stream: public tinfra::output_stream {
+        tinfra::thread::monitor m;
+        bool open;
+        std::string data;
+
+        gated_output_stream(): open(false) {}
+
+        void release()
+        {
+            tinfra::thread::synchronizator s(m);
+            open = true;
+            s.broadcast();
+        }
+        void close() {}
+        void sync() {}
+        int write(const char* d, int size)
+        {
+            tinfra::thread::synchronizator s(m);
+            while( !open )
+                s.wait();
+            data.append(d, size);
+            return size;
+        }
+    };
+
+    TEST(async_log_handler_drop)
+    {
+        gated_output_stream out;
+        {
+            async_log_handler async(out, tinfra::LOG_OVERFLOW_REPORT, 4096);
+            log_handler& h = async;
+            // first record blocks consumer in write, rest fill the ring
+            for( int i = 0; i < 1000; ++i )
+                h.log(make_record(tinfra::LL_INFO, "", "some message that takes space"));
+            CHECK( async.dropped() > 0 );
+            out.release();
+        }
+        CHECK( out.data.find("log records dropped") != std::string::npos );
+    }
+
+    TEST(async_log_handler_truncate)
+    {
+        std::string result;
+        std::auto_ptr<tinfra::output_stream> out = tinfra::create_memory_output_stream(result);
+        const std::string long_message(3000, 'x');
+        {
+            // record may take quarter of ring
+            async_log_handler async(*out, tinfra::LOG_OVERFLOW_REPORT, 4096);
+            log_handler& h = async;
+            h.log(make_record(tinfra::LL_INFO, "", long_message.c_str()));
+            h.log(make_record(tinfra::LL_INFO, "", "short"));
+            async.flush();
+            CHECK_EQUAL(1u, async.truncated());
+            CHECK_EQUAL(0u, async.dropped());
+        }
+        CHECK( result.find(long_message) == std::string::npos );
+        CHECK( result.find(std::string(900, 'x')) != std::string::npos );
+        CHECK( result.find("1 log records truncated") != std::string::npos );
+    }
+
+    //
+    // benchmark: time spent in log() by logging thread
+    //
+
+    struct null_output_stream: public tinfra::output_stream {
+        void close() {}
+        void sync() {}
+        int write(const char*, int size) { return size; }
+    };
+
+    static tinfra::time_duration log_many(log_handler& h, int count)
+    {
+        tinfra::logger log("bench", h);
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        for( int i = 0; i < count; ++i )
+            log.info("benchmark message of moderate length, like most log lines are");
+        return tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+    }
+
+    TEST(async_log_handler_benchmark)
+    {
+        const int count = 100000;
+        null_output_stream out;
+        {
+            generic_log_handler generic(out);
+            const tinfra::time_duration t = log_many(generic, count);
+            tinfra::log_info(tinfra::fmt("generic_log_handler: records=%i time=%ims")
+                % count % t.milliseconds());
+        }
+        {
+            async_log_handler async(out, tinfra::LOG_OVERFLOW_BLOCK, 1024*1024);
+            const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+            const tinfra::time_duration t = log_many(async, count);
+            async.flush();
+            const tinfra::time_duration total = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+            tinfra::log_info(tinfra::fmt("async_log_handler: records=%i time=%ims (with flush %ims)")
+                % count % t.milliseconds() % total.milliseconds());
+        }
+    }
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,280 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/binary_codec.h" // we test this
+#include "tinfra/json.h"
+#include "tinfra/json_reader.h"
+#include "tinfra/fmt.h"
+#include "tinfra/logger.h"
+#include "tinfra/time.h"
+
+#include "tinfra/test.h"
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+namespace binary_codec_test {
+
+struct point {
+    int    x;
+    int    y;
+
+    TINFRA_MO_MANIFEST(point) {
+        TINFRA_MO_FIELD(x);
+        TINFRA_MO_FIELD(y);
+    }
+};
+
+struct message {
+    std::string               name;
+    tinfra::tstring           key;
+    bool                      flag;
+    double                    ratio;
+    long long                 big;
+    unsigned char             small;
+    std::vector<int>          ids;
+    std::vector<point>        points;
+    std::vector<std::string>  tags;
+
+    TINFRA_MO_MANIFEST(message) {
+        TINFRA_MO_FIELD(name);
+        TINFRA_MO_FIELD(key);
+        TINFRA_MO_FIELD(flag);
+        TINFRA_MO_FIELD(ratio);
+        TINFRA_MO_FIELD(big);
+        TINFRA_MO_FIELD(small);
+        TINFRA_MO_FIELD(ids);
+        TINFRA_MO_FIELD(points);
+        TINFRA_MO_FIELD(tags);
+    }
+};
+
+// same as point, with field appended in newer version
+struct point_v2 {
+    int         x;
+    int         y;
+    std::string label;
+
+    TINFRA_MO_MANIFEST(point_v2) {
+        TINFRA_MO_FIELD(x);
+        TINFRA_MO_FIELD(y);
+        TINFRA_MO_FIELD(label);
+    }
+};
+
+struct book {
+    std::string      name;
+    int              year;
+    double           rating;
+    bool             available;
+    std::vector<int> editions;
+
+    TINFRA_MO_MANIFEST(book) {
+        TINFRA_MO_FIELD(name);
+        TINFRA_MO_FIELD(year);
+        TINFRA_MO_FIELD(rating);
+        TINFRA_MO_FIELD(available);
+        TINFRA_MO_FIELD(editions);
+    }
+};
+
+struct library {
+    std::string       owner;
+    std::vector<book> books;
+
+    TINFRA_MO_MANIFEST(library) {
+        TINFRA_MO_FIELD(owner);
+        TINFRA_MO_FIELD(books);
+    }
+};
+
+} // end namespace binary_codec_test
+
+TINFRA_MO_IS_RECORD(binary_codec_test::point);
+TINFRA_MO_IS_RECORD(binary_codec_test::message);
+TINFRA_MO_IS_RECORD(binary_codec_test::point_v2);
+TINFRA_MO_IS_RECORD(binary_codec_test::book);
+TINFRA_MO_IS_RECORD(binary_codec_test::library);
+
+SUITE(tinfra) {
+
+using tinfra::tstring;
+using namespace binary_codec_test;
+
+TEST(binary_codec_wire_format)
+{
+    const std::string r = tinfra::binary_encode(0x01020304, 7);
+    CHECK_EQUAL(std::string("\x07\x00\x00\x00\x04\x03\x02\x01", 8), r);
+    CHECK_EQUAL(8u, tinfra::binary_encoded_size(0x01020304));
+
+    point p;
+    p.x = -1;
+    p.y = 2;
+    CHECK_EQUAL(std::string("\x00\x00\x00\x00"
+                            "\x08\x00\x00\x00"
+                            "\xff\xff\xff\xff"
+                            "\x02\x00\x00\x00", 16), tinfra::binary_encode(p));
+
+    std::vector<std::string> v;
+    v.push_back("ab");
+    CHECK_EQUAL(std::string("\x00\x00\x00\x00"
+                            "\x01\x00\x00\x00"
+                            "\x02\x00\x00\x00" "ab", 14), tinfra::binary_encode(v));
+}
+
+TEST(binary_codec_roundtrip)
+{
+    message m;
+    m.name = "name";
+    m.key = "key";
+    m.flag = true;
+    m.ratio = 0.25;
+    m.big = -(1LL << 40);
+    m.small = 200;
+    for( int i = 0; i < 10; ++i )
+        m.ids.push_back(i * 1000);
+    point p = { 1, -2 };
+    m.points.push_back(p);
+    m.points.push_back(p);
+    m.tags.push_back("a");
+    m.tags.push_back("");
+
+    const size_t size = tinfra::binary_encoded_size(m);
+    std::string encoded = "prefix";
+    tinfra::binary_encode(m, encoded, 3);
+    CHECK_EQUAL(6 + size, encoded.size());
+
+    const tstring input = tstring(encoded).substr(6);
+    message r;
+    CHECK_EQUAL(3u, tinfra::binary_decode(input, r));
+    CHECK_EQUAL("name", r.name);
+    CHECK_EQUAL("key", r.key);
+    // tstring is view into input
+    CHECK(r.key.data() > input.data() && r.key.data() < input.data() + input.size());
+    CHECK_EQUAL(true, r.flag);
+    CHECK_EQUAL(0.25, r.ratio);
+    CHECK_EQUAL(-(1LL << 40), r.big);
+    CHECK_EQUAL(200, r.small);
+    CHECK(m.ids == r.ids);
+    CHECK_EQUAL(2u, r.points.size());
+    CHECK_EQUAL(-2, r.points[1].y);
+    CHECK(m.tags == r.tags);
+
+    // encode into caller buffer
+    std::vector<char> buffer(size);
+    CHECK_EQUAL(size, tinfra::binary_encode(m, &buffer[0], buffer.size(), 3));
+    CHECK_EQUAL(input, tstring(&buffer[0], buffer.size()));
+}
+
+TEST(binary_codec_versions)
+{
+    point_v2 p2;
+    p2.x = 1;
+    p2.y = 2;
+    p2.label = "two";
+
+    // old reader skips new field
+    std::vector<point_v2> v2(2, p2);
+    std::vector<point> v1;
+    tinfra::binary_decode(tinfra::binary_encode(v2, 2), v1);
+    CHECK_EQUAL(2u, v1.size());
+    CHECK_EQUAL(1, v1[1].x);
+    CHECK_EQUAL(2, v1[1].y);
+
+    // new reader leaves missing field unchanged
+    point_v2 r;
+    r.label = "default";
+    CHECK_EQUAL(1u, tinfra::binary_decode(tinfra::binary_encode(v1[0], 1), r));
+    CHECK_EQUAL(1, r.x);
+    CHECK_EQUAL(2, r.y);
+    CHECK_EQUAL("default", r.label);
+}
+
+TEST(binary_codec_errors)
+{
+    point p = { 1, 2 };
+    const std::string encoded = tinfra::binary_encode(p);
+    point r;
+    for( size_t i = 0; i < encoded.size(); ++i ) {
+        CHECK_THROW(tinfra::binary_decode(tstring(encoded.data(), i), r), std::runtime_error);
+    }
+    CHECK_THROW(tinfra::binary_decode(tstring(encoded + "x"), r), std::runtime_error);
+
+    // huge count is rejected before allocating
+    std::vector<int> v;
+    CHECK_THROW(tinfra::binary_decode(tstring("\0\0\0\0\xff\xff\xff\x7f", 8), v), std::runtime_error);
+    std::vector<std::string> vs;
+    CHECK_THROW(tinfra::binary_decode(tstring("\0\0\0\0\x02\0\0\0\0\0\0\0", 12), vs), std::runtime_error);
+}
+
+//
+// benchmark: binary codec vs JSON
+//
+
+TEST(binary_codec_benchmark)
+{
+    library lib;
+    lib.owner = "x";
+    book b;
+    b.name = "some book title";
+    b.year = 1961;
+    b.rating = 4.5;
+    b.available = true;
+    b.editions.push_back(1);
+    b.editions.push_back(2);
+    b.editions.push_back(3);
+    lib.books.resize(20000, b);
+
+    std::string json;
+    {
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        json = "{ \"owner\": \"x\", \"books\": [";
+        for( size_t i = 0; i < lib.books.size(); ++i ) {
+            tinfra::variant v = tinfra::variant::dict();
+            v["name"] = tinfra::variant(lib.books[i].name);
+            v["year"] = tinfra::variant(lib.books[i].year);
+            v["rating"] = tinfra::variant(lib.books[i].rating);
+            v["available"].set_bool(lib.books[i].available);
+            v["editions"] = tinfra::variant::array();
+            for( size_t k = 0; k < lib.books[i].editions.size(); ++k )
+                v["editions"][k] = tinfra::variant(lib.books[i].editions[k]);
+            if( i > 0 )
+                json += ",";
+            json += tinfra::json_write(v);
+        }
+        json += "]}";
+        const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("json encode: bytes=%i time=%ims") % json.size() % t.milliseconds());
+    }
+    {
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        library r;
+        tinfra::json_read(json, r);
+        const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("json decode: bytes=%i time=%ims") % json.size() % t.milliseconds());
+        CHECK_EQUAL(20000u, r.books.size());
+    }
+    std::string encoded;
+    {
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        encoded = tinfra::binary_encode(lib);
+        const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("binary encode: bytes=%i time=%ims") % encoded.size() % t.milliseconds());
+    }
+    {
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        library r;
+        tinfra::binary_decode(encoded, r);
+        const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("binary decode: bytes=%i time=%ims") % encoded.size() % t.milliseconds());
+        CHECK_EQUAL(20000u, r.books.size());
+        CHECK_EQUAL(3, r.books[19999].editions[2]);
+    }
+}
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
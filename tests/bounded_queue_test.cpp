@@ -0,0 +1,194 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/bounded_queue.h" // API under test
+#include "tinfra/queue.h"
+#include "tinfra/thread.h"
+#include "tinfra/fmt.h"
+#include "tinfra/logger.h"
+
+#include "tinfra/test.h" // test infra
+
+#include <vector>
+#include <iterator>
+
+SUITE(tinfra)
+{
+    using tinfra::bounded_queue;
+    using tinfra::deadline;
+    using tinfra::time_duration;
+
+    TEST(bounded_queue_basic)
+    {
+        bounded_queue<int> q(3);
+        CHECK_EQUAL(4, q.capacity());
+        CHECK(q.empty());
+
+        for( int i = 0; i < 4; ++i )
+            CHECK(q.try_put(i));
+        CHECK(q.full());
+        CHECK(!q.try_put(100));
+        CHECK_EQUAL(4, q.size());
+
+        int v = -1;
+        for( int i = 0; i < 4; ++i ) {
+            CHECK(q.try_get(v));
+            CHECK_EQUAL(i, v);
+        }
+        CHECK(!q.try_get(v));
+        CHECK(q.empty());
+    }
+
+    TEST(bounded_queue_wraps)
+    {
+        bounded_queue<int> q(4);
+        int v;
+        for( int i = 0; i < 100; ++i ) {
+            CHECK(q.try_put(i));
+            CHECK(q.try_put(i+1000));
+            CHECK(q.try_get(v));
+            CHECK_EQUAL(i, v);
+            CHECK(q.try_get(v));
+            CHECK_EQUAL(i+1000, v);
+        }
+    }
+
+    TEST(bounded_queue_drain)
+    {
+        bounded_queue<int> q(16);
+        for( int i = 0; i < 10; ++i )
+            q.put(i);
+        std::vector<int> out;
+        CHECK_EQUAL(4, q.drain(std::back_inserter(out), 4));
+        CHECK_EQUAL(6, q.size());
+        CHECK_EQUAL(6, q.drain(std::back_inserter(out), 100));
+        CHECK_EQUAL(10, out.size());
+        for( int i = 0; i < 10; ++i )
+            CHECK_EQUAL(i, out[i]);
+        CHECK_EQUAL(0, q.drain(std::back_inserter(out), 100));
+    }
+
+    TEST(bounded_queue_deadline)
+    {
+        bounded_queue<int> q(2);
+        int v;
+        CHECK(!q.get(v, deadline::relative(time_duration::millisecond(20))));
+        CHECK(q.put(1, deadline::relative(time_duration::millisecond(20))));
+        CHECK(q.put(2, deadline::relative(time_duration::millisecond(20))));
+        CHECK(!q.put(3, deadline::relative(time_duration::millisecond(20))));
+        CHECK(q.get(v, deadline::relative(time_duration::millisecond(20))));
+        CHECK_EQUAL(1, v);
+    }
+
+#if TINFRA_THREADS
+    using tinfra::thread::thread_set;
+
+    static const int BQ_ITEMS = 20000;
+
+    static void* bq_produce(void* q_)
+    {
+        bounded_queue<int>* q = (bounded_queue<int>*)q_;
+        for( int i = 1; i <= BQ_ITEMS; ++i )
+            q->put(i);
+        return 0;
+    }
+
+    static void* bq_consume(void* q_)
+    {
+        bounded_queue<int>* q = (bounded_queue<int>*)q_;
+        long long sum = 0;
+        for( int i = 0; i < BQ_ITEMS; ++i )
+            sum += q->get();
+        return reinterpret_cast<void*>(sum == static_cast<long long>(BQ_ITEMS)*(BQ_ITEMS+1)/2 ? 1 : 0);
+    }
+
+    static void* bq_consume_any(void* q_)
+    {
+        bounded_queue<int>* q = (bounded_queue<int>*)q_;
+        for( int i = 0; i < BQ_ITEMS; ++i ) {
+            const int r = q->get();
+            CHECK( r >= 1 && r <= BQ_ITEMS );
+        }
+        return 0;
+    }
+
+    TEST(bounded_queue_2_threads)
+    {
+        // small capacity, so both full and empty paths are exercised
+        bounded_queue<int> q(8);
+        tinfra::thread::thread consumer = tinfra::thread::thread::start(&bq_consume, &q);
+        bq_produce(&q);
+        CHECK_EQUAL((void*)1, consumer.join());
+        CHECK(q.empty());
+    }
+
+    TEST(bounded_queue_more_threads)
+    {
+        bounded_queue<int> q(16);
+        thread_set ts;
+
+        ts.start(&bq_consume_any, &q);
+        ts.start(&bq_consume_any, &q);
+        ts.start(&bq_consume_any, &q);
+
+        ts.start(&bq_produce, &q);
+        ts.start(&bq_produce, &q);
+        ts.start(&bq_produce, &q);
+
+        ts.join();
+        CHECK(q.empty());
+    }
+
+    //
+    // benchmark: tinfra::queue vs bounded_queue, 1 producer, 1 consumer
+    //
+
+    template <typename Q>
+    struct bq_bench {
+        static void* produce(void* q_)
+        {
+            Q* q = (Q*)q_;
+            for( int i = 0; i < 200000; ++i )
+                q->put(i);
+            return 0;
+        }
+        static void* consume(void* q_)
+        {
+            Q* q = (Q*)q_;
+            for( int i = 0; i < 200000; ++i )
+                q->get();
+            return 0;
+        }
+        static tinfra::time_duration run(Q& q)
+        {
+            const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+            thread_set ts;
+            ts.start(&consume, &q);
+            ts.start(&produce, &q);
+            ts.join();
+            return tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        }
+    };
+
+    TEST(bounded_queue_throughput)
+    {
+        {
+            tinfra::queue<int> q;
+            const tinfra::time_duration t = bq_bench<tinfra::queue<int> >::run(q);
+            tinfra::log_info(tinfra::fmt("queue: items=%i time=%ims")
+                % 200000 % t.milliseconds());
+        }
+        {
+            bounded_queue<int> q(1024);
+            const tinfra::time_duration t = bq_bench<bounded_queue<int> >::run(q);
+            tinfra::log_info(tinfra::fmt("bounded_queue: items=%i time=%ims")
+                % 200000 % t.milliseconds());
+        }
+    }
+#endif
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
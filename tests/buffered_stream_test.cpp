@@ -1,7 +1,13 @@
 #include "tinfra/test.h" // for test infra
 #include "tinfra/buffered_stream.h" // we test this
+#include "tinfra/file.h"
+#include "tinfra/memory_stream.h"
+#include "tinfra/text.h"
+#include "tinfra/time.h"
 
 #include <deque>
+#include <string>
+#include <stdexcept>
 
 SUITE(tinfra) {
 
@@ -119,4 +125,155 @@ TEST(buffered_stream)
     }
 }
 
+TEST(buffered_stream_peek_consume)
+{
+    mock_input_stream mock;
+    mock.will_return("abc");
+    mock.will_return("d");
+    mock.will_return("efgh");
+
+    tinfra::buffered_input_stream bs(mock, 4);
+    CHECK_EQUAL("ab", bs.peek(2));
+    CHECK_EQUAL(4, mock.called_with());
+    CHECK_EQUAL("abc", bs.buffered());
+
+    // needs more than buffer capacity, buffer grows
+    CHECK_EQUAL("abcdef", bs.peek(6));
+    CHECK(bs.capacity() >= 6);
+    bs.consume(4);
+    CHECK_EQUAL("efgh", bs.buffered());
+    CHECK_THROW(bs.consume(5), std::logic_error);
+
+    mock.will_return(0);
+    CHECK_EQUAL("efgh", bs.peek(10));
+    char buf[16] = {0};
+    CHECK_EQUAL(4, bs.read(buf, 16));
+    CHECK_EQUAL("efgh", buf);
+    CHECK_EQUAL("", bs.peek(1));
+}
+
+TEST(buffered_stream_read_until)
+{
+    const std::string content = "ab\ncdefghijk\n\nlast";
+    tinfra::memory_input_stream mem(content);
+    tinfra::buffered_input_stream bs(mem, 4);
+    tinfra::tstring r;
+    CHECK(bs.read_until('\n', r)); CHECK_EQUAL("ab\n", r);
+    // record longer than buffer
+    CHECK(bs.read_until('\n', r)); CHECK_EQUAL("cdefghijk\n", r);
+    CHECK(bs.read_until('\n', r)); CHECK_EQUAL("\n", r);
+    CHECK(bs.read_until('\n', r)); CHECK_EQUAL("last", r);
+    CHECK(!bs.read_until('\n', r));
+}
+
+TEST(buffered_stream_line_reader)
+{
+    tinfra::test::test_fs_sandbox sandbox;
+    tinfra::write_file("a.txt", "first\nsecond\n\nlast");
+
+    std::auto_ptr<tinfra::input_stream> in = tinfra::create_file_input_stream("a.txt", 8192);
+    tinfra::line_reader lines(*in);
+    std::string line;
+    CHECK(lines.fetch_next(line)); CHECK_EQUAL("first\n", line);
+    CHECK(lines.fetch_next(line)); CHECK_EQUAL("second\n", line);
+    CHECK(lines.fetch_next(line)); CHECK_EQUAL("\n", line);
+    CHECK(lines.fetch_next(line)); CHECK_EQUAL("last", line);
+    CHECK(!lines.fetch_next(line));
+}
+
+struct recording_output_stream: public tinfra::output_stream {
+    recording_output_stream(): syncs(0), closed(false) {}
+
+    void close() { closed = true; }
+    int write(const char* data, int size)
+    {
+        writes.push_back(std::string(data, size));
+        return size;
+    }
+    void sync() { ++syncs; }
+
+    std::string all() const
+    {
+        std::string r;
+        for( size_t i = 0; i < writes.size(); ++i )
+            r += writes[i];
+        return r;
+    }
+
+    std::deque<std::string> writes;
+    int  syncs;
+    bool closed;
+};
+
+TEST(buffered_output_stream_coalescing)
+{
+    recording_output_stream target;
+    {
+        tinfra::buffered_output_stream out(target, 8);
+        CHECK_EQUAL(3, out.write("abc", 3));
+        CHECK_EQUAL(3, out.write("def", 3));
+        CHECK_EQUAL(0u, target.writes.size());
+        CHECK_EQUAL(6u, out.buffered_size());
+
+        // doesn't fit, buffered part is flushed first
+        out.write("ghi", 3);
+        CHECK_EQUAL(1u, target.writes.size());
+        CHECK_EQUAL("abcdef", target.writes[0]);
+
+        // big write passes through together with buffered data
+        out.write("0123456789", 10);
+        CHECK_EQUAL(3u, target.writes.size());
+        CHECK_EQUAL("abcdefghi0123456789", target.all());
+        CHECK_EQUAL(0u, out.buffered_size());
+
+        const tinfra::tstring fragments[] = { "x", "y", "z" };
+        CHECK_EQUAL(3, out.writev(fragments, 3));
+        out.sync();
+        CHECK_EQUAL(1, target.syncs);
+        CHECK_EQUAL("abcdefghi0123456789xyz", target.all());
+
+        out.write("tail", 4);
+    }
+    // destructor flushes
+    CHECK_EQUAL("abcdefghi0123456789xyztail", target.all());
+    CHECK(!target.closed);
+}
+
+TEST(buffered_output_stream_flush_policy)
+{
+    recording_output_stream target;
+    tinfra::buffered_output_stream out(target, 64);
+    out.set_flush_threshold(4);
+    out.write("ab", 2);
+    CHECK_EQUAL(0u, target.writes.size());
+    out.write("cd", 2);
+    CHECK_EQUAL(1u, target.writes.size());
+
+    // corked, only full buffer is flushed
+    out.cork();
+    for( int i = 0; i < 10; ++i )
+        out.write("xy", 2);
+    CHECK_EQUAL(1u, target.writes.size());
+    out.uncork();
+    CHECK_EQUAL(2u, target.writes.size());
+    CHECK_EQUAL("xyxyxyxyxyxyxyxyxyxy", target.writes[1]);
+
+    // time based
+    out.set_flush_threshold(0);
+    out.set_flush_interval(tinfra::time_duration::millisecond(20));
+    out.write("a", 1);
+    CHECK_EQUAL(2u, target.writes.size());
+    const tinfra::time_stamp written = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+    while( tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - written < tinfra::time_duration::millisecond(30) )
+        ;
+    out.write("b", 1);
+    CHECK_EQUAL(3u, target.writes.size());
+    CHECK_EQUAL("ab", target.writes[2]);
+
+    out.write("c", 1);
+    out.close();
+    CHECK(target.closed);
+    CHECK_EQUAL("abcdxyxyxyxyxyxyxyxyxyxyabc", target.all());
+}
+
 }
@@ -9,6 +9,12 @@
 
 #include "tinfra/vfs.h"
 #include "tinfra/path.h"
+#include "tinfra/mutex.h"
+#include "tinfra/guard.h"
+#include "tinfra/atomic.h"
+#include "tinfra/fmt.h"
+#include "tinfra/logger.h"
+#include "tinfra/time.h"
 
 #include <iostream>
 #include <stdexcept>
@@ -101,7 +107,14 @@ SUITE(tinfra)
     {
         test_fs_sandbox tmp_location("testtest_dir");
         fs::recursive_copy("testtest_dir", "boo");
+        CHECK(fs::is_dir("boo"));
         fs::recursive_rm("boo");
+        CHECK(!fs::exists("boo"));
+
+        fs::recursive_copy("testtest_dir", "boo", true);
+        CHECK(fs::is_dir("boo"));
+        fs::recursive_rm("boo", true);
+        CHECK(!fs::exists("boo"));
     }
     
     TEST(fs_walk)
@@ -117,6 +130,211 @@ SUITE(tinfra)
         fs::walk(".", foo);
     }
     
+    struct collecting_walker: public fs::walker {
+        collecting_walker(): prune(""), stop_at(""), fail_at("") {}
+        
+        virtual bool accept(tstring const& name, tstring const& parent, bool is_dir)
+        {
+            if( name == stop_at )
+                throw fs::walker::stop();
+            if( name == fail_at )
+                throw std::runtime_error("walker failed");
+            tinfra::guard g(mutex);
+            result.push_back(tinfra::path::join(parent, name) + (is_dir ? "/" : ""));
+            return name != prune;
+        }
+        
+        tinfra::mutex            mutex;
+        std::vector<std::string> result;
+        tstring                  prune;
+        tstring                  stop_at;
+        tstring                  fail_at;
+    };
+    
+    TEST(fs_parallel_walk)
+    {
+        test_fs_sandbox tmp_location("testtest_dir");
+        fs::mkdir("testtest_dir/a/b/c");
+        tinfra::write_file("testtest_dir/a/b/c/file3", "");
+        
+        collecting_walker sequential;
+        fs::walk(".", sequential);
+        std::sort(sequential.result.begin(), sequential.result.end());
+        CHECK_EQUAL(7, sequential.result.size());
+        
+        collecting_walker parallel;
+        fs::parallel_walk(".", parallel, 3);
+        std::sort(parallel.result.begin(), parallel.result.end());
+        CHECK(sequential.result == parallel.result);
+        
+        collecting_walker pruned;
+        pruned.prune = "b";
+        fs::parallel_walk(".", pruned);
+        std::sort(pruned.result.begin(), pruned.result.end());
+        CHECK_EQUAL(5, pruned.result.size());
+        CHECK_EQUAL("./testtest_dir/a/b/", pruned.result[2]);
+        
+        collecting_walker stopped;
+        stopped.stop_at = "testtest_dir";
+        fs::parallel_walk(".", stopped);
+        CHECK_EQUAL(0, stopped.result.size());
+        
+        // failure of accept() isn't taken as unreadable directory
+        collecting_walker failing;
+        failing.fail_at = "c";
+        CHECK_THROW(fs::parallel_walk(".", failing), std::runtime_error);
+        CHECK(std::find(failing.result.begin(), failing.result.end(), "./testtest_dir/a/b/c/file3") == failing.result.end());
+    }
+    
+    //
+    // benchmark: walk vs parallel_walk vs recursive_lister
+    //
+    
+    struct counting_walker: public fs::walker {
+        counting_walker(): count(0) {}
+        
+        virtual bool accept(tstring const&, tstring const&, bool)
+        {
+            count.fetch_add(1);
+            return true;
+        }
+        tinfra::atomic<int> count;
+    };
+    
+    TEST(fs_walk_benchmark)
+    {
+        test_fs_sandbox tmp_location;
+        int created = 0;
+        for( int i = 0; i < 20; ++i ) {
+            for( int j = 0; j < 10; ++j ) {
+                const std::string dir = tinfra::tsprintf("d%i/e%i", i, j);
+                fs::mkdir(dir);
+                created += (j == 0 ? 2 : 1);
+                for( int k = 0; k < 20; ++k, ++created )
+                    tinfra::write_file(tinfra::tsprintf("%s/f%i", dir, k), "");
+            }
+        }
+        {
+            const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+            int count = 0;
+            fs::recursive_lister lister(".", true);
+            fs::directory_entry de;
+            while( lister.fetch_next(de) )
+                ++count;
+            const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+            tinfra::log_info(tinfra::fmt("recursive_lister(need_stat): entries=%i time=%ims") % count % t.milliseconds());
+            CHECK_EQUAL(created, count);
+        }
+        {
+            const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+            int count = 0;
+            fs::recursive_lister lister(".", false);
+            fs::directory_entry de;
+            while( lister.fetch_next(de) )
+                ++count;
+            const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+            tinfra::log_info(tinfra::fmt("recursive_lister: entries=%i time=%ims") % count % t.milliseconds());
+            CHECK_EQUAL(created, count);
+        }
+        {
+            const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+            counting_walker w;
+            fs::walk(".", w);
+            const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+            tinfra::log_info(tinfra::fmt("walk: entries=%i time=%ims") % w.count.load() % t.milliseconds());
+            CHECK_EQUAL(created, w.count.load());
+        }
+        {
+            const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+            counting_walker w;
+            fs::parallel_walk(".", w);
+            const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+            tinfra::log_info(tinfra::fmt("parallel_walk: entries=%i time=%ims") % w.count.load() % t.milliseconds());
+            CHECK_EQUAL(created, w.count.load());
+        }
+    }
+    
+    struct counting_monitor: public tinfra::tree_operation_monitor {
+        counting_monitor(int limit = -1): count(0), limit(limit) {}
+        
+        virtual bool progress(tstring const&)
+        {
+            return count.fetch_add(1) + 1 != limit;
+        }
+        tinfra::atomic<int> count;
+        int                 limit;
+    };
+    
+    static std::vector<std::string> sorted_tree(tstring const& path)
+    {
+        std::vector<std::string> result;
+        fs::recursive_lister lister(path, false);
+        fs::directory_entry de;
+        while( lister.fetch_next(de) )
+            result.push_back(de.name.str().substr(path.size()));
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+    
+    TEST(vfs_parallel_recursive_copy_rm)
+    {
+        test_fs_sandbox tmp_location("testtest_dir");
+        fs::mkdir("testtest_dir/a/b/c");
+        fs::mkdir("testtest_dir/d");
+        tinfra::write_file("testtest_dir/a/b/c/file3", "content 3");
+        tinfra::write_file("testtest_dir/d/file4", "content 4");
+        
+        tinfra::tree_operation_options options;
+        counting_monitor monitor;
+        options.monitor = &monitor;
+        options.thread_count = 3;
+        CHECK(tinfra::parallel_recursive_copy(tinfra::local_fs(), "testtest_dir", tinfra::local_fs(), "copy", options));
+        CHECK(sorted_tree("testtest_dir") == sorted_tree("copy"));
+        CHECK_EQUAL(8u, sorted_tree("copy").size());
+        CHECK_EQUAL(9, monitor.count.load()); // with copy itself
+        CHECK_EQUAL("content 3", tinfra::read_file("copy/a/b/c/file3"));
+        
+        // copy into existing dir
+        fs::mkdir("into");
+        tinfra::parallel_recursive_copy(tinfra::local_fs(), "testtest_dir", tinfra::local_fs(), "into");
+        CHECK(sorted_tree("testtest_dir") == sorted_tree("into/testtest_dir"));
+        
+        counting_monitor rm_monitor;
+        options.monitor = &rm_monitor;
+        CHECK(tinfra::parallel_recursive_rm(tinfra::local_fs(), "copy", options));
+        CHECK(!fs::exists("copy"));
+        CHECK_EQUAL(9, rm_monitor.count.load());
+        
+        // cancelled
+        counting_monitor cancelling(3);
+        options.monitor = &cancelling;
+        CHECK(!tinfra::parallel_recursive_rm(tinfra::local_fs(), "into", options));
+        CHECK(fs::exists("into"));
+        
+        CHECK_THROW(tinfra::parallel_recursive_rm(tinfra::local_fs(), "does-not-exist"), std::runtime_error);
+    }
+    
+    TEST(vfs_parallel_recursive_copy_errors)
+    {
+        test_fs_sandbox tmp_location("testtest_dir");
+        fs::mkdir("testtest_dir/d");
+        tinfra::write_file("testtest_dir/d/file4", "content 4");
+        fs::symlink("nowhere", "testtest_dir/d/broken1");
+        fs::symlink("nowhere", "testtest_dir/broken2");
+        
+        // broken links can't be copied, but everything else is
+        std::vector<std::string> errors;
+        try {
+            tinfra::parallel_recursive_copy(tinfra::local_fs(), "testtest_dir", tinfra::local_fs(), "copy");
+        } catch( tinfra::tree_operation_error& e ) {
+            errors = e.errors();
+        }
+        CHECK_EQUAL(2u, errors.size());
+        CHECK_EQUAL("content 4", tinfra::read_file("copy/d/file4"));
+        CHECK(fs::is_file("copy/file1"));
+        CHECK(fs::is_file("copy/a/file2"));
+    }
+    
     TEST(fs_recursive_lister_depth)
     {
         test_fs_sandbox tmp_location("testtest_dir");
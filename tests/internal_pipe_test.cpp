@@ -5,10 +5,15 @@
 
 #include "tinfra/internal_pipe.h"
 #include "tinfra/tstring.h"
+#include "tinfra/thread.h"
+#include "tinfra/fmt.h"
+#include "tinfra/logger.h"
+#include "tinfra/time.h"
 
 #include "tinfra/test.h"
 
 #include <stdexcept>
+#include <cstring>
 
 SUITE(tinfra)
 {
@@ -40,5 +45,196 @@ SUITE(tinfra)
         
         // each subsequent read should return 0
         CHECK_EQUAL( 0 , pipe.read(buf, sizeof(buf)) );
+        
+        // chunk API is available only in SPSC mode
+        CHECK_THROW( pipe.acquire_read(), std::logic_error);
+    }
+    
+    TEST(internal_pipe_spsc_sequential_flow)
+    {
+        internal_pipe pipe(8, internal_pipe::SINGLE_PRODUCER_CONSUMER);
+        
+        CHECK_EQUAL( 6, pipe.write("abcdef", 6));
+        char buf[100] = {0};
+        CHECK_EQUAL( 4, pipe.read(buf, 4));
+        CHECK_EQUAL( "abcd", tstring(buf, 4));
+        
+        // wraps over ring end
+        CHECK_EQUAL( 5, pipe.write("ghijk", 5));
+        CHECK_EQUAL( 7, pipe.read(buf, sizeof(buf)));
+        CHECK_EQUAL( "efghijk", tstring(buf, 7));
+        
+        pipe.close();
+        CHECK_THROW( pipe.write("aa", 2), std::logic_error);
+        CHECK_EQUAL( 0 , pipe.read(buf, sizeof(buf)) );
+    }
+    
+    TEST(internal_pipe_spsc_chunks)
+    {
+        internal_pipe pipe(8, internal_pipe::SINGLE_PRODUCER_CONSUMER);
+        
+        tinfra::mutable_buffer space = pipe.acquire_write(3);
+        CHECK_EQUAL( 8u, space.size);
+        std::memcpy(space.data, "abcde", 5);
+        pipe.commit(5);
+        
+        tstring chunk = pipe.acquire_read();
+        CHECK_EQUAL( "abcde", chunk);
+        pipe.release(2);
+        CHECK_EQUAL( "cde", pipe.acquire_read());
+        CHECK_THROW( pipe.release(4), std::logic_error);
+        
+        // 5 bytes contiguous, although only 3 remain before ring end
+        space = pipe.acquire_write(5);
+        CHECK_EQUAL( 5u, space.size);
+        std::memcpy(space.data, "12345", 5);
+        pipe.commit(5);
+        
+        CHECK_EQUAL( "cde123", pipe.acquire_read());
+        pipe.release(6);
+        CHECK_EQUAL( "45", pipe.acquire_read());
+        pipe.release(2);
+        
+        CHECK_THROW( pipe.acquire_write(9), std::logic_error);
+        
+        // commit only what was acquired
+        space = pipe.acquire_write(1);
+        CHECK_THROW( pipe.commit(space.size + 1), std::logic_error);
+        pipe.commit(1);
+        CHECK_THROW( pipe.commit(1), std::logic_error);
+        pipe.release(pipe.acquire_read().size());
+        pipe.close();
+        CHECK( pipe.acquire_read().empty() );
+    }
+
+#if TINFRA_THREADS
+    static const int PIPE_RECORDS = 100000;
+    
+    static void* pipe_produce(void* p_)
+    {
+        internal_pipe* p = (internal_pipe*)p_;
+        for( int i = 0; i < PIPE_RECORDS; ++i )
+            p->write((const char*)&i, sizeof(i));
+        p->close();
+        return 0;
+    }
+    
+    static void* pipe_produce_chunks(void* p_)
+    {
+        internal_pipe* p = (internal_pipe*)p_;
+        for( int i = 0; i < PIPE_RECORDS; ) {
+            tinfra::mutable_buffer space = p->acquire_write(sizeof(int));
+            size_t used = 0;
+            for( ; used + sizeof(int) <= space.size && i < PIPE_RECORDS; used += sizeof(int), ++i )
+                std::memcpy(space.data + used, &i, sizeof(i));
+            p->commit(used);
+        }
+        p->close();
+        return 0;
+    }
+    
+    static bool pipe_consume(internal_pipe& p)
+    {
+        int expected = 0;
+        char record[sizeof(int)];
+        size_t filled = 0;
+        char buf[1000];
+        while( true ) {
+            const int r = p.read(buf, sizeof(buf));
+            if( r == 0 )
+                break;
+            for( int i = 0; i < r; ++i ) {
+                record[filled++] = buf[i];
+                if( filled == sizeof(int) ) {
+                    int v;
+                    std::memcpy(&v, record, sizeof(v));
+                    if( v != expected )
+                        return false;
+                    ++expected;
+                    filled = 0;
+                }
+            }
+        }
+        return expected == PIPE_RECORDS && filled == 0;
+    }
+    
+    static tinfra::time_duration pipe_run(internal_pipe& p, void* (*producer)(void*), bool& ok)
+    {
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        tinfra::thread::thread_set ts;
+        ts.start(producer, &p);
+        ok = pipe_consume(p);
+        ts.join();
+        return tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+    }
+    
+    struct blocked_writer {
+        internal_pipe* pipe;
+        bool           closed_error;
+    };
+    
+    static void* pipe_write_blocked(void* p_)
+    {
+        blocked_writer* w = (blocked_writer*)p_;
+        try {
+            // ring is 8 bytes, so second half waits for reader
+            w->pipe->write("0123456789abcdef", 16);
+        } catch( std::logic_error& ) {
+            w->closed_error = true;
+        }
+        return 0;
+    }
+    
+    TEST(internal_pipe_spsc_close_wakes_writer)
+    {
+        internal_pipe p(8, internal_pipe::SINGLE_PRODUCER_CONSUMER);
+        blocked_writer w = { &p, false };
+        tinfra::thread::thread_set ts;
+        ts.start(&pipe_write_blocked, &w);
+        // wait till ring is full, writer is then waiting for space
+        while( p.acquire_read().size() < 8 )
+            ;
+        p.close();
+        ts.join();
+        CHECK(w.closed_error);
+        CHECK_EQUAL( "01234567", p.acquire_read());
+    }
+    
+    TEST(internal_pipe_threads)
+    {
+        {
+            internal_pipe p(internal_pipe::UNLIMITED);
+            bool ok = false;
+            const tinfra::time_duration t = pipe_run(p, &pipe_produce, ok);
+            CHECK(ok);
+            tinfra::log_info(tinfra::fmt("internal_pipe(locking): records=%i time=%ims")
+                % PIPE_RECORDS % t.milliseconds());
+        }
+        {
+            // small ring, so both full and empty paths are exercised
+            internal_pipe p(100, internal_pipe::SINGLE_PRODUCER_CONSUMER);
+            bool ok = false;
+            const tinfra::time_duration t = pipe_run(p, &pipe_produce, ok);
+            CHECK(ok);
+            tinfra::log_info(tinfra::fmt("internal_pipe(spsc, 100 bytes): records=%i time=%ims")
+                % PIPE_RECORDS % t.milliseconds());
+        }
+        {
+            internal_pipe p(internal_pipe::UNLIMITED, internal_pipe::SINGLE_PRODUCER_CONSUMER);
+            bool ok = false;
+            const tinfra::time_duration t = pipe_run(p, &pipe_produce, ok);
+            CHECK(ok);
+            tinfra::log_info(tinfra::fmt("internal_pipe(spsc): records=%i time=%ims")
+                % PIPE_RECORDS % t.milliseconds());
+        }
+        {
+            internal_pipe p(internal_pipe::UNLIMITED, internal_pipe::SINGLE_PRODUCER_CONSUMER);
+            bool ok = false;
+            const tinfra::time_duration t = pipe_run(p, &pipe_produce_chunks, ok);
+            CHECK(ok);
+            tinfra::log_info(tinfra::fmt("internal_pipe(spsc, chunks): records=%i time=%ims")
+                % PIPE_RECORDS % t.milliseconds());
+        }
     }
+#endif
 }
@@ -0,0 +1,256 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/io_engine.h" // we test this
+#include "tinfra/file.h"
+#include "tinfra/tcp_socket.h"
+#include "tinfra/runner.h"
+#include "tinfra/fmt.h"
+
+#include "tinfra/test.h"
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cerrno>
+
+SUITE(tinfra) {
+
+using tinfra::io_engine;
+using tinfra::io_request;
+using tinfra::test::test_fs_sandbox;
+
+typedef std::auto_ptr<io_engine> (*io_engine_factory)();
+
+static std::auto_ptr<io_engine> default_io_engine()     { return tinfra::create_io_engine(16); }
+static std::auto_ptr<io_engine> thread_pool_io_engine() { return tinfra::create_thread_pool_io_engine(16, 2); }
+
+static const io_engine_factory io_engine_factories[] = {
+    &default_io_engine,
+    &thread_pool_io_engine
+};
+
+static void wait_all(io_engine& e)
+{
+    while( e.in_flight() > 0 )
+        e.wait();
+}
+
+struct counting_handler: public tinfra::io_completion_handler {
+    counting_handler(): count(0), bytes(0) {}
+
+    void on_complete(io_request& r)
+    {
+        ++count;
+        if( r.error == 0 )
+            bytes += static_cast<size_t>(r.result);
+    }
+    int    count;
+    size_t bytes;
+};
+
+TEST(io_engine_file_read_write)
+{
+    test_fs_sandbox sandbox;
+    for( size_t k = 0; k < sizeof(io_engine_factories)/sizeof(io_engine_factories[0]); ++k ) {
+        std::auto_ptr<io_engine> e = io_engine_factories[k]();
+        tinfra::file f("data", tinfra::FOM_READ | tinfra::FOM_WRITE | tinfra::FOM_CREATE | tinfra::FOM_TRUNC);
+
+        // batch of writes at offsets, in reverse order
+        const char* parts[] = { "aaaa", "bbbb", "cccc", "dddd" };
+        io_request w[4];
+        for( int i = 3; i >= 0; --i ) {
+            w[i].operation = tinfra::IO_WRITE;
+            w[i].handle = f.native();
+            w[i].data = const_cast<char*>(parts[i]);
+            w[i].size = 4;
+            w[i].offset = i*4;
+            e->prepare(w[i]);
+        }
+        CHECK_EQUAL(4u, e->in_flight());
+        wait_all(*e);
+        int completed = 0;
+        while( io_request* r = e->next_completed() ) {
+            CHECK_EQUAL(0, r->error);
+            CHECK_EQUAL(4, r->result);
+            ++completed;
+        }
+        CHECK_EQUAL(4, completed);
+
+        io_request s;
+        s.operation = tinfra::IO_FSYNC;
+        s.handle = f.native();
+        e->prepare(s);
+        wait_all(*e);
+        CHECK_EQUAL(&s, e->next_completed());
+        CHECK_EQUAL(0, s.error);
+        CHECK_EQUAL("aaaabbbbccccdddd", tinfra::read_file("data"));
+
+        // reads with registered buffers and handler
+        std::vector<char> buffer(16);
+        const tinfra::mutable_buffer registered = { &buffer[0], buffer.size() };
+        e->register_buffers(&registered, 1);
+
+        counting_handler handler;
+        io_request r[2];
+        for( int i = 0; i < 2; ++i ) {
+            r[i].operation = tinfra::IO_READ;
+            r[i].handle = f.native();
+            r[i].data = &buffer[i*8];
+            r[i].size = 8;
+            r[i].offset = 8 - i*8;
+            r[i].buffer_index = 0;
+            r[i].handler = &handler;
+        }
+        e->prepare(r[0]);
+        e->prepare(r[1]);
+        CHECK_EQUAL(2, e->submit());
+        wait_all(*e);
+        CHECK_EQUAL(2, handler.count);
+        CHECK_EQUAL(16u, handler.bytes);
+        CHECK_EQUAL("ccccddddaaaabbbb", std::string(&buffer[0], buffer.size()));
+        CHECK(e->next_completed() == 0);
+        e->register_buffers(0, 0);
+    }
+}
+
+TEST(io_engine_runner)
+{
+    test_fs_sandbox sandbox;
+    tinfra::write_file("data", "0123456789");
+    for( size_t k = 0; k < sizeof(io_engine_factories)/sizeof(io_engine_factories[0]); ++k ) {
+        std::auto_ptr<io_engine> e = io_engine_factories[k]();
+        tinfra::file f("data", tinfra::FOM_READ);
+        char buf[10];
+        counting_handler handler;
+        io_request r;
+        r.operation = tinfra::IO_READ;
+        r.handle = f.native();
+        r.data = buf;
+        r.size = sizeof(buf);
+        r.offset = 0;
+        r.handler = &handler;
+        e->prepare(r);
+
+        tinfra::sequential_runner runner;
+        while( e->in_flight() > 0 )
+            e->wait(runner, 1000);
+        CHECK_EQUAL(1, handler.count);
+        CHECK_EQUAL(10u, handler.bytes);
+        CHECK_EQUAL("0123456789", std::string(buf, sizeof(buf)));
+    }
+}
+
+TEST(io_engine_errors)
+{
+    for( size_t k = 0; k < sizeof(io_engine_factories)/sizeof(io_engine_factories[0]); ++k ) {
+        std::auto_ptr<io_engine> e = io_engine_factories[k]();
+        char buf[4];
+        io_request r;
+        r.operation = tinfra::IO_READ;
+        r.handle = 12345; // not opened
+        r.data = buf;
+        r.size = sizeof(buf);
+        r.offset = 0;
+        e->prepare(r);
+        wait_all(*e);
+        CHECK_EQUAL(&r, e->next_completed());
+        CHECK_EQUAL(EBADF, r.error);
+        CHECK_EQUAL(-1, r.result);
+
+        // nothing in flight, returns immediately
+        CHECK_EQUAL(0, e->wait());
+        CHECK_EQUAL(0, e->wait(0));
+
+        std::vector<io_request> many(e->capacity() + 1);
+        for( size_t i = 0; i < e->capacity(); ++i ) {
+            many[i].operation = tinfra::IO_FSYNC;
+            many[i].handle = 12345;
+            e->prepare(many[i]);
+        }
+        CHECK_THROW(e->prepare(many.back()), std::logic_error);
+        wait_all(*e);
+    }
+}
+
+TEST(io_engine_accept)
+{
+    for( size_t k = 0; k < sizeof(io_engine_factories)/sizeof(io_engine_factories[0]); ++k ) {
+        std::auto_ptr<io_engine> e = io_engine_factories[k]();
+        tinfra::tcp_server_socket server("", 10998);
+        io_request a;
+        a.operation = tinfra::IO_ACCEPT;
+        a.handle = server.handle();
+        e->prepare(a);
+        e->submit();
+
+        // nobody connected yet
+        CHECK_EQUAL(0, e->wait(10));
+
+        tinfra::tcp_client_socket client("localhost", 10998);
+        wait_all(*e);
+        CHECK_EQUAL(&a, e->next_completed());
+        CHECK_EQUAL(0, a.error);
+        CHECK(a.result >= 0);
+        tinfra::client_stream_socket accepted(static_cast<tinfra::socket::handle_type>(a.result));
+
+        client.write("hello", 5);
+        char buf[5];
+        io_request r;
+        r.operation = tinfra::IO_READ;
+        r.handle = accepted.handle();
+        r.data = buf;
+        r.size = sizeof(buf);
+        e->prepare(r);
+        wait_all(*e);
+        CHECK_EQUAL(&r, e->next_completed());
+        CHECK_EQUAL(0, r.error);
+        CHECK(r.result > 0);
+        CHECK_EQUAL(std::string("hello", static_cast<size_t>(r.result)), std::string(buf, static_cast<size_t>(r.result)));
+    }
+}
+
+TEST(io_engine_full_queue)
+{
+    // capacity() requests in flight, prepared in rounds without
+    // explicit submit()
+    test_fs_sandbox sandbox;
+    tinfra::file f("data", tinfra::FOM_READ | tinfra::FOM_WRITE | tinfra::FOM_CREATE | tinfra::FOM_TRUNC);
+    for( size_t k = 0; k < sizeof(io_engine_factories)/sizeof(io_engine_factories[0]); ++k ) {
+        std::auto_ptr<io_engine> e = io_engine_factories[k]();
+        const size_t n = e->capacity();
+        std::string expected;
+        std::vector<std::string> parts(n);
+        std::vector<io_request> requests(n);
+        for( int round = 0; round < 3; ++round ) {
+            expected.clear();
+            for( size_t i = 0; i < n; ++i ) {
+                parts[i] = tinfra::tsprintf("%04i", int(i + round*100));
+                expected += parts[i];
+                requests[i] = io_request();
+                requests[i].operation = tinfra::IO_WRITE;
+                requests[i].handle = f.native();
+                requests[i].data = &parts[i][0];
+                requests[i].size = 4;
+                requests[i].offset = i*4;
+                e->prepare(requests[i]);
+            }
+            CHECK_EQUAL(n, e->in_flight());
+            CHECK_THROW(e->prepare(requests[0]), std::logic_error);
+            wait_all(*e);
+            size_t completed = 0;
+            while( io_request* r = e->next_completed() ) {
+                CHECK_EQUAL(0, r->error);
+                ++completed;
+            }
+            CHECK_EQUAL(n, completed);
+            CHECK_EQUAL(expected, tinfra::read_file("data"));
+        }
+    }
+}
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,220 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/json_document.h" // we test this
+#include "tinfra/json.h"
+#include "tinfra/vtpath.h"
+#include "tinfra/file.h"
+#include "tinfra/fmt.h"
+#include "tinfra/logger.h"
+#include "tinfra/time.h"
+#include "tinfra/thread.h"
+
+#include "tinfra/test.h"
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+SUITE(tinfra) {
+
+using tinfra::json_document;
+using tinfra::json_cursor;
+using tinfra::tstring;
+
+static const char* sample_books =
+    "{ \"owner\": \"Zbyszek\","
+    "  \"books\": ["
+    "    { \"name\": \"Solaris\", \"year\": 1961, \"rating\": 4.5,"
+    "      \"available\": true, \"editions\": [1, 2] },"
+    "    { \"name\": \"Moby \\\"Dick\\\"\", \"year\": 1851, \"rating\": 4,"
+    "      \"available\": false, \"editions\": null }"
+    "  ],"
+    "  \"empty\": {}"
+    "}";
+
+TEST(json_document_navigation)
+{
+    json_document doc(sample_books);
+    json_cursor root = doc.root();
+    CHECK(root.is_object());
+    CHECK_EQUAL(3u, root.size());
+    CHECK_EQUAL("Zbyszek", root["owner"].get_string());
+    CHECK(!root["nonexistent"]);
+    CHECK(!root["nonexistent"]["deeper"]);
+
+    json_cursor books = root["books"];
+    CHECK(books.is_array());
+    CHECK_EQUAL(2u, books.size());
+    CHECK_EQUAL("Solaris", books[0]["name"].get_string());
+    CHECK_EQUAL(1961, books[0]["year"].get_integer());
+    CHECK_EQUAL(4.5, books[0]["rating"].get_double());
+    CHECK_EQUAL(4.0, books[1]["rating"].get_double());
+    CHECK_EQUAL(true, books[0]["available"].get_bool());
+    CHECK_EQUAL(false, books[1]["available"].get_bool());
+    CHECK_EQUAL(2, books[0]["editions"][1].get_integer());
+    CHECK(books[1]["editions"].is_null());
+    CHECK(!books[2]);
+
+    CHECK(root["empty"].is_object());
+    CHECK_EQUAL(0u, root["empty"].size());
+    CHECK(!root["empty"].first());
+
+    CHECK_THROW(root["owner"].get_integer(), std::runtime_error);
+    CHECK_THROW(json_cursor().get_string(), std::runtime_error);
+}
+
+TEST(json_document_iteration)
+{
+    json_document doc(sample_books);
+    std::vector<std::string> keys;
+    for( json_cursor c = doc.root().first(); c; c = c.next() )
+        keys.push_back(c.key().str());
+    CHECK_EQUAL(3u, keys.size());
+    CHECK_EQUAL("owner", keys[0]);
+    CHECK_EQUAL("books", keys[1]);
+    CHECK_EQUAL("empty", keys[2]);
+
+    int count = 0;
+    for( json_cursor c = doc.root()["books"].first(); c; c = c.next() ) {
+        CHECK(c.is_object());
+        CHECK_EQUAL("", c.key());
+        ++count;
+    }
+    CHECK_EQUAL(2, count);
+}
+
+TEST(json_document_unescape)
+{
+    const tstring input("[\"plain\", \"a\\tb\", \"\\u00e9\"]");
+    json_document doc(input);
+    json_cursor root = doc.root();
+    // plain strings point into input
+    CHECK(root[0].get_string().data() == input.data() + 2);
+    CHECK_EQUAL("a\\tb", root[1].raw());
+    CHECK_EQUAL("a\tb", root[1].get_string());
+    CHECK_EQUAL("a\tb", root[1].get_string());
+    CHECK_EQUAL("\xc3\xa9", root[2].get_string());
+
+    json_document keys("{\"a\\\"b\": 1}");
+    CHECK_EQUAL(1, keys.root()["a\"b"].get_integer());
+}
+
+static void* json_document_read_escaped(void* p)
+{
+    json_document const& doc = *static_cast<json_document const*>(p);
+    bool ok = true;
+    for( int i = 0; i < 1000; ++i ) {
+        for( json_cursor c = doc.root().first(); c; c = c.next() )
+            ok = ok && c.key() == "k\tey" && c.get_string() == "v\nalue";
+    }
+    return ok ? p : 0;
+}
+
+TEST(json_document_concurrent_readers)
+{
+    std::string input = "{";
+    for( int i = 0; i < 100; ++i )
+        input += tinfra::tsprintf("%s\"k\\tey\": \"v\\nalue\"", i ? "," : "");
+    input += "}";
+    json_document doc(input);
+
+    tinfra::thread::thread_set ts;
+    for( int i = 0; i < 4; ++i )
+        ts.start(&json_document_read_escaped, &doc);
+    std::vector<void*> results;
+    ts.join(&results);
+    CHECK_EQUAL(4u, results.size());
+    for( size_t i = 0; i < results.size(); ++i )
+        CHECK(results[i] == &doc);
+}
+
+TEST(json_document_to_variant)
+{
+    json_document doc(sample_books);
+    CHECK_EQUAL(tinfra::json_parse(sample_books), doc.root().to_variant());
+}
+
+TEST(json_document_vtpath)
+{
+    json_document doc(sample_books);
+    {
+        std::vector<json_cursor> r = tinfra::vtpath_visit(doc.root(), "$.books[*].name");
+        CHECK_EQUAL(2u, r.size());
+        CHECK_EQUAL("Solaris", r[0].get_string());
+        CHECK_EQUAL("Moby \"Dick\"", r[1].get_string());
+    }
+    {
+        std::vector<json_cursor> r = tinfra::vtpath_visit(doc.root(), "$..year");
+        CHECK_EQUAL(2u, r.size());
+        CHECK_EQUAL(1851, r[1].get_integer());
+    }
+    {
+        std::vector<json_cursor> r = tinfra::vtpath_visit(doc.root(), "$.books.1.name");
+        CHECK_EQUAL(1u, r.size());
+    }
+    CHECK_EQUAL(0u, tinfra::vtpath_visit(doc.root(), "$.foo.bar").size());
+    CHECK_THROW(tinfra::vtpath_visit(doc.root(), "books"), std::runtime_error);
+}
+
+TEST(json_document_errors)
+{
+    CHECK_THROW(json_document(""), std::runtime_error);
+    CHECK_THROW(json_document("[1 2]"), std::runtime_error);
+    CHECK_THROW(json_document("{\"a\" 1}"), std::runtime_error);
+    CHECK_THROW(json_document("{\"a\": 1]"), std::runtime_error);
+    CHECK_THROW(json_document("[1,"), std::runtime_error);
+    CHECK_THROW(json_document("1 2"), std::runtime_error);
+
+    json_document scalar("  \"foo\"  ");
+    CHECK_EQUAL("foo", scalar.root().get_string());
+}
+
+TEST(json_document_load)
+{
+    tinfra::test::test_fs_sandbox sandbox;
+    tinfra::write_file("doc.json", sample_books);
+    json_document doc;
+    doc.load("doc.json");
+    CHECK_EQUAL("Zbyszek", doc.root()["owner"].get_string());
+    CHECK_EQUAL(1851, doc.root()["books"][1]["year"].get_integer());
+
+    CHECK_THROW(doc.load("nonexistent.json"), std::runtime_error);
+}
+
+//
+// benchmark: json_parse vs json_document
+//
+
+TEST(json_document_benchmark)
+{
+    std::string input = "{ \"owner\": \"x\", \"books\": [";
+    for( int i = 0; i < 40000; ++i ) {
+        if( i > 0 )
+            input += ",";
+        input += "{ \"name\": \"some book title\", \"year\": 1961, \"rating\": 4.5,"
+                 "  \"available\": true, \"editions\": [1, 2, 3], \"comment\": \"with \\\"escapes\\\"\" }";
+    }
+    input += "]}";
+
+    tinfra::time_duration parse_time;
+    {
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        tinfra::variant v = tinfra::json_parse(input);
+        parse_time = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("json_parse: bytes=%i time=%ims") % input.size() % parse_time.milliseconds());
+    }
+    {
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        json_document doc(input);
+        const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("json_document: bytes=%i nodes=%i time=%ims") % input.size() % doc.node_count() % t.milliseconds());
+        CHECK_EQUAL(40000u, doc.root()["books"].size());
+    }
+}
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
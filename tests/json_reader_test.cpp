@@ -0,0 +1,210 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/json_reader.h" // we test this
+#include "tinfra/memory_stream.h"
+
+#include "tinfra/test.h"
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+namespace json_reader_test {
+
+struct book {
+    std::string      name;
+    int              year;
+    double           rating;
+    bool             available;
+    std::vector<int> editions;
+
+    TINFRA_MO_MANIFEST(book) {
+        TINFRA_MO_FIELD(name);
+        TINFRA_MO_FIELD(year);
+        TINFRA_MO_FIELD(rating);
+        TINFRA_MO_FIELD(available);
+        TINFRA_MO_FIELD(editions);
+    }
+};
+
+struct library {
+    std::string       owner;
+    std::vector<book> books;
+    tinfra::variant   extra;
+
+    TINFRA_MO_MANIFEST(library) {
+        TINFRA_MO_FIELD(owner);
+        TINFRA_MO_FIELD(books);
+        TINFRA_MO_FIELD(extra);
+    }
+};
+
+} // end namespace json_reader_test
+
+TINFRA_MO_IS_RECORD(json_reader_test::book);
+TINFRA_MO_IS_RECORD(json_reader_test::library);
+
+SUITE(tinfra) {
+
+using tinfra::json_reader;
+using tinfra::json_buffer_lexer;
+using tinfra::json_token;
+using tinfra::tstring;
+
+TEST(json_buffer_lexer_basic)
+{
+    const tstring input("{\"a\": [1, -2.5e3, true, false, null, \"x\\ty\"]}");
+    json_buffer_lexer lexer(input);
+    json_token t;
+    CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::OBJECT_BEGIN, t.type);
+    CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::STRING, t.type);
+    CHECK_EQUAL("a", t.value);
+    // no escapes, value points into input
+    CHECK(t.value.data() == input.data() + 2);
+    CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::COLON, t.type);
+    CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::ARRAY_BEGIN, t.type);
+    CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::INTEGER, t.type);
+    CHECK_EQUAL("1", t.value);
+    CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::COMMA, t.type);
+    CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::DOUBLE, t.type);
+    CHECK_EQUAL("-2.5e3", t.value);
+    CHECK(lexer.fetch_next(t)); CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::TOK_TRUE, t.type);
+    CHECK(lexer.fetch_next(t)); CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::TOK_FALSE, t.type);
+    CHECK(lexer.fetch_next(t)); CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::TOK_NULL, t.type);
+    CHECK(lexer.fetch_next(t)); CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::STRING, t.type);
+    CHECK_EQUAL("x\ty", t.value);
+    CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::ARRAY_END, t.type);
+    CHECK(lexer.fetch_next(t)); CHECK_EQUAL(json_token::OBJECT_END, t.type);
+    CHECK(!lexer.fetch_next(t));
+}
+
+TEST(json_buffer_lexer_unicode_escapes)
+{
+    json_buffer_lexer lexer("\"\\u0041\\u00e9\\u20ac\\ud83d\\ude00\"");
+    json_token t;
+    CHECK(lexer.fetch_next(t));
+    CHECK_EQUAL("A\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", t.value);
+}
+
+TEST(json_reader_events)
+{
+    json_reader reader("{\"a\": [1, 2.5], \"b\": {\"c\": null}, \"d\": \"s\"}");
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::OBJECT_BEGIN, reader.type());
+    CHECK_EQUAL(1, reader.depth());
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::KEY, reader.type());
+    CHECK_EQUAL("a", reader.value());
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::ARRAY_BEGIN, reader.type());
+    CHECK_EQUAL(2, reader.depth());
+    CHECK(reader.next()); CHECK_EQUAL(1, reader.get_integer());
+    CHECK(reader.next()); CHECK_EQUAL(2.5, reader.get_double());
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::ARRAY_END, reader.type());
+    CHECK_EQUAL(1, reader.depth());
+    CHECK(reader.next()); CHECK_EQUAL("b", reader.get_string());
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::OBJECT_BEGIN, reader.type());
+    CHECK(reader.next()); CHECK_EQUAL("c", reader.get_string());
+    CHECK(reader.next()); CHECK(reader.is_null());
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::OBJECT_END, reader.type());
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::KEY, reader.type());
+    CHECK(reader.next()); CHECK_EQUAL("s", reader.get_string());
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::OBJECT_END, reader.type());
+    CHECK_EQUAL(0, reader.depth());
+    CHECK(!reader.next());
+    CHECK(!reader.next());
+}
+
+TEST(json_reader_from_stream)
+{
+    const std::string input = "[true, \"foo\"]";
+    tinfra::memory_input_stream in(input);
+    json_reader reader(in);
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::ARRAY_BEGIN, reader.type());
+    CHECK(reader.next()); CHECK_EQUAL(true, reader.get_bool());
+    CHECK(reader.next()); CHECK_EQUAL("foo", reader.get_string());
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::ARRAY_END, reader.type());
+    CHECK(!reader.next());
+}
+
+TEST(json_reader_skip_value)
+{
+    json_reader reader("{\"skip\": {\"x\": [1, {\"y\": \"\\n\"}], \"z\": []}, \"keep\": 7}");
+    CHECK(reader.next());
+    CHECK(reader.next()); CHECK_EQUAL("skip", reader.value());
+    reader.skip_value();
+    CHECK_EQUAL(json_reader::OBJECT_END, reader.type());
+    CHECK_EQUAL(1, reader.depth());
+    CHECK(reader.next()); CHECK_EQUAL("keep", reader.value());
+    CHECK(reader.next()); CHECK_EQUAL(7, reader.get_integer());
+    CHECK(reader.next()); CHECK_EQUAL(json_reader::OBJECT_END, reader.type());
+    CHECK(!reader.next());
+}
+
+TEST(json_reader_errors)
+{
+    {
+        json_reader reader("[1 2]");
+        CHECK(reader.next());
+        CHECK(reader.next());
+        CHECK_THROW(reader.next(), std::runtime_error);
+    }
+    {
+        json_reader reader("{\"a\" 1}");
+        CHECK(reader.next());
+        CHECK(reader.next());
+        CHECK_THROW(reader.next(), std::runtime_error);
+    }
+    {
+        json_reader reader("[1,");
+        CHECK(reader.next());
+        CHECK(reader.next());
+        CHECK_THROW(reader.next(), std::runtime_error);
+    }
+    {
+        json_reader reader("1 2");
+        CHECK(reader.next());
+        CHECK_THROW(reader.next(), std::runtime_error);
+    }
+    {
+        json_reader reader("\"foo\"");
+        CHECK(reader.next());
+        CHECK_THROW(reader.get_integer(), std::runtime_error);
+    }
+}
+
+TEST(json_read_mo)
+{
+    using json_reader_test::library;
+    library lib;
+    tinfra::json_read(
+        "{ \"owner\": \"Zbyszek\","
+        "  \"unknown\": { \"deep\": [1,2,3] },"
+        "  \"books\": ["
+        "    { \"name\": \"Solaris\", \"year\": 1961, \"rating\": 4.5,"
+        "      \"available\": true, \"editions\": [1, 2] },"
+        "    { \"name\": \"Moby Dick\", \"year\": 1851, \"rating\": 4,"
+        "      \"available\": false, \"editions\": null }"
+        "  ],"
+        "  \"extra\": { \"a\": [1, \"b\"] }"
+        "}", lib);
+    CHECK_EQUAL("Zbyszek", lib.owner);
+    CHECK_EQUAL(2, lib.books.size());
+    CHECK_EQUAL("Solaris", lib.books[0].name);
+    CHECK_EQUAL(1961, lib.books[0].year);
+    CHECK_EQUAL(4.5, lib.books[0].rating);
+    CHECK_EQUAL(true, lib.books[0].available);
+    CHECK_EQUAL(2, lib.books[0].editions.size());
+    CHECK_EQUAL(2, lib.books[0].editions[1]);
+    CHECK_EQUAL("Moby Dick", lib.books[1].name);
+    CHECK_EQUAL(4.0, lib.books[1].rating);
+    CHECK_EQUAL(false, lib.books[1].available);
+    CHECK_EQUAL(0, lib.books[1].editions.size());
+    CHECK(lib.extra.is_dict());
+    CHECK_EQUAL(tinfra::variant(1), lib.extra["a"][0]);
+    CHECK_EQUAL("b", lib.extra["a"][1]);
+}
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
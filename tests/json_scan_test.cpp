@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/json_scan.h" // we test this
+#include "tinfra/json.h"
+#include "tinfra/memory_stream.h"
+#include "tinfra/buffered_stream.h"
+#include "tinfra/stream.h"
+
+#include "tinfra/test.h"
+
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+SUITE(tinfra) {
+
+using tinfra::json_scanner;
+
+/// pseudo-random text with given density of special characters
+static std::string make_scan_input(size_t size, const char* specials, int one_in)
+{
+    std::string result;
+    unsigned seed = 12345;
+    for( size_t i = 0; i < size; ++i ) {
+        seed = seed * 1103515245 + 12345;
+        const unsigned r = (seed >> 16);
+        if( (r % one_in) == 0 )
+            result += specials[r % std::strlen(specials)];
+        else
+            result += static_cast<char>('a' + (r % 26));
+    }
+    return result;
+}
+
+TEST(json_scan_implementations_agree)
+{
+    const json_scanner* scanners = tinfra::json_available_scanners();
+    CHECK_EQUAL("scalar", std::string(scanners[0].name));
+    const json_scanner& scalar = scanners[0];
+
+    const std::string strings = make_scan_input(1000, "\"\\", 40);
+    std::string spaces = make_scan_input(1000, "x{", 50);
+    for( size_t i = 0; i < spaces.size(); ++i )
+        if( spaces[i] >= 'a' && spaces[i] <= 'z' )
+            spaces[i] = " \t\r\n"[spaces[i] % 4];
+
+    for( const json_scanner* s = scanners; s->name != 0; ++s ) {
+        // all start offsets and lengths up to few blocks, to cover
+        // block boundaries and tails
+        for( size_t begin = 0; begin < 70; ++begin ) {
+            for( size_t len = 0; len < 100; ++len ) {
+                const char* b = strings.data() + begin;
+                CHECK( s->find_quote_or_escape(b, b + len) == scalar.find_quote_or_escape(b, b + len) );
+                const char* w = spaces.data() + begin;
+                CHECK( s->skip_whitespace(w, w + len) == scalar.skip_whitespace(w, w + len) );
+            }
+        }
+        // byte with high bit set is not special
+        const char high[] = "\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\xe2\x82\xac\"";
+        CHECK_EQUAL(33, s->find_quote_or_escape(high, high + sizeof(high) - 1) - high);
+        CHECK_EQUAL(0, s->skip_whitespace(high, high + sizeof(high) - 1) - high);
+    }
+}
+
+TEST(json_lexer_long_strings)
+{
+    // strings and whitespace runs longer than scanner blocks and
+    // stream buffer
+    const std::string long_value(200000, 'x');
+    const std::string input = "[\"" + long_value + "\", \"a\\\"" + long_value + "\"," +
+                              std::string(100000, ' ') + "\n\t 1]";
+    {
+        tinfra::variant v = tinfra::json_parse(input);
+        CHECK_EQUAL(3, v.size());
+        CHECK_EQUAL(long_value, v[0].get_string());
+        CHECK_EQUAL("a\"" + long_value, v[1].get_string());
+        CHECK_EQUAL(1, v[2].get_integer());
+    }
+    {
+        tinfra::json_buffer_lexer lexer(input);
+        tinfra::json_token t;
+        CHECK(lexer.fetch_next(t)); CHECK(lexer.fetch_next(t));
+        CHECK_EQUAL(long_value, t.value);
+        CHECK(lexer.fetch_next(t)); CHECK(lexer.fetch_next(t));
+        CHECK_EQUAL("a\"" + long_value, t.value);
+        CHECK(lexer.fetch_next(t)); CHECK(lexer.fetch_next(t));
+        CHECK_EQUAL(tinfra::json_token::INTEGER, t.type);
+        CHECK(lexer.fetch_next(t));
+        CHECK(!lexer.fetch_next(t));
+    }
+}
+
+static void lex_first_object(tinfra::input_stream& in)
+{
+    tinfra::json_lexer lexer(in);
+    tinfra::json_token t;
+    const tinfra::json_token::token_type expected[] = {
+        tinfra::json_token::OBJECT_BEGIN, tinfra::json_token::STRING, tinfra::json_token::COLON,
+        tinfra::json_token::STRING, tinfra::json_token::OBJECT_END };
+    for( size_t i = 0; i < sizeof(expected)/sizeof(expected[0]); ++i ) {
+        CHECK(lexer.fetch_next(t));
+        CHECK_EQUAL(expected[i], t.type);
+        if( i == 3 )
+            CHECK_EQUAL(std::string(1000, 'x'), t.value);
+    }
+}
+
+TEST(json_lexer_leaves_rest_of_stream)
+{
+    // concatenated documents, lexer looks only one byte past value
+    const std::string input = "{ \"a\": \"" + std::string(1000, 'x') + "\" } [2]";
+    {
+        tinfra::memory_input_stream in(input);
+        lex_first_object(in);
+        CHECK_EQUAL("[2]", tinfra::read_all(in));
+    }
+    {
+        // buffered stream is scanned in place, only lexed part is consumed
+        tinfra::memory_input_stream in(input);
+        tinfra::buffered_input_stream buffered(in, 64);
+        lex_first_object(buffered);
+        tinfra::variant second = tinfra::json_parse(buffered);
+        CHECK_EQUAL(2, second[0].get_integer());
+    }
+}
+
+static std::string json_parse_outcome(tinfra::input_stream& in)
+{
+    try {
+        return tinfra::json_parse(in)[0].get_string();
+    } catch( std::runtime_error& ) {
+        return "error";
+    }
+}
+
+TEST(json_lexer_scanned_runs_validated)
+{
+    // plain stream is lexed byte by byte, buffered one by scanner,
+    // they must agree on non-ASCII input
+    const std::string input = "[\"" + std::string(100, 'a') + "\xc4\x85" + std::string(100, 'b') + "\"]";
+    tinfra::memory_input_stream plain(input);
+    tinfra::memory_input_stream in(input);
+    tinfra::buffered_input_stream buffered(in);
+    CHECK_EQUAL(json_parse_outcome(plain), json_parse_outcome(buffered));
+}
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -58,6 +58,18 @@ TEST(json_string_basic)
     CHECK_EQUAL(variant("foo\r\nbar\t\b"), json_parse("\"foo\\r\\nbar\\t\\b\""));
 }
 
+TEST(json_keywords)
+{
+    using tinfra::variant;
+    using tinfra::json_parse;
+    variant r = json_parse("[true, false, null]");
+    CHECK(r[0].is_bool());
+    CHECK_EQUAL(true, r[0].get_bool());
+    CHECK_EQUAL(false, r[1].get_bool());
+    CHECK(r[2].is_none());
+    CHECK_EQUAL("[true,false,null]", tinfra::json_write(r));
+}
+
 TEST(json_string_errors)
 {
     using tinfra::json_parse;
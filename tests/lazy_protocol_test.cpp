@@ -0,0 +1,145 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/lazy_protocol.h" // API under test
+#include "tinfra/protocol_connection.h" // API under test
+
+#include "tinfra/thread.h"
+#include "tinfra/tcp_socket.h"
+#include "tinfra/stream.h"
+
+#include "tinfra/test.h" // test infra
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+using tinfra::tstring;
+using tinfra::tcp_client_socket;
+using tinfra::net::reactor;
+using tinfra::net::protocol_connection;
+
+namespace {
+
+// line protocol: "size\n" header followed by size bytes of body
+class message_protocol: public tinfra::lazy_protocol {
+public:
+    std::vector<std::string> messages;
+
+    message_protocol()
+    {
+        wait_for_delimiter("\r\n", make_step_method(&message_protocol::header));
+    }
+protected:
+    virtual void on_message(tstring const& body)
+    {
+        messages.push_back(body.str());
+    }
+private:
+    int header(tstring const& input)
+    {
+        if( input == "quit" ) {
+            return input.size() + 2;
+        }
+        wait_for_bytes(std::atoi(input.str().c_str()), make_step_method(&message_protocol::body));
+        return input.size() + 2;
+    }
+    int body(tstring const& input)
+    {
+        on_message(input);
+        wait_for_delimiter("\r\n", make_step_method(&message_protocol::header));
+        return input.size();
+    }
+};
+
+class reply_protocol: public message_protocol {
+    protocol_connection& connection_;
+public:
+    reply_protocol(protocol_connection& c): connection_(c) {}
+protected:
+    void on_message(tstring const& body)
+    {
+        connection_.send(body);
+        connection_.send("\n");
+    }
+};
+
+class reply_connection: public protocol_connection {
+    reply_protocol protocol_;
+public:
+    reply_connection(reactor& r, std::auto_ptr<tcp_client_socket> client):
+        protocol_connection(r, client, protocol_, 16),
+        protocol_(*this)
+    {}
+};
+
+class reply_server: public tinfra::net::reactor_server {
+public:
+    void operator()()
+    {
+        run();
+    }
+protected:
+    tinfra::net::reactor_connection* on_accept(reactor& r, std::auto_ptr<tcp_client_socket> client, std::string const&)
+    {
+        return new reply_connection(r, client);
+    }
+};
+
+} // end anonymous namespace
+
+SUITE(tinfra)
+{
+    TEST(lazy_protocol_partial_input)
+    {
+        message_protocol p;
+        const std::string input = "5\r\nhello3\r\nabc";
+        // feed growing prefixes as driver does
+        size_t consumed = 0;
+        for( size_t end = 1; end <= input.size(); ++end ) {
+            while( !p.is_finished() ) {
+                const int r = p.process(tstring(input.data() + consumed, end - consumed));
+                consumed += r;
+                if( p.again_requested() )
+                    break;
+            }
+        }
+        CHECK_EQUAL(input.size(), consumed);
+        CHECK_EQUAL(2u, p.messages.size());
+        CHECK_EQUAL("hello", p.messages[0]);
+        CHECK_EQUAL("abc",   p.messages[1]);
+    }
+
+    TEST(lazy_protocol_finishes)
+    {
+        message_protocol p;
+        CHECK_EQUAL(6, p.process("quit\r\n"));
+        CHECK( p.is_finished() );
+    }
+
+    TEST(protocol_connection_echo)
+    {
+        reply_server server;
+        server.bind("localhost", 10903, 1);
+
+        tinfra::thread::thread_set ts;
+        ts.start(tinfra::runnable_ref(server));
+        {
+            tcp_client_socket client("localhost", 10903);
+            // bigger than initial buffer to force growth
+            const std::string body(100, 'z');
+            tinfra::write_all(client, "2\r\nab");
+            tinfra::write_all(client, tinfra::tsprintf("%i\r\n%s", body.size(), body));
+            tinfra::write_all(client, "quit\r\n");
+            
+            const std::string response = tinfra::read_all(client);
+            CHECK_EQUAL("ab\n" + body + "\n", response);
+        }
+        server.stop();
+        ts.join();
+    }
+}
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
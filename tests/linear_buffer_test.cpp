@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/linear_buffer.h" // API under test
+
+#include "tinfra/test.h" // test infra
+
+#include <cstring>
+
+SUITE(tinfra)
+{
+    using tinfra::linear_buffer;
+    using tinfra::tstring;
+
+    static void append(linear_buffer& b, tstring const& data)
+    {
+        size_t available;
+        char* area = b.prepare(data.size(), available);
+        CHECK( available >= data.size() );
+        std::memcpy(area, data.data(), data.size());
+        b.commit(data.size());
+    }
+
+    TEST(linear_buffer_basic)
+    {
+        linear_buffer b(8, 64);
+        CHECK( b.empty() );
+        CHECK_EQUAL(0u, b.capacity()); // allocated lazily
+
+        append(b, "abc");
+        CHECK_EQUAL("abc", b.readable());
+        b.consume(1);
+        CHECK_EQUAL("bc", b.readable());
+        append(b, "def");
+        CHECK_EQUAL("bcdef", b.readable());
+        b.consume(5);
+        CHECK( b.empty() );
+
+        b.release_if_empty();
+        CHECK_EQUAL(0u, b.capacity());
+    }
+
+    TEST(linear_buffer_compacts_before_growing)
+    {
+        linear_buffer b(8, 64);
+        append(b, "0123456");
+        b.consume(5);
+        append(b, "abcde");
+        CHECK_EQUAL("56abcde", b.readable());
+        CHECK_EQUAL(8u, b.capacity());
+    }
+
+    TEST(linear_buffer_grows_up_to_max)
+    {
+        linear_buffer b(8, 32);
+        append(b, "0123456789");
+        CHECK_EQUAL(16u, b.capacity());
+        append(b, "0123456789");
+        CHECK_EQUAL(32u, b.capacity());
+        CHECK_EQUAL("01234567890123456789", b.readable());
+
+        size_t available;
+        b.prepare(100, available);
+        CHECK_EQUAL(12u, available);
+    }
+}
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
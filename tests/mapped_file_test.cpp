@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/mapped_file.h" // we test this
+#include "tinfra/file.h"
+#include "tinfra/text.h"
+
+#include "tinfra/test.h"
+
+#include <string>
+#include <stdexcept>
+#include <cstring>
+
+SUITE(tinfra) {
+
+using tinfra::mapped_file;
+using tinfra::test::test_fs_sandbox;
+
+TEST(mapped_file_read)
+{
+    test_fs_sandbox sandbox;
+    const std::string content = "line one\nline two\n[1, 2, 3]";
+    tinfra::write_file("a.txt", content);
+    tinfra::write_file("empty", "");
+
+    mapped_file m("a.txt");
+    CHECK(m.is_open());
+    CHECK_EQUAL(content.size(), m.size());
+    CHECK_EQUAL(content, m.content().str());
+    CHECK_THROW(m.writable_data(), std::logic_error);
+    m.advise(tinfra::MFM_RANDOM);
+
+    mapped_file e("empty", tinfra::MFM_READ | tinfra::MFM_POPULATE);
+    CHECK(e.is_open());
+    CHECK_EQUAL(0u, e.size());
+    CHECK(e.content().empty());
+
+    m.close();
+    CHECK(!m.is_open());
+    CHECK_EQUAL(0u, m.size());
+
+    CHECK_THROW(mapped_file("does-not-exist"), std::runtime_error);
+}
+
+TEST(mapped_file_write)
+{
+    test_fs_sandbox sandbox;
+    {
+        mapped_file m;
+        m.open("new", tinfra::MFM_WRITE, 10);
+        CHECK_EQUAL(10u, m.size());
+        std::memcpy(m.writable_data(), "0123456789", 10);
+        m.sync();
+    }
+    CHECK_EQUAL("0123456789", tinfra::read_file("new"));
+    {
+        mapped_file m("new", tinfra::MFM_READ | tinfra::MFM_WRITE);
+        m.writable_data()[0] = 'X';
+    }
+    CHECK_EQUAL("X123456789", tinfra::read_file("new"));
+}
+
+TEST(mapped_input_stream)
+{
+    test_fs_sandbox sandbox;
+    tinfra::write_file("a.txt", "first\nsecond\n\nlast");
+
+    std::auto_ptr<tinfra::input_stream> in = tinfra::create_mapped_input_stream("a.txt");
+    tinfra::line_reader lines(*in);
+    std::string line;
+    CHECK(lines.fetch_next(line)); CHECK_EQUAL("first\n", line);
+    CHECK(lines.fetch_next(line)); CHECK_EQUAL("second\n", line);
+    CHECK(lines.fetch_next(line)); CHECK_EQUAL("\n", line);
+    CHECK(lines.fetch_next(line)); CHECK_EQUAL("last", line);
+    CHECK(!lines.fetch_next(line));
+
+    std::auto_ptr<tinfra::input_stream> in2 = tinfra::create_mapped_input_stream("a.txt");
+    CHECK_EQUAL("first\nsecond\n\nlast", tinfra::read_all(*in2));
+}
+
+#ifdef __linux__
+TEST(mapped_file_procfs)
+{
+    // procfs files report size 0, but have content
+    const std::string status = tinfra::read_file("/proc/self/status");
+    CHECK( status.find("Name:") != std::string::npos );
+
+    mapped_file m("/proc/self/status");
+    CHECK( m.content().str().find("Name:") != std::string::npos );
+}
+#endif
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
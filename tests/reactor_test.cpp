@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/reactor.h" // API under test
+
+#include "tinfra/thread.h"
+#include "tinfra/tcp_socket.h"
+#include "tinfra/stream.h"
+
+#include "tinfra/test.h" // test infra
+
+#include <string>
+
+using tinfra::tcp_client_socket;
+using tinfra::net::reactor;
+using tinfra::net::reactor_connection;
+
+namespace {
+
+class echo_connection: public reactor_connection {
+public:
+    echo_connection(reactor& r, std::auto_ptr<tcp_client_socket> client):
+        reactor_connection(r, client)
+    {}
+
+    void on_readable()
+    {
+        char buf[64];
+        while( true ) {
+            const int r = socket().try_read(buf, sizeof(buf));
+            if( r < 0 )
+                break;
+            if( r == 0 ) {
+                close();
+                return;
+            }
+            pending_.append(buf, r);
+        }
+        flush();
+    }
+
+    void on_writable()
+    {
+        flush();
+    }
+private:
+    void flush()
+    {
+        while( !pending_.empty() ) {
+            const int w = socket().try_write(pending_.data(), pending_.size());
+            if( w < 0 )
+                break;
+            pending_.erase(0, w);
+        }
+    }
+    std::string pending_;
+};
+
+class echo_server: public tinfra::net::reactor_server {
+public:
+    void operator()()
+    {
+        run();
+    }
+protected:
+    reactor_connection* on_accept(reactor& r, std::auto_ptr<tcp_client_socket> client, std::string const&)
+    {
+        return new echo_connection(r, client);
+    }
+};
+
+std::string read_exactly(tcp_client_socket& s, size_t size)
+{
+    std::string result;
+    char buf[64];
+    while( result.size() < size ) {
+        const int r = s.read(buf, std::min(sizeof(buf), size - result.size()));
+        if( r == 0 )
+            break;
+        result.append(buf, r);
+    }
+    return result;
+}
+
+} // end anonymous namespace
+
+SUITE(tinfra)
+{
+    TEST(reactor_server_echo)
+    {
+        echo_server server;
+        server.bind("localhost", 10902, 2);
+        CHECK_EQUAL(2, server.loop_count());
+
+        tinfra::thread::thread_set ts;
+        ts.start(tinfra::runnable_ref(server));
+        {
+            tcp_client_socket a("localhost", 10902);
+            tcp_client_socket b("localhost", 10902);
+
+            tinfra::write_all(a, "hello");
+            tinfra::write_all(b, "world!");
+            CHECK_EQUAL("world!", read_exactly(b, 6));
+            CHECK_EQUAL("hello",  read_exactly(a, 5));
+
+            const std::string big(30000, 'x');
+            tinfra::write_all(a, big);
+            CHECK_EQUAL(big, read_exactly(a, big.size()));
+        }
+        server.stop();
+        ts.join();
+        CHECK(server.stopped());
+    }
+
+    TEST(reactor_stop_before_run)
+    {
+        reactor r;
+        r.stop();
+        r.run();
+        CHECK(r.stopped());
+        CHECK_EQUAL(0u, r.owned_count());
+    }
+}
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
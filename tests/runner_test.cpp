@@ -5,9 +5,16 @@
 
 #include "tinfra/runner.h"
 #include "tinfra/thread_runner.h"
+#include "tinfra/work_stealing_runner.h"
 #include "tinfra/test.h" // for test infra
 
 #include "tinfra/trace.h"
+#include "tinfra/atomic.h"
+#include "tinfra/logger.h"
+#include "tinfra/fmt.h"
+#include "tinfra/time.h"
+
+#include <memory>
 
 SUITE(tinfra) {
     
@@ -120,6 +127,141 @@ SUITE(tinfra) {
             CHECK_EQUAL(job.n, basic_recursive_job::runs);
         }
     }
+    
+    TEST(work_stealing_runner)
+    {
+        tinfra::work_stealing_runner runner(4);
+        CHECK_EQUAL(4, runner.thread_count());
+        
+        basic_recursive_job job;
+        job.parent_runner = &runner;
+        job.n = 120; 
+        {
+            tinfra::thread::synchronizator sss(finish_monitor);
+            basic_recursive_job::runs = 0;
+            basic_recursive_job::finished = 0;
+        }
+        runner(job);
+        runner.wait_idle();
+        {
+            tinfra::thread::synchronizator sss(finish_monitor);
+            CHECK_EQUAL(1, basic_recursive_job::finished);
+            CHECK_EQUAL(job.n, basic_recursive_job::runs);
+        }
+    }
+    
+    struct throwing_job {
+        tinfra::atomic<int>* counter;
+        void operator()()
+        {
+            counter->fetch_add(1, tinfra::MO_RELAXED);
+            throw 42; // not std::exception
+        }
+    };
+    
+    TEST(work_stealing_runner_job_throws)
+    {
+        tinfra::atomic<int> counter(0);
+        tinfra::work_stealing_runner runner(2);
+        throwing_job job;
+        job.counter = &counter;
+        for( int i = 0; i < 10; ++i )
+            runner(job);
+        // failed jobs are also accounted
+        runner.wait_idle();
+        CHECK_EQUAL(10, counter.load());
+    }
+    
+    //
+    // throughput benchmark
+    //
+    
+    struct counting_job {
+        tinfra::atomic<int>* counter;
+        void operator()()
+        {
+            counter->fetch_add(1, tinfra::MO_RELAXED);
+        }
+    };
+    
+    // each job spawns two children until depth is reached,
+    // exercises local submission and stealing
+    struct fork_job {
+        runner*              parent_runner;
+        tinfra::atomic<int>* counter;
+        int                  depth;
+        void operator()()
+        {
+            counter->fetch_add(1, tinfra::MO_RELAXED);
+            if( depth == 0 )
+                return;
+            fork_job child = *this;
+            child.depth = depth - 1;
+            (*parent_runner)(child);
+            (*parent_runner)(child);
+        }
+    };
+    
+    static void run_counting_jobs(runner& r, int count, tinfra::atomic<int>& counter)
+    {
+        counting_job job;
+        job.counter = &counter;
+        for( int i = 0; i < count; ++i ) {
+            r(job);
+        }
+    }
+    
+    TEST(work_stealing_runner_throughput)
+    {
+        const int JOB_COUNT = 20000;
+        const int FORK_DEPTH = 13; // 2^14-1 jobs
+        const int max_threads = tinfra::thread::hardware_concurrency();
+        
+        for( int threads = 1; ; threads *= 2 ) {
+            if( threads > max_threads )
+                threads = max_threads;
+            {
+                tinfra::atomic<int> counter(0);
+                std::auto_ptr<tinfra::static_thread_pool_runner> runner(new tinfra::static_thread_pool_runner(threads));
+                const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+                run_counting_jobs(*runner, JOB_COUNT, counter);
+                // destructor waits for all jobs
+                runner.reset();
+                const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+                CHECK_EQUAL(JOB_COUNT, counter.load());
+                tinfra::log_info(tinfra::fmt("static_thread_pool_runner: threads=%i jobs=%i time=%ims") 
+                    % threads % JOB_COUNT % t.milliseconds());
+            }
+            {
+                tinfra::atomic<int> counter(0);
+                tinfra::work_stealing_runner runner(threads);
+                const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+                run_counting_jobs(runner, JOB_COUNT, counter);
+                runner.wait_idle();
+                const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+                CHECK_EQUAL(JOB_COUNT, counter.load());
+                tinfra::log_info(tinfra::fmt("work_stealing_runner: threads=%i jobs=%i time=%ims") 
+                    % threads % JOB_COUNT % t.milliseconds());
+            }
+            {
+                tinfra::atomic<int> counter(0);
+                tinfra::work_stealing_runner runner(threads);
+                fork_job job;
+                job.parent_runner = &runner;
+                job.counter = &counter;
+                job.depth = FORK_DEPTH;
+                const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+                runner(job);
+                runner.wait_idle();
+                const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+                CHECK_EQUAL((1 << (FORK_DEPTH+1)) - 1, counter.load());
+                tinfra::log_info(tinfra::fmt("work_stealing_runner: threads=%i forked jobs=%i time=%ims") 
+                    % threads % counter.load() % t.milliseconds());
+            }
+            if( threads == max_threads )
+                break;
+        }
+    }
 }
 
 // jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
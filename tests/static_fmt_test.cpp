@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/static_fmt.h" // we test this
+#include "tinfra/fmt.h"
+#include "tinfra/memory_stream.h"
+#include "tinfra/logger.h"
+#include "tinfra/time.h"
+
+#include "tinfra/test.h"
+
+#include <string>
+#include <sstream>
+#include <cstdio>
+
+SUITE(tinfra) {
+
+using tinfra::tsprintf;
+using tinfra::fmt;
+
+enum static_fmt_test_enum { STATIC_FMT_A = 3 };
+
+struct static_fmt_test_point { int x, y; };
+
+static std::ostream& operator<<(std::ostream& out, static_fmt_test_point const& p)
+{
+    return out << p.x << "," << p.y;
+}
+
+TEST(static_fmt_basic)
+{
+    CHECK_EQUAL("", tsprintf(TINFRA_FMT("")));
+    CHECK_EQUAL("a%b", tsprintf(TINFRA_FMT("a%%b")));
+    CHECK_EQUAL("a b c 33", tsprintf(TINFRA_FMT("a %s %s %i"), "b", 'c', 33));
+    CHECK_EQUAL("-1 0 18446744073709551615", tsprintf(TINFRA_FMT("%i %i %i"), -1, 0u, 18446744073709551615ull));
+    CHECK_EQUAL("-9223372036854775808", tsprintf(TINFRA_FMT("%i"), -9223372036854775807LL - 1));
+    CHECK_EQUAL("f ffff ffffffff", tsprintf(TINFRA_FMT("%x %x %x"), 15, 65535, -1));
+    CHECK_EQUAL("   f 0xf00ff00f", tsprintf(TINFRA_FMT("%4x 0x%08x"), 15, 0xf00ff00f));
+    CHECK_EQUAL("  ab 1 0", tsprintf(TINFRA_FMT("%4s %s %s"), std::string("ab"), true, false));
+    CHECK_EQUAL("x y", tsprintf(TINFRA_FMT("%s %s"), tinfra::tstring("x"), static_cast<unsigned char>('y')));
+    CHECK_EQUAL("3 1,2", tsprintf(TINFRA_FMT("%i %s"), STATIC_FMT_A, static_fmt_test_point{1, 2}));
+}
+
+TEST(static_fmt_same_as_fmt)
+{
+    // new engine produces same output as iostream based basic_fmt
+    const double d = 3.14159265358979;
+    CHECK_EQUAL((fmt("%s %.3s %s %s") % d % d % 1e20 % 0.5f).str(),
+                tsprintf(TINFRA_FMT("%s %.3s %s %s"), d, d, 1e20, 0.5f));
+    CHECK_EQUAL((fmt("%08i|%5s|%x") % 42 % "ab" % 255u).str(),
+                tsprintf(TINFRA_FMT("%08i|%5s|%x"), 42, "ab", 255u));
+    char buf[] = "mutable";
+    CHECK_EQUAL((fmt("%s %s") % buf % 'z').str(), tsprintf(TINFRA_FMT("%s %s"), buf, 'z'));
+}
+
+TEST(static_fmt_runtime_format)
+{
+    // tsprintf with runtime format uses same engine
+    CHECK_EQUAL("a 1", tsprintf("a %i", 1));
+    CHECK_THROW(tsprintf("%s%s", 1), tinfra::format_exception);
+    CHECK_THROW(tsprintf("%s", 1, 2), tinfra::format_exception);
+    CHECK_THROW(tsprintf("%l", 1), tinfra::format_exception);
+    CHECK_THROW(tsprintf("BOBO%", 1), tinfra::format_exception);
+}
+
+TEST(static_fmt_buffer)
+{
+    char buf[8];
+    CHECK_EQUAL(5u, tinfra::tsnprintf(buf, sizeof(buf), TINFRA_FMT("%s-%i"), "ab", 12));
+    CHECK_EQUAL("ab-12", std::string(buf));
+    // truncated, but full length returned
+    CHECK_EQUAL(11u, tinfra::tsnprintf(buf, sizeof(buf), TINFRA_FMT("%s %08x"), "ab", 1));
+    CHECK_EQUAL("ab 0000", std::string(buf));
+
+    std::string long_string(2000, 'x');
+    std::string result;
+    tinfra::memory_output_stream out(result);
+    tinfra::tprintf(out, TINFRA_FMT("%i:%s"), 1, long_string);
+    CHECK_EQUAL("1:" + long_string, result);
+
+    std::ostringstream os;
+    tinfra::tprintf(os, TINFRA_FMT("%s=%i"), "a", 2);
+    CHECK_EQUAL("a=2", os.str());
+
+    // appends
+    std::string appended = "x";
+    tinfra::fmt_append(appended, "%s", long_string);
+    CHECK_EQUAL("x" + long_string, appended);
+}
+
+//
+// benchmark: basic_fmt, tsprintf with static format and snprintf
+//
+
+TEST(static_fmt_benchmark)
+{
+    const int N = 100000;
+    size_t total = 0;
+    {
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        for( int i = 0; i < N; ++i )
+            total += (fmt("request %s from %s took %ims, code %x") % i % "host" % (i*3) % 404).str().size();
+        const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("basic_fmt: count=%i time=%ims") % N % t.milliseconds());
+    }
+    {
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        for( int i = 0; i < N; ++i )
+            total -= tsprintf(TINFRA_FMT("request %s from %s took %ims, code %x"), i, "host", i*3, 404).size();
+        const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("tsprintf(TINFRA_FMT): count=%i time=%ims") % N % t.milliseconds());
+    }
+    CHECK_EQUAL(0u, total);
+    {
+        char buf[128];
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        for( int i = 0; i < N; ++i )
+            total += tinfra::tsnprintf(buf, sizeof(buf), TINFRA_FMT("request %s from %s took %ims, code %x"), i, "host", i*3, 404);
+        const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("tsnprintf: count=%i time=%ims") % N % t.milliseconds());
+    }
+    {
+        char buf[128];
+        const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        for( int i = 0; i < N; ++i )
+            total -= std::snprintf(buf, sizeof(buf), "request %i from %s took %ims, code %x", i, "host", i*3, 404);
+        const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+        tinfra::log_info(tinfra::fmt("snprintf: count=%i time=%ims") % N % t.milliseconds());
+    }
+    CHECK_EQUAL(0u, total);
+}
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
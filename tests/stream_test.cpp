@@ -5,12 +5,18 @@
 
 #include "tinfra/file.h"
 #include "tinfra/tcp_socket.h"
+#include "tinfra/fs.h"
 #include <ostream>
 #include <istream>
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <stdexcept>
+#include <algorithm>
+
+#ifdef TINFRA_POSIX
+#include <unistd.h>
+#endif
 
 #include "tinfra/test.h"
 
@@ -18,4 +24,235 @@ SUITE(tinfra)
 {
     // TBD, tests for read_all, write_all
     // memory stream ...
+
+    using tinfra::test::test_fs_sandbox;
+
+    static std::string make_stream_test_content(size_t size)
+    {
+        std::string result;
+        result.reserve(size);
+        for( size_t i = 0; i < size; ++i )
+            result += static_cast<char>('a' + (i * 7 + i / 251) % 26);
+        return result;
+    }
+
+    /// hides real stream type, so stream_copy can't use native copy
+    class opaque_input_stream: public tinfra::input_stream {
+    public:
+        explicit opaque_input_stream(tinfra::input_stream& in): in_(in) {}
+        void close() { in_.close(); }
+        int read(char* dest, int size) { return in_.read(dest, size); }
+    private:
+        tinfra::input_stream& in_;
+    };
+
+    TEST(stream_copy_file_to_file)
+    {
+        test_fs_sandbox sandbox;
+        const std::string content = make_stream_test_content(3*1024*1024 + 17);
+        tinfra::write_file("source", content);
+        {
+            tinfra::file in("source", tinfra::FOM_READ);
+            char skipped[10];
+            CHECK_EQUAL(10, in.read(skipped, sizeof(skipped)));
+
+            // copy continues from current position of input
+            tinfra::file out("dest", tinfra::FOM_WRITE | tinfra::FOM_CREATE | tinfra::FOM_TRUNC);
+            tinfra::stream_copy(in, out);
+            out.close();
+        }
+        CHECK(tinfra::read_file("dest") == content.substr(10));
+
+        tinfra::fs::copy("source", "dest2");
+        CHECK(tinfra::read_file("dest2") == content);
+    }
+
+    TEST(stream_copy_fallback)
+    {
+        test_fs_sandbox sandbox;
+        const std::string content = make_stream_test_content(200000);
+        tinfra::write_file("source", content);
+
+        // file -> memory
+        {
+            tinfra::file in("source", tinfra::FOM_READ);
+            std::string result;
+            std::auto_ptr<tinfra::output_stream> out = tinfra::create_memory_output_stream(result);
+            tinfra::stream_copy(in, *out);
+            CHECK(result == content);
+        }
+        // opaque -> file
+        {
+            tinfra::file in("source", tinfra::FOM_READ);
+            opaque_input_stream opaque(in);
+            tinfra::file out("dest", tinfra::FOM_WRITE | tinfra::FOM_CREATE | tinfra::FOM_TRUNC);
+            tinfra::stream_copy(opaque, out);
+            out.close();
+            CHECK(tinfra::read_file("dest") == content);
+        }
+        // appending output, copy_file_range refuses O_APPEND
+        {
+            tinfra::write_file("dest", "head");
+            tinfra::file in("source", tinfra::FOM_READ);
+            tinfra::file out("dest", tinfra::FOM_WRITE | tinfra::FOM_APPEND);
+            tinfra::stream_copy(in, out);
+            out.close();
+            CHECK(tinfra::read_file("dest") == "head" + content);
+        }
+    }
+
+    /// accepts at most 3 bytes per write(), uses default writev()
+    class slow_output_stream: public tinfra::output_stream {
+    public:
+        explicit slow_output_stream(std::string& out): out_(out), calls(0) {}
+        void close() {}
+        void sync() {}
+        int write(const char* data, int size) {
+            ++calls;
+            const int w = std::min(size, 3);
+            out_.append(data, w);
+            return w;
+        }
+        using tinfra::output_stream::write;
+    private:
+        std::string& out_;
+    public:
+        int calls;
+    };
+
+    TEST(stream_write_all_fragments)
+    {
+        const tinfra::tstring fragments[] = { "HEAD", "", "x", "body of message", "" };
+        std::string result;
+        slow_output_stream slow(result);
+        tinfra::write_all(slow, fragments, 5);
+        CHECK_EQUAL("HEADxbody of message", result);
+
+        // default writev stops at first partial write
+        result.clear();
+        CHECK_EQUAL(3, slow.writev(fragments, 5));
+        CHECK_EQUAL("HEA", result);
+
+        // empty
+        tinfra::write_all(slow, fragments, 0);
+    }
+
+    TEST(file_vectored_io)
+    {
+        test_fs_sandbox sandbox;
+        {
+            tinfra::file f("v", tinfra::FOM_WRITE | tinfra::FOM_CREATE | tinfra::FOM_TRUNC);
+            const tinfra::tstring fragments[] = { "header:", "", "body" };
+            CHECK_EQUAL(11, f.writev(fragments, 3));
+            tinfra::write_all(f, fragments, 3);
+        }
+        CHECK_EQUAL("header:bodyheader:body", tinfra::read_file("v"));
+        {
+            tinfra::file f("v", tinfra::FOM_READ);
+            char a[7], b[100];
+            const tinfra::mutable_buffer buffers[] = { { a, sizeof(a) }, { b, sizeof(b) } };
+            CHECK_EQUAL(22, f.readv(buffers, 2));
+            CHECK_EQUAL("header:", std::string(a, 7));
+            CHECK_EQUAL("bodyheader:body", std::string(b, 15));
+            CHECK_EQUAL(0, f.readv(buffers, 2));
+        }
+    }
+
+    TEST(file_positional_io)
+    {
+        test_fs_sandbox sandbox;
+        // beyond 4GB, file is sparse
+        const tinfra::file::offset_type far = 5LL*1024*1024*1024;
+        {
+            tinfra::file f("p", tinfra::FOM_READ | tinfra::FOM_WRITE | tinfra::FOM_CREATE);
+            f.allocate(0, 4096);
+            f.advise(0, 0, tinfra::FA_RANDOM);
+            tinfra::write_all(f, "0123456789");
+            CHECK_EQUAL(4, f.pwrite("abcd", 4, 2));
+            CHECK_EQUAL(3, f.pwrite("end", 3, far));
+            // file position is not affected
+            CHECK_EQUAL(10, f.seek(0, tinfra::file::SO_CURRENT));
+            CHECK_EQUAL(far + 3, f.seek(0, tinfra::file::SO_END));
+            CHECK_EQUAL(far, f.seek(far));
+
+            char buf[10];
+            CHECK_EQUAL(3, f.pread(buf, 10, far));
+            CHECK_EQUAL("end", std::string(buf, 3));
+            CHECK_EQUAL(6, f.pread(buf, 6, 0));
+            CHECK_EQUAL("01abcd", std::string(buf, 6));
+            CHECK_EQUAL(0, f.pread(buf, 6, far + 3));
+            CHECK_EQUAL(far, f.seek(0, tinfra::file::SO_CURRENT));
+        }
+        CHECK_EQUAL(far + 3, tinfra::fs::stat("p").size);
+    }
+
+    // base_file without native pread/pwrite, failing reads and writes
+    class failing_file: public tinfra::base_file {
+        offset_type pos_;
+    public:
+        failing_file(): pos_(0) {}
+        void close() {}
+        offset_type seek(offset_type pos, seek_origin origin = SO_START) {
+            if( origin == SO_START )
+                pos_ = pos;
+            else if( origin == SO_CURRENT )
+                pos_ += pos;
+            else
+                pos_ = 100 + pos;
+            return pos_;
+        }
+        tinfra::fs::file_info stat() { return tinfra::fs::file_info(); }
+        int read(char*, int) { throw std::runtime_error("read failed"); }
+        int write(const char*, int) { throw std::runtime_error("write failed"); }
+        void sync() {}
+    };
+
+    TEST(base_file_positional_io_restores_position)
+    {
+        failing_file f;
+        f.seek(7);
+        char buf[10];
+        CHECK_THROW(f.pread(buf, 10, 50), std::runtime_error);
+        CHECK_EQUAL(7, f.seek(0, tinfra::base_file::SO_CURRENT));
+        CHECK_THROW(f.pwrite("abc", 3, 60), std::runtime_error);
+        CHECK_EQUAL(7, f.seek(0, tinfra::base_file::SO_CURRENT));
+    }
+
+#ifdef TINFRA_POSIX
+    TEST(stream_copy_pipes)
+    {
+        test_fs_sandbox sandbox;
+        const std::string content = make_stream_test_content(30000); // fits in pipe buffer
+        tinfra::write_file("source", content);
+
+        // file -> pipe
+        {
+            int p[2];
+            CHECK_EQUAL(0, ::pipe(p));
+            tinfra::posix::native_input_stream pipe_in(p[0]);
+            {
+                tinfra::posix::native_output_stream pipe_out(p[1]);
+                tinfra::file in("source", tinfra::FOM_READ);
+                tinfra::stream_copy(in, pipe_out);
+            }
+            CHECK(tinfra::read_all(pipe_in) == content);
+        }
+        // pipe -> file
+        {
+            int p[2];
+            CHECK_EQUAL(0, ::pipe(p));
+            tinfra::posix::native_input_stream pipe_in(p[0]);
+            {
+                tinfra::posix::native_output_stream pipe_out(p[1]);
+                tinfra::write_all(pipe_out, content);
+            }
+            tinfra::file out("dest", tinfra::FOM_WRITE | tinfra::FOM_CREATE | tinfra::FOM_TRUNC);
+            tinfra::stream_copy(pipe_in, out);
+            out.close();
+            CHECK(tinfra::read_file("dest") == content);
+        }
+    }
+#endif
 }
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,186 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "tinfra/string_search.h" // we test this
+#include "tinfra/tstring.h"
+#include "tinfra/fmt.h"
+#include "tinfra/logger.h"
+#include "tinfra/time.h"
+
+#include "tinfra/test.h"
+
+#include <string>
+#include <algorithm>
+#include <cstring>
+
+SUITE(tinfra) {
+
+using tinfra::string_searcher;
+using tinfra::byte_set;
+using tinfra::tstring;
+
+/// pseudo-random text with given density of special characters
+static std::string make_search_input(size_t size, const char* specials, int one_in)
+{
+    std::string result;
+    unsigned seed = 54321;
+    for( size_t i = 0; i < size; ++i ) {
+        seed = seed * 1103515245 + 12345;
+        const unsigned r = (seed >> 16);
+        if( (r % one_in) == 0 )
+            result += specials[r % std::strlen(specials)];
+        else
+            result += static_cast<char>('a' + (r % 26));
+    }
+    return result;
+}
+
+// reference implementations
+
+static const char* naive_find(const char* b, const char* e, const char* needle, size_t n)
+{
+    return std::search(b, e, needle, needle + n);
+}
+
+static const char* naive_find_of(const char* b, const char* e, const char* s, size_t n, bool negate)
+{
+    for( ; b != e; ++b )
+        if( (std::memchr(s, *b, n) != 0) != negate )
+            return b;
+    return e;
+}
+
+static const char* naive_rfind_of(const char* b, const char* e, const char* s, size_t n, bool negate)
+{
+    for( const char* p = e; p != b; ) {
+        --p;
+        if( (std::memchr(s, *p, n) != 0) != negate )
+            return p;
+    }
+    return e;
+}
+
+TEST(string_search_implementations_agree)
+{
+    const string_searcher* searchers = tinfra::string_available_searchers();
+    CHECK_EQUAL("scalar", std::string(searchers[0].name));
+
+    const std::string input = make_search_input(1000, "\xe2\x82\xac,;: \t", 20) + "ab,c";
+    const char* sets[] = {
+        ",",
+        ";: ",
+        "\xe2\x82",
+        "abcdefghijklmnopqrstuvwxy,", // more than 16 bytes
+        "abcdefghijklmnopq"
+    };
+    const char* needles[] = { "ab", "abc", "a,", ", ", ";\xe2\x82", "ab,c", "xyzxyzxyzxyzxyzxyzxyzxyzxyzxyzxyzxyz" };
+    for( const string_searcher* s = searchers; s->name != 0; ++s ) {
+        // all start offsets and lengths up to few blocks, to cover
+        // block boundaries and tails
+        for( size_t begin = 0; begin < 70; ++begin ) {
+            for( size_t len = 0; len < 100; ++len ) {
+                const char* b = input.data() + begin;
+                const char* e = b + len;
+                for( size_t k = 0; k < sizeof(sets)/sizeof(sets[0]); ++k ) {
+                    const byte_set set(sets[k], std::strlen(sets[k]));
+                    for( int negate = 0; negate < 2; ++negate ) {
+                        CHECK( s->find_of(b, e, set, negate) == naive_find_of(b, e, sets[k], std::strlen(sets[k]), negate) );
+                        CHECK( s->rfind_of(b, e, set, negate) == naive_rfind_of(b, e, sets[k], std::strlen(sets[k]), negate) );
+                    }
+                }
+                for( size_t k = 0; k < sizeof(needles)/sizeof(needles[0]); ++k ) {
+                    const size_t n = std::strlen(needles[k]);
+                    CHECK( s->find(b, e, needles[k], n) == naive_find(b, e, needles[k], n) );
+                }
+            }
+        }
+        // match in last possible position of long input
+        const std::string tail = input + "needle";
+        CHECK_EQUAL(input.size(), size_t(s->find(tail.data(), tail.data() + tail.size(), "needle", 6) - tail.data()));
+    }
+}
+
+TEST(string_search_tstring)
+{
+    // longer inputs go through searcher, compare with std::string
+    const std::string input = make_search_input(300, ",;\xff", 30);
+    const tstring t(input);
+    const size_t positions[] = { 0, 1, 17, 100, 299, 300, 301, std::string::npos };
+    const char* params[] = { "", ",", ",;", "\xff", "abcdefghijklmnopqrstuvwxyz", "xyz" };
+    for( size_t i = 0; i < sizeof(positions)/sizeof(positions[0]); ++i ) {
+        const size_t pos = positions[i];
+        for( size_t k = 0; k < sizeof(params)/sizeof(params[0]); ++k ) {
+            const char* p = params[k];
+            if( pos <= input.size() )
+                CHECK_EQUAL(input.find(p, pos), t.find(p, pos));
+            CHECK_EQUAL(input.find_first_of(p, pos), t.find_first_of(p, pos));
+            CHECK_EQUAL(input.find_first_not_of(p, pos), t.find_first_not_of(p, pos));
+            CHECK_EQUAL(input.find_last_of(p, pos), t.find_last_of(p, pos));
+            CHECK_EQUAL(input.find_last_not_of(p, pos), t.find_last_not_of(p, pos));
+        }
+        CHECK_EQUAL(input.find_first_of(';', pos), t.find_first_of(';', pos));
+        CHECK_EQUAL(input.find_first_not_of('a', pos), t.find_first_not_of('a', pos));
+        CHECK_EQUAL(input.find_last_of(';', pos), t.find_last_of(';', pos));
+        CHECK_EQUAL(input.find_last_not_of('a', pos), t.find_last_not_of('a', pos));
+    }
+}
+
+//
+// benchmark: searchers and naive loops on short and long haystacks
+//
+
+static void string_search_benchmark_run(const char* what, std::string const& input, int repeat)
+{
+    const char needle[] = "needle";
+    const char set[] = ",;:";
+    const byte_set bset(set, 3);
+    const char* b = input.data();
+    const char* e = b + input.size();
+
+    for( const string_searcher* s = tinfra::string_available_searchers(); ; ++s ) {
+        const char* name = s->name ? s->name : "naive";
+        size_t found = 0;
+        tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        for( int i = 0; i < repeat; ++i )
+            found += (s->name ? s->find(b, e, needle, 6) : naive_find(b, e, needle, 6)) - b;
+        tinfra::time_duration find_time = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+
+        start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        for( int i = 0; i < repeat; ++i )
+            found += (s->name ? s->find_of(b, e, bset, false) : naive_find_of(b, e, set, 3, false)) - b;
+        tinfra::time_duration find_of_time = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+
+        start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        for( int i = 0; i < repeat; ++i )
+            found += (s->name ? s->find_of(b, e, bset, true) : naive_find_of(b, e, set, 3, true)) - b;
+        tinfra::time_duration find_not_of_time = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+
+        start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+        for( int i = 0; i < repeat; ++i )
+            found += (s->name ? s->rfind_of(b, e, bset, false) : naive_rfind_of(b, e, set, 3, false)) - b;
+        tinfra::time_duration rfind_of_time = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+
+        tinfra::log_info(tinfra::fmt("string_searcher %s %s: bytes=%i repeat=%i find=%ims find_of=%ims find_not_of=%ims rfind_of=%ims (%i)")
+            % name % what % input.size() % repeat
+            % find_time.milliseconds() % find_of_time.milliseconds()
+            % find_not_of_time.milliseconds() % rfind_of_time.milliseconds() % found);
+        if( !s->name )
+            break;
+    }
+}
+
+TEST(string_search_benchmark)
+{
+    // no matches, so whole haystack is scanned
+    const std::string long_input = make_search_input(16*1024*1024, "n", 10);
+    string_search_benchmark_run("long", long_input, 1);
+
+    const std::string short_input = make_search_input(32, "n", 10);
+    string_search_benchmark_run("short", short_input, 500000);
+}
+
+} // end SUITE(tinfra)
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
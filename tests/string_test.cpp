@@ -155,6 +155,61 @@ SUITE(tinfra)
         CHECK_EQUAL("", r[2] );
     }
     
+    TEST(string_split_views)
+    {
+        using std::vector;
+        using tinfra::tstring;
+
+        const char* inputs[] = { "", "a", ",", ",,", "a,b", ",a,,b,", "FIRST,,THIRD,", "a\r", "a\r\n\r\nb\n", "\n\n" };
+        vector<tstring> views;
+        for( size_t i = 0; i < sizeof(inputs)/sizeof(inputs[0]); ++i ) {
+            const tstring in(inputs[i]);
+            vector<std::string> expected = tinfra::split_strict(in, ',');
+            tinfra::split_strict(in, ',', views);
+            CHECK_EQUAL(expected.size(), views.size());
+            for( size_t k = 0; k < expected.size() && k < views.size(); ++k ) {
+                CHECK_EQUAL(expected[k], views[k].str());
+                // views point into input
+                CHECK( views[k].data() >= in.data() && views[k].data() + views[k].size() <= in.data() + in.size() );
+            }
+
+            expected = tinfra::split_skip_empty(in, ',');
+            tinfra::split_skip_empty(in, ',', views);
+            CHECK_EQUAL(expected.size(), views.size());
+            for( size_t k = 0; k < expected.size() && k < views.size(); ++k )
+                CHECK_EQUAL(expected[k], views[k].str());
+
+            expected = tinfra::split_lines(in);
+            tinfra::split_lines(in, views);
+            CHECK_EQUAL(expected.size(), views.size());
+            for( size_t k = 0; k < expected.size() && k < views.size(); ++k )
+                CHECK_EQUAL(expected[k], views[k].str());
+        }
+    }
+
+    struct split_test_counter {
+        size_t count;
+        size_t bytes;
+        void operator()(tinfra::tstring const& s) { count += 1; bytes += s.size(); }
+    };
+
+    TEST(string_split_each)
+    {
+        split_test_counter c = { 0, 0 };
+        c = tinfra::split_strict_each("ab,,cde,", ',', c);
+        CHECK_EQUAL(4u, c.count);
+        CHECK_EQUAL(5u, c.bytes);
+
+        split_test_counter c2 = { 0, 0 };
+        c2 = tinfra::split_skip_empty_each("ab,,cde", ',', c2);
+        CHECK_EQUAL(2u, c2.count);
+
+        split_test_counter c3 = { 0, 0 };
+        c3 = tinfra::split_lines_each("a\r\nbc\n", c3);
+        CHECK_EQUAL(2u, c3.count);
+        CHECK_EQUAL(3u, c3.bytes);
+    }
+
     TEST(string_before_first)
     {
         using tinfra::before_first;
@@ -4,8 +4,16 @@
 //
 
 #include "tinfra/symbol.h"
+#include "tinfra/thread.h"
+#include "tinfra/fmt.h"
+#include "tinfra/logger.h"
+#include "tinfra/time.h"
 #include "tinfra/test.h" // test infra
 
+#include <vector>
+#include <stdexcept>
+#include <string>
+
 using tinfra::symbol;
 
 SUITE(tinfra)
@@ -36,4 +44,110 @@ SUITE(tinfra)
         CHECK( symbol::get("aaaa")   != symbol::null);
         CHECK( symbol::find("aaaa")  != symbol::null);
     }
+
+    static const char* const symbol_test_methods[] = {
+        "GET", "PUT", "POST", "DELETE", "HEAD", "OPTIONS", "TRACE", "CONNECT"
+    };
+
+    TEST(symbol_set_basic)
+    {
+        const tinfra::symbol_set methods(symbol_test_methods);
+        CHECK_EQUAL(8u, methods.size());
+        for( size_t i = 0; i < methods.size(); ++i ) {
+            CHECK_EQUAL((int)i, methods.index_of(symbol_test_methods[i]));
+            CHECK_EQUAL(symbol(symbol_test_methods[i]), methods.find(symbol_test_methods[i]));
+            CHECK_EQUAL(symbol(symbol_test_methods[i]), methods.at(i));
+        }
+        CHECK_EQUAL(-1, methods.index_of("get"));
+        CHECK_EQUAL(-1, methods.index_of(""));
+        CHECK_EQUAL(-1, methods.index_of("GETX"));
+        CHECK_EQUAL(symbol::null, methods.find("PATCH"));
+        // find doesn't create symbols
+        CHECK( symbol::find("PATCH-not-created") == symbol::null );
+        CHECK_EQUAL(symbol::null, methods.find("PATCH-not-created"));
+        CHECK( symbol::find("PATCH-not-created") == symbol::null );
+    }
+
+    TEST(symbol_set_large)
+    {
+        std::vector<std::string> storage;
+        for( int i = 0; i < 500; ++i )
+            storage.push_back(tinfra::tsprintf("field_%i", i));
+        std::vector<const char*> names;
+        for( size_t i = 0; i < storage.size(); ++i )
+            names.push_back(storage[i].c_str());
+
+        const tinfra::symbol_set fields(&names[0], names.size());
+        for( size_t i = 0; i < names.size(); ++i )
+            CHECK_EQUAL((int)i, fields.index_of(names[i]));
+        CHECK_EQUAL(-1, fields.index_of("field_500"));
+
+        const char* const duplicated[] = { "a", "b", "a" };
+        CHECK_THROW(tinfra::symbol_set dup(duplicated), std::logic_error);
+    }
+
+#if TINFRA_THREADS
+    using tinfra::thread::thread_set;
+
+    static const int SYMBOL_BENCH_NAMES = 1000;
+    static const int SYMBOL_BENCH_ROUNDS = 200;
+
+    static std::vector<std::string> symbol_bench_names()
+    {
+        std::vector<std::string> result;
+        for( int i = 0; i < SYMBOL_BENCH_NAMES; ++i )
+            result.push_back(tinfra::tsprintf("symbol_bench_%i", i));
+        return result;
+    }
+
+    static void* symbol_bench_lookup(void* names_)
+    {
+        std::vector<std::string> const& names = *(std::vector<std::string> const*)names_;
+        size_t total = 0;
+        for( int r = 0; r < SYMBOL_BENCH_ROUNDS; ++r ) {
+            for( size_t i = 0; i < names.size(); ++i ) {
+                const symbol s(names[i]);
+                total += s.str().size();
+            }
+        }
+        return (void*)total;
+    }
+
+    TEST(symbol_concurrent_get)
+    {
+        // all threads race to create same symbols, all must get same ids
+        const std::vector<std::string> names = symbol_bench_names();
+        thread_set ts;
+        for( int i = 0; i < 4; ++i )
+            ts.start(&symbol_bench_lookup, (void*)&names);
+        ts.join();
+        for( size_t i = 0; i < names.size(); ++i ) {
+            const symbol s = symbol::find(names[i]);
+            CHECK( s != symbol::null );
+            CHECK_EQUAL(names[i], s.str());
+            CHECK_EQUAL(s, symbol::get(s.id()));
+        }
+    }
+
+    //
+    // benchmark: lookups of existing symbols from N threads
+    //
+
+    TEST(symbol_lookup_benchmark)
+    {
+        const std::vector<std::string> names = symbol_bench_names();
+        symbol_bench_lookup((void*)&names);
+
+        for( int threads = 1; threads <= 8; threads *= 2 ) {
+            const tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+            thread_set ts;
+            for( int i = 0; i < threads; ++i )
+                ts.start(&symbol_bench_lookup, (void*)&names);
+            ts.join();
+            const tinfra::time_duration t = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+            tinfra::log_info(tinfra::fmt("symbol: threads=%i lookups=%i time=%ims")
+                % threads % (threads * SYMBOL_BENCH_NAMES * SYMBOL_BENCH_ROUNDS) % t.milliseconds());
+        }
+    }
+#endif
 }
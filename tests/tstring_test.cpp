@@ -6,6 +6,9 @@
 #include "tinfra/tstring.h"
 #include "tinfra/fmt.h"
 
+#include <vector>
+#include <cstring>
+
 #include "tinfra/test.h" // test infra
 
 using tinfra::fmt;
@@ -236,6 +239,63 @@ SUITE(tinfra)
         }
     }
     
+    TEST(string_pool_arena)
+    {
+        tinfra::string_pool pool(16);
+        std::vector<tstring> strings;
+        for( int i = 0; i < 100; ++i ) {
+            const std::string s(i, char('a' + i % 26));
+            strings.push_back(pool.alloc(s));
+        }
+        // strings stay valid and null terminated when pool grows
+        for( int i = 0; i < 100; ++i ) {
+            CHECK_EQUAL(std::string(i, char('a' + i % 26)), strings[i].str());
+            CHECK( strings[i].is_null_terminated() );
+            CHECK_EQUAL(size_t(i), std::strlen(strings[i].data()));
+        }
+        const std::string big(100000, 'x');
+        CHECK_EQUAL(big, std::string(pool.create(big)));
+
+        // clear() keeps chunks, same workload doesn't allocate
+        const size_t capacity = pool.capacity();
+        for( int k = 0; k < 3; ++k ) {
+            pool.clear();
+            for( int i = 0; i < 100; ++i )
+                CHECK_EQUAL(std::string(i, 'z'), pool.alloc(std::string(i, 'z')).str());
+            pool.create(big);
+            CHECK_EQUAL(capacity, pool.capacity());
+        }
+    }
+
+    TEST(string_pool_intern)
+    {
+        tinfra::string_pool pool;
+        char buf[] = { 'n', 'a', 'm', 'e' };
+        const tstring a = pool.intern(tstring(buf, sizeof(buf)));
+        CHECK_EQUAL("name", a.str());
+        CHECK( a.is_null_terminated() );
+        CHECK( a.data() != buf );
+        CHECK( pool.intern("name").data() == a.data() );
+        CHECK( pool.intern("nam").data() != a.data() );
+        CHECK( pool.intern("").data() == pool.intern("").data() );
+        // alloc always copies
+        CHECK( pool.alloc("name").data() != a.data() );
+
+        // many strings, table grows
+        std::vector<tstring> interned;
+        for( int i = 0; i < 1000; ++i )
+            interned.push_back(pool.intern(tinfra::tsprintf("key%i", i)));
+        for( int i = 0; i < 1000; ++i )
+            CHECK( pool.intern(tinfra::tsprintf("key%i", i)).data() == interned[i].data() );
+        CHECK( pool.intern("name").data() == a.data() );
+
+        // after clear, new copies are made
+        pool.clear();
+        const tstring b = pool.intern("key1");
+        CHECK_EQUAL("key1", b.str());
+        CHECK( pool.intern("key1").data() == b.data() );
+    }
+
     static void foo(tstring const& a)
     {
         std::string x = a.str();
@@ -1,7 +1,13 @@
 #include "tinfra/variant.h" // we test this
+#include "tinfra/fmt.h"
+#include "tinfra/logger.h"
+#include "tinfra/time.h"
 
 #include "tinfra/test.h"
 
+#include <string>
+#include <utility>
+
 SUITE(tinfra) {
 
 using tinfra::variant;
@@ -27,6 +33,15 @@ TEST(variant_variant_compare)
     CHECK_EQUAL(variant(99), variant(99));
     CHECK_EQUAL(variant(1.2), variant(1.2));
     CHECK_EQUAL(variant("aaaabbbbb"), variant("aaaabbbbb")) ;
+    {
+        variant t1, t2, f;
+        t1.set_bool(true);
+        t2.set_bool(true);
+        f.set_bool(false);
+        CHECK_EQUAL(t1, t2);
+        CHECK(!(t1 == f));
+        CHECK(!(t1 == variant(1)));
+    }
 
     // dict
     CHECK_EQUAL(variant::dict(), variant::dict());
@@ -70,4 +85,172 @@ TEST(variant_variant_compare)
     }
 }
 
+TEST(variant_dict_basics)
+{
+    using tinfra::variant_dict;
+    variant_dict d;
+    CHECK(d.empty());
+    d["c"] = variant(3);
+    d["a"] = variant(1);
+    d["b"] = variant(2);
+    CHECK_EQUAL(3u, d.size());
+
+    // iteration is in key order, regardless of insertion order
+    std::string keys;
+    for( variant_dict::const_iterator i = d.begin(); i != d.end(); ++i )
+        keys += i->first;
+    CHECK_EQUAL("abc", keys);
+
+    CHECK( d.find("b") != d.end() );
+    CHECK_EQUAL(2, d.find("b")->second.get_integer());
+    CHECK( d.find("x") == d.end() );
+    CHECK_EQUAL(1u, d.count("a"));
+    CHECK_EQUAL(0u, d.count("x"));
+
+    // insert doesn't overwrite
+    CHECK( !d.insert(std::make_pair(std::string("a"), variant(10))).second );
+    CHECK_EQUAL(1, d["a"].get_integer());
+    std::pair<variant_dict::iterator, bool> r = d.insert(std::make_pair(std::string("aa"), variant(11)));
+    CHECK( r.second );
+    CHECK_EQUAL("aa", r.first->first);
+    CHECK_EQUAL(11, r.first->second.get_integer());
+
+    CHECK_EQUAL(1u, d.erase("b"));
+    CHECK_EQUAL(0u, d.erase("b"));
+    d.erase(d.find("a"));
+    keys.clear();
+    for( variant_dict::iterator i = d.begin(); i != d.end(); ++i )
+        keys += i->first + ",";
+    CHECK_EQUAL("aa,c,", keys);
+
+    variant_dict other;
+    other["z"] = variant(26);
+    d.swap(other);
+    CHECK_EQUAL(1u, d.size());
+    CHECK_EQUAL(26, d["z"].get_integer());
+    CHECK_EQUAL(2u, other.size());
+    CHECK_EQUAL(3, other["c"].get_integer());
+
+    d.clear();
+    CHECK(d.empty());
+    CHECK( d.begin() == d.end() );
+}
+
+TEST(variant_dict_grow)
+{
+    using tinfra::variant_dict;
+    variant_dict d;
+    d.reserve(10);
+    for( int i = 0; i < 1000; ++i )
+        d[tinfra::tsprintf("key%04i", (i * 7) % 1000)] = variant(i);
+    CHECK_EQUAL(1000u, d.size());
+    int n = 0;
+    std::string previous;
+    for( variant_dict::const_iterator i = d.begin(); i != d.end(); ++i, ++n ) {
+        CHECK( previous < i->first );
+        previous = i->first;
+    }
+    CHECK_EQUAL(1000, n);
+
+    // copies are deep
+    variant_dict copy(d);
+    copy["key0001"] = variant("changed");
+    CHECK( d["key0001"].is_integer() );
+    d = copy;
+    CHECK( d["key0001"].is_string() );
+    CHECK_EQUAL(1000u, d.size());
+}
+
+TEST(variant_dict_references_stable)
+{
+    // as with std::map, values don't move when dict grows
+    variant d = variant::dict();
+    variant& a = d["a"];
+    a = variant("value");
+    for( int i = 0; i < 100; ++i )
+        d[tinfra::tsprintf("k%i", i)] = variant(i);
+    d.get_dict().erase("k5");
+    CHECK( a.is_string() );
+    CHECK_EQUAL("value", a.get_string());
+    CHECK( &a == &d["a"] );
+
+    // erased slot is reused, dict stays consistent
+    variant& k6 = d["k6"];
+    d["new"] = variant("new");
+    CHECK_EQUAL(101u, d.size());
+    CHECK( d.get_dict().count("k5") == 0 );
+    CHECK_EQUAL("new", d["new"].get_string());
+    CHECK_EQUAL(6, k6.get_integer());
+    CHECK( &k6 == &d["k6"] );
+
+    // copy is deep and independent
+    variant copy = d;
+    CHECK( copy == d );
+    copy["a"] = variant("changed");
+    CHECK_EQUAL("value", a.get_string());
+}
+
+#ifdef TINFRA_CXX11
+TEST(variant_move_from_child)
+{
+    variant v = variant::dict();
+    v["child"] = variant::dict();
+    v["child"]["x"] = variant(1);
+    v = std::move(v["child"]);
+    CHECK( v.is_dict() );
+    CHECK_EQUAL(1u, v.get_dict().size());
+    CHECK_EQUAL(1, v["x"].get_integer());
+}
+#endif
+
+//
+// benchmark: build, copy and compare large tree
+//
+
+static variant make_benchmark_tree(int count)
+{
+    variant root = variant::dict();
+    variant& items = root["items"];
+    items = variant::array();
+    for( int i = 0; i < count; ++i ) {
+        variant& item = items[i];
+        item = variant::dict();
+        item["id"] = variant(i);
+        item["name"] = variant("item name");
+        item["price"] = variant(1.5 * i);
+        item["available"].set_bool((i % 2) == 0);
+        item["category"] = variant("some category name longer than short string");
+        item["quantity"] = variant(i * 3);
+        item["discount"] = variant(0.1);
+        item["code"] = variant("X-1234");
+        item["tags"] = variant::array();
+        item["tags"][0] = variant("a");
+        item["tags"][1] = variant("b");
+        item["extra"] = variant();
+    }
+    return root;
+}
+
+TEST(variant_benchmark)
+{
+    const int count = 50000;
+    tinfra::time_stamp start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+    variant tree = make_benchmark_tree(count);
+    const tinfra::time_duration build_time = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+
+    variant other = make_benchmark_tree(count);
+
+    start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+    variant copy(tree);
+    const tinfra::time_duration copy_time = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+
+    start = tinfra::time_stamp::now(tinfra::TS_MONOTONIC);
+    CHECK( tree == other );
+    CHECK( tree == copy );
+    const tinfra::time_duration compare_time = tinfra::time_stamp::now(tinfra::TS_MONOTONIC) - start;
+
+    tinfra::log_info(tinfra::fmt("variant: items=%i build=%ims copy=%ims compare=%ims")
+        % count % build_time.milliseconds() % copy_time.milliseconds() % compare_time.milliseconds());
+}
+
 } // end suite tinfra
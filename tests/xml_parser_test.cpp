@@ -0,0 +1,167 @@
+#include "tinfra/xml_parser.h" // we test this
+#include "tinfra/config-pub.h"
+
+#include "tinfra/memory_stream.h"
+#include "tinfra/fmt.h"
+
+#include <tinfra/test.h> // for test infra
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef TINFRA_EXPAT_H
+
+SUITE(tinfra_xml) {
+
+using tinfra::xml_event;
+
+/// memory input stream returning at most chunk bytes at once
+class chunked_input_stream: public tinfra::input_stream {
+    std::string data_;
+    size_t      pos_;
+    size_t      chunk_;
+public:
+    chunked_input_stream(std::string const& data, size_t chunk):
+        data_(data), pos_(0), chunk_(chunk)
+    {}
+    virtual void close() {}
+    virtual int read(char* dest, int size)
+    {
+        const size_t n = std::min(std::min(size_t(size), chunk_), data_.size() - pos_);
+        data_.copy(dest, n, pos_);
+        pos_ += n;
+        return int(n);
+    }
+};
+
+static const char sample_xml[] =
+    "<root a=\"1\" b=\"x y\">"
+    "<item id=\"7\">text &amp; more</item>"
+    "<![CDATA[cd]]>tail"
+    "<item id=\"8\"/>"
+    "</root>";
+
+static void check_sample_events(tinfra::xml_input_stream& in)
+{
+    xml_event ev;
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::START_ELEMENT, ev.type);
+    CHECK_EQUAL("root", ev.content);
+    CHECK_EQUAL(2u, ev.attributes.size());
+    CHECK_EQUAL("a", ev.attributes[0].name);
+    CHECK_EQUAL("1", ev.attributes[0].value);
+    CHECK_EQUAL("b", ev.attributes[1].name);
+    CHECK_EQUAL("x y", ev.attributes[1].value);
+
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::START_ELEMENT, ev.type);
+    CHECK_EQUAL("item", ev.content);
+    CHECK_EQUAL(1u, ev.attributes.size());
+    CHECK_EQUAL("7", ev.attributes[0].value);
+
+    // expat reports text in pieces (split on entities and buffers),
+    // they're coalesced
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::CDATA, ev.type);
+    CHECK_EQUAL("text & more", ev.content);
+    CHECK_EQUAL(0u, ev.attributes.size());
+
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::END_ELEMENT, ev.type);
+    CHECK_EQUAL("item", ev.content);
+
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::CDATA, ev.type);
+    CHECK_EQUAL("cdtail", ev.content);
+
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::START_ELEMENT, ev.type);
+    CHECK_EQUAL("8", ev.attributes[0].value);
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::END_ELEMENT, ev.type);
+
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::END_ELEMENT, ev.type);
+    CHECK_EQUAL("root", ev.content);
+
+    // END is sticky
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::END, ev.type);
+    in.read_into(ev);
+    CHECK_EQUAL(xml_event::END, ev.type);
+}
+
+TEST(xml_parser_basic)
+{
+    tinfra::memory_input_stream input(sample_xml, sizeof(sample_xml)-1, false);
+    std::auto_ptr<tinfra::xml_input_stream> in = tinfra::xml_stream_reader(&input);
+    check_sample_events(*in);
+}
+
+TEST(xml_parser_chunked_input)
+{
+    for( size_t chunk = 1; chunk < 8; ++chunk ) {
+        chunked_input_stream input(sample_xml, chunk);
+        std::auto_ptr<tinfra::xml_input_stream> in = tinfra::xml_stream_reader(&input);
+        check_sample_events(*in);
+    }
+}
+
+TEST(xml_parser_read)
+{
+    tinfra::memory_input_stream input(sample_xml, sizeof(sample_xml)-1, false);
+    std::auto_ptr<tinfra::xml_input_stream> in = tinfra::xml_stream_reader(&input);
+    xml_event ev = in->read();
+    CHECK_EQUAL(xml_event::START_ELEMENT, ev.type);
+    CHECK_EQUAL("root", ev.content);
+    CHECK_EQUAL(2u, ev.attributes.size());
+    CHECK_EQUAL("x y", ev.attributes[1].value);
+    int count = 1;
+    while( in->read().type != xml_event::END )
+        ++count;
+    CHECK_EQUAL(8, count);
+}
+
+TEST(xml_parser_errors)
+{
+    // memory_input_stream keeps view of document, it must outlive reader
+    const std::string document = "<root><a></root>";
+    tinfra::memory_input_stream input(document);
+    std::auto_ptr<tinfra::xml_input_stream> in = tinfra::xml_stream_reader(&input);
+    xml_event ev;
+    CHECK_THROW(in->read_into(ev), std::runtime_error);
+}
+
+TEST(xml_parser_large_document)
+{
+    // many input buffers, events from each are recycled
+    std::string xml = "<root>";
+    for( int i = 0; i < 10000; ++i )
+        xml += tinfra::tsprintf("<item id=\"%i\">value %i</item>\n", i, i);
+    xml += "</root>";
+
+    tinfra::memory_input_stream input(xml);
+    std::auto_ptr<tinfra::xml_input_stream> in = tinfra::xml_stream_reader(&input);
+    xml_event ev;
+    size_t events = 0;
+    int item = 0;
+    for( in->read_into(ev); ev.type != xml_event::END; in->read_into(ev) ) {
+        ++events;
+        if( ev.type == xml_event::START_ELEMENT && ev.content == "item" ) {
+            CHECK_EQUAL(tinfra::tsprintf("%i", item), ev.attributes[0].value.str());
+            in->read_into(ev);
+            ++events;
+            CHECK_EQUAL(xml_event::CDATA, ev.type);
+            CHECK_EQUAL(tinfra::tsprintf("value %i", item), ev.content.str());
+            ++item;
+        }
+    }
+    CHECK_EQUAL(10000, item);
+    // start, cdata, end and newline per item, root start and end
+    CHECK_EQUAL(2u + 10000*4, events);
+}
+
+};
+
+#endif // TINFRA_EXPAT_H
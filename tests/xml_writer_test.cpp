@@ -1,7 +1,11 @@
 #include "tinfra/xml_writer.h" // we test this
 #include "tinfra/xml_builder.h"
+#include "tinfra/buffered_stream.h"
+
+#include "tinfra/fmt.h"
 
 #include <tinfra/test.h> // for test infra
+#include <sstream>
 #include <vector>
 
 SUITE(tinfra_xml) {
@@ -77,4 +81,83 @@ TEST(xml_writer_basic_entities_encoding)
         , sink.str());
 }
 
+static std::string build_large_xml(size_t buffer_size, int items)
+{
+    string_output_stream sink;
+    {
+        tinfra::xml_writer_options options;
+        options.buffer_size = buffer_size;
+
+        std::auto_ptr<tinfra::xml_output_stream> out(tinfra::xml_stream_writer(&sink, options));
+        tinfra::xml_builder xml(*out);
+        xml.start("root");
+        for( int i = 0; i < items; ++i ) {
+            const std::string id = tinfra::tsprintf("%i", i);
+            xml.start("item").attr("id", id).attr("name", "a \"quoted\" & <tagged> name")
+                .cdata("plain text run without any specials, long enough to be copied in blocks")
+                .cdata(i % 2 ? "x < y & y > z" : "")
+            .end();
+        }
+        xml.end();
+    }
+    return sink.str();
+}
+
+TEST(xml_writer_buffering)
+{
+    const std::string expected = build_large_xml(0, 300);
+    CHECK( expected.find("<item id=\"299\" name=\"a &quot;quoted&quot; &amp; &lt;tagged> name\">") != std::string::npos );
+    CHECK( expected.find("x &lt; y &amp; y > z") != std::string::npos );
+    // same output regardless of buffer size, also when pieces don't
+    // fit in buffer
+    CHECK_EQUAL(expected, build_large_xml(1, 300));
+    CHECK_EQUAL(expected, build_large_xml(7, 300));
+    CHECK_EQUAL(expected, build_large_xml(100, 300));
+    CHECK_EQUAL(expected, build_large_xml(64*1024, 300));
+}
+
+TEST(xml_writer_flush)
+{
+    string_output_stream sink;
+    tinfra::xml_writer_options options;
+    options.start_document = false;
+    options.human_readable = false;
+
+    std::auto_ptr<tinfra::xml_output_stream> out(tinfra::xml_stream_writer(&sink, options));
+    {
+        tinfra::xml_builder xml(*out);
+        xml.start("a").attr("b", "c").cdata("d");
+        // incomplete document is buffered until flush
+        CHECK_EQUAL("", sink.str());
+        out->flush();
+        CHECK_EQUAL("<a b=\"c\">d", sink.str());
+        xml.cdata("e");
+        CHECK_EQUAL("<a b=\"c\">d", sink.str());
+        // closing root element flushes
+        xml.end();
+        CHECK_EQUAL("<a b=\"c\">de</a>", sink.str());
+    }
+}
+
+TEST(xml_writer_buffered_target)
+{
+    string_output_stream sink;
+    tinfra::buffered_output_stream buffered(sink);
+    buffered.set_flush_threshold(8);
+    tinfra::xml_writer_options options;
+    options.start_document = false;
+    options.human_readable = false;
+
+    std::auto_ptr<tinfra::xml_output_stream> out(tinfra::xml_stream_writer(&buffered, options));
+    tinfra::xml_builder xml(*out);
+    xml.start("a").attr("b", "c").cdata("d");
+    // output goes straight to buffered stream, which flushes it
+    // according to its own threshold
+    xml.start("e").end();
+    CHECK(sink.str().size() >= 8);
+    xml.end();
+    buffered.flush();
+    CHECK_EQUAL("<a b=\"c\">d<e/></a>", sink.str());
+}
+
 };
@@ -0,0 +1,484 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "async_log_handler.h" // we implement this
+
+#include "tinfra/futex.h"
+#include "tinfra/guard.h"
+#include "tinfra/time.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+
+namespace tinfra {
+
+/// consumer wakes up at least this often, even if nobody woke it
+static const int    ASYNC_LOG_FLUSH_INTERVAL_MS = 100;
+
+/// write batch when it grows above this size
+static const size_t ASYNC_LOG_BATCH_SIZE = 64*1024;
+
+/// entries in ring are aligned to this
+static const size_t ASYNC_LOG_ALIGN = 8;
+
+/// message lines at least this long are written from ring, shorter
+/// ones are copied to batch
+static const size_t ASYNC_LOG_EXTERNAL_LINE = 256;
+
+namespace detail {
+
+/// Record as stored in ring, followed by component and message.
+///
+/// size == 0 marks unused tail of ring, next entry is at ring start.
+struct async_log_entry {
+    size_t      size;
+    int         level;
+    time_t      timestamp;
+    const char* filename;
+    const char* name;
+    int         line;
+    size_t      component_size;
+    size_t      message_size;
+};
+
+/// Single producer, single consumer ring of log entries.
+struct async_log_ring {
+    explicit async_log_ring(size_t c):
+        head(0),
+        tail(0),
+        capacity(c),
+        buffer(new char[c])
+    {}
+    ~async_log_ring() { delete[] buffer; }
+
+    atomic<size_t> head;   // written by logging thread
+    char           pad0[CACHE_LINE_SIZE - sizeof(atomic<size_t>)];
+    atomic<size_t> tail;   // written by consumer
+    char           pad1[CACHE_LINE_SIZE - sizeof(atomic<size_t>)];
+    size_t const   capacity;
+    char* const    buffer;
+};
+
+} // end namespace detail
+
+using detail::async_log_entry;
+
+static size_t align_entry_size(size_t s)
+{
+    return (s + ASYNC_LOG_ALIGN - 1) & ~(ASYNC_LOG_ALIGN - 1);
+}
+
+//
+// thread local ring cache
+//
+
+static atomic<unsigned long> async_log_handler_ids;
+
+static TINFRA_THREAD_LOCAL unsigned long           tls_handler_id = 0;
+static TINFRA_THREAD_LOCAL detail::async_log_ring* tls_ring = 0;
+
+//
+// async_log_handler
+//
+
+async_log_handler::async_log_handler(tinfra::output_stream& out,
+                                     log_overflow_policy policy,
+                                     size_t ring_size):
+    out_(out),
+    policy_(policy),
+    ring_size_(4096),
+    id_(async_log_handler_ids.fetch_add(1) + 1),
+    ring_count_(0),
+    batch_external_size_(0),
+    prefix_time_(static_cast<time_t>(-1)),
+    reported_dropped_(0),
+    reported_truncated_(0),
+    batch_records_(0),
+    dropped_(0),
+    truncated_(0),
+    work_(0),
+    space_(0),
+    written_(0),
+    stopping_(0)
+{
+    while( ring_size_ < ring_size )
+        ring_size_ *= 2;
+    batch_.reserve(ASYNC_LOG_BATCH_SIZE * 2);
+    consumer_ = tinfra::thread::thread::start(&async_log_handler::consumer_thread_func, this);
+}
+
+async_log_handler::~async_log_handler()
+{
+    stopping_.store(1);
+    wake_consumer();
+    consumer_.join();
+    for( std::map<size_t, ring*>::const_iterator i = rings_.begin(); i != rings_.end(); ++i )
+        delete i->second;
+}
+
+unsigned long async_log_handler::dropped() const
+{
+    return dropped_.load(MO_RELAXED);
+}
+
+unsigned long async_log_handler::truncated() const
+{
+    return truncated_.load(MO_RELAXED);
+}
+
+void async_log_handler::log(log_record const& record)
+{
+    ring& r = *current_ring();
+    while( !write_record(r, record) ) {
+        if( policy_ != LOG_OVERFLOW_BLOCK ) {
+            dropped_.fetch_add(1, MO_RELAXED);
+            return;
+        }
+        // mark that we wait and kick consumer; timeout covers
+        // lost wakeups
+        int e = space_.load(MO_RELAXED);
+        if( (e & 1) == 0 && !space_.compare_exchange(e, e | 1) )
+            continue;
+        wake_consumer();
+        futex_wait(space_, e | 1, deadline::relative(time_duration::millisecond(ASYNC_LOG_FLUSH_INTERVAL_MS)));
+    }
+    // consumer parked, wake it; unordered check may miss it, in which
+    // case record waits at most ASYNC_LOG_FLUSH_INTERVAL_MS
+    if( (work_.load(MO_RELAXED) & 1) != 0 )
+        wake_consumer();
+}
+
+void async_log_handler::flush()
+{
+    std::vector<std::pair<ring*, size_t> > marks;
+    {
+        tinfra::guard g(rings_mutex_);
+        for( std::map<size_t, ring*>::const_iterator i = rings_.begin(); i != rings_.end(); ++i )
+            marks.push_back(std::make_pair(i->second, i->second->head.load(MO_ACQUIRE)));
+    }
+    while( true ) {
+        const int e = written_.load(MO_ACQUIRE);
+        bool done = true;
+        for( size_t i = 0; i < marks.size(); ++i ) {
+            if( marks[i].first->tail.load(MO_ACQUIRE) < marks[i].second ) {
+                done = false;
+                break;
+            }
+        }
+        if( done )
+            return;
+        wake_consumer();
+        futex_wait(written_, e, deadline::relative(time_duration::millisecond(ASYNC_LOG_FLUSH_INTERVAL_MS)));
+    }
+}
+
+async_log_handler::ring* async_log_handler::current_ring()
+{
+    if( tls_handler_id == id_ )
+        return tls_ring;
+
+    const size_t thread_number = tinfra::thread::thread::current().to_number();
+    ring* r;
+    {
+        tinfra::guard g(rings_mutex_);
+        std::map<size_t, ring*>::const_iterator i = rings_.find(thread_number);
+        if( i != rings_.end() ) {
+            r = i->second;
+        } else {
+            r = new ring(ring_size_);
+            rings_[thread_number] = r;
+            ring_count_.fetch_add(1, MO_RELEASE);
+        }
+    }
+    tls_handler_id = id_;
+    tls_ring = r;
+    return r;
+}
+
+void async_log_handler::wake_consumer()
+{
+    int e = work_.load(MO_RELAXED);
+    while( !work_.compare_exchange(e, (e | 1) + 1) )
+        ;
+    futex_wake(work_, 1);
+}
+
+bool async_log_handler::write_record(ring& r, log_record const& record)
+{
+    const size_t max_entry = r.capacity / 4;
+    const size_t component_size = std::min(record.component.size(), max_entry / 2);
+    size_t message_size = record.message.size();
+    size_t need = align_entry_size(sizeof(async_log_entry) + component_size + message_size);
+    const bool truncate = need > max_entry;
+    if( truncate ) {
+        // truncate oversized message
+        message_size -= need - max_entry;
+        need = max_entry;
+    }
+
+    size_t head = r.head.load(MO_RELAXED);
+    const size_t tail = r.tail.load(MO_ACQUIRE);
+    const size_t offset = head & (r.capacity - 1);
+    const size_t contiguous = r.capacity - offset;
+    const size_t total = contiguous < need ? contiguous + need : need;
+    if( r.capacity - (head - tail) < total )
+        return false;
+
+    if( contiguous < need ) {
+        // not enough space till end of ring, mark rest as unused
+        reinterpret_cast<async_log_entry*>(r.buffer + offset)->size = 0;
+        head += contiguous;
+    }
+    char* p = r.buffer + (head & (r.capacity - 1));
+    async_log_entry* entry = reinterpret_cast<async_log_entry*>(p);
+    entry->size           = need;
+    entry->level          = record.level;
+    entry->timestamp      = record.timestamp;
+    entry->filename       = record.location.filename;
+    entry->name           = record.location.name;
+    entry->line           = record.location.line;
+    entry->component_size = component_size;
+    entry->message_size   = message_size;
+    p += sizeof(async_log_entry);
+    std::memcpy(p, record.component.data(), component_size);
+    std::memcpy(p + component_size, record.message.data(), message_size);
+
+    r.head.store(head + need, MO_RELEASE);
+    if( truncate )
+        truncated_.fetch_add(1, MO_RELAXED);
+    return true;
+}
+
+//
+// consumer
+//
+
+void* async_log_handler::consumer_thread_func(void* p)
+{
+    static_cast<async_log_handler*>(p)->consumer_main();
+    return 0;
+}
+
+void async_log_handler::consumer_main()
+{
+    while( true ) {
+        if( drain() )
+            continue;
+        if( stopping_.load() != 0 )
+            break;
+
+        int e = work_.load(MO_RELAXED);
+        if( (e & 1) == 0 && !work_.compare_exchange(e, e | 1) )
+            continue;
+        // producers that published before seeing our mark
+        // must be drained before sleeping
+        if( drain() ) {
+            // we're busy, don't let producers wake us
+            int marked = e | 1;
+            work_.compare_exchange(marked, marked + 1);
+            continue;
+        }
+        futex_wait(work_, e | 1, deadline::relative(time_duration::millisecond(ASYNC_LOG_FLUSH_INTERVAL_MS)));
+    }
+    // anything formatted but not written yet
+    write_batch();
+}
+
+bool async_log_handler::drain()
+{
+    if( static_cast<size_t>(ring_count_.load(MO_ACQUIRE)) != consumer_rings_.size() ) {
+        tinfra::guard g(rings_mutex_);
+        consumer_rings_.clear();
+        for( std::map<size_t, ring*>::const_iterator i = rings_.begin(); i != rings_.end(); ++i )
+            consumer_rings_.push_back(i->second);
+    }
+
+    report_dropped();
+
+    // tails are released only after batch is written, so flush()
+    // can rely on them
+    std::vector<std::pair<ring*, size_t> > new_tails;
+    bool any = false;
+    for( std::vector<ring*>::const_iterator i = consumer_rings_.begin(); i != consumer_rings_.end(); ++i ) {
+        ring& r = **i;
+        size_t tail = r.tail.load(MO_RELAXED);
+        const size_t head = r.head.load(MO_ACQUIRE);
+        if( tail == head )
+            continue;
+        while( tail != head ) {
+            const size_t offset = tail & (r.capacity - 1);
+            async_log_entry const* entry = reinterpret_cast<async_log_entry const*>(r.buffer + offset);
+            if( entry->size == 0 ) {
+                tail += r.capacity - offset;
+                continue;
+            }
+            const char* p = r.buffer + offset + sizeof(async_log_entry);
+            source_location location;
+            location.filename = entry->filename;
+            location.name     = entry->name;
+            location.line     = entry->line;
+            format_record(entry->level, entry->timestamp,
+                          tstring(p, entry->component_size),
+                          tstring(p + entry->component_size, entry->message_size),
+                          location, true);
+            tail += entry->size;
+        }
+        new_tails.push_back(std::make_pair(&r, tail));
+        any = true;
+    }
+    if( !any ) {
+        // drop report may be formatted even if rings are empty
+        write_batch();
+        return false;
+    }
+
+    write_batch();
+    for( size_t i = 0; i < new_tails.size(); ++i )
+        new_tails[i].first->tail.store(new_tails[i].second, MO_RELEASE);
+
+    written_.fetch_add(1, MO_RELEASE);
+    futex_wake_all(written_);
+    int e = space_.load(MO_RELAXED);
+    if( (e & 1) != 0 && space_.compare_exchange(e, e + 1) )
+        futex_wake_all(space_);
+    return true;
+}
+
+static void append_number(std::string& out, long v)
+{
+    char buf[32];
+    const int n = std::sprintf(buf, "%li", v);
+    out.append(buf, n);
+}
+
+void async_log_handler::format_record(int level, time_t timestamp,
+                                      tstring const& component, tstring const& message,
+                                      source_location const& location,
+                                      bool message_in_ring)
+{
+    if( timestamp != prefix_time_ ) {
+        prefix_ = log_line_prefix(timestamp);
+        prefix_time_ = timestamp;
+    }
+    // same layout as generic_log_handler
+    // YYYY-MM-DD HH:MM:SS name[pid] level(component::func:source:line): message
+    const size_t header_start = batch_.size();
+    batch_.append(prefix_);
+    batch_.append(log_level_to_string(static_cast<log_level>(level)));
+    if( !component.empty() || location.name != 0 || location.filename != 0 ) {
+        batch_ += '(';
+        if( !component.empty() )
+            batch_.append(component.data(), component.size());
+        if( location.name != 0 ) {
+            if( !component.empty() )
+                batch_.append("::");
+            batch_.append(location.name);
+        }
+        if( location.filename != 0 ) {
+            batch_ += ':';
+            batch_.append(location.filename);
+            batch_ += ':';
+            append_number(batch_, location.line);
+        }
+        batch_ += ')';
+    }
+    batch_.append(": ");
+    const size_t header_size = batch_.size() - header_start;
+
+    // each line of multiline message gets header
+    size_t start = 0;
+    bool first = true;
+    while( start < message.size() ) {
+        size_t eol = message.find_first_of('\n', start);
+        if( eol == tstring::npos )
+            eol = message.size();
+        size_t end = eol;
+        if( end > start && message[end-1] == '\r' )
+            --end;
+        if( end > start ) {
+            if( !first )
+                batch_.append(batch_, header_start, header_size);
+            append_line(message.substr(start, end - start), message_in_ring);
+            first = false;
+        }
+        start = eol + 1;
+    }
+    if( first ) {
+        // empty message, don't leave header
+        batch_.resize(header_start);
+    } else {
+        ++batch_records_;
+    }
+    if( batch_.size() + batch_external_size_ >= ASYNC_LOG_BATCH_SIZE )
+        write_batch();
+}
+
+void async_log_handler::append_line(tstring const& line, bool in_ring)
+{
+    // ring data stays valid until tails are released after write,
+    // so long lines needn't be copied
+    if( in_ring && line.size() >= ASYNC_LOG_EXTERNAL_LINE ) {
+        batch_external_.push_back(std::make_pair(batch_.size(), line));
+        batch_external_size_ += line.size();
+    } else {
+        batch_.append(line.data(), line.size());
+    }
+    batch_ += '\n';
+}
+
+void async_log_handler::report_dropped()
+{
+    if( policy_ != LOG_OVERFLOW_REPORT )
+        return;
+    source_location location = { 0, 0, 0 };
+    char buf[64];
+
+    const unsigned long d = dropped_.load(MO_RELAXED);
+    if( d != reported_dropped_ ) {
+        std::sprintf(buf, "%lu log records dropped", d - reported_dropped_);
+        reported_dropped_ = d;
+        format_record(LL_WARNING, ::time(0), "async_log_handler", buf, location, false);
+    }
+    const unsigned long t = truncated_.load(MO_RELAXED);
+    if( t != reported_truncated_ ) {
+        std::sprintf(buf, "%lu log records truncated", t - reported_truncated_);
+        reported_truncated_ = t;
+        format_record(LL_WARNING, ::time(0), "async_log_handler", buf, location, false);
+    }
+}
+
+void async_log_handler::write_batch()
+{
+    if( batch_.empty() )
+        return;
+    // batch text interleaved with lines from rings
+    std::vector<tstring> fragments;
+    fragments.reserve(batch_external_.size() * 2 + 1);
+    size_t pos = 0;
+    for( size_t i = 0; i < batch_external_.size(); ++i ) {
+        const size_t at = batch_external_[i].first;
+        if( at > pos )
+            fragments.push_back(tstring(batch_.data() + pos, at - pos));
+        fragments.push_back(batch_external_[i].second);
+        pos = at;
+    }
+    fragments.push_back(tstring(batch_.data() + pos, batch_.size() - pos));
+    try {
+        write_all(out_, &fragments[0], fragments.size());
+    } catch( std::exception& ) {
+        // nowhere to log it, just count lost records
+        dropped_.fetch_add(batch_records_, MO_RELAXED);
+    }
+    batch_.clear();
+    batch_external_.clear();
+    batch_external_size_ = 0;
+    batch_records_ = 0;
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
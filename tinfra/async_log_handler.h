@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_async_log_handler_h_included
+#define tinfra_async_log_handler_h_included
+
+#include "logger.h"
+#include "atomic.h"
+#include "mutex.h"
+#include "thread.h"
+
+#include <map>
+#include <vector>
+#include <string>
+
+namespace tinfra {
+
+/// What to do when thread's log ring is full.
+enum log_overflow_policy {
+    /// wait until background thread makes space
+    LOG_OVERFLOW_BLOCK,
+    /// drop record, only count it in dropped()
+    LOG_OVERFLOW_DROP,
+    /// drop record, background thread logs number of dropped records
+    LOG_OVERFLOW_REPORT
+};
+
+namespace detail {
+struct async_log_ring;
+}
+
+/// Log handler that formats and writes records on background thread.
+///
+/// Each logging thread gets its own preallocated ring, log() only
+/// copies record into it and publishes it with one atomic store.
+/// Background thread formats records (caching header prefix per
+/// second) and writes them in large vectored batches: headers are
+/// formatted into batch buffer, long message lines are written
+/// directly from rings with one writev().
+///
+/// Record must fit in quarter of ring, longer messages are truncated.
+/// Truncated records are counted in truncated() and, with
+/// LOG_OVERFLOW_REPORT, reported like dropped ones; use bigger
+/// ring_size for long messages.
+///
+/// Output format is the same as of generic_log_handler. Records from
+/// one thread keep their order, records from different threads may be
+/// reordered.
+///
+/// Rings are kept until handler is destroyed, so it's intended for
+/// long lived threads.
+class async_log_handler: public tinfra::log_handler {
+public:
+    async_log_handler(tinfra::output_stream& out,
+                      log_overflow_policy policy = LOG_OVERFLOW_BLOCK,
+                      size_t ring_size = 64*1024);
+
+    /// Writes all pending records and stops background thread.
+    ~async_log_handler();
+
+    /// Wait until all records logged before this call are written.
+    void          flush();
+
+    /// Number of records dropped because of full ring or write error.
+    unsigned long dropped() const;
+
+    /// Number of records truncated because they didn't fit in ring.
+    unsigned long truncated() const;
+
+private:
+    virtual void log(log_record const& record);
+
+    typedef detail::async_log_ring ring;
+
+    ring*        current_ring();
+    void         wake_consumer();
+    bool         write_record(ring& r, log_record const& record);
+
+    static void* consumer_thread_func(void* p);
+    void         consumer_main();
+    bool         drain();
+    void         format_record(int level, time_t timestamp,
+                               tstring const& component, tstring const& message,
+                               source_location const& location,
+                               bool message_in_ring);
+    void         append_line(tstring const& line, bool in_ring);
+    void         report_dropped();
+    void         write_batch();
+
+    tinfra::output_stream&      out_;
+    log_overflow_policy const   policy_;
+    size_t                      ring_size_;
+    unsigned long const         id_;
+
+    tinfra::mutex               rings_mutex_;
+    std::map<size_t, ring*>     rings_;        // by thread number
+    atomic<int>                 ring_count_;
+
+    // consumer state, touched only by background thread
+    std::vector<ring*>          consumer_rings_;
+    std::string                 batch_;
+    // lines written directly from rings, each inserted at batch_ offset
+    std::vector<std::pair<size_t, tstring> > batch_external_;
+    size_t                      batch_external_size_;
+    time_t                      prefix_time_;
+    std::string                 prefix_;
+    unsigned long               reported_dropped_;
+    unsigned long               reported_truncated_;
+    unsigned long               batch_records_;
+
+    atomic<unsigned long>       dropped_;
+    atomic<unsigned long>       truncated_;
+    atomic<int>                 work_;         // futex, lowest bit: consumer parked
+    atomic<int>                 space_;        // futex, lowest bit: producer waits
+    atomic<int>                 written_;      // futex, bumped after each write
+    atomic<int>                 stopping_;
+
+    tinfra::thread::thread      consumer_;
+
+    // noncopyable
+    async_log_handler(async_log_handler const&);
+    async_log_handler& operator=(async_log_handler const&);
+};
+
+} // end namespace tinfra
+
+#endif // tinfra_async_log_handler_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+//
+// atomic.h
+//   minimal atomic operations for lock-free containers
+//
+//   subset of C++11 std::atomic usable also in C++98 builds,
+//   implemented with GCC __atomic builtins (gcc >= 4.7, clang)
+//
+
+#ifndef tinfra_atomic_h_included
+#define tinfra_atomic_h_included
+
+#include "platform.h"
+
+#if !defined(__GNUC__)
+#error "tinfra/atomic.h: atomic operations not supported on this compiler"
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <xmmintrin.h> // for _mm_pause
+#endif
+
+namespace tinfra {
+
+enum memory_order {
+    MO_RELAXED = __ATOMIC_RELAXED,
+    MO_ACQUIRE = __ATOMIC_ACQUIRE,
+    MO_RELEASE = __ATOMIC_RELEASE,
+    MO_ACQ_REL = __ATOMIC_ACQ_REL,
+    MO_SEQ_CST = __ATOMIC_SEQ_CST
+};
+
+/// Atomic integral or pointer value.
+template <typename T>
+class atomic {
+public:
+    atomic(): value_() {}
+    explicit atomic(T v): value_(v) {}
+
+    T load(memory_order mo = MO_SEQ_CST) const {
+        return __atomic_load_n(&value_, mo);
+    }
+    void store(T v, memory_order mo = MO_SEQ_CST) {
+        __atomic_store_n(&value_, v, mo);
+    }
+    T exchange(T v, memory_order mo = MO_SEQ_CST) {
+        return __atomic_exchange_n(&value_, v, mo);
+    }
+
+    /// Compare and swap.
+    ///
+    /// If current value equals expected, replace it with desired and
+    /// return true, otherwise store current value in expected and
+    /// return false.
+    bool compare_exchange(T& expected, T desired, memory_order mo = MO_SEQ_CST) {
+        return __atomic_compare_exchange_n(&value_, &expected, desired, false, mo, failure_order(mo));
+    }
+
+    /// Weak compare and swap.
+    ///
+    /// May fail spuriously, use in loops.
+    bool compare_exchange_weak(T& expected, T desired, memory_order mo = MO_SEQ_CST) {
+        return __atomic_compare_exchange_n(&value_, &expected, desired, true, mo, failure_order(mo));
+    }
+
+    T fetch_add(T v, memory_order mo = MO_SEQ_CST) {
+        return __atomic_fetch_add(&value_, v, mo);
+    }
+    T fetch_sub(T v, memory_order mo = MO_SEQ_CST) {
+        return __atomic_fetch_sub(&value_, v, mo);
+    }
+
+    /// Raw address, for futex and similar.
+    T volatile* address() { return &value_; }
+private:
+    static int failure_order(memory_order mo) {
+        return mo == MO_ACQ_REL ? MO_ACQUIRE
+             : mo == MO_RELEASE ? MO_RELAXED
+             : mo;
+    }
+    T volatile value_;
+
+    // noncopyable
+    atomic(atomic const&);
+    atomic& operator=(atomic const&);
+};
+
+inline void atomic_thread_fence(memory_order mo)
+{
+    __atomic_thread_fence(mo);
+}
+
+/// Hint CPU that we're spinning.
+inline void cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    _mm_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/// Cache line size assumed for padding of shared counters.
+enum { CACHE_LINE_SIZE = 64 };
+
+} // end namespace tinfra
+
+#endif // tinfra_atomic_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
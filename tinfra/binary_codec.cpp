@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "binary_codec.h"
+
+#include "fmt.h"
+
+#include <stdexcept>
+
+namespace tinfra {
+
+//
+// binary_size_counter
+//
+
+void binary_size_counter::check_length(size_t n, const char* what)
+{
+    if( n > 0xffffffffu )
+        throw std::runtime_error(tsprintf("binary_encode: %s too long (%i)", what, n));
+}
+
+//
+// binary_writer
+//
+
+binary_writer::binary_writer(char* buffer, size_t size):
+    begin_(buffer),
+    pos_(buffer),
+    end_(buffer + size)
+{
+}
+
+void binary_writer::put_bytes(const char* data, size_t size)
+{
+    put_uint32(static_cast<uint32_t>(size));
+    if( size > 0 )
+        std::memcpy(take(size), data, size);
+}
+
+//
+// binary_reader
+//
+
+binary_reader::binary_reader(tstring const& input):
+    begin_(input.data()),
+    pos_(input.data()),
+    end_(input.data() + input.size())
+{
+}
+
+void binary_reader::expect_end() const
+{
+    if( !at_end() )
+        fail("expected end of input after value");
+}
+
+void binary_reader::fail(const char* message) const
+{
+    throw std::runtime_error(tsprintf("binary_decode: %s at offset %i", message, pos_ - begin_));
+}
+
+tstring binary_reader::get_bytes()
+{
+    const size_t size = get_uint32();
+    return tstring(take(size, "string longer than input"), size);
+}
+
+size_t binary_reader::get_count(size_t min_element_size)
+{
+    const size_t count = get_uint32();
+    if( count > size_t(end_ - pos_) / min_element_size )
+        fail("sequence longer than input");
+    return count;
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,573 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_binary_codec_h_included
+#define tinfra_binary_codec_h_included
+
+#include "platform.h"
+#include "mo.h"
+#include "tstring.h"
+#include "assert.h"
+#include "primitive_wrapper.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) \
+    || defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define TINFRA_BINARY_CODEC_LITTLE_ENDIAN
+#endif
+
+namespace tinfra {
+
+/// Binary codec for MO structures.
+///
+/// Compact, length-prefixed wire format for structures declared with
+/// TINFRA_MO_MANIFEST (see mo.h). All numbers are little endian:
+///  - message   - uint32 version chosen by writer, then value
+///  - integers  - fixed width (long is always 64 bits), bool - 1 byte,
+///                float/double - IEEE 754 bits
+///  - strings   - uint32 length, then bytes (std::string and tstring)
+///  - sequences - uint32 element count, then elements
+///  - records   - uint32 byte length, then fields in manifest order
+///
+/// Record length makes format versioned: reader skips fields appended
+/// by newer writer and leaves fields missing in data from older
+/// writer unchanged, so fields may be added only at end of manifest.
+///
+/// Encoder computes exact message size first, so output is allocated
+/// once. Decoder binds tstring fields to input buffer (zero-copy),
+/// they're valid as long as input is. Vectors of numbers are copied
+/// in bulk. Malformed input is reported with std::runtime_error.
+///
+/// Usage:
+/// <pre>
+///   std::string message = binary_encode(request, 2);
+///   ...
+///   request_type request;
+///   const uint32_t version = binary_decode(message, request);
+/// </pre>
+
+/// Exact size of binary_encode() output.
+template <typename T>
+size_t      binary_encoded_size(T const& value);
+
+/// Encode value into new string.
+template <typename T>
+std::string binary_encode(T const& value, uint32_t version = 0);
+
+/// Append encoded value to out.
+template <typename T>
+void        binary_encode(T const& value, std::string& out, uint32_t version = 0);
+
+/// Encode value into buffer of at least binary_encoded_size() bytes.
+///
+/// Returns number of bytes written.
+template <typename T>
+size_t      binary_encode(T const& value, char* buffer, size_t size, uint32_t version = 0);
+
+/// Decode whole message into target, returns message version.
+template <typename T>
+uint32_t    binary_decode(tstring const& input, T& target);
+
+//
+// scalar traits
+//
+
+/// Wire representation of scalar type.
+///
+/// Specialized for builtin numeric types. bulk is set when in-memory
+/// representation equals wire one, so arrays may be copied with
+/// memcpy.
+template <typename T>
+struct binary_scalar_traits {
+    enum { bulk = 0 };
+};
+
+#ifdef TINFRA_BINARY_CODEC_LITTLE_ENDIAN
+#define TINFRA_BINARY_CODEC_BULK(T, W) (sizeof(T) == sizeof(W))
+#else
+#define TINFRA_BINARY_CODEC_BULK(T, W) 0
+#endif
+
+#define TINFRA_BINARY_INTEGER_TRAITS(T, W)                             \
+template <> struct binary_scalar_traits<T> {                           \
+    enum { bulk = TINFRA_BINARY_CODEC_BULK(T, W) };                    \
+    typedef W wire_type;                                               \
+    static wire_type to_wire(T v)   { return static_cast<wire_type>(v); } \
+    static T from_wire(wire_type w) { return static_cast<T>(w); }      \
+}
+
+TINFRA_BINARY_INTEGER_TRAITS(char,               uint8_t);
+TINFRA_BINARY_INTEGER_TRAITS(signed char,        uint8_t);
+TINFRA_BINARY_INTEGER_TRAITS(unsigned char,      uint8_t);
+TINFRA_BINARY_INTEGER_TRAITS(short,              uint16_t);
+TINFRA_BINARY_INTEGER_TRAITS(unsigned short,     uint16_t);
+TINFRA_BINARY_INTEGER_TRAITS(int,                uint32_t);
+TINFRA_BINARY_INTEGER_TRAITS(unsigned int,       uint32_t);
+TINFRA_BINARY_INTEGER_TRAITS(long,               uint64_t);
+TINFRA_BINARY_INTEGER_TRAITS(unsigned long,      uint64_t);
+TINFRA_BINARY_INTEGER_TRAITS(long long,          uint64_t);
+TINFRA_BINARY_INTEGER_TRAITS(unsigned long long, uint64_t);
+
+#undef TINFRA_BINARY_INTEGER_TRAITS
+
+template <> struct binary_scalar_traits<bool> {
+    enum { bulk = 0 };
+    typedef uint8_t wire_type;
+    static wire_type to_wire(bool v)   { return v ? 1 : 0; }
+    static bool from_wire(wire_type w) { return w != 0; }
+};
+
+template <> struct binary_scalar_traits<float> {
+    enum { bulk = TINFRA_BINARY_CODEC_BULK(float, uint32_t) };
+    typedef uint32_t wire_type;
+    static wire_type to_wire(float v)   { wire_type w; std::memcpy(&w, &v, sizeof(w)); return w; }
+    static float from_wire(wire_type w) { float v; std::memcpy(&v, &w, sizeof(v)); return v; }
+};
+
+template <> struct binary_scalar_traits<double> {
+    enum { bulk = TINFRA_BINARY_CODEC_BULK(double, uint64_t) };
+    typedef uint64_t wire_type;
+    static wire_type to_wire(double v)   { wire_type w; std::memcpy(&w, &v, sizeof(w)); return w; }
+    static double from_wire(wire_type w) { double v; std::memcpy(&v, &w, sizeof(v)); return v; }
+};
+
+#undef TINFRA_BINARY_CODEC_BULK
+
+template <typename T>
+struct binary_scalar_traits< primitive_wrapper::integer_wrapper<T> > {
+    typedef binary_scalar_traits<T> base;
+    enum { bulk = 0 };
+    typedef typename base::wire_type wire_type;
+    static wire_type to_wire(primitive_wrapper::integer_wrapper<T> const& v) { return base::to_wire(v); }
+    static primitive_wrapper::integer_wrapper<T> from_wire(wire_type w)     { return base::from_wire(w); }
+};
+
+//
+// codec functors
+//
+
+/// Computes encoded size of value (without message header).
+class binary_size_counter {
+public:
+    binary_size_counter(): size_(0) {}
+
+    template <typename S, typename T>
+    void leaf(S const&, T const&)             { add(sizeof(typename binary_scalar_traits<T>::wire_type)); }
+    template <typename S>
+    void leaf(S const&, std::string const& v) { add_bytes(v.size()); }
+    template <typename S>
+    void leaf(S const&, tstring const& v)     { add_bytes(v.size()); }
+
+    template <typename S, typename T>
+    void record(S const&, T const& v);
+
+    template <typename S, typename T>
+    void sequence(S const&, T const& v);
+
+    size_t size() const { return size_; }
+
+    template <typename T>
+    void add_elements(std::vector<T> const& v);
+    template <typename C>
+    void add_elements(C const& v);
+
+private:
+    void add(size_t n) { size_ += n; }
+    void add_bytes(size_t n) { check_length(n, "string"); add(4 + n); }
+    void check_length(size_t n, const char* what);
+
+    size_t size_;
+};
+
+/// Encodes value into preallocated buffer.
+class binary_writer {
+public:
+    binary_writer(char* buffer, size_t size);
+
+    template <typename S, typename T>
+    void leaf(S const&, T const& v)
+    {
+        typedef binary_scalar_traits<T> traits;
+        put(traits::to_wire(v));
+    }
+    template <typename S>
+    void leaf(S const&, std::string const& v) { put_bytes(v.data(), v.size()); }
+    template <typename S>
+    void leaf(S const&, tstring const& v)     { put_bytes(v.data(), v.size()); }
+
+    template <typename S, typename T>
+    void record(S const&, T const& v);
+
+    template <typename S, typename T>
+    void sequence(S const&, T const& v);
+
+    /// Write uint32 in wire format.
+    void   put_uint32(uint32_t v) { put(v); }
+
+    /// Write bytes as is.
+    void   put_raw(const void* data, size_t size)
+    {
+        if( size > 0 )
+            std::memcpy(take(size), data, size);
+    }
+
+    /// Number of bytes written.
+    size_t written() const { return pos_ - begin_; }
+
+    template <typename T>
+    void put_elements(std::vector<T> const& v);
+    template <typename C>
+    void put_elements(C const& v);
+
+private:
+    char* take(size_t n)
+    {
+        TINFRA_ASSERT(n <= size_t(end_ - pos_));
+        char* r = pos_;
+        pos_ += n;
+        return r;
+    }
+
+    template <typename W>
+    void put(W w);
+
+    void put_bytes(const char* data, size_t size);
+
+    char* begin_;
+    char* pos_;
+    char* end_;
+};
+
+/// Decodes value from memory buffer.
+///
+/// Reads into current record bounds, fields behind record end are
+/// left unchanged.
+class binary_reader {
+public:
+    explicit binary_reader(tstring const& input);
+
+    template <typename S, typename T>
+    void leaf(S const&, T& v)
+    {
+        typedef binary_scalar_traits<T> traits;
+        if( at_end() )
+            return;
+        v = traits::from_wire(get<typename traits::wire_type>());
+    }
+    template <typename S>
+    void leaf(S const&, std::string& v)
+    {
+        if( at_end() )
+            return;
+        const tstring bytes = get_bytes();
+        v.assign(bytes.data(), bytes.size());
+    }
+    template <typename S>
+    void leaf(S const&, tstring& v)
+    {
+        if( at_end() )
+            return;
+        v = get_bytes();
+    }
+
+    template <typename S, typename T>
+    void record(S const&, T& v);
+
+    template <typename S, typename T>
+    void sequence(S const&, T& v);
+
+    /// Read uint32 in wire format.
+    uint32_t get_uint32() { return get<uint32_t>(); }
+
+    /// Read size bytes as is.
+    void     get_raw(void* data, size_t size)
+    {
+        const char* p = take(size, "unexpected end of input");
+        if( size > 0 )
+            std::memcpy(data, p, size);
+    }
+
+    /// True if whole input (or current record) has been read.
+    bool     at_end() const { return pos_ == end_; }
+
+    /// Fail unless whole input has been read.
+    void     expect_end() const;
+
+    template <typename T>
+    void get_elements(std::vector<T>& v, size_t count);
+    template <typename C>
+    void get_elements(C& v, size_t count);
+
+    /// Throw std::runtime_error with current offset.
+    void     fail(const char* message) const;
+
+private:
+    const char* take(size_t n, const char* what)
+    {
+        if( n > size_t(end_ - pos_) )
+            fail(what);
+        const char* r = pos_;
+        pos_ += n;
+        return r;
+    }
+
+    template <typename W>
+    W get();
+
+    tstring get_bytes();
+    size_t  get_count(size_t min_element_size);
+
+    const char* begin_;
+    const char* pos_;
+    const char* end_;
+};
+
+//
+// implementation (templates)
+//
+
+namespace detail {
+
+template <typename W>
+void binary_store(char* p, W w)
+{
+#ifdef TINFRA_BINARY_CODEC_LITTLE_ENDIAN
+    std::memcpy(p, &w, sizeof(w));
+#else
+    for( size_t i = 0; i < sizeof(W); ++i )
+        p[i] = static_cast<char>((w >> (8*i)) & 0xff);
+#endif
+}
+
+template <typename W>
+W binary_load(const char* p)
+{
+    W w;
+#ifdef TINFRA_BINARY_CODEC_LITTLE_ENDIAN
+    std::memcpy(&w, p, sizeof(w));
+#else
+    w = 0;
+    for( size_t i = 0; i < sizeof(W); ++i )
+        w |= static_cast<W>(static_cast<unsigned char>(p[i])) << (8*i);
+#endif
+    return w;
+}
+
+/// Vector element loops, bulk variant copies whole vector at once.
+template <bool Bulk>
+struct binary_vector_codec {
+    template <typename T>
+    static size_t size(binary_size_counter& c, std::vector<T> const& v)
+    {
+        c.add_elements<std::vector<T> >(v);
+        return 0;
+    }
+    template <typename T>
+    static void write(binary_writer& w, std::vector<T> const& v)    { w.put_elements<std::vector<T> >(v); }
+    template <typename T>
+    static void read(binary_reader& r, std::vector<T>& v, size_t n)
+    {
+        // decode in place, without temporary elements
+        v.resize(n);
+        for( size_t i = 0; i < n; ++i ) {
+            if( r.at_end() )
+                r.fail("sequence longer than input");
+            tinfra::mutate(static_cast<const char*>(0), v[i], r);
+        }
+    }
+};
+
+template <>
+struct binary_vector_codec<true> {
+    template <typename T>
+    static size_t size(binary_size_counter&, std::vector<T> const& v) { return v.size() * sizeof(T); }
+    template <typename T>
+    static void write(binary_writer& w, std::vector<T> const& v)
+    {
+        if( !v.empty() )
+            w.put_raw(&v[0], v.size() * sizeof(T));
+    }
+    template <typename T>
+    static void read(binary_reader& r, std::vector<T>& v, size_t n)
+    {
+        v.resize(n);
+        if( n > 0 )
+            r.get_raw(&v[0], n * sizeof(T));
+    }
+};
+
+} // end namespace detail
+
+template <typename S, typename T>
+void binary_size_counter::record(S const&, T const& v)
+{
+    const size_t start = size_;
+    add(4);
+    tinfra::mo_process(v, *this);
+    check_length(size_ - start - 4, "record");
+}
+
+template <typename S, typename T>
+void binary_size_counter::sequence(S const&, T const& v)
+{
+    check_length(v.size(), "sequence");
+    add(4);
+    add_elements(v);
+}
+
+template <typename T>
+void binary_size_counter::add_elements(std::vector<T> const& v)
+{
+    add(detail::binary_vector_codec<binary_scalar_traits<T>::bulk != 0>::size(*this, v));
+}
+
+template <typename C>
+void binary_size_counter::add_elements(C const& v)
+{
+    for( typename C::const_iterator i = v.begin(); i != v.end(); ++i )
+        tinfra::process(static_cast<const char*>(0), *i, *this);
+}
+
+template <typename W>
+void binary_writer::put(W w)
+{
+    detail::binary_store(take(sizeof(W)), w);
+}
+
+template <typename S, typename T>
+void binary_writer::record(S const&, T const& v)
+{
+    char* length = take(4);
+    const size_t start = written();
+    tinfra::mo_process(v, *this);
+    detail::binary_store(length, static_cast<uint32_t>(written() - start));
+}
+
+template <typename S, typename T>
+void binary_writer::sequence(S const&, T const& v)
+{
+    put_uint32(static_cast<uint32_t>(v.size()));
+    put_elements(v);
+}
+
+template <typename T>
+void binary_writer::put_elements(std::vector<T> const& v)
+{
+    detail::binary_vector_codec<binary_scalar_traits<T>::bulk != 0>::write(*this, v);
+}
+
+template <typename C>
+void binary_writer::put_elements(C const& v)
+{
+    for( typename C::const_iterator i = v.begin(); i != v.end(); ++i )
+        tinfra::process(static_cast<const char*>(0), *i, *this);
+}
+
+template <typename W>
+W binary_reader::get()
+{
+    return detail::binary_load<W>(take(sizeof(W), "unexpected end of input"));
+}
+
+template <typename S, typename T>
+void binary_reader::record(S const&, T& v)
+{
+    if( at_end() )
+        return;
+    const uint32_t length = get_uint32();
+    if( length > size_t(end_ - pos_) )
+        fail("record longer than input");
+    const char* record_end = pos_ + length;
+    const char* outer_end = end_;
+    end_ = record_end;
+    tinfra::mo_mutate(v, *this);
+    // skip fields unknown to this reader
+    pos_ = record_end;
+    end_ = outer_end;
+}
+
+template <typename S, typename T>
+void binary_reader::sequence(S const&, T& v)
+{
+    if( at_end() )
+        return;
+    // each element takes at least one byte
+    const size_t count = get_count(1);
+    v.clear();
+    get_elements(v, count);
+}
+
+template <typename T>
+void binary_reader::get_elements(std::vector<T>& v, size_t count)
+{
+    detail::binary_vector_codec<binary_scalar_traits<T>::bulk != 0>::read(*this, v, count);
+}
+
+template <typename C>
+void binary_reader::get_elements(C& v, size_t count)
+{
+    for( size_t i = 0; i < count; ++i ) {
+        if( at_end() )
+            fail("sequence longer than input");
+        typename C::value_type item = typename C::value_type();
+        tinfra::mutate(static_cast<const char*>(0), item, *this);
+        v.insert(v.end(), item);
+    }
+}
+
+template <typename T>
+size_t binary_encoded_size(T const& value)
+{
+    binary_size_counter counter;
+    tinfra::process(static_cast<const char*>(0), value, counter);
+    return 4 + counter.size();
+}
+
+template <typename T>
+size_t binary_encode(T const& value, char* buffer, size_t size, uint32_t version)
+{
+    binary_writer writer(buffer, size);
+    writer.put_uint32(version);
+    tinfra::process(static_cast<const char*>(0), value, writer);
+    return writer.written();
+}
+
+template <typename T>
+void binary_encode(T const& value, std::string& out, uint32_t version)
+{
+    const size_t size = binary_encoded_size(value);
+    const size_t start = out.size();
+    out.resize(start + size);
+    binary_encode(value, &out[start], size, version);
+}
+
+template <typename T>
+std::string binary_encode(T const& value, uint32_t version)
+{
+    std::string result;
+    binary_encode(value, result, version);
+    return result;
+}
+
+template <typename T>
+uint32_t binary_decode(tstring const& input, T& target)
+{
+    binary_reader reader(input);
+    const uint32_t version = reader.get_uint32();
+    if( reader.at_end() )
+        reader.fail("missing value");
+    tinfra::mutate(static_cast<const char*>(0), target, reader);
+    reader.expect_end();
+    return version;
+}
+
+} // end namespace tinfra
+
+#endif // tinfra_binary_codec_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
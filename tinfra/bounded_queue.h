@@ -0,0 +1,307 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_bounded_queue_h_included
+#define tinfra_bounded_queue_h_included
+
+#include "atomic.h"
+#include "futex.h"
+#include "time.h"
+
+#include <cstddef>
+
+namespace tinfra {
+
+/// Bounded lock-free multi-producer multi-consumer queue.
+///
+/// Fixed size ring of cells, each with own sequence number
+/// (D. Vyukov's bounded MPMC queue). No allocation after
+/// construction, try_put() and try_get() are single CAS in common
+/// case.
+///
+/// Blocking put() and get() spin shortly and then park on futex.
+/// Parked thread marks the futex word, so only the first put()/get()
+/// after that pays for wake syscall; when nobody is parked, put() and
+/// get() only check the mark (no fence).
+///
+/// T must be default constructible and assignable. Capacity is
+/// rounded up to power of two.
+template <typename T>
+class bounded_queue {
+public:
+    explicit bounded_queue(size_t capacity);
+    ~bounded_queue();
+
+    /// Put value if there is free space.
+    ///
+    /// Returns false if queue is full.
+    bool try_put(T const& v);
+
+    /// Get value if there is any.
+    ///
+    /// Returns false if queue is empty.
+    bool try_get(T& result);
+
+    /// Put value, block while queue is full.
+    void put(T const& v);
+
+    /// Put value, block while queue is full, but not longer than deadline.
+    ///
+    /// Returns false if deadline passed and value was not put.
+    bool put(T const& v, deadline const& d);
+
+    /// Get value, block while queue is empty.
+    T    get();
+
+    /// Get value, block while queue is empty, but not longer than deadline.
+    ///
+    /// Returns false if deadline passed and nothing was got.
+    bool get(T& result, deadline const& d);
+
+    /// Get up to max values without blocking.
+    ///
+    /// Values are written to out, returns number of values got.
+    template <typename OutputIterator>
+    size_t drain(OutputIterator out, size_t max);
+
+    /// Approximate number of values in queue.
+    size_t size() const;
+    bool   empty() const { return size() == 0; }
+    bool   full() const { return size() == capacity(); }
+    size_t capacity() const { return static_cast<size_t>(mask_) + 1; }
+
+private:
+    struct cell {
+        atomic<size_t> sequence;
+        T              value;
+    };
+
+    /// number of failed attempts before blocking call parks on futex
+    enum { SPIN_COUNT = 32 };
+
+    void notify(atomic<int>& epoch);
+    bool park(atomic<int>& epoch, bool (bounded_queue::*attempt)(T&),
+              bool (bounded_queue::*claimed)() const, T& v, deadline const& d);
+
+    bool try_put_ref(T& v) { return try_put(v); }
+
+    // position based checks used by parking thread, see notify()
+    bool get_claimed() const;
+    bool put_claimed() const;
+
+    // producers and consumers hammer different counters,
+    // keep them in separate cache lines
+    char           pad0_[CACHE_LINE_SIZE];
+    atomic<size_t> enqueue_pos_;
+    char           pad1_[CACHE_LINE_SIZE - sizeof(atomic<size_t>)];
+    atomic<size_t> dequeue_pos_;
+    char           pad2_[CACHE_LINE_SIZE - sizeof(atomic<size_t>)];
+
+    cell*          cells_;
+    size_t         mask_;
+
+    // futex words, lowest bit set means someone is parked
+    atomic<int>    not_empty_;
+    atomic<int>    not_full_;
+
+    // noncopyable
+    bounded_queue(bounded_queue const&);
+    bounded_queue& operator=(bounded_queue const&);
+};
+
+//
+// bounded_queue implementation
+//
+
+template <typename T>
+bounded_queue<T>::bounded_queue(size_t capacity):
+    enqueue_pos_(0),
+    dequeue_pos_(0),
+    not_empty_(0),
+    not_full_(0)
+{
+    size_t c = 2;
+    while( c < capacity )
+        c *= 2;
+    cells_ = new cell[c];
+    mask_ = c - 1;
+    for( size_t i = 0; i < c; ++i )
+        cells_[i].sequence.store(i, MO_RELAXED);
+}
+
+template <typename T>
+bounded_queue<T>::~bounded_queue()
+{
+    delete[] cells_;
+}
+
+template <typename T>
+bool bounded_queue<T>::try_put(T const& v)
+{
+    cell* c;
+    size_t pos = enqueue_pos_.load(MO_RELAXED);
+    while( true ) {
+        c = &cells_[pos & mask_];
+        const size_t seq = c->sequence.load(MO_ACQUIRE);
+        const ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos);
+        if( diff == 0 ) {
+            // seq_cst, see notify()
+            if( enqueue_pos_.compare_exchange_weak(pos, pos + 1, MO_SEQ_CST) )
+                break;
+            // pos reloaded by failed CAS
+        } else if( diff < 0 ) {
+            return false; // full
+        } else {
+            pos = enqueue_pos_.load(MO_RELAXED);
+        }
+    }
+    c->value = v;
+    c->sequence.store(pos + 1, MO_RELEASE);
+    notify(not_empty_);
+    return true;
+}
+
+template <typename T>
+bool bounded_queue<T>::try_get(T& result)
+{
+    cell* c;
+    size_t pos = dequeue_pos_.load(MO_RELAXED);
+    while( true ) {
+        c = &cells_[pos & mask_];
+        const size_t seq = c->sequence.load(MO_ACQUIRE);
+        const ptrdiff_t diff = static_cast<ptrdiff_t>(seq) - static_cast<ptrdiff_t>(pos + 1);
+        if( diff == 0 ) {
+            if( dequeue_pos_.compare_exchange_weak(pos, pos + 1, MO_SEQ_CST) )
+                break;
+        } else if( diff < 0 ) {
+            return false; // empty
+        } else {
+            pos = dequeue_pos_.load(MO_RELAXED);
+        }
+    }
+    result = c->value;
+    c->value = T();
+    c->sequence.store(pos + mask_ + 1, MO_RELEASE);
+    notify(not_full_);
+    return true;
+}
+
+template <typename T>
+void bounded_queue<T>::put(T const& v)
+{
+    put(v, deadline::infinity());
+}
+
+template <typename T>
+bool bounded_queue<T>::put(T const& v, deadline const& d)
+{
+    T tmp(v);
+    return park(not_full_, &bounded_queue::try_put_ref, &bounded_queue::put_claimed, tmp, d);
+}
+
+template <typename T>
+T bounded_queue<T>::get()
+{
+    T result;
+    get(result, deadline::infinity());
+    return result;
+}
+
+template <typename T>
+bool bounded_queue<T>::get(T& result, deadline const& d)
+{
+    return park(not_empty_, &bounded_queue::try_get, &bounded_queue::get_claimed, result, d);
+}
+
+template <typename T>
+template <typename OutputIterator>
+size_t bounded_queue<T>::drain(OutputIterator out, size_t max)
+{
+    size_t count = 0;
+    T v;
+    while( count < max && try_get(v) ) {
+        *out = v;
+        ++out;
+        ++count;
+    }
+    return count;
+}
+
+template <typename T>
+size_t bounded_queue<T>::size() const
+{
+    const size_t d = dequeue_pos_.load(MO_RELAXED);
+    const size_t e = enqueue_pos_.load(MO_RELAXED);
+    const ptrdiff_t n = static_cast<ptrdiff_t>(e - d);
+    if( n < 0 )
+        return 0;
+    if( static_cast<size_t>(n) > capacity() )
+        return capacity();
+    return static_cast<size_t>(n);
+}
+
+template <typename T>
+bool bounded_queue<T>::get_claimed() const
+{
+    // some put() claimed cell, value is about to be published
+    const ptrdiff_t n = static_cast<ptrdiff_t>(enqueue_pos_.load(MO_SEQ_CST) - dequeue_pos_.load(MO_RELAXED));
+    return n > 0;
+}
+
+template <typename T>
+bool bounded_queue<T>::put_claimed() const
+{
+    // some get() claimed cell, it's about to be freed
+    const ptrdiff_t n = static_cast<ptrdiff_t>(enqueue_pos_.load(MO_RELAXED) - dequeue_pos_.load(MO_SEQ_CST));
+    return n < static_cast<ptrdiff_t>(capacity());
+}
+
+template <typename T>
+void bounded_queue<T>::notify(atomic<int>& epoch)
+{
+    // No fence here: position CAS in try_put()/try_get() and this load
+    // are seq_cst, as are marking and *_claimed() check in park(). So
+    // either we see the mark, or parking thread sees claimed position
+    // and doesn't sleep.
+    int e = epoch.load(MO_SEQ_CST);
+    if( (e & 1) == 0 )
+        return;
+    // clear mark and advance epoch, only one notifier wins
+    if( epoch.compare_exchange(e, e + 1, MO_RELEASE) )
+        futex_wake_all(epoch);
+}
+
+template <typename T>
+bool bounded_queue<T>::park(atomic<int>& epoch, bool (bounded_queue::*attempt)(T&),
+                            bool (bounded_queue::*claimed)() const, T& v, deadline const& d)
+{
+    for( int i = 0; i < SPIN_COUNT; ++i ) {
+        if( (this->*attempt)(v) )
+            return true;
+        cpu_relax();
+    }
+    while( true ) {
+        int e = epoch.load(MO_RELAXED);
+        if( (e & 1) == 0 && !epoch.compare_exchange(e, e | 1, MO_SEQ_CST) )
+            continue;
+        atomic_thread_fence(MO_SEQ_CST);
+        if( (this->*attempt)(v) )
+            return true;
+        if( (this->*claimed)() ) {
+            // other side is in the middle of operation, its notify()
+            // may have missed our mark
+            cpu_relax();
+            continue;
+        }
+        if( !futex_wait(epoch, e | 1, d) )
+            return (this->*attempt)(v);
+    }
+}
+
+} // end namespace tinfra
+
+#endif // tinfra_bounded_queue_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
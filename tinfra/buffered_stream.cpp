@@ -1,14 +1,17 @@
 #include "buffered_stream.h"
+#include "trace.h"
 
+#include <stdexcept>
 #include <algorithm>
+#include <cstring>
 
 namespace tinfra {
 
 buffered_input_stream::buffered_input_stream(tinfra::input_stream& target, size_t size):
         target(target),
-        buffer(size),
-        buf_begin(buffer.begin()),
-        buf_end(buffer.begin()),
+        buffer(std::max<size_t>(size, 1)),
+        buf_begin(0),
+        buf_end(0),
         eof_readed(false)
 {
 }
@@ -61,16 +64,50 @@ int buffered_input_stream::read(char* dest, int size)
 void buffered_input_stream::close()
 {
     this->eof_readed = true;
-    this->buf_begin = this->buf_end = this->buffer.begin();
+    this->buf_begin = this->buf_end = 0;
+}
+
+tstring buffered_input_stream::peek(size_t n)
+{
+    while( buf_size() < n ) {
+        if( fill_more() == 0 )
+            break;
+    }
+    return tstring(ptr(buf_begin), std::min(n, buf_size()));
+}
+
+void buffered_input_stream::consume(size_t n)
+{
+    if( n > buf_size() )
+        throw std::logic_error("buffered_input_stream: consume() beyond buffered data");
+    buf_begin += n;
+}
+
+bool buffered_input_stream::read_until(char delimiter, tstring& result)
+{
+    size_t scanned = 0;
+    while( true ) {
+        const char* begin = ptr(buf_begin);
+        const size_t available = buf_size();
+        const void* found = std::memchr(begin + scanned, delimiter, available - scanned);
+        if( found != 0 ) {
+            const size_t record_size = static_cast<const char*>(found) - begin + 1;
+            result = tstring(begin, record_size);
+            buf_begin += record_size;
+            return true;
+        }
+        scanned = available;
+        if( fill_more() == 0 ) {
+            if( available == 0 )
+                return false;
+            // last record without delimiter
+            result = tstring(ptr(buf_begin), available);
+            buf_begin = buf_end;
+            return true;
+        }
+    }
 }
-/* inline
-char*   ptr(buffer_t::iterator i ) { return & (*i); }
-char*   ptr(size_t idx)            { return & ( this->buffer[idx] ); }
 
-char*   ptr()   const { return & (*buf_begin); }
-bool    buf_empty() const { return buf_begin == buf_end; }
-size_t  buf_size()  const { return buf_end - buf_begin; }
-*/
 size_t buffered_input_stream::consume_buffer(char* dest, size_t size)
 {
     const size_t consumed_size = std::min(buf_size(), size);
@@ -87,12 +124,12 @@ bool  buffered_input_stream::fill_buffer()
     if( eof_readed ) 
         return ! this->buf_empty(); 
     
-    if( this->buf_begin != this->buffer.begin() ) {
+    if( this->buf_begin != 0 ) {
         if (initial_size != 0) {
             std::memmove(ptr(0), ptr(this->buf_begin), initial_size);
         }
-        this->buf_begin = this->buffer.begin();
-        this->buf_end   = this->buffer.begin() + initial_size;
+        this->buf_begin = 0;
+        this->buf_end   = initial_size;
     }
     const size_t remaining_read = this->buffer.size() - initial_size;
     
@@ -105,5 +142,111 @@ bool  buffered_input_stream::fill_buffer()
     return ! this->buf_empty();
 }
 
-} // end namespace tinfra
+/// Read more data after already buffered, growing buffer when it's
+/// full. Returns number of bytes read, 0 at EOF.
+size_t buffered_input_stream::fill_more()
+{
+    if( eof_readed )
+        return 0;
+    if( buf_begin == 0 && buf_end == buffer.size() ) {
+        // full buffer holds one unfinished record
+        buffer.resize(std::max<size_t>(buffer.size() * 2, 64));
+    }
+    const size_t initial_size = buf_size();
+    fill_buffer();
+    return buf_size() - initial_size;
+}
+
+//
+// buffered_output_stream
+//
+
+buffered_output_stream::buffered_output_stream(tinfra::output_stream& target, size_t size):
+    target_(target),
+    capacity_(std::max<size_t>(size, 1)),
+    flush_threshold_(0),
+    corked_(false)
+{
+    buffer_.reserve(capacity_);
+}
+
+buffered_output_stream::~buffered_output_stream()
+{
+    try {
+        flush();
+    } catch( std::exception& e ) {
+        TINFRA_GLOBAL_TRACE("buffered_output_stream: unable to flush in destructor: " << e.what());
+    }
+}
 
+void buffered_output_stream::close()
+{
+    flush();
+    target_.close();
+}
+
+int buffered_output_stream::write(const char* data, int size)
+{
+    if( size <= 0 )
+        return 0;
+    const size_t n = static_cast<size_t>(size);
+    if( buffer_.size() + n <= capacity_ ) {
+        if( buffer_.empty() && flush_interval_ != time_duration() )
+            first_buffered_ = time_stamp::now(TS_MONOTONIC);
+        buffer_.append(data, n);
+        maybe_flush();
+        return size;
+    }
+    if( n < capacity_ ) {
+        // doesn't fit, but small: make room and buffer
+        flush();
+        return write(data, size);
+    }
+    // big write, pass through together with buffered data
+    const tstring fragments[2] = { tstring(buffer_), tstring(data, n) };
+    write_all(target_, fragments, 2);
+    buffer_.clear();
+    return size;
+}
+
+int buffered_output_stream::writev(tstring const* fragments, size_t count)
+{
+    int result = 0;
+    for( size_t i = 0; i < count; ++i )
+        result += write(fragments[i].data(), static_cast<int>(fragments[i].size()));
+    return result;
+}
+
+void buffered_output_stream::sync()
+{
+    flush();
+    target_.sync();
+}
+
+void buffered_output_stream::flush()
+{
+    if( buffer_.empty() )
+        return;
+    write_all(target_, tstring(buffer_));
+    buffer_.clear();
+}
+
+void buffered_output_stream::maybe_flush()
+{
+    if( corked_ ) {
+        if( buffer_.size() == capacity_ )
+            flush();
+        return;
+    }
+    if( buffer_.size() == capacity_ ||
+        (flush_threshold_ > 0 && buffer_.size() >= flush_threshold_) ) {
+        flush();
+        return;
+    }
+    if( flush_interval_ != time_duration() &&
+        time_stamp::now(TS_MONOTONIC) - first_buffered_ >= flush_interval_ ) {
+        flush();
+    }
+}
+
+} // end namespace tinfra
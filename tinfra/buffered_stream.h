@@ -7,18 +7,31 @@
 #define tinfra_buffered_stream_h_included
 
 #include "stream.h"
+#include "tstring.h"
+#include "time.h"
 #include <vector>
 #include <memory>
 
 namespace tinfra {
 
+/// Buffering input stream.
+///
+/// Besides plain read(), exposes buffered data as tstring views, so
+/// records can be parsed in place:
+/// <pre>
+///   tstring line;
+///   while( in.read_until('\n', line) )
+///       process(line);
+/// </pre>
+/// Views returned by peek(), read_until() and buffered() are valid
+/// until next call of peek(), read_until() or read().
 class buffered_input_stream: public tinfra::input_stream {
     tinfra::input_stream&     target;
     typedef std::vector<char> buffer_t;
     buffer_t buffer;
     
-    buffer_t::iterator   buf_begin;
-    buffer_t::iterator   buf_end;
+    size_t               buf_begin;
+    size_t               buf_end;
     
     bool                 eof_readed;
 public:
@@ -28,26 +41,47 @@ public:
     // implement tinfra::input_stream
     int  read(char* dest, int size);
     void close();
+
+    /// Data already buffered, but not consumed.
+    tstring buffered() const { return tstring(ptr(buf_begin), buf_size()); }
+
+    /// Look at next n bytes without consuming them.
+    ///
+    /// Reads from target until n bytes are buffered, growing buffer
+    /// if needed. Result is shorter than n only at EOF.
+    tstring peek(size_t n);
+
+    /// Skip n bytes; n must not exceed buffered().size().
+    void    consume(size_t n);
+
+    /// Read record terminated by delimiter.
+    ///
+    /// On success, result points to record including delimiter (or
+    /// to remaining data if EOF came first) and record is consumed.
+    /// Buffer grows to fit longest record. Returns false at EOF.
+    bool    read_until(char delimiter, tstring& result);
+
+    /// Current buffer capacity.
+    size_t  capacity() const { return buffer.size(); }
 private:
-    char*   ptr(buffer_t::iterator i ) { return & (*i); }
-    char*   ptr(size_t idx)            { return & ( this->buffer[idx] ); }
+    const char* ptr(size_t idx) const  { return & ( this->buffer[0] ) + idx; }
+    char*   ptr(size_t idx)            { return & ( this->buffer[0] ) + idx; }
     
-    char*   ptr()   const { return & (*buf_begin); }
     bool    buf_empty() const { return buf_begin == buf_end; }
     size_t  buf_size()  const { return buf_end - buf_begin; }
     
     size_t consume_buffer(char* dest, size_t size);
     
-    bool  fill_buffer();
+    bool   fill_buffer();
+    size_t fill_more();
 };
 
-class owning_buffered_input_stream: public input_stream {
+class owning_buffered_input_stream: public buffered_input_stream {
     std::auto_ptr<tinfra::input_stream> delegate_;
-    buffered_input_stream          buffer;
 public:
     owning_buffered_input_stream(input_stream* base, size_t buffer_size):
-        delegate_(base),
-        buffer(*base, buffer_size)
+        buffered_input_stream(*base, buffer_size),
+        delegate_(base)
     {
     }
     
@@ -58,11 +92,69 @@ public:
     {
         delegate_->close();
     }
+};
 
-    int read(char* dest, int size)
-    {
-        return buffer.read(dest, size);
-    }
+/// Buffering output stream.
+///
+/// Small writes are coalesced in buffer and passed to target in one
+/// write when buffer fills; writes bigger than capacity are passed
+/// through (together with buffered data, as one writev()).
+/// Unlike plain streams, write() always writes all data.
+///
+/// Buffered data is flushed by flush(), sync(), close() and
+/// destructor (which ignores errors, so call flush() if they
+/// matter). Additionally, data may be flushed automatically by
+/// write() when:
+///   - more than flush threshold bytes are buffered
+///     (set_flush_threshold()),
+///   - oldest buffered data is older than flush interval
+///     (set_flush_interval(); checked only by write(), there is no
+///     timer).
+/// cork() suspends automatic flushing (except when buffer is full)
+/// until uncork(), like TCP_CORK for sockets: message assembled from
+/// many writes goes out in one write.
+class buffered_output_stream: public tinfra::output_stream {
+public:
+    buffered_output_stream(tinfra::output_stream& target, size_t size = 8192);
+    ~buffered_output_stream();
+
+    // implement tinfra::output_stream
+    void close();
+    int  write(const char* data, int size);
+    int  writev(tstring const* fragments, size_t count);
+    void sync();
+
+    /// Write buffered data to target.
+    void    flush();
+
+    /// Flush when more than bytes are buffered, 0 disables.
+    void    set_flush_threshold(size_t bytes) { flush_threshold_ = bytes; }
+
+    /// Flush when data is buffered longer than interval,
+    /// 0 (default) disables.
+    void    set_flush_interval(time_duration interval) { flush_interval_ = interval; }
+
+    void    cork()   { corked_ = true; }
+    /// Stop holding data and flush.
+    void    uncork() { corked_ = false; flush(); }
+
+    size_t  buffered_size() const { return buffer_.size(); }
+    size_t  capacity() const      { return capacity_; }
+
+private:
+    void    maybe_flush();
+
+    tinfra::output_stream& target_;
+    std::string   buffer_;
+    size_t        capacity_;
+    size_t        flush_threshold_;
+    time_duration flush_interval_;
+    time_stamp    first_buffered_;
+    bool          corked_;
+
+    // noncopyable
+    buffered_output_stream(buffered_output_stream const&);
+    buffered_output_stream& operator=(buffered_output_stream const&);
 };
 
 } // end namespace tinfra
@@ -13,6 +13,65 @@ base_file::~base_file()
 {
 }
 
+namespace {
+
+/// Restores file position when leaving scope, also by exception.
+class file_position_guard {
+    base_file& f_;
+    base_file::offset_type saved_;
+    bool restored_;
+public:
+    file_position_guard(base_file& f):
+        f_(f),
+        saved_(f.seek(0, base_file::SO_CURRENT)),
+        restored_(false)
+    {}
+    ~file_position_guard()
+    {
+        if( restored_ )
+            return;
+        // already unwinding, original error is more important
+        try {
+            f_.seek(saved_);
+        } catch( ... ) {
+        }
+    }
+    /// Restore now, reporting errors.
+    void restore()
+    {
+        restored_ = true;
+        f_.seek(saved_);
+    }
+};
+
+} // end anonymous namespace
+
+int base_file::pread(char* dest, int size, offset_type offset)
+{
+    file_position_guard position(*this);
+    seek(offset);
+    const int r = read(dest, size);
+    position.restore();
+    return r;
+}
+
+int base_file::pwrite(const char* data, int size, offset_type offset)
+{
+    file_position_guard position(*this);
+    seek(offset);
+    const int w = write(data, size);
+    position.restore();
+    return w;
+}
+
+void base_file::allocate(offset_type, offset_type)
+{
+}
+
+void base_file::advise(offset_type, offset_type, file_access_advice)
+{
+}
+
 
 //static 
 file::handle_type file::open_native(tstring const& name, int flags)
@@ -48,6 +107,9 @@ auto_ptr<output_stream> create_file_output_stream(tstring const& name, int mode)
 
 std::string read_file(tinfra::tstring name)
 {
+    // read(), not mapped_file: works also for files that report
+    // size 0 (procfs, sysfs) and isn't hit by SIGBUS when file is
+    // truncated while being read
     file fin(name, FOM_READ);
     
     return read_all(fin);
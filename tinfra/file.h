@@ -24,6 +24,15 @@ enum file_open_flags {
 
 typedef int file_output_flags;
 
+/// Access pattern hints, see base_file::advise().
+enum file_access_advice {
+    FA_NORMAL,
+    FA_SEQUENTIAL,
+    FA_RANDOM,
+    FA_WILLNEED,  ///< range will be needed soon, start reading it
+    FA_DONTNEED   ///< range won't be needed, drop it from cache
+};
+
 class base_file: public input_stream, 
                  public output_stream {
 
@@ -34,12 +43,35 @@ public:
         SO_CURRENT
     };
     
+    typedef int64_t offset_type;
+
     virtual ~base_file();
 
     virtual void close() = 0;
     
-    virtual int seek(int pos, seek_origin origin = SO_START) = 0;    
+    /// Change file position, returns new position.
+    virtual offset_type seek(offset_type pos, seek_origin origin = SO_START) = 0;
     virtual tinfra::fs::file_info stat() = 0;
+
+    /// Positional read.
+    ///
+    /// Read at given offset without using (and changing) file
+    /// position, so several threads may read one file. Default
+    /// implementation uses seek() and read(), so isn't thread safe.
+    virtual int  pread(char* dest, int size, offset_type offset);
+
+    /// Positional write, see pread().
+    virtual int  pwrite(const char* data, int size, offset_type offset);
+
+    /// Reserve disk space for range of file, extending it if needed.
+    ///
+    /// Default implementation does nothing.
+    virtual void allocate(offset_type offset, offset_type size);
+
+    /// Declare access pattern for range of file (size 0 means to
+    /// end of file). It's only a hint, default implementation does
+    /// nothing.
+    virtual void advise(offset_type offset, offset_type size, file_access_advice advice);
 };
 
 class file: public base_file {
@@ -60,8 +92,15 @@ public:
     virtual int write(const char* data, int size);    
     virtual void sync();
     
+    virtual int readv(mutable_buffer const* buffers, size_t count);
+    virtual int writev(tstring const* fragments, size_t count);
+
     // additional file specific functions
-    virtual int seek(int pos, seek_origin origin = SO_START);
+    virtual offset_type seek(offset_type pos, seek_origin origin = SO_START);
+    virtual int  pread(char* dest, int size, offset_type offset);
+    virtual int  pwrite(const char* data, int size, offset_type offset);
+    virtual void allocate(offset_type offset, offset_type size);
+    virtual void advise(offset_type offset, offset_type size, file_access_advice advice);
     
     virtual tinfra::fs::file_info stat();
     
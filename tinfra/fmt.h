@@ -10,6 +10,7 @@
 
 #include "tinfra/tstring.h"
 #include "stream.h" // for tinfra::output_stream
+#include "static_fmt.h" // for format_exception and formatting engine
 
 #include <string>  // for std::string
 #include <iosfwd>  // for std::ostream
@@ -25,11 +26,6 @@ namespace tinfra {
 ///     fmt("Hello %s. Nice to %s you. Count %i") % "zbyszek" % "opryszek" % 2;
 ///
 
-class format_exception: public std::logic_error {
-public:
-    format_exception(const std::string& message): std::logic_error("format exception: " + message) {}
-};
-
 class basic_fmt {
 public:
     basic_fmt(std::streambuf* buf, tstring const& format):
@@ -163,10 +159,10 @@ typedef stringbuf_fmt fmt;
 
 #ifdef TINFRA_HAS_VARIADIC_TEMPLATES
 template < typename... Args>
-void tprintf(std::ostream& out, tinfra::tstring const& fmt, Args... args);
+void tprintf(std::ostream& out, tinfra::tstring const& fmt, Args const&... args);
 
 template < typename... Args>
-std::string tsprintf(tstring const& fmt, Args ... args);
+std::string tsprintf(tstring const& fmt, Args const& ... args);
 #endif
 
 
@@ -174,27 +170,38 @@ std::string tsprintf(tstring const& fmt, Args ... args);
 // tsprintf and tprintf implementation
 //
 #ifdef TINFRA_HAS_VARIADIC_TEMPLATES
+//
+// these use formatting engine from static_fmt.h, format is parsed
+// and checked at runtime
+//
 template <typename... Args>
-void tprintf(std::ostream& out, tinfra::tstring const& fmt, Args... args)
+void tprintf(std::ostream& out, tinfra::tstring const& fmt, Args const&... args)
 {
-    basic_fmt F(out.rdbuf(), fmt);
-    F.push(args...);
-    F.flush();
+    std::string tmp;
+    fmt_append(tmp, fmt, args...);
+    out.write(tmp.data(), tmp.size());
+}
+
+template <size_t N, typename... Args>
+void tprintf(std::ostream& out, static_fmt<N> const& fmt, Args const&... args)
+{
+    static_assert(sizeof...(Args) == N, "number of arguments doesn't match format");
+    tprintf(out, fmt.str(), args...);
 }
 
 template <typename... Args>
-void tprintf(tinfra::output_stream& out, tinfra::tstring const& fmt, Args... args)
+void tprintf(tinfra::output_stream& out, tinfra::tstring const& fmt, Args const&... args)
 {
-    stringbuf_fmt F(fmt);
-    F.push(args...);
-    out.write(F);
+    std::string tmp;
+    fmt_append(tmp, fmt, args...);
+    fmt_write(out, tmp.data(), tmp.size());
 }
 
 template <typename ... Args>
-std::string tsprintf(tstring const& fmt, Args ... args) {
-    stringbuf_fmt F(fmt);
-    F.push(args...);
-    return F.str();
+std::string tsprintf(tstring const& fmt, Args const& ... args) {
+    std::string result;
+    fmt_append(result, fmt, args...);
+    return result;
 }
 
 
@@ -13,6 +13,10 @@
 #include "tinfra/os_common.h"
 #include "tinfra/vfs.h"
 #include "tinfra/trace.h"
+#include "tinfra/work_stealing_runner.h"
+#include "tinfra/atomic.h"
+#include "tinfra/mutex.h"
+#include "tinfra/guard.h"
 #include <streambuf>
 #include <fstream>
 #include <stdexcept>
@@ -66,12 +70,14 @@ struct recursive_lister::internal_data {
     bool                    last_was_dir;
     
     bool                    recurse_enabled;
+    bool                    need_stat;
 };
 
-recursive_lister::recursive_lister(tstring const& path, bool):
+recursive_lister::recursive_lister(tstring const& path, bool need_stat):
     self(new internal_data())
 {
-    self->listers.push_back(new lister(path, true));
+    self->need_stat = need_stat;
+    self->listers.push_back(new lister(path, need_stat));
     self->base_paths.push_back(path);
     
     // fake for first run
@@ -88,7 +94,7 @@ recursive_lister::~recursive_lister()
 bool recursive_lister::fetch_next(directory_entry& de)
 {
     if( self->recurse_enabled && self->last_was_dir) {
-        self->listers.push_back(new lister(self->last_path, true));
+        self->listers.push_back(new lister(self->last_path, self->need_stat));
         self->base_paths.push_back(self->last_path);
     }
     self->recurse_enabled = true;
@@ -118,16 +124,22 @@ void recursive_lister::recurse(bool recurse)
     self->recurse_enabled = recurse;
 }
 
-void recursive_copy(tstring const& src, tstring const& dest)
+void recursive_copy(tstring const& src, tstring const& dest, bool parallel)
 {
     tinfra::vfs& fs = tinfra::local_fs();
-    tinfra::default_recursive_copy(fs, src, fs, dest);
+    if( parallel )
+        tinfra::parallel_recursive_copy(fs, src, fs, dest);
+    else
+        tinfra::default_recursive_copy(fs, src, fs, dest);
 }
 
-void recursive_rm(tstring const& name)
+void recursive_rm(tstring const& name, bool parallel)
 {
     tinfra::vfs& fs = tinfra::local_fs();
-    return tinfra::default_recursive_rm(fs, name);
+    if( parallel )
+        tinfra::parallel_recursive_rm(fs, name);
+    else
+        tinfra::default_recursive_rm(fs, name);
 }
 
 void copy(tstring const& src, tstring const& dest)
@@ -137,37 +149,104 @@ void copy(tstring const& src, tstring const& dest)
 }
 
 namespace {
-    
-static void walk_(tstring const& start, walker& walker);
-    
-struct walker_file_visitor: public tinfra::fs::file_list_visitor {
-    tstring const& parent_;
-    walker& walker_;
-    
-    walker_file_visitor(tstring const& parent, walker& walker): parent_(parent), walker_(walker) {}
-        
-    void accept(tstring const& name)
-    {
-        std::string file_path(tinfra::path::join(parent_, name));
-        bool dir = is_dir(file_path);
-        bool dig_further = walker_.accept(name,  parent_, dir);
-        if( dir && dig_further ) {
-            walk_(file_path, walker_);
-        }
-    }
-};
 
+/// Check if entry is directory, following symlinks.
+static bool is_dir_entry(tstring const& parent, directory_entry const& de, std::string& file_path)
+{
+    if( de.info.type != SYMBOLIC_LINK )
+        return de.info.type == DIRECTORY;
+    file_path = tinfra::path::join(parent, de.name);
+    return is_dir(file_path);
+}
+    
 static void walk_(tstring const& start, walker& w)
 {    
-    walker_file_visitor visitor(start, w);
     try {
-        tinfra::fs::list_files(start, visitor);
+        lister files(start);
+        directory_entry de;
+        while( files.fetch_next(de) ) {
+            std::string file_path;
+            const bool dir = is_dir_entry(start, de, file_path);
+            const bool dig_further = w.accept(de.name, start, dir);
+            if( dir && dig_further ) {
+                if( file_path.empty() )
+                    file_path = tinfra::path::join(start, de.name);
+                walk_(file_path, w);
+            }
+        }
     } catch(std::runtime_error const&) {
         // TBD, it should be more intelligent!!
     }    
 }
+
+struct parallel_walk_context {
+    walker&                      w;
+    tinfra::work_stealing_runner runner;
+    tinfra::atomic<int>          stopped;
+    tinfra::mutex                error_mutex;
+    std::string                  error;
+
+    parallel_walk_context(walker& w, int thread_count):
+        w(w),
+        runner(thread_count),
+        stopped(0)
+    {}
+};
+
+static void parallel_walk_dir(parallel_walk_context& ctx, std::string const& dir);
+
+struct parallel_walk_job {
+    parallel_walk_context* context;
+    std::string            path;
+
+    void operator()()
+    {
+        parallel_walk_dir(*context, path);
+    }
+};
+
+static void parallel_walk_record_error(parallel_walk_context& ctx, std::string const& message)
+{
+    tinfra::guard g(ctx.error_mutex);
+    if( ctx.error.empty() )
+        ctx.error = message;
+    ctx.stopped.store(1);
 }
 
+static void parallel_walk_dir(parallel_walk_context& ctx, std::string const& dir)
+{
+    std::auto_ptr<lister> files;
+    try {
+        files.reset(new lister(dir));
+    } catch( std::runtime_error const& ) {
+        // unreadable directory, skipped as in walk()
+        return;
+    }
+    try {
+        directory_entry de;
+        while( ctx.stopped.load(tinfra::MO_RELAXED) == 0 && files->fetch_next(de) ) {
+            std::string file_path;
+            const bool dir_entry = is_dir_entry(dir, de, file_path);
+            const bool dig_further = ctx.w.accept(de.name, dir, dir_entry);
+            if( dir_entry && dig_further ) {
+                if( file_path.empty() )
+                    file_path = tinfra::path::join(dir, de.name);
+                // submitted from worker, goes to its local deque
+                const parallel_walk_job job = { &ctx, file_path };
+                ctx.runner(job);
+            }
+        }
+    } catch( walker::stop ) {
+        ctx.stopped.store(1);
+    } catch( std::exception const& e ) {
+        parallel_walk_record_error(ctx, e.what());
+    } catch( ... ) {
+        parallel_walk_record_error(ctx, "unknown exception");
+    }
+}
+
+} // end anonymous namespace
+
 void walk(tstring const& start, walker& w)
 {
     try 
@@ -177,6 +256,16 @@ void walk(tstring const& start, walker& w)
     catch(walker::stop) { }
 }
 
+void parallel_walk(tstring const& start, walker& w, int thread_count)
+{
+    parallel_walk_context ctx(w, thread_count);
+    const parallel_walk_job root = { &ctx, start.str() };
+    ctx.runner(root);
+    ctx.runner.wait_idle();
+    if( !ctx.error.empty() )
+        throw std::runtime_error(tsprintf("parallel_walk: %s", ctx.error));
+}
+
 file_list_visitor::~file_list_visitor()
 {
 }
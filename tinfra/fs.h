@@ -43,6 +43,11 @@ struct directory_entry {
     file_info info;
 };
 
+/// List directory.
+///
+/// info.type and info.is_dir are always filled (from d_type where
+/// available, so without stat), other info fields only when
+/// need_stat is set.
 class lister: public generator_impl<lister, directory_entry> {
 public:
     lister(tstring const& path, bool need_stat = false);    
@@ -97,11 +102,20 @@ void mkdir(tstring const& name, bool create_parents = true);
 void copy(tstring const& src, tstring const& dest);
 void mv(tstring const& src, tstring const& dest);
 
-void recursive_copy(tstring const& src, tstring const& dest);
+/// Copy file or directory tree.
+///
+/// By default entries are copied one by one and first error is
+/// thrown. With parallel, directories are processed on thread pool
+/// (see parallel_recursive_copy() in vfs.h), copying continues after
+/// errors and all of them are thrown as tree_operation_error.
+void recursive_copy(tstring const& src, tstring const& dest, bool parallel = false);
 
 void rm(tstring const& name);
 void rmdir(tstring const& name);
-void recursive_rm(tstring const& src);
+/// Remove file or directory tree.
+///
+/// parallel has same meaning as in recursive_copy().
+void recursive_rm(tstring const& src, bool parallel = false);
 
 // implemented only in POSIX
 void         symlink(tstring const& target, tstring const& path);
@@ -130,6 +144,21 @@ struct walker
 */
 void walk(tstring const& start, walker& w);
 
+/** Walk through filesystem hierarchy using many threads.
+
+    Each directory is listed by separate job on work stealing thread
+    pool (thread_count == 0 means one thread per processor), so
+    w.accept() is called concurrently and must be thread safe. Order
+    of visits is unspecified, but parent directory is always accepted
+    before its children.
+    
+    Returning false from accept() prunes directory; walker::stop
+    stops whole walk (threads stop at next entry). Unreadable
+    directories are skipped; any other exception thrown by accept()
+    stops walk and is rethrown as std::runtime_error.
+*/
+void parallel_walk(tstring const& start, walker& w, int thread_count = 0);
+
 } } // end namespace tinfra::fs
 
 
@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "platform.h"
+#include "config-priv.h"
+
+#include "futex.h" // we implement this
+
+#include <climits>
+
+#ifdef HAVE_LINUX_FUTEX_H
+#include "tinfra/os_common.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#else
+#include "tinfra/thread.h"
+#endif
+
+namespace tinfra {
+
+#ifdef HAVE_LINUX_FUTEX_H
+
+static int sys_futex(atomic<int>& word, int op, int value, const struct timespec* timeout)
+{
+    return ::syscall(SYS_futex, (int*)word.address(), op, value, timeout, 0, 0);
+}
+
+void futex_wait(atomic<int>& word, int expected)
+{
+    if( sys_futex(word, FUTEX_WAIT_PRIVATE, expected, 0) == -1 ) {
+        const int e = errno;
+        if( e != EAGAIN && e != EINTR )
+            throw_errno_error(e, "futex(FUTEX_WAIT) failed");
+    }
+}
+
+bool futex_wait(atomic<int>& word, int expected, deadline const& d)
+{
+    if( d.is_infinite() ) {
+        futex_wait(word, expected);
+        return true;
+    }
+    const time_duration left = d.time_left_to();
+    if( left <= time_duration() )
+        return false;
+    
+    struct timespec timeout;
+    const time_int ms = left.milliseconds();
+    timeout.tv_sec  = ms / 1000;
+    timeout.tv_nsec = (ms % 1000) * 1000000;
+    if( sys_futex(word, FUTEX_WAIT_PRIVATE, expected, &timeout) == -1 ) {
+        const int e = errno;
+        if( e == ETIMEDOUT )
+            return false;
+        if( e != EAGAIN && e != EINTR )
+            throw_errno_error(e, "futex(FUTEX_WAIT) failed");
+    }
+    return true;
+}
+
+void futex_wake(atomic<int>& word, int count)
+{
+    sys_futex(word, FUTEX_WAKE_PRIVATE, count, 0);
+}
+
+void futex_wake_all(atomic<int>& word)
+{
+    sys_futex(word, FUTEX_WAKE_PRIVATE, INT_MAX, 0);
+}
+
+#else // HAVE_LINUX_FUTEX_H
+
+//
+// emulation: each word is hashed to one of monitors, waiter checks
+// word under monitor lock, so wake (which takes the same lock after
+// word is changed) can't be lost
+//
+
+static const size_t FUTEX_MONITOR_COUNT = 64;
+static tinfra::thread::monitor futex_monitors[FUTEX_MONITOR_COUNT];
+
+static tinfra::thread::monitor& get_monitor(atomic<int>& word)
+{
+    const size_t h = (reinterpret_cast<size_t>(word.address()) / sizeof(int)) % FUTEX_MONITOR_COUNT;
+    return futex_monitors[h];
+}
+
+void futex_wait(atomic<int>& word, int expected)
+{
+    tinfra::thread::synchronizator s(get_monitor(word));
+    if( word.load() == expected )
+        s.wait();
+}
+
+bool futex_wait(atomic<int>& word, int expected, deadline const& d)
+{
+    tinfra::thread::synchronizator s(get_monitor(word));
+    if( word.load() != expected )
+        return true;
+    if( d.is_infinite() ) {
+        s.wait();
+        return true;
+    }
+    return s.timed_wait(d);
+}
+
+void futex_wake(atomic<int>& word, int)
+{
+    // monitor is shared by many words, so
+    // we can't wake selectively
+    futex_wake_all(word);
+}
+
+void futex_wake_all(atomic<int>& word)
+{
+    tinfra::thread::synchronizator s(get_monitor(word));
+    s.broadcast();
+}
+
+#endif // HAVE_LINUX_FUTEX_H
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
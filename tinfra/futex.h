@@ -0,0 +1,43 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+//
+// futex.h
+//   wait/wake on atomic word
+//
+//   on linux it's thin wrapper over futex(2), elsewhere it's
+//   emulated with table of monitors
+//
+
+#ifndef tinfra_futex_h_included
+#define tinfra_futex_h_included
+
+#include "atomic.h"
+#include "time.h" // for deadline
+
+namespace tinfra {
+
+/// Block while word == expected.
+///
+/// Returns immediately if word != expected. May return spuriously,
+/// so caller must recheck its condition.
+void futex_wait(atomic<int>& word, int expected);
+
+/// Block while word == expected, but not longer than deadline.
+///
+/// Returns false if deadline passed.
+bool futex_wait(atomic<int>& word, int expected, deadline const& d);
+
+/// Wake at most count threads waiting on word.
+void futex_wake(atomic<int>& word, int count);
+
+/// Wake all threads waiting on word.
+void futex_wake_all(atomic<int>& word);
+
+} // end namespace tinfra
+
+#endif // tinfra_futex_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -4,6 +4,7 @@
 //
 
 #include "inifile.h"
+#include "buffered_stream.h"
 #include "trace.h"
 #include "string.h" // for strip
 #include "tinfra/fmt.h"    // for fmt
@@ -41,6 +42,15 @@ void fill_invalid_entry(entry& out, std::string const& error, std::string const&
 
 static bool readline(tinfra::input_stream& in, std::string& result)
 {
+    if( tinfra::buffered_input_stream* bin = dynamic_cast<tinfra::buffered_input_stream*>(&in) ) {
+        tstring line;
+        if( !bin->read_until('\n', line) )
+            return false;
+        if( line.size() > 0 && line[line.size()-1] == '\n' )
+            line = line.substr(0, line.size()-1);
+        result.append(line.data(), line.size());
+        return true;
+    }
     int readed = 0;
     while( true ) {
         char c;
@@ -7,7 +7,11 @@
 #include "internal_pipe.h" // we implement this
 
 #include <tinfra/thread.h>
+#include <tinfra/atomic.h>
+#include <tinfra/futex.h>
 #include <deque>        // implementation underlying buffer
+#include <vector>
+#include <cstring>      // for std::memcpy
 #include <iterator>     // for std::advance
 #include <algorithm>    // for std::copy
 #include <stdexcept>    // for std::logic_error
@@ -18,6 +22,30 @@ using tinfra::thread::synchronizator;
     
 class internal_pipe::implementation_detail
 {
+public:
+    virtual ~implementation_detail() {}
+
+    virtual int  read(char* dest, int size) = 0;
+    virtual int  write(const char* data, int size) = 0;
+    virtual void close() = 0;
+
+    virtual mutable_buffer acquire_write(size_t) { unsupported(); return mutable_buffer(); }
+    virtual void    commit(size_t)                { unsupported(); }
+    virtual tstring acquire_read()                { unsupported(); return tstring(); }
+    virtual void    release(size_t)               { unsupported(); }
+private:
+    static void unsupported()
+    {
+        throw std::logic_error("internal_pipe: chunk API requires SINGLE_PRODUCER_CONSUMER mode");
+    }
+};
+
+//
+// locking implementation
+//
+
+class internal_pipe::locking_implementation: public internal_pipe::implementation_detail
+{
 public:
     tinfra::thread::monitor  monitor;
     //int              requested_buffer_size; // read_only, not implemented!!!
@@ -26,7 +54,7 @@ public:
     typedef std::deque<char> buffer_container_t; 
     buffer_container_t buffer;
 public:
-    implementation_detail(int /*_buffer_size*/):
+    locking_implementation(int /*_buffer_size*/):
         //requested_buffer_size(_buffer_size),
         closed(false)
     {
@@ -78,11 +106,215 @@ public:
     }
 };
 
+//
+// spsc implementation
+//
+
+/// number of failed checks before reader/writer parks on futex
+static const int INTERNAL_PIPE_SPIN_COUNT = 64;
+
+static const size_t INTERNAL_PIPE_DEFAULT_RING_SIZE = 65536;
+
+/// Lock-free ring for one reader and one writer.
+///
+/// Positions grow monotonically, each is modified only by its owner
+/// and read by other side. Ring is followed by mirror area of ring
+/// size, so acquire_write() can return contiguous space even when
+/// it wraps; commit() copies wrapped part to ring start.
+class internal_pipe::spsc_implementation: public internal_pipe::implementation_detail
+{
+public:
+    explicit spsc_implementation(size_t size):
+        write_pos_(0),
+        read_pos_(0),
+        buffer_(size * 2),
+        capacity_(size),
+        wanted_(0),
+        acquired_(0),
+        closed_(0),
+        not_empty_(0),
+        not_full_(0)
+    {
+    }
+
+    int read(char* dest, int size)
+    {
+        const tstring available = acquire_read();
+        size_t n = std::min(available.size(), static_cast<size_t>(size));
+        std::memcpy(dest, available.data(), n);
+        release(n);
+        if( n < static_cast<size_t>(size) && n == available.size() ) {
+            // data may continue at ring start
+            const tstring rest = readable_now();
+            const size_t m = std::min(rest.size(), static_cast<size_t>(size) - n);
+            std::memcpy(dest + n, rest.data(), m);
+            release(m);
+            n += m;
+        }
+        return static_cast<int>(n);
+    }
+
+    int write(const char* data, int size)
+    {
+        size_t remaining = static_cast<size_t>(size);
+        while( remaining > 0 ) {
+            const mutable_buffer space = acquire_write(1);
+            const size_t n = std::min(space.size, remaining);
+            std::memcpy(space.data, data, n);
+            commit(n);
+            data += n;
+            remaining -= n;
+        }
+        return size;
+    }
+
+    void close()
+    {
+        closed_.store(1, MO_RELEASE);
+        // wake both sides, writer may wait for space that never comes
+        notify(not_empty_);
+        notify(not_full_);
+    }
+
+    mutable_buffer acquire_write(size_t min_size)
+    {
+        if( closed_.load(MO_RELAXED) )
+            throw std::logic_error("internal_pipe: attempt to write() after close()");
+        if( min_size > capacity_ )
+            throw std::logic_error("internal_pipe: acquire_write() bigger than buffer");
+        wanted_ = std::max<size_t>(min_size, 1);
+        if( !writable() )
+            park(not_full_, &spsc_implementation::writable);
+        if( closed_.load(MO_ACQUIRE) )
+            throw std::logic_error("internal_pipe: pipe closed while waiting for space");
+
+        const size_t w = write_pos_.load(MO_RELAXED);
+        const size_t free_space = capacity_ - (w - read_pos_.load(MO_ACQUIRE));
+        const mutable_buffer result = { &buffer_[w % capacity_], free_space };
+        acquired_ = free_space;
+        return result;
+    }
+
+    void commit(size_t size)
+    {
+        if( size > acquired_ )
+            throw std::logic_error("internal_pipe: commit() beyond acquired space");
+        acquired_ = 0;
+        const size_t w = write_pos_.load(MO_RELAXED);
+        const size_t index = w % capacity_;
+        if( index + size > capacity_ ) {
+            // written over ring end, copy it to ring start
+            std::memcpy(&buffer_[0], &buffer_[capacity_], index + size - capacity_);
+        }
+        write_pos_.store(w + size, MO_RELEASE);
+        notify(not_empty_);
+    }
+
+    tstring acquire_read()
+    {
+        if( !readable() )
+            park(not_empty_, &spsc_implementation::readable);
+        return readable_now();
+    }
+
+    void release(size_t size)
+    {
+        const size_t r = read_pos_.load(MO_RELAXED);
+        if( size > write_pos_.load(MO_ACQUIRE) - r )
+            throw std::logic_error("internal_pipe: release() beyond acquired data");
+        read_pos_.store(r + size, MO_RELEASE);
+        notify(not_full_);
+    }
+
+private:
+    /// Contiguous readable data (up to ring end).
+    tstring readable_now() const
+    {
+        const size_t r = read_pos_.load(MO_RELAXED);
+        const size_t available = write_pos_.load(MO_ACQUIRE) - r;
+        const size_t index = r % capacity_;
+        return tstring(&buffer_[index], std::min(available, capacity_ - index));
+    }
+
+    bool readable() const
+    {
+        return write_pos_.load(MO_ACQUIRE) != read_pos_.load(MO_RELAXED)
+            || closed_.load(MO_ACQUIRE) != 0;
+    }
+
+    bool writable() const
+    {
+        return capacity_ - (write_pos_.load(MO_RELAXED) - read_pos_.load(MO_ACQUIRE)) >= wanted_
+            || closed_.load(MO_ACQUIRE) != 0;
+    }
+
+    // same protocol as in bounded_queue
+    void notify(atomic<int>& epoch)
+    {
+        atomic_thread_fence(MO_SEQ_CST);
+        int e = epoch.load(MO_RELAXED);
+        if( (e & 1) == 0 )
+            return;
+        if( epoch.compare_exchange(e, e + 1, MO_RELEASE) )
+            futex_wake_all(epoch);
+    }
+
+    void park(atomic<int>& epoch, bool (spsc_implementation::*ready)() const)
+    {
+        for( int i = 0; i < INTERNAL_PIPE_SPIN_COUNT; ++i ) {
+            if( (this->*ready)() )
+                return;
+            cpu_relax();
+        }
+        while( true ) {
+            int e = epoch.load(MO_RELAXED);
+            if( (e & 1) == 0 && !epoch.compare_exchange(e, e | 1, MO_SEQ_CST) )
+                continue;
+            atomic_thread_fence(MO_SEQ_CST);
+            if( (this->*ready)() )
+                return;
+            futex_wait(epoch, e | 1);
+        }
+    }
+
+    // reader and writer hammer different positions,
+    // keep them in separate cache lines
+    char              pad0_[CACHE_LINE_SIZE];
+    atomic<size_t>    write_pos_;
+    char              pad1_[CACHE_LINE_SIZE - sizeof(atomic<size_t>)];
+    atomic<size_t>    read_pos_;
+    char              pad2_[CACHE_LINE_SIZE - sizeof(atomic<size_t>)];
+
+    std::vector<char> buffer_;
+    size_t            capacity_;
+    size_t            wanted_;   // used by writer only
+    size_t            acquired_; // used by writer only
+    atomic<int>       closed_;
+
+    // futex words, lowest bit set means someone is parked
+    atomic<int>       not_empty_;
+    atomic<int>       not_full_;
+};
+
+//
+// internal_pipe
+//
+
 internal_pipe::internal_pipe(int buffer_size)
-    : impl(new implementation_detail(/*this,*/ buffer_size))
+    : impl(new locking_implementation(/*this,*/ buffer_size))
 {
 }
 
+internal_pipe::internal_pipe(int buffer_size, pipe_mode mode)
+{
+    if( mode == SINGLE_PRODUCER_CONSUMER ) {
+        const size_t size = buffer_size > 0 ? static_cast<size_t>(buffer_size) : INTERNAL_PIPE_DEFAULT_RING_SIZE;
+        impl.reset(new spsc_implementation(size));
+    } else {
+        impl.reset(new locking_implementation(buffer_size));
+    }
+}
+
 internal_pipe::~internal_pipe()
 {
 }
@@ -107,5 +339,25 @@ void internal_pipe::close()
     impl->close();
 }
 
+mutable_buffer internal_pipe::acquire_write(size_t min_size)
+{
+    return impl->acquire_write(min_size);
+}
+
+void internal_pipe::commit(size_t size)
+{
+    impl->commit(size);
+}
+
+tstring internal_pipe::acquire_read()
+{
+    return impl->acquire_read();
+}
+
+void internal_pipe::release(size_t size)
+{
+    impl->release(size);
+}
+
 } // end namespace tinfra
 
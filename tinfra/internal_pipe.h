@@ -19,7 +19,18 @@ public:
         UNLIMITED = 0
     };
 
+    enum pipe_mode {
+        /// Any number of readers and writers, buffer grows as needed
+        /// (buffer_size is ignored).
+        LOCKING,
+        /// One reader thread and one writer thread; lock-free ring
+        /// of buffer_size bytes (64KB for UNLIMITED), threads block
+        /// on futex only when ring is empty or full.
+        SINGLE_PRODUCER_CONSUMER
+    };
+
     internal_pipe(int buffer_size);
+    internal_pipe(int buffer_size, pipe_mode mode);
 	~internal_pipe();
 
     /// Blocking read from pipe.
@@ -62,12 +73,43 @@ public:
     ///    and when buffer is empty will return EOF(0)
     /// Throws nothing.
     void close();
+
+    //
+    // chunk API, SINGLE_PRODUCER_CONSUMER mode only
+    //   (std::logic_error is thrown in LOCKING mode)
+    //
+
+    /// Get writable space in ring.
+    ///
+    /// Blocks until at least min_size (<= buffer size) contiguous
+    /// bytes are free; result may be bigger. Data written there is
+    /// passed to reader by commit().
+    /// Throws std::logic_error if pipe is closed, also when it's
+    /// closed while waiting.
+    mutable_buffer acquire_write(size_t min_size = 1);
+
+    /// Pass size bytes written to buffer from acquire_write() to reader.
+    ///
+    /// Throws std::logic_error if size exceeds space returned by
+    /// last acquire_write().
+    void           commit(size_t size);
+
+    /// Get readable data in ring.
+    ///
+    /// Blocks until there is any data, returns empty tstring on EOF.
+    /// Data stays in ring (and result is valid) until release().
+    tstring        acquire_read();
+
+    /// Free size bytes from beginning of acquire_read() result.
+    void           release(size_t size);
 private:
     // noncopyable
     internal_pipe(internal_pipe const&);
     internal_pipe& operator=(internal_pipe const&);
 
     class implementation_detail;
+    class locking_implementation;
+    class spsc_implementation;
     std::auto_ptr<implementation_detail> impl;
 };
 } // end namespace tinfra
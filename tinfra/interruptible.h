@@ -22,7 +22,7 @@ public:
     {
     }
     
-    bool process(T const& input)
+    R process(T const& input)
     {
         if( finished_ ) {
             throw std::logic_error("already finished");
@@ -44,6 +44,14 @@ public:
     bool is_finished() const {
         return finished_;
     }
+    
+    /// Check if last step requested to be called again.
+    ///
+    /// True if last process() call ended with again(), i.e
+    /// step is waiting for more input.
+    bool again_requested() const {
+        return again_;
+    }
 protected:
     
     R call(step_method m, T const& a)
@@ -56,7 +64,9 @@ protected:
     
     template <typename F>
     step_method make_step_method(R (F::*m)(T const&)) {
-        return reinterpret_cast<step_method>(m);
+        // static_cast adjusts this pointer if F has different layout
+        // (e.g. F introduces virtual methods)
+        return static_cast<step_method>(m);
     }
     void again() {
         again_ = true;
@@ -0,0 +1,657 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "platform.h"
+#include "config-priv.h"
+
+#include "io_engine.h" // we implement this
+
+#include "tinfra/fmt.h"
+#include "tinfra/os_common.h"
+#include "tinfra/trace.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#ifdef TINFRA_POSIX
+#include "tinfra/thread.h"
+#include "tinfra/bounded_queue.h"
+#include "tinfra/time.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_SYS_MMAN_H)
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define TINFRA_IO_URING
+#endif
+#endif
+
+namespace tinfra {
+
+//
+// io_request, io_completion_handler
+//
+
+io_request::io_request():
+    operation(IO_READ),
+    handle(-1),
+    data(0),
+    size(0),
+    offset(-1),
+    buffer_index(-1),
+    handler(0),
+    user_data(0),
+    result(0),
+    error(0)
+{
+}
+
+io_completion_handler::~io_completion_handler()
+{
+}
+
+//
+// io_engine
+//
+
+io_engine::io_engine(size_t capacity):
+    capacity_(capacity),
+    in_flight_(0)
+{
+}
+
+io_engine::~io_engine()
+{
+}
+
+void io_engine::prepare(io_request& request)
+{
+    if( in_flight_ >= capacity_ )
+        throw std::logic_error(tsprintf("io_engine: %i requests already in flight", in_flight_));
+    request.result = 0;
+    request.error = 0;
+    do_prepare(request);
+    ++in_flight_;
+}
+
+int io_engine::wait(int timeout_ms)
+{
+    return deliver(0, timeout_ms);
+}
+
+int io_engine::wait(runner& r, int timeout_ms)
+{
+    return deliver(&r, timeout_ms);
+}
+
+io_request* io_engine::next_completed()
+{
+    if( completed_.empty() )
+        return 0;
+    io_request* r = completed_.front();
+    completed_.pop_front();
+    return r;
+}
+
+namespace {
+
+struct io_completion_job {
+    io_request* request;
+
+    void operator()()
+    {
+        request->handler->on_complete(*request);
+    }
+};
+
+} // end anonymous namespace
+
+int io_engine::deliver(runner* r, int timeout_ms)
+{
+    if( in_flight_ == 0 )
+        return 0;
+    // handlers may prepare new requests or even wait again, so
+    // work on own copy of batch
+    std::vector<io_request*> done;
+    done.swap(batch_);
+    done.clear();
+    do_wait(timeout_ms, done);
+    in_flight_ -= done.size();
+
+    for( std::vector<io_request*>::const_iterator i = done.begin(); i != done.end(); ++i ) {
+        io_request* request = *i;
+        if( request->handler == 0 ) {
+            completed_.push_back(request);
+        } else if( r != 0 ) {
+            const io_completion_job job = { request };
+            (*r)(runnable(job));
+        } else {
+            request->handler->on_complete(*request);
+        }
+    }
+    const int result = static_cast<int>(done.size());
+    done.swap(batch_);
+    return result;
+}
+
+#ifdef TINFRA_POSIX
+
+//
+// thread_pool_io_engine
+//
+
+namespace {
+
+// how often blocked workers check if engine is being destroyed
+static const int IO_POOL_POLL_MS = 100;
+
+class thread_pool_io_engine: public io_engine {
+public:
+    thread_pool_io_engine(size_t capacity, int threads):
+        io_engine(capacity),
+        queue_(capacity + threads),
+        thread_count_(threads),
+        stopping_(false)
+    {
+        for( int i = 0; i < threads; ++i )
+            threads_.start(&thread_pool_io_engine::worker, this);
+    }
+
+    ~thread_pool_io_engine()
+    {
+        stopping_ = true;
+        for( int i = 0; i < thread_count_; ++i )
+            queue_.put(0);
+        threads_.join();
+    }
+
+    const char* name() const { return "thread_pool"; }
+
+    void register_buffers(mutable_buffer const*, size_t)
+    {
+        // blocking calls don't benefit from registration
+        if( in_flight() > 0 )
+            throw std::logic_error("io_engine: register_buffers() with requests in flight");
+    }
+
+    int submit()
+    {
+        const int n = static_cast<int>(prepared_.size());
+        for( std::vector<io_request*>::const_iterator i = prepared_.begin(); i != prepared_.end(); ++i )
+            queue_.put(*i);
+        prepared_.clear();
+        return n;
+    }
+
+private:
+    void do_prepare(io_request& request)
+    {
+        prepared_.push_back(&request);
+    }
+
+    void do_wait(int timeout_ms, std::vector<io_request*>& completed)
+    {
+        submit();
+        tinfra::thread::synchronizator s(done_monitor_);
+        if( timeout_ms > 0 ) {
+            const deadline d = deadline::relative(time_duration::millisecond(timeout_ms));
+            while( done_.empty() && s.timed_wait(d) )
+                ;
+        } else if( timeout_ms < 0 ) {
+            while( done_.empty() )
+                s.wait();
+        }
+        completed.insert(completed.end(), done_.begin(), done_.end());
+        done_.clear();
+    }
+
+    static void* worker(thread_pool_io_engine* self)
+    {
+        while( io_request* r = self->queue_.get() ) {
+            self->execute(*r);
+            tinfra::thread::synchronizator s(self->done_monitor_);
+            self->done_.push_back(r);
+            s.signal();
+        }
+        return 0;
+    }
+
+    /// Wait until descriptor is ready, so blocked operation can be
+    /// cancelled when engine is destroyed. Regular files are always
+    /// ready.
+    bool wait_ready(io_request& r, short events)
+    {
+        struct pollfd p;
+        p.fd = static_cast<int>(r.handle);
+        p.events = events;
+        while( true ) {
+            p.revents = 0;
+            const int rc = ::poll(&p, 1, IO_POOL_POLL_MS);
+            if( rc > 0 )
+                return true;
+            if( rc < 0 && errno != EINTR ) {
+                r.error = errno;
+                r.result = -1;
+                return false;
+            }
+            if( stopping_ ) {
+                r.error = ECANCELED;
+                r.result = -1;
+                return false;
+            }
+        }
+    }
+
+    void execute(io_request& r)
+    {
+        const int fd = static_cast<int>(r.handle);
+        while( true ) {
+            ssize_t rc = -1;
+            switch( r.operation ) {
+            case IO_READ:
+                if( !wait_ready(r, POLLIN) )
+                    return;
+                rc = r.offset >= 0 ? ::pread(fd, r.data, r.size, static_cast<off_t>(r.offset))
+                                   : ::read(fd, r.data, r.size);
+                break;
+            case IO_WRITE:
+                if( !wait_ready(r, POLLOUT) )
+                    return;
+                rc = r.offset >= 0 ? ::pwrite(fd, r.data, r.size, static_cast<off_t>(r.offset))
+                                   : ::write(fd, r.data, r.size);
+                break;
+            case IO_ACCEPT:
+                if( !wait_ready(r, POLLIN) )
+                    return;
+                rc = ::accept(fd, 0, 0);
+                break;
+            case IO_FSYNC:
+                rc = ::fsync(fd);
+                break;
+            default:
+                errno = EINVAL;
+                break;
+            }
+            if( rc < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) && !stopping_ )
+                continue;
+            if( rc < 0 ) {
+                r.error = errno;
+                r.result = -1;
+            } else {
+                r.error = 0;
+                r.result = rc;
+            }
+            return;
+        }
+    }
+
+    bounded_queue<io_request*>   queue_;
+    std::vector<io_request*>     prepared_;
+    tinfra::thread::monitor      done_monitor_;
+    std::vector<io_request*>     done_;  // guarded by done_monitor_
+    tinfra::thread::thread_set   threads_;
+    int                          thread_count_;
+    volatile bool                stopping_;
+};
+
+} // end anonymous namespace
+
+#endif // TINFRA_POSIX
+
+#ifdef TINFRA_IO_URING
+
+//
+// uring_io_engine
+//
+
+namespace {
+
+static int io_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t arg_size)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// ring indexes are shared with kernel
+static inline unsigned ring_load_acquire(unsigned const* p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void ring_store_release(unsigned* p, unsigned v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+class uring_io_engine: public io_engine {
+public:
+    explicit uring_io_engine(size_t capacity):
+        io_engine(capacity),
+        ring_fd_(-1),
+        sq_ring_(MAP_FAILED),
+        cq_ring_(MAP_FAILED),
+        sqes_(static_cast<struct io_uring_sqe*>(MAP_FAILED)),
+        prepared_tail_(0),
+        submitted_tail_(0),
+        buffers_registered_(false)
+    {
+        struct io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        // completion ring is twice as big as submission ring,
+        // so capacity requests always fit
+        ring_fd_ = io_uring_setup(static_cast<unsigned>(std::max<size_t>(capacity, 1)), &p);
+        if( ring_fd_ < 0 )
+            throw_errno_error(errno, "io_uring_setup failed");
+        try {
+            map_rings(p);
+        } catch( ... ) {
+            unmap_rings();
+            throw;
+        }
+        ext_arg_ = (p.features & IORING_FEAT_EXT_ARG) != 0;
+    }
+
+    ~uring_io_engine()
+    {
+        // closing ring cancels requests in flight
+        unmap_rings();
+    }
+
+    const char* name() const { return "io_uring"; }
+
+    void register_buffers(mutable_buffer const* buffers, size_t count)
+    {
+        if( in_flight() > 0 )
+            throw std::logic_error("io_engine: register_buffers() with requests in flight");
+        if( buffers_registered_ ) {
+            io_uring_register(ring_fd_, IORING_UNREGISTER_BUFFERS, 0, 0);
+            buffers_registered_ = false;
+        }
+        if( count == 0 )
+            return;
+        std::vector<struct iovec> iov(count);
+        for( size_t i = 0; i < count; ++i ) {
+            iov[i].iov_base = buffers[i].data;
+            iov[i].iov_len = buffers[i].size;
+        }
+        if( io_uring_register(ring_fd_, IORING_REGISTER_BUFFERS, &iov[0], count) < 0 )
+            throw_errno_error(errno, "io_uring_register(buffers) failed");
+        buffers_registered_ = true;
+    }
+
+    int submit()
+    {
+        int submitted = 0;
+        while( prepared_tail_ != submitted_tail_ ) {
+            const unsigned n = enter(prepared_tail_ - submitted_tail_, 0, 0);
+            if( n == 0 )
+                break; // kernel busy, rest is submitted by next submit() or wait()
+            submitted += static_cast<int>(n);
+        }
+        return submitted;
+    }
+
+private:
+    void map_rings(struct io_uring_params const& p)
+    {
+        sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if( single_mmap )
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+        sq_ring_ = ::mmap(0, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd_, IORING_OFF_SQ_RING);
+        if( sq_ring_ == MAP_FAILED )
+            throw_errno_error(errno, "io_uring: unable to map submission ring");
+        if( single_mmap ) {
+            cq_ring_ = sq_ring_;
+        } else {
+            cq_ring_ = ::mmap(0, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              ring_fd_, IORING_OFF_CQ_RING);
+            if( cq_ring_ == MAP_FAILED )
+                throw_errno_error(errno, "io_uring: unable to map completion ring");
+        }
+        sqes_size_ = p.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqes = ::mmap(0, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring_fd_, IORING_OFF_SQES);
+        if( sqes == MAP_FAILED )
+            throw_errno_error(errno, "io_uring: unable to map submission entries");
+        sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ring_);
+        sq_head_    = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sq_tail_    = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask_    = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_entries_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_entries);
+        sq_array_   = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+        char* cq = static_cast<char*>(cq_ring_);
+        cq_head_    = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_    = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_    = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_       = reinterpret_cast<struct io_uring_cqe*>(cq + p.cq_off.cqes);
+
+        prepared_tail_ = submitted_tail_ = *sq_tail_;
+    }
+
+    void unmap_rings()
+    {
+        if( sqes_ != MAP_FAILED )
+            ::munmap(sqes_, sqes_size_);
+        if( cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_ )
+            ::munmap(cq_ring_, cq_ring_size_);
+        if( sq_ring_ != MAP_FAILED )
+            ::munmap(sq_ring_, sq_ring_size_);
+        if( ring_fd_ >= 0 )
+            ::close(ring_fd_);
+        sqes_ = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+        cq_ring_ = sq_ring_ = MAP_FAILED;
+        ring_fd_ = -1;
+    }
+
+    void do_prepare(io_request& r)
+    {
+        // no SQPOLL, so kernel consumes entries only in enter()
+        if( sq_full() ) {
+            submit();
+            if( sq_full() ) {
+                // kernel short of resources, let some requests complete
+                enter(0, 1, IORING_ENTER_GETEVENTS);
+                submit();
+                if( sq_full() )
+                    throw std::runtime_error("io_uring: submission queue full");
+            }
+        }
+
+        const unsigned index = prepared_tail_ & sq_mask_;
+        struct io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->fd = static_cast<int>(r.handle);
+        switch( r.operation ) {
+        case IO_READ:
+        case IO_WRITE:
+            if( r.buffer_index >= 0 ) {
+                sqe->opcode = r.operation == IO_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+                sqe->buf_index = static_cast<unsigned short>(r.buffer_index);
+            } else {
+                sqe->opcode = r.operation == IO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+            }
+            sqe->addr = reinterpret_cast<uintptr_t>(r.data);
+            sqe->len = static_cast<unsigned>(r.size);
+            sqe->off = static_cast<uint64_t>(r.offset); // -1: current position
+            break;
+        case IO_ACCEPT:
+            sqe->opcode = IORING_OP_ACCEPT;
+            break;
+        case IO_FSYNC:
+            sqe->opcode = IORING_OP_FSYNC;
+            break;
+        default:
+            throw std::logic_error(tsprintf("io_engine: bad operation %i", r.operation));
+        }
+        sqe->user_data = reinterpret_cast<uintptr_t>(&r);
+        sq_array_[index] = index;
+        ++prepared_tail_;
+    }
+
+    void do_wait(int timeout_ms, std::vector<io_request*>& completed)
+    {
+        if( reap(completed) > 0 || timeout_ms == 0 ) {
+            submit();
+            return;
+        }
+        const unsigned to_submit = prepared_tail_ - submitted_tail_;
+        if( timeout_ms > 0 && ext_arg_ ) {
+            struct __kernel_timespec ts;
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+            struct io_uring_getevents_arg arg;
+            std::memset(&arg, 0, sizeof(arg));
+            arg.ts = reinterpret_cast<uintptr_t>(&ts);
+            enter(to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+        } else {
+            // note, without EXT_ARG (linux < 5.11) timeout is not supported
+            enter(to_submit, 1, IORING_ENTER_GETEVENTS);
+        }
+        reap(completed);
+    }
+
+    bool sq_full() const
+    {
+        return prepared_tail_ - ring_load_acquire(sq_head_) >= sq_entries_;
+    }
+
+    /// Publish prepared entries and enter kernel; returns number of
+    /// entries consumed by kernel, which may be less than to_submit,
+    /// submitted_tail_ is advanced only by that.
+    unsigned enter(unsigned to_submit, unsigned min_complete, unsigned flags, void* arg = 0, size_t arg_size = 0)
+    {
+        if( to_submit > 0 )
+            ring_store_release(sq_tail_, prepared_tail_);
+        while( true ) {
+            const int rc = io_uring_enter(ring_fd_, to_submit, min_complete, flags, arg, arg_size);
+            if( rc >= 0 ) {
+                const unsigned consumed = std::min(static_cast<unsigned>(rc), to_submit);
+                submitted_tail_ += consumed;
+                return consumed;
+            }
+            if( errno == EINTR || errno == ETIME )
+                return 0; // timeout or signal, caller just reaps what's available
+            if( errno == EAGAIN || errno == EBUSY ) {
+                // kernel short of resources, completions will make room;
+                // entries stay pending
+                if( min_complete == 0 )
+                    return 0;
+                to_submit = 0;
+                continue;
+            }
+            throw_errno_error(errno, "io_uring_enter failed");
+        }
+    }
+
+    size_t reap(std::vector<io_request*>& completed)
+    {
+        unsigned head = *cq_head_;
+        const unsigned tail = ring_load_acquire(cq_tail_);
+        const size_t n = tail - head;
+        for( ; head != tail; ++head ) {
+            struct io_uring_cqe const& cqe = cqes_[head & cq_mask_];
+            io_request* r = reinterpret_cast<io_request*>(static_cast<uintptr_t>(cqe.user_data));
+            if( cqe.res < 0 ) {
+                r->error = -cqe.res;
+                r->result = -1;
+            } else {
+                r->error = 0;
+                r->result = cqe.res;
+            }
+            completed.push_back(r);
+        }
+        ring_store_release(cq_head_, head);
+        return n;
+    }
+
+    int                   ring_fd_;
+    bool                  ext_arg_;
+
+    void*                 sq_ring_;
+    size_t                sq_ring_size_;
+    void*                 cq_ring_;
+    size_t                cq_ring_size_;
+    struct io_uring_sqe*  sqes_;
+    size_t                sqes_size_;
+
+    unsigned*             sq_head_;
+    unsigned*             sq_tail_;
+    unsigned              sq_mask_;
+    unsigned              sq_entries_;
+    unsigned*             sq_array_;
+
+    unsigned*             cq_head_;
+    unsigned*             cq_tail_;
+    unsigned              cq_mask_;
+    struct io_uring_cqe*  cqes_;
+
+    unsigned              prepared_tail_;  // filled entries
+    unsigned              submitted_tail_; // consumed by kernel
+    bool                  buffers_registered_;
+};
+
+} // end anonymous namespace
+
+#endif // TINFRA_IO_URING
+
+//
+// factories
+//
+
+std::auto_ptr<io_engine> create_io_engine(size_t capacity)
+{
+#ifdef TINFRA_IO_URING
+    try {
+        return std::auto_ptr<io_engine>(new uring_io_engine(capacity));
+    } catch( std::runtime_error& e ) {
+        // old kernel (ENOSYS) or disabled by policy (EPERM)
+        TINFRA_GLOBAL_TRACE(tsprintf("io_uring not available, using thread pool: %s", e.what()));
+    }
+#endif
+    return create_thread_pool_io_engine(capacity);
+}
+
+std::auto_ptr<io_engine> create_thread_pool_io_engine(size_t capacity, int threads)
+{
+#ifdef TINFRA_POSIX
+    if( threads <= 0 )
+        threads = 4;
+    return std::auto_ptr<io_engine>(new thread_pool_io_engine(capacity, threads));
+#else
+    (void)capacity;
+    (void)threads;
+    throw std::runtime_error("io_engine: not supported on this platform");
+#endif
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_io_engine_h_included
+#define tinfra_io_engine_h_included
+
+#include "platform.h"
+#include "stream.h" // for mutable_buffer
+#include "runner.h"
+
+#include <memory>
+#include <deque>
+#include <vector>
+
+namespace tinfra {
+
+struct io_request;
+
+enum io_operation {
+    IO_READ,
+    IO_WRITE,
+    IO_ACCEPT,
+    IO_FSYNC
+};
+
+/// Receiver of asynchronous I/O completions.
+class io_completion_handler {
+public:
+    virtual ~io_completion_handler();
+
+    virtual void on_complete(io_request& request) = 0;
+};
+
+/// Asynchronous I/O operation.
+///
+/// Request is owned by caller; it must not be modified nor destroyed
+/// until its completion is delivered. Failures are not thrown,
+/// they're reported in error field.
+struct io_request {
+    io_request();
+
+    // input
+    io_operation           operation;
+    intptr_t               handle;       ///< file descriptor or socket
+    char*                  data;         ///< IO_READ: destination, IO_WRITE: source
+    size_t                 size;
+    int64_t                offset;       ///< file offset, -1 means current position
+    int                    buffer_index; ///< index of registered buffer containing data or -1
+    io_completion_handler* handler;      ///< may be 0, see io_engine::next_completed()
+    void*                  user_data;
+
+    // output
+    int64_t                result;       ///< bytes transferred, accepted handle, 0 for IO_FSYNC
+    int                    error;        ///< errno value, 0 on success
+};
+
+/// Asynchronous I/O engine.
+///
+/// Requests are queued by prepare() and passed to OS in batches, so
+/// one thread may keep many operations in flight. Completions are
+/// delivered by wait(): either directly to request handler, as jobs
+/// to runner, or (for requests without handler) to completion queue
+/// read by next_completed().
+///
+/// Engine is not thread safe, it should be used by one thread.
+///
+/// Usage:
+/// <pre>
+///   std::auto_ptr<io_engine> engine = create_io_engine();
+///   io_request r;
+///   r.operation = IO_READ;
+///   r.handle = f.native(); r.data = buf; r.size = sizeof(buf); r.offset = 0;
+///   engine->prepare(r);
+///   while( engine->in_flight() > 0 )
+///       engine->wait();
+///   io_request* done = engine->next_completed();
+/// </pre>
+class io_engine {
+public:
+    virtual ~io_engine();
+
+    /// Implementation name, "io_uring" or "thread_pool".
+    virtual const char* name() const = 0;
+
+    /// Register buffers for fixed buffer I/O.
+    ///
+    /// Requests with buffer_index >= 0 must have data inside
+    /// buffers[buffer_index]; kernel can skip mapping them for
+    /// each operation. Replaces previous registration, may be
+    /// called only when no request is in flight.
+    virtual void register_buffers(mutable_buffer const* buffers, size_t count) = 0;
+
+    /// Queue request.
+    ///
+    /// Request is passed to OS by next submit() or wait(), or
+    /// immediately if submission queue is full.
+    /// Throws std::logic_error if capacity() requests are already
+    /// in flight.
+    void         prepare(io_request& request);
+
+    /// Pass prepared requests to OS, returns number of passed ones.
+    ///
+    /// If OS is short of resources, some may stay prepared; they're
+    /// passed by next submit() or wait().
+    virtual int  submit() = 0;
+
+    /// Submit prepared requests and deliver completions.
+    ///
+    /// Waits until at least one request completes or timeout_ms
+    /// elapses (-1 means infinity, 0 just checks). Returns number
+    /// of delivered completions.
+    int          wait(int timeout_ms = -1);
+
+    /// Same as wait(), but handler calls are passed as jobs to runner.
+    int          wait(runner& r, int timeout_ms = -1);
+
+    /// Take completed request without handler, or 0 if there is none.
+    io_request*  next_completed();
+
+    /// Max number of requests in flight.
+    size_t       capacity() const  { return capacity_; }
+
+    /// Number of prepared or submitted, but not completed requests.
+    size_t       in_flight() const { return in_flight_; }
+
+protected:
+    explicit io_engine(size_t capacity);
+
+private:
+    /// Queue request for submission.
+    virtual void do_prepare(io_request& request) = 0;
+
+    /// Submit and wait for completions.
+    ///
+    /// Fills in result/error of completed requests and appends them
+    /// to completed.
+    virtual void do_wait(int timeout_ms, std::vector<io_request*>& completed) = 0;
+
+    int          deliver(runner* r, int timeout_ms);
+
+    size_t                   capacity_;
+    size_t                   in_flight_;
+    std::vector<io_request*> batch_;
+    std::deque<io_request*>  completed_;
+
+    // noncopyable
+    io_engine(io_engine const&);
+    io_engine& operator=(io_engine const&);
+};
+
+/// Create best engine available.
+///
+/// io_uring on Linux when kernel supports it, otherwise thread pool.
+std::auto_ptr<io_engine> create_io_engine(size_t capacity = 256);
+
+/// Create engine executing blocking calls on pool of threads.
+///
+/// Works with any descriptor on any posix platform; threads == 0
+/// means 4 threads.
+std::auto_ptr<io_engine> create_thread_pool_io_engine(size_t capacity = 256, int threads = 0);
+
+} // end namespace tinfra
+
+#endif // tinfra_io_engine_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -1,13 +1,16 @@
 #include "json.h" // we implement this
+#include "json_scan.h"
 
 #include "tinfra/variant.h"
 #include "tinfra/memory_stream.h"
+#include "tinfra/buffered_stream.h"
 #include "tinfra/lex.h"
 #include "tinfra/fmt.h"
 #include "tinfra/string.h"
 #include "tinfra/trace.h"
 
 #include <ostream>
+#include <cstring>
 // impl
 namespace tinfra {
 
@@ -114,6 +117,15 @@ public:
             }
             next();
             break;
+        case json_token::TOK_TRUE:
+        case json_token::TOK_FALSE:
+            dest.set_bool(current.type == json_token::TOK_TRUE);
+            next();
+            break;
+        case json_token::TOK_NULL:
+            dest = variant::none();
+            next();
+            break;
         default:
             fail(tsprintf("expected value but %s found", current.type));
         }
@@ -200,8 +212,10 @@ public:
 };
 variant json_parse(tstring const& s)
 {
+    // buffered stream, so lexer scans in blocks
     memory_input_stream stream(s.data(), s.size(),USE_BUFFER);
-    return json_parse(stream);
+    buffered_input_stream buffered(stream, 65536);
+    return json_parse(buffered);
 }
 
 variant json_parse(tinfra::input_stream& in)
@@ -266,7 +280,7 @@ void json_renderer::boolean(bool v)
 }
 void json_renderer::none()
 {
-    this->out.write("nil");
+    this->out.write("null");
 }
 
 //
@@ -366,10 +380,21 @@ void json_writer::value_impl(variant const& v)
         this->value_impl(v.get_integer());
     } else if ( v.is_double() ) {
         this->value_impl(v.get_double());
+    } else if ( v.is_bool() ) {
+        this->value_impl(v.get_bool());
     } else if ( v.is_none() ) {
         this->value_impl();
     }
 }
+void json_writer::value_impl(variant_dict const& v)
+{
+    this->begin_object();
+    for( variant_dict::const_iterator i = v.begin(); i != v.end(); ++i ) {
+        this->named_value(i->first, i->second);
+    }
+    this->end_object();
+}
+
 void json_writer::value_impl(tstring const& value)
 {
     this->renderer.string(value);
@@ -399,6 +424,16 @@ void json_writer::value_impl() // none/nil
 
 void        json_write(variant const& v, tinfra::output_stream& out, json_encoding encoding)
 {
+    // renderer emits many tiny writes, coalesce them unless
+    // stream is memory or buffered already
+    if( dynamic_cast<tinfra::memory_output_stream*>(&out) == 0 &&
+        dynamic_cast<tinfra::buffered_output_stream*>(&out) == 0 )
+    {
+        tinfra::buffered_output_stream buffered(out);
+        json_write(v, buffered, encoding);
+        buffered.flush();
+        return;
+    }
     json_renderer renderer(out, encoding);
     json_writer writer(renderer);
     writer.value(v);
@@ -420,17 +455,29 @@ std::string json_write(variant const& v, json_encoding encoding)
 
 tinfra::module_tracer json_lexer_tracer(tinfra::tinfra_tracer, "json_lexer");
 
+/// same check in scalar and scanned path, so both accept same input
+static bool json_invalid_plain_char(int c)
+{
+    return c > 127;
+}
+
 struct json_lexer::internal_data {
     int   current;
     bool  finished;
     
     input_stream* input;
+    // if input is buffered, its buffer is lexed in place
+    buffered_input_stream* buffered;
     json_encoding input_encoding;
+    json_scanner const* scanner;
     enum {
-        BUFFER_LEN = 10
+        BUFFER_LEN = 16
     };
     char*   buffer_start;
     char*   buffer_end;
+    // start of buffered input view, bytes before buffer_start
+    // are lexed but not consumed yet
+    char*   window;
     char    buffer[BUFFER_LEN];
     
     std::string last_token;
@@ -448,22 +495,42 @@ struct json_lexer::internal_data {
             return false;
         }
         
-        TINFRA_ASSERT(required_size_at_least < BUFFER_LEN);
-        if( buffer_start > buffer ) {
-            memmove(buffer, buffer_start, current_len_at_start);
-            buffer_start = buffer;
-            buffer_end   = buffer+current_len_at_start;
+        if( buffered ) {
+            // take everything buffered stream has, consuming only
+            // what is already lexed
+            release_window();
+            buffered->peek(required_size_at_least);
+            const tstring available = buffered->buffered();
+            window       = const_cast<char*>(available.data());
+            buffer_start = window;
+            buffer_end   = window + available.size();
+        } else {
+            // read only what is required, so rest of stream
+            // is left for caller
+            TINFRA_ASSERT(required_size_at_least < BUFFER_LEN);
+            if( buffer_start > buffer ) {
+                memmove(buffer, buffer_start, current_len_at_start);
+                buffer_start = buffer;
+                buffer_end   = buffer+current_len_at_start;
+            }
+            const size_t len_required = required_size_at_least - current_len_at_start;
+            this->buffer_end += read_for_sure(buffer_end, len_required);
         }
-        const size_t len_required = required_size_at_least - current_len_at_start;
-        int r = read_for_sure(buffer_end, len_required);
-        this->buffer_end += r;
         
-        if( r == 0 && bytes_in_buffer() == 0 ) {
+        if( bytes_in_buffer() == 0 ) {
             this->finished = true;
         }
         return bytes_in_buffer() >= required_size_at_least;
     }
     
+    void release_window()
+    {
+        if( buffered && buffer_start != window ) {
+            buffered->consume(buffer_start - window);
+            window = buffer_start;
+        }
+    }
+    
     int read_for_sure(void* buf, size_t len)
     {
         char* buf2 = static_cast<char*>(buf);
@@ -491,20 +558,49 @@ struct json_lexer::internal_data {
     
     bool next_utf8() {
         // ok, this is fake, we just return byte by byte
-        if( !fill_buffer(1) )
+        if( TINFRA_UNLIKELY(buffer_start == buffer_end) && !fill_buffer(1) )
             return false;
         this->current = * (this->buffer_start);
         this->buffer_start += 1;
         return true;
     }
     
+    void skip_whitespace()
+        // assuming that current is whitespace
+    {
+        if( this->input_encoding == UTF8 ) {
+            // skip whole run in buffer at once
+            while( true ) {
+                buffer_start = const_cast<char*>(scanner->skip_whitespace(buffer_start, buffer_end));
+                if( buffer_start != buffer_end || !fill_buffer(1) )
+                    break;
+            }
+        }
+        next();
+    }
+    
+    void append_plain_run()
+        // append characters up to next '"' or '\\' to last_token
+        // directly from buffer
+    {
+        while( true ) {
+            const char* run_end = scanner->find_quote_or_escape(buffer_start, buffer_end);
+            for( const char* p = buffer_start; p != run_end; ++p )
+                if( json_invalid_plain_char(*p) )
+                    fail("we don't support anything plain old ASCII");
+            last_token.append(buffer_start, run_end - buffer_start);
+            buffer_start = const_cast<char*>(run_end);
+            if( buffer_start != buffer_end || !fill_buffer(1) )
+                break;
+        }
+    }
+    
     void detect_encoding()
     {
-        int r =  this->read_for_sure(this->buffer, 4);
-        this->buffer_start = buffer;
-        this->buffer_end   = buffer + r;
+        fill_buffer(4);
+        const char* b = this->buffer_start;
         
-        switch( r ) {
+        switch( std::min<size_t>(bytes_in_buffer(), 4) ) {
         case 0: // 0-byte JSON,
             this->finished = true;
             break;
@@ -515,24 +611,24 @@ struct json_lexer::internal_data {
         case 2:
         case 3:
             // only 2- or 3-byte JSON, so it can be 1 UTF-8 or invalid UTF16
-            if( this->buffer[0] == 0 ) {
+            if( b[0] == 0 ) {
                 this->input_encoding = UTF16_BE;
-            } else if( this->buffer[1] == 0 ) {
+            } else if( b[1] == 0 ) {
                 this->input_encoding = UTF16_BE;
             } else {
                 this->input_encoding = UTF8;
             }
             break;
         case 4:
-            if( this->buffer[0] == 0 ) { // 00 ... 
-                if (this->buffer[1] == 0 ) { // 00 00 ...
+            if( b[0] == 0 ) { // 00 ... 
+                if (b[1] == 0 ) { // 00 00 ...
                     this->input_encoding = UTF32_BE;
                 } else { // 00 xx ...
                     this->input_encoding = UTF16_BE;
                 }
             } else { // xx ...
-                if (this->buffer[1] == 0 ) { // xx 00 ...
-                    if( this->buffer[2] == 0 ) { // xx 00 00 ..
+                if (b[1] == 0 ) { // xx 00 ...
+                    if( b[2] == 0 ) { // xx 00 00 ..
                         this->input_encoding = UTF32_LE;
                     } else { // xx 00 xx ...
                         this->input_encoding = UTF16_LE;
@@ -619,8 +715,10 @@ struct json_lexer::internal_data {
                 next();
                 break;
             default:
-                if( this->current > 127) fail("we don't support anything plain old ASCII");
+                if( json_invalid_plain_char(this->current) ) fail("we don't support anything plain old ASCII");
                 last_token.append(1, (char)this->current);
+                if( this->input_encoding == UTF8 )
+                    append_plain_run();
                 next();
                 break;
             }
@@ -676,16 +774,21 @@ json_lexer::json_lexer(tinfra::input_stream& s):
     self(new internal_data())
 {
     self->input = &s;
+    self->buffered = dynamic_cast<buffered_input_stream*>(&s);
+    self->scanner = &json_default_scanner();
     self->current = -1;
     self->finished = 0;
     self->buffer_start = self->buffer;
     self->buffer_end = self->buffer;
+    self->window = self->buffer;
     
     self->detect_encoding();
     self->next();
 }
 json_lexer::~json_lexer()
 {
+    // leave unlexed data in buffered stream
+    self->release_window();
 }
 
 bool json_lexer::fetch_next(json_token& tok)
@@ -754,7 +857,7 @@ bool json_lexer::fetch_next(json_token& tok)
             TINFRA_TRACE(json_lexer_tracer, "readed NULL");
             return true;
         case ' ': case '\t': case '\r': case '\n': // whitespace
-            self->next();
+            self->skip_whitespace();
             continue;
         default:
             self->fail(tsprintf("unknown input %s", self->current)); 
@@ -763,4 +866,201 @@ bool json_lexer::fetch_next(json_token& tok)
     return false;
 }
 
+//
+// json_buffer_lexer
+//
+
+json_buffer_lexer::json_buffer_lexer(tstring const& input):
+    begin_(input.data()),
+    current_(input.data()),
+    end_(input.data() + input.size()),
+    scanner_(&json_default_scanner()),
+    decode_strings_(true)
+{
+}
+
+json_buffer_lexer::~json_buffer_lexer()
+{
+}
+
+void json_buffer_lexer::fail(std::string const& message)
+{
+    TINFRA_TRACE(json_lexer_tracer, "failure: " << message);
+    throw std::runtime_error(tsprintf("json_lexer: %s at offset %i", message, position()));
+}
+
+bool json_buffer_lexer::fetch_next(json_token& tok)
+{
+    while( current_ < end_ ) {
+        switch( *current_ ) {
+        case '{': tok.type = json_token::OBJECT_BEGIN; ++current_; return true;
+        case '}': tok.type = json_token::OBJECT_END;   ++current_; return true;
+        case '[': tok.type = json_token::ARRAY_BEGIN;  ++current_; return true;
+        case ']': tok.type = json_token::ARRAY_END;    ++current_; return true;
+        case ':': tok.type = json_token::COLON;        ++current_; return true;
+        case ',': tok.type = json_token::COMMA;        ++current_; return true;
+        case '"':
+            lex_string(tok);
+            return true;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            lex_number(tok);
+            return true;
+        case 't':
+            lex_keyword("true", 4);
+            tok.type = json_token::TOK_TRUE;
+            return true;
+        case 'f':
+            lex_keyword("false", 5);
+            tok.type = json_token::TOK_FALSE;
+            return true;
+        case 'n':
+            lex_keyword("null", 4);
+            tok.type = json_token::TOK_NULL;
+            return true;
+        case ' ': case '\t': case '\r': case '\n':
+            current_ = scanner_->skip_whitespace(current_ + 1, end_);
+            continue;
+        default:
+            fail(tsprintf("unknown input %s", *current_));
+        }
+    }
+    return false;
+}
+
+void json_buffer_lexer::lex_string(json_token& tok)
+{
+    const char* start = current_ + 1;
+    const char* p = start;
+    bool escaped = false;
+    while( true ) {
+        p = scanner_->find_quote_or_escape(p, end_);
+        if( p >= end_ || *p == '"' )
+            break;
+        // skip escape sequence, (\uXXXX is validated when decoding)
+        escaped = true;
+        p += 2;
+    }
+    if( p >= end_ )
+        fail("unterminated string constant (expected \")");
+    current_ = p + 1;
+    tok.type = json_token::STRING;
+    if( escaped && decode_strings_ ) {
+        decode_string(start, p);
+        tok.value = tstring(decoded_);
+    } else {
+        tok.value = tstring(start, p - start);
+    }
+}
+
+static int json_hex_value(int c)
+{
+    if( c >= '0' && c <= '9' ) return c - '0';
+    if( c >= 'a' && c <= 'f' ) return c - 'a' + 10;
+    if( c >= 'A' && c <= 'F' ) return c - 'A' + 10;
+    return -1;
+}
+
+static void append_utf8(std::string& out, unsigned long cp)
+{
+    if( cp < 0x80 ) {
+        out += static_cast<char>(cp);
+    } else if( cp < 0x800 ) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if( cp < 0x10000 ) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+void json_buffer_lexer::decode_string(const char* p, const char* end)
+{
+    decoded_.clear();
+    while( p < end ) {
+        const char* plain = p;
+        while( p < end && *p != '\\' )
+            ++p;
+        decoded_.append(plain, p - plain);
+        if( p == end )
+            break;
+        ++p; // skip '\\'
+        switch( *p ) {
+        case '"':  decoded_ += '"'; break;
+        case '\\': decoded_ += '\\'; break;
+        case '/':  decoded_ += '/'; break;
+        case 'b':  decoded_ += '\b'; break;
+        case 'f':  decoded_ += '\f'; break;
+        case 'n':  decoded_ += '\n'; break;
+        case 'r':  decoded_ += '\r'; break;
+        case 't':  decoded_ += '\t'; break;
+        case 'u':
+            {
+                unsigned long cp = 0;
+                for( int i = 0; i < 4; ++i ) {
+                    const int h = (p + 1 < end) ? json_hex_value(*++p) : -1;
+                    if( h < 0 )
+                        fail("invalid '\\uXXXX' expression, expecting 4 hex digits");
+                    cp = (cp << 4) | h;
+                }
+                // surrogate pair
+                if( cp >= 0xD800 && cp < 0xDC00 && end - p > 6 && p[1] == '\\' && p[2] == 'u' ) {
+                    unsigned long low = 0;
+                    bool valid = true;
+                    for( int i = 3; i < 7; ++i ) {
+                        const int h = json_hex_value(p[i]);
+                        if( h < 0 ) {
+                            valid = false;
+                            break;
+                        }
+                        low = (low << 4) | h;
+                    }
+                    if( valid && low >= 0xDC00 && low < 0xE000 ) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+                }
+                append_utf8(decoded_, cp);
+            }
+            break;
+        default:
+            fail("unknown escape character");
+        }
+        ++p;
+    }
+}
+
+void json_buffer_lexer::lex_number(json_token& tok)
+{
+    const char* start = current_;
+    json_token::token_type type = json_token::INTEGER;
+    while( current_ < end_ ) {
+        const char c = *current_;
+        if( (c >= '0' && c <= '9') || c == '-' || c == '+' ) {
+            ++current_;
+        } else if( c == '.' || c == 'e' || c == 'E' ) {
+            type = json_token::DOUBLE;
+            ++current_;
+        } else {
+            break;
+        }
+    }
+    tok.type = type;
+    tok.value = tstring(start, current_ - start);
+}
+
+void json_buffer_lexer::lex_keyword(const char* keyword, size_t length)
+{
+    if( static_cast<size_t>(end_ - current_) < length || std::memcmp(current_, keyword, length) != 0 )
+        fail(tsprintf("bad keyword, expected %s", keyword));
+    current_ += length;
+}
+
 } // end namespace tinfra
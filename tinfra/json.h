@@ -13,11 +13,14 @@
 
 #include <memory>
 #include <stack>
+#include <map>
+#include <vector>
 
 namespace tinfra {
 
 class input_stream;
 class output_stream;
+struct json_scanner;
 
 enum json_encoding {
     UTF8,
@@ -62,6 +65,16 @@ struct json_token {
 
 std::ostream& operator <<(std::ostream& s, json_token::token_type tt);
 
+/// JSON lexer reading from stream.
+///
+/// Plain streams are read only as far as needed, lexer looks at most
+/// few bytes past end of value, so rest of stream can be read after
+/// value by caller (framed protocols, concatenated documents).
+///
+/// If stream is buffered_input_stream, its buffer is scanned in
+/// place (much faster for long strings and whitespace runs) and
+/// only lexed bytes are consumed from it when lexer is destroyed;
+/// stream must not be read while lexer is in use.
 class json_lexer: public generator_impl<json_lexer, json_token> {
 public:
     json_lexer(tinfra::input_stream& s);
@@ -74,6 +87,44 @@ private:
     std::auto_ptr<internal_data> self;
 };
 
+/// JSON lexer working on memory buffer.
+///
+/// Token values are views into input, except strings with escapes,
+/// which are decoded into internal buffer. In both cases value is
+/// valid until next call to fetch_next().
+///
+/// Input is expected in UTF-8, \uXXXX escapes are decoded to UTF-8.
+class json_buffer_lexer: public generator_impl<json_buffer_lexer, json_token> {
+public:
+    explicit json_buffer_lexer(tstring const& input);
+    ~json_buffer_lexer();
+
+    bool   fetch_next(json_token&);
+
+    /// Offset of first byte not yet consumed.
+    size_t position() const { return current_ - begin_; }
+
+    /// Enable/disable decoding of escaped strings.
+    ///
+    /// When disabled, value of string token with escapes is its raw,
+    /// not decoded content. Useful when tokens are only skipped.
+    void   set_decode_strings(bool decode) { decode_strings_ = decode; }
+
+private:
+    void   lex_string(json_token&);
+    void   lex_number(json_token&);
+    void   lex_keyword(const char* keyword, size_t length);
+    void   decode_string(const char* start, const char* end);
+    void   fail(std::string const& message);
+
+    const char* begin_;
+    const char* current_;
+    const char* end_;
+    json_scanner const* scanner_;
+    bool        decode_strings_;
+    std::string decoded_;
+};
+
 class json_renderer {
     tinfra::output_stream& out;
     json_encoding   enc;
@@ -135,6 +186,8 @@ private:
     template <typename K, typename T>
     void value_impl(std::map<K,T> const& v);
 
+    void value_impl(variant_dict const& v);
+
     json_renderer& renderer;
     enum container_type { OBJECT, ARRAY };
     std::stack<container_type> stack;
@@ -0,0 +1,422 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "json_document.h" // we implement this
+
+#include "tinfra/json.h"
+#include "tinfra/fmt.h"
+
+#include <stdexcept>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+namespace tinfra {
+
+//
+// json_document
+//
+
+json_document::json_document()
+{
+}
+
+json_document::json_document(tstring const& input)
+{
+    parse(input);
+}
+
+json_document::~json_document()
+{
+    clear();
+}
+
+void json_document::clear()
+{
+    nodes_.clear();
+    decoded_.clear();
+    input_ = tstring();
+    file_.close();
+}
+
+void json_document::parse(tstring const& input)
+{
+    clear();
+    build(input);
+}
+
+void json_document::load(tstring const& filename)
+{
+    clear();
+    file_.open(filename, MFM_READ | MFM_SEQUENTIAL);
+    build(file_.content());
+}
+
+json_cursor json_document::root() const
+{
+    if( nodes_.empty() )
+        return json_cursor();
+    return json_cursor(this, 0, nodes_.size());
+}
+
+size_t json_document::subtree_end(size_t index) const
+{
+    node const& n = nodes_[index];
+    if( n.type == OBJECT || n.type == ARRAY )
+        return n.end;
+    return index + 1;
+}
+
+tstring json_document::string_value(size_t index) const
+{
+    node const& n = nodes_[index];
+    if( (n.flags & DECODED) == 0 )
+        return tstring(input_.data() + n.offset, n.length);
+    return tstring(decoded_[n.end]);
+}
+
+void json_document::decode_string(node& n)
+{
+    if( !std::memchr(input_.data() + n.offset, '\\', n.length) )
+        return;
+    // lex quoted literal again, this time with decoding
+    json_buffer_lexer lexer(tstring(input_.data() + n.offset - 1, n.length + 2));
+    json_token tok;
+    lexer.fetch_next(tok);
+    decoded_.push_back(tok.value.str());
+    n.end = static_cast<unsigned>(decoded_.size() - 1);
+    n.flags |= DECODED;
+}
+
+namespace {
+
+enum build_state {
+    EXPECT_VALUE,
+    EXPECT_VALUE_OR_ARRAY_END,
+    EXPECT_KEY,
+    EXPECT_KEY_OR_OBJECT_END,
+    EXPECT_COLON,
+    EXPECT_SEPARATOR,
+    EXPECT_EOF
+};
+
+void json_document_fail(json_buffer_lexer const& lexer, std::string const& message)
+{
+    throw std::runtime_error(tsprintf("json_document: %s at offset %i", message, lexer.position()));
+}
+
+} // end anonymous namespace
+
+int json_document::close_container(std::vector<unsigned>& stack)
+{
+    nodes_[stack.back()].end = static_cast<unsigned>(nodes_.size());
+    stack.pop_back();
+    return stack.empty() ? EXPECT_EOF : EXPECT_SEPARATOR;
+}
+
+void json_document::build(tstring const& input)
+{
+    if( input.size() >= std::numeric_limits<unsigned>::max() )
+        throw std::runtime_error("json_document: input too big");
+    input_ = input;
+    // rough estimate, avoids most of reallocations on typical input
+    nodes_.reserve(input.size() / 12 + 1);
+
+    json_buffer_lexer lexer(input);
+    lexer.set_decode_strings(false);
+
+    std::vector<unsigned> stack; // indexes of open containers
+    int state = EXPECT_VALUE;
+    json_token tok;
+    while( lexer.fetch_next(tok) ) {
+        switch( state ) {
+        case EXPECT_EOF:
+            json_document_fail(lexer, "expected end of input after top-level value");
+            break;
+        case EXPECT_COLON:
+            if( tok.type != json_token::COLON )
+                json_document_fail(lexer, tsprintf("expected ':' after key, but found %s", tok.type));
+            state = EXPECT_VALUE;
+            continue;
+        case EXPECT_SEPARATOR:
+            {
+                node& container = nodes_[stack.back()];
+                if( tok.type == json_token::COMMA ) {
+                    state = (container.type == OBJECT) ? EXPECT_KEY : EXPECT_VALUE;
+                    continue;
+                }
+                if( !(tok.type == json_token::OBJECT_END && container.type == OBJECT) &&
+                    !(tok.type == json_token::ARRAY_END  && container.type == ARRAY) )
+                {
+                    json_document_fail(lexer, tsprintf("expected ',' or end of %s, but found %s",
+                                       container.type == OBJECT ? "object" : "array", tok.type));
+                }
+            }
+            state = close_container(stack);
+            continue;
+        case EXPECT_KEY_OR_OBJECT_END:
+            if( tok.type == json_token::OBJECT_END ) {
+                state = close_container(stack);
+                continue;
+            }
+            // fall through
+        case EXPECT_KEY:
+            {
+                if( tok.type != json_token::STRING )
+                    json_document_fail(lexer, tsprintf("expected key string, but found %s", tok.type));
+                node n;
+                n.type = KEY;
+                n.flags = 0;
+                n.offset = static_cast<unsigned>(tok.value.data() - input.data());
+                n.length = static_cast<unsigned>(tok.value.size());
+                n.end = 0;
+                decode_string(n);
+                nodes_[stack.back()].length += 1;
+                nodes_.push_back(n);
+                state = EXPECT_COLON;
+                continue;
+            }
+        case EXPECT_VALUE_OR_ARRAY_END:
+            if( tok.type == json_token::ARRAY_END ) {
+                state = close_container(stack);
+                continue;
+            }
+            // fall through
+        case EXPECT_VALUE:
+            {
+                node n;
+                n.flags = 0;
+                n.offset = 0;
+                n.length = 0;
+                n.end = 0;
+                switch( tok.type ) {
+                case json_token::OBJECT_BEGIN: n.type = OBJECT; break;
+                case json_token::ARRAY_BEGIN:  n.type = ARRAY;  break;
+                case json_token::STRING:       n.type = STRING; break;
+                case json_token::INTEGER:      n.type = INTEGER; break;
+                case json_token::DOUBLE:       n.type = DOUBLE; break;
+                case json_token::TOK_TRUE:     n.type = BOOLEAN; n.flags = BOOL_TRUE; break;
+                case json_token::TOK_FALSE:    n.type = BOOLEAN; break;
+                case json_token::TOK_NULL:     n.type = NONE; break;
+                default:
+                    json_document_fail(lexer, tsprintf("expected value, but found %s", tok.type));
+                }
+                if( n.type == STRING || n.type == INTEGER || n.type == DOUBLE ) {
+                    n.offset = static_cast<unsigned>(tok.value.data() - input.data());
+                    n.length = static_cast<unsigned>(tok.value.size());
+                }
+                if( n.type == STRING )
+                    decode_string(n);
+                if( !stack.empty() && nodes_[stack.back()].type == ARRAY )
+                    nodes_[stack.back()].length += 1;
+                if( n.type == OBJECT || n.type == ARRAY ) {
+                    stack.push_back(static_cast<unsigned>(nodes_.size()));
+                    state = (n.type == OBJECT) ? EXPECT_KEY_OR_OBJECT_END : EXPECT_VALUE_OR_ARRAY_END;
+                } else {
+                    state = stack.empty() ? EXPECT_EOF : EXPECT_SEPARATOR;
+                }
+                nodes_.push_back(n);
+                continue;
+            }
+        }
+    }
+    if( state != EXPECT_EOF ) {
+        if( nodes_.empty() )
+            json_document_fail(lexer, "empty document");
+        json_document_fail(lexer, "unexpected end of input");
+    }
+}
+
+//
+// json_cursor
+//
+
+void json_cursor::fail(std::string const& message) const
+{
+    throw std::runtime_error(tsprintf("json_cursor: %s", message));
+}
+
+void json_cursor::check_valid() const
+{
+    if( !doc_ )
+        fail("null cursor");
+}
+
+json_document::node const& json_cursor::node() const
+{
+    check_valid();
+    return doc_->nodes_[index_];
+}
+
+json_document::node_type json_cursor::type() const
+{
+    return static_cast<json_document::node_type>(node().type);
+}
+
+json_cursor json_cursor::item(size_t index, size_t parent_end) const
+{
+    // object items start with KEY, cursor points at value
+    if( doc_->nodes_[index].type == json_document::KEY )
+        index += 1;
+    return json_cursor(doc_, index, parent_end);
+}
+
+size_t json_cursor::size() const
+{
+    if( !doc_ )
+        return 0;
+    json_document::node const& n = node();
+    if( n.type == json_document::OBJECT || n.type == json_document::ARRAY )
+        return n.length;
+    return 0;
+}
+
+json_cursor json_cursor::operator[](tstring const& key) const
+{
+    if( !is_object() )
+        return json_cursor();
+    const size_t end = node().end;
+    size_t i = index_ + 1;
+    while( i < end ) {
+        // i points at KEY, value follows
+        if( doc_->string_value(i) == key )
+            return json_cursor(doc_, i+1, end);
+        i = doc_->subtree_end(i+1);
+    }
+    return json_cursor();
+}
+
+json_cursor json_cursor::operator[](size_t index) const
+{
+    if( !is_array() || index >= node().length )
+        return json_cursor();
+    const size_t end = node().end;
+    size_t i = index_ + 1;
+    while( index-- > 0 )
+        i = doc_->subtree_end(i);
+    return json_cursor(doc_, i, end);
+}
+
+json_cursor json_cursor::first() const
+{
+    if( size() == 0 )
+        return json_cursor();
+    return item(index_ + 1, node().end);
+}
+
+json_cursor json_cursor::next() const
+{
+    if( !doc_ )
+        return json_cursor();
+    const size_t i = doc_->subtree_end(index_);
+    if( i >= parent_end_ )
+        return json_cursor();
+    return item(i, parent_end_);
+}
+
+tstring json_cursor::key() const
+{
+    if( !doc_ || index_ == 0 || doc_->nodes_[index_-1].type != json_document::KEY )
+        return tstring();
+    return doc_->string_value(index_-1);
+}
+
+tstring json_cursor::get_string() const
+{
+    if( type() != json_document::STRING )
+        fail("expected string");
+    return doc_->string_value(index_);
+}
+
+tstring json_cursor::raw() const
+{
+    json_document::node const& n = node();
+    if( n.type == json_document::OBJECT || n.type == json_document::ARRAY )
+        return tstring();
+    return tstring(doc_->input_.data() + n.offset, n.length);
+}
+
+/// copy number literal into null terminated buffer for strto*()
+static void number_literal(json_cursor const& c, char* buf, size_t size)
+{
+    const tstring v = c.raw();
+    if( v.size() >= size )
+        throw std::runtime_error("json_cursor: number literal too long");
+    std::memcpy(buf, v.data(), v.size());
+    buf[v.size()] = 0;
+}
+
+variant::integer_type json_cursor::get_integer() const
+{
+    if( type() != json_document::INTEGER )
+        fail("expected integer");
+    char buf[64];
+    number_literal(*this, buf, sizeof(buf));
+    char* end;
+    errno = 0;
+    const variant::integer_type result = ::strtoll(buf, &end, 10);
+    if( *end != 0 || errno == ERANGE )
+        fail(tsprintf("invalid integer '%s'", buf));
+    return result;
+}
+
+double json_cursor::get_double() const
+{
+    const json_document::node_type t = type();
+    if( t != json_document::INTEGER && t != json_document::DOUBLE )
+        fail("expected number");
+    char buf[64];
+    number_literal(*this, buf, sizeof(buf));
+    char* end;
+    const double result = std::strtod(buf, &end);
+    if( *end != 0 )
+        fail(tsprintf("invalid number '%s'", buf));
+    return result;
+}
+
+bool json_cursor::get_bool() const
+{
+    if( type() != json_document::BOOLEAN )
+        fail("expected boolean");
+    return (node().flags & json_document::BOOL_TRUE) != 0;
+}
+
+variant json_cursor::to_variant() const
+{
+    variant result;
+    switch( type() ) {
+    case json_document::OBJECT:
+        result = variant::dict();
+        for( json_cursor c = first(); c; c = c.next() )
+            result[c.key().str()] = c.to_variant();
+        break;
+    case json_document::ARRAY:
+        result = variant::array();
+        for( json_cursor c = first(); c; c = c.next() )
+            result[result.size()] = c.to_variant();
+        break;
+    case json_document::STRING:
+        result.set_string(get_string().str());
+        break;
+    case json_document::INTEGER:
+        result.set_integer(get_integer());
+        break;
+    case json_document::DOUBLE:
+        result.set_double(get_double());
+        break;
+    case json_document::BOOLEAN:
+        result.set_bool(get_bool());
+        break;
+    case json_document::NONE:
+    case json_document::KEY:
+        break;
+    }
+    return result;
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_json_document_h_included
+#define tinfra_json_document_h_included
+
+#include "tstring.h"
+#include "variant.h"
+#include "mapped_file.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+
+namespace tinfra {
+
+class json_cursor;
+
+/// Read-only JSON document.
+///
+/// Whole document is parsed into one flat array of nodes stored in
+/// document order; containers know where their subtree ends, so
+/// siblings are reached without touching children. Scalars and keys
+/// are views into input. Strings with escapes are decoded while
+/// parsing and kept in document.
+///
+/// Document built from tstring doesn't copy input, so input must
+/// outlive document. Document loaded from file keeps file mapped
+/// into memory (or read into buffer where mmap is not available).
+///
+/// Usage:
+/// <pre>
+///   json_document doc;
+///   doc.load("catalog.json");
+///   json_cursor books = doc.root()["books"];
+///   for( json_cursor b = books.first(); b; b = b.next() )
+///       std::cout << b["name"].get_string() << "\n";
+/// </pre>
+///
+/// Grammar errors are reported with std::runtime_error.
+/// Document is not modified after parse() or load(), so it can be
+/// read from many threads concurrently.
+class json_document {
+public:
+    enum node_type {
+        OBJECT,
+        ARRAY,
+        STRING,
+        INTEGER,
+        DOUBLE,
+        BOOLEAN,
+        NONE,
+        KEY
+    };
+
+    json_document();
+    /// Parse input, input is not copied.
+    explicit json_document(tstring const& input);
+    ~json_document();
+
+    /// Parse input, input is not copied.
+    void         parse(tstring const& input);
+
+    /// Map (or read) file and parse it.
+    void         load(tstring const& filename);
+
+    /// Cursor pointing at top-level value.
+    json_cursor  root() const;
+
+    /// Number of nodes, each key and value is a node.
+    size_t       node_count() const { return nodes_.size(); }
+
+    tstring      input() const { return input_; }
+
+private:
+    friend class json_cursor;
+
+    /// Node of flat document tree.
+    ///
+    /// For scalars, offset/length describe literal in input (for
+    /// strings and keys without quotes); for containers, length is
+    /// number of items (key-value pairs in objects) and end is index
+    /// of first node after subtree. For strings with escapes, end is
+    /// index in decoded_. Object items are stored as KEY node immediately
+    /// followed by value subtree.
+    struct node {
+        unsigned char type;
+        unsigned char flags;
+        unsigned      offset;
+        unsigned      length;
+        unsigned      end;
+    };
+
+    enum node_flags {
+        DECODED = 1,   // string has escapes, end is index in decoded_
+        BOOL_TRUE = 2
+    };
+
+    void         clear();
+    void         build(tstring const& input);
+    int          close_container(std::vector<unsigned>& stack);
+    void         decode_string(node& n);
+    size_t       subtree_end(size_t index) const;
+    tstring      string_value(size_t index) const;
+
+    tstring                         input_;
+    std::vector<node>               nodes_;
+    std::deque<std::string>         decoded_;
+
+    // file backing store, see load()
+    mapped_file                     file_;
+
+    // noncopyable
+    json_document(json_document const&);
+    json_document& operator=(json_document const&);
+};
+
+/// Lightweight pointer to node of json_document.
+///
+/// Cursor is valid as long as document is alive. Default constructed
+/// cursor and cursors returned for missing items are null (evaluate
+/// to false); navigating from null cursor yields null cursor, while
+/// reading value of null cursor throws std::runtime_error.
+class json_cursor {
+public:
+    json_cursor(): doc_(0), index_(0), parent_end_(0) {}
+
+    bool        valid() const { return doc_ != 0; }
+    operator    const void*() const { return doc_; }
+
+    json_document::node_type type() const;
+
+    bool        is_object() const { return valid() && type() == json_document::OBJECT; }
+    bool        is_array() const  { return valid() && type() == json_document::ARRAY; }
+    bool        is_null() const   { return valid() && type() == json_document::NONE; }
+
+    /// Number of items in object or array, 0 for scalars.
+    size_t      size() const;
+
+    /// Object member by key, null if there is no such key.
+    json_cursor operator[](tstring const& key) const;
+    json_cursor operator[](const char* key) const { return (*this)[tstring(key)]; }
+    /// Array item by index, null if out of range.
+    json_cursor operator[](size_t index) const;
+    json_cursor operator[](int index) const { return (*this)[static_cast<size_t>(index)]; }
+
+    /// First item of object or array.
+    ///
+    /// For objects, cursor points at value; key() returns its key.
+    json_cursor first() const;
+    /// Next sibling in parent container, null after last item.
+    json_cursor next() const;
+
+    /// Key of object member, empty for other nodes.
+    tstring     key() const;
+
+    // typed access, throw std::runtime_error on type mismatch
+    tstring               get_string() const;
+    variant::integer_type get_integer() const;
+    double                get_double() const; // accepts also INTEGER
+    bool                  get_bool() const;
+
+    /// Raw text of value in input.
+    ///
+    /// Literal of numbers, undecoded content of strings, empty for
+    /// containers, booleans and null.
+    tstring     raw() const;
+
+    /// Convert subtree to variant.
+    variant     to_variant() const;
+
+    bool operator==(json_cursor const& other) const { return doc_ == other.doc_ && index_ == other.index_; }
+    bool operator!=(json_cursor const& other) const { return !(*this == other); }
+
+private:
+    friend class json_document;
+    json_cursor(json_document const* doc, size_t index, size_t parent_end):
+        doc_(doc), index_(index), parent_end_(parent_end) {}
+
+    json_document::node const& node() const;
+    json_cursor item(size_t index, size_t parent_end) const;
+    void        check_valid() const;
+    void        fail(std::string const& message) const;
+
+    json_document const* doc_;
+    size_t               index_;
+    size_t               parent_end_;
+};
+
+} // end namespace tinfra
+
+#endif // tinfra_json_document_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,310 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "json_reader.h" // we implement this
+
+#include "tinfra/fmt.h"
+
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+namespace tinfra {
+
+json_reader::json_reader(tstring const& input):
+    buffer_lexer_(new json_buffer_lexer(input)),
+    state_(EXPECT_VALUE),
+    type_(NONE),
+    bool_value_(false)
+{
+}
+
+json_reader::json_reader(tinfra::input_stream& input):
+    stream_lexer_(new json_lexer(input)),
+    state_(EXPECT_VALUE),
+    type_(NONE),
+    bool_value_(false)
+{
+}
+
+json_reader::~json_reader()
+{
+}
+
+void json_reader::fail(std::string const& message) const
+{
+    if( buffer_lexer_.get() )
+        throw std::runtime_error(tsprintf("json_reader: %s at offset %i", message, buffer_lexer_->position()));
+    else
+        throw std::runtime_error(tsprintf("json_reader: %s", message));
+}
+
+bool json_reader::fetch(json_token& tok)
+{
+    if( buffer_lexer_.get() )
+        return buffer_lexer_->fetch_next(tok);
+    else
+        return stream_lexer_->fetch_next(tok);
+}
+
+bool json_reader::next()
+{
+    json_token tok;
+    while( true ) {
+        if( state_ == FINISHED )
+            return false;
+        if( !fetch(tok) ) {
+            // empty input is empty document
+            if( state_ == EXPECT_EOF || (state_ == EXPECT_VALUE && stack_.empty()) ) {
+                state_ = FINISHED;
+                return false;
+            }
+            fail("unexpected end of input");
+        }
+        switch( state_ ) {
+        case EXPECT_KEY_OR_OBJECT_END:
+            if( tok.type == json_token::OBJECT_END ) {
+                close(OBJECT_END, 'o');
+                return true;
+            }
+            read_key(tok);
+            return true;
+        case EXPECT_KEY:
+            read_key(tok);
+            return true;
+        case EXPECT_COLON:
+            if( tok.type != json_token::COLON )
+                fail(tsprintf("expected ':' after key, but found %s", tok.type));
+            state_ = EXPECT_VALUE;
+            continue;
+        case EXPECT_VALUE_OR_ARRAY_END:
+            if( tok.type == json_token::ARRAY_END ) {
+                close(ARRAY_END, 'a');
+                return true;
+            }
+            read_value(tok);
+            return true;
+        case EXPECT_VALUE:
+            read_value(tok);
+            return true;
+        case EXPECT_SEPARATOR:
+            if( tok.type == json_token::COMMA ) {
+                state_ = (stack_.back() == 'o') ? EXPECT_KEY : EXPECT_VALUE;
+                continue;
+            }
+            if( tok.type == json_token::OBJECT_END && stack_.back() == 'o' ) {
+                close(OBJECT_END, 'o');
+                return true;
+            }
+            if( tok.type == json_token::ARRAY_END && stack_.back() == 'a' ) {
+                close(ARRAY_END, 'a');
+                return true;
+            }
+            fail(tsprintf("expected ',' or end of %s, but found %s",
+                          stack_.back() == 'o' ? "object" : "array", tok.type));
+            break;
+        case EXPECT_EOF:
+            fail("expected end of input after top-level value");
+            break;
+        case FINISHED:
+            break;
+        }
+    }
+}
+
+void json_reader::next_or_fail()
+{
+    if( !next() )
+        fail("unexpected end of input");
+}
+
+void json_reader::read_key(json_token const& tok)
+{
+    if( tok.type != json_token::STRING )
+        fail(tsprintf("expected key string, but found %s", tok.type));
+    type_ = KEY;
+    value_ = tok.value;
+    state_ = EXPECT_COLON;
+}
+
+void json_reader::read_value(json_token const& tok)
+{
+    value_ = tstring();
+    switch( tok.type ) {
+    case json_token::OBJECT_BEGIN:
+        type_ = OBJECT_BEGIN;
+        stack_.push_back('o');
+        state_ = EXPECT_KEY_OR_OBJECT_END;
+        return;
+    case json_token::ARRAY_BEGIN:
+        type_ = ARRAY_BEGIN;
+        stack_.push_back('a');
+        state_ = EXPECT_VALUE_OR_ARRAY_END;
+        return;
+    case json_token::STRING:
+        type_ = STRING;
+        value_ = tok.value;
+        break;
+    case json_token::INTEGER:
+        type_ = INTEGER;
+        value_ = tok.value;
+        break;
+    case json_token::DOUBLE:
+        type_ = DOUBLE;
+        value_ = tok.value;
+        break;
+    case json_token::TOK_TRUE:
+        type_ = BOOLEAN;
+        bool_value_ = true;
+        break;
+    case json_token::TOK_FALSE:
+        type_ = BOOLEAN;
+        bool_value_ = false;
+        break;
+    case json_token::TOK_NULL:
+        type_ = NONE;
+        break;
+    default:
+        fail(tsprintf("expected value, but found %s", tok.type));
+    }
+    after_value();
+}
+
+void json_reader::close(event_type t, char container)
+{
+    TINFRA_ASSERT(!stack_.empty() && stack_.back() == container);
+    stack_.pop_back();
+    type_ = t;
+    value_ = tstring();
+    after_value();
+}
+
+void json_reader::after_value()
+{
+    state_ = stack_.empty() ? EXPECT_EOF : EXPECT_SEPARATOR;
+}
+
+void json_reader::expect(event_type t) const
+{
+    static const char* names[] = {
+        "object begin", "object end", "array begin", "array end",
+        "key", "string", "integer", "double", "boolean", "null"
+    };
+    if( type_ != t )
+        fail(tsprintf("expected %s, but found %s", names[t], names[type_]));
+}
+
+tstring json_reader::get_string() const
+{
+    if( type_ != KEY )
+        expect(STRING);
+    return value_;
+}
+
+/// copy number literal into null terminated buffer for strto*()
+static void number_literal(json_reader const& reader, char* buf, size_t size)
+{
+    tstring const& v = reader.value();
+    if( v.size() >= size )
+        reader.fail("number literal too long");
+    std::memcpy(buf, v.data(), v.size());
+    buf[v.size()] = 0;
+}
+
+variant::integer_type json_reader::get_integer() const
+{
+    expect(INTEGER);
+    char buf[64];
+    number_literal(*this, buf, sizeof(buf));
+    char* end;
+    errno = 0;
+    const variant::integer_type result = ::strtoll(buf, &end, 10);
+    if( *end != 0 || errno == ERANGE )
+        fail(tsprintf("invalid integer '%s'", buf));
+    return result;
+}
+
+double json_reader::get_double() const
+{
+    if( type_ != INTEGER )
+        expect(DOUBLE);
+    char buf[64];
+    number_literal(*this, buf, sizeof(buf));
+    char* end;
+    const double result = std::strtod(buf, &end);
+    if( *end != 0 )
+        fail(tsprintf("invalid number '%s'", buf));
+    return result;
+}
+
+bool json_reader::get_bool() const
+{
+    expect(BOOLEAN);
+    return bool_value_;
+}
+
+void json_reader::skip_value()
+{
+    if( type_ == KEY )
+        next_or_fail();
+    if( type_ != OBJECT_BEGIN && type_ != ARRAY_BEGIN )
+        return;
+
+    const size_t d = depth();
+    if( buffer_lexer_.get() )
+        buffer_lexer_->set_decode_strings(false);
+    while( depth() >= d )
+        next_or_fail();
+    if( buffer_lexer_.get() )
+        buffer_lexer_->set_decode_strings(true);
+}
+
+void json_read_leaf(json_reader& reader, variant& v)
+{
+    switch( reader.type() ) {
+    case json_reader::OBJECT_BEGIN:
+        v = variant::dict();
+        while( true ) {
+            reader.next_or_fail();
+            if( reader.type() == json_reader::OBJECT_END )
+                break;
+            variant& item = v[reader.value().str()];
+            reader.next_or_fail();
+            json_read_leaf(reader, item);
+        }
+        break;
+    case json_reader::ARRAY_BEGIN:
+        v = variant::array();
+        while( true ) {
+            reader.next_or_fail();
+            if( reader.type() == json_reader::ARRAY_END )
+                break;
+            json_read_leaf(reader, v[v.size()]);
+        }
+        break;
+    case json_reader::STRING:
+        v.set_string(reader.get_string().str());
+        break;
+    case json_reader::INTEGER:
+        v.set_integer(reader.get_integer());
+        break;
+    case json_reader::DOUBLE:
+        v.set_double(reader.get_double());
+        break;
+    case json_reader::BOOLEAN:
+        v.set_bool(reader.get_bool());
+        break;
+    case json_reader::NONE:
+        v = variant();
+        break;
+    default:
+        reader.fail("expected value");
+    }
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
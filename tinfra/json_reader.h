@@ -0,0 +1,283 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_json_reader_h_included
+#define tinfra_json_reader_h_included
+
+#include "json.h"
+#include "mo.h"
+#include "tstring.h"
+#include "variant.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tinfra {
+
+class input_stream;
+
+/// Streaming (pull) JSON reader.
+///
+/// Reads JSON document event by event without building any tree.
+/// When constructed on memory buffer, values are views into that
+/// buffer (only strings with escapes are decoded into internal
+/// buffer); in both cases value() is valid until next call to next().
+///
+/// Usage:
+/// <pre>
+///   json_reader reader(input);
+///   while( reader.next() ) {
+///       switch( reader.type() ) {
+///       case json_reader::KEY: ...
+///       }
+///   }
+/// </pre>
+///
+/// Grammar errors are reported with std::runtime_error.
+class json_reader {
+public:
+    enum event_type {
+        OBJECT_BEGIN,
+        OBJECT_END,
+        ARRAY_BEGIN,
+        ARRAY_END,
+        KEY,
+        STRING,
+        INTEGER,
+        DOUBLE,
+        BOOLEAN,
+        NONE
+    };
+
+    /// Read from memory, values are views into input.
+    explicit json_reader(tstring const& input);
+
+    /// Read from stream.
+    explicit json_reader(tinfra::input_stream& input);
+
+    ~json_reader();
+
+    /// Advance to next event.
+    ///
+    /// Returns false at end of document.
+    bool           next();
+
+    /// Advance to next event, throw if there is none.
+    void           next_or_fail();
+
+    event_type     type() const { return type_; }
+
+    /// Raw value of current event.
+    ///
+    /// Content of KEY and STRING, literal of INTEGER and DOUBLE,
+    /// empty for other events.
+    tstring const& value() const { return value_; }
+
+    /// Number of currently open objects and arrays.
+    ///
+    /// OBJECT_BEGIN and ARRAY_BEGIN already count opened container,
+    /// OBJECT_END and ARRAY_END don't count closed one.
+    size_t         depth() const { return stack_.size(); }
+
+    // typed access to current value, throw std::runtime_error
+    // if current event has different type
+    tstring               get_string() const;
+    variant::integer_type get_integer() const;
+    double                get_double() const; // accepts also INTEGER
+    bool                  get_bool() const;
+    bool                  is_null() const { return type_ == NONE; }
+
+    /// Skip value starting at current event.
+    ///
+    /// If current event is KEY, it's skipped together with its value.
+    /// If current event starts object or array, whole subtree is
+    /// skipped without decoding strings. After call current event is
+    /// last event of skipped value.
+    void           skip_value();
+
+    /// Throw std::runtime_error unless current event is of type t.
+    void           expect(event_type t) const;
+
+    /// Throw std::runtime_error with position information.
+    void           fail(std::string const& message) const;
+
+private:
+    enum state {
+        EXPECT_VALUE,
+        EXPECT_VALUE_OR_ARRAY_END,
+        EXPECT_KEY,
+        EXPECT_KEY_OR_OBJECT_END,
+        EXPECT_COLON,
+        EXPECT_SEPARATOR,
+        EXPECT_EOF,
+        FINISHED
+    };
+
+    bool           fetch(json_token& tok);
+    void           read_value(json_token const& tok);
+    void           read_key(json_token const& tok);
+    void           close(event_type t, char container);
+    void           after_value();
+
+    std::auto_ptr<json_buffer_lexer> buffer_lexer_;
+    std::auto_ptr<json_lexer>        stream_lexer_;
+
+    state              state_;
+    std::vector<char>  stack_;  // 'o' - object, 'a' - array
+    event_type         type_;
+    tstring            value_;
+    bool               bool_value_;
+
+    // noncopyable
+    json_reader(json_reader const&);
+    json_reader& operator=(json_reader const&);
+};
+
+/// Read value starting at current event into MO target.
+///
+/// Objects are bound to structures declared with TINFRA_MO_MANIFEST
+/// (by field name, unknown keys are skipped), arrays to
+/// std::vector, scalars to strings, numbers and bools, anything
+/// to tinfra::variant. JSON null leaves target unchanged.
+template <typename T>
+void json_read(json_reader& reader, T& target);
+
+/// Parse whole document into MO target.
+template <typename T>
+void json_read(tstring const& input, T& target);
+
+//
+// leaf readers
+//
+
+template <typename T>
+void json_read_leaf(json_reader& reader, T& v)
+{
+    v = static_cast<T>(reader.get_integer());
+}
+
+inline void json_read_leaf(json_reader& reader, double& v)      { v = reader.get_double(); }
+inline void json_read_leaf(json_reader& reader, float& v)       { v = static_cast<float>(reader.get_double()); }
+inline void json_read_leaf(json_reader& reader, bool& v)        { v = reader.get_bool(); }
+inline void json_read_leaf(json_reader& reader, std::string& v) { v = reader.get_string().str(); }
+void        json_read_leaf(json_reader& reader, variant& v);
+
+//
+// implementation (templates)
+//
+
+namespace detail {
+
+struct json_mo_binder {
+    json_reader& reader;
+
+    explicit json_mo_binder(json_reader& r): reader(r) {}
+
+    template <typename S, typename T>
+    void leaf(S const&, T& v)
+    {
+        if( reader.is_null() )
+            return;
+        json_read_leaf(reader, v);
+    }
+
+    template <typename S, typename T>
+    void record(S const&, T& v);
+
+    template <typename S, typename T>
+    void sequence(S const&, T& v)
+    {
+        if( reader.is_null() )
+            return;
+        reader.expect(json_reader::ARRAY_BEGIN);
+        v.clear();
+        while( true ) {
+            reader.next_or_fail();
+            if( reader.type() == json_reader::ARRAY_END )
+                break;
+            typename T::value_type item = typename T::value_type();
+            tinfra::mutate(static_cast<const char*>(0), item, *this);
+            v.push_back(item);
+        }
+    }
+};
+
+/// Binds value of one key to field with the same name.
+struct json_mo_field_binder {
+    json_reader& reader;
+    tstring      key;
+    bool         found;
+
+    json_mo_field_binder(json_reader& r, tstring const& k):
+        reader(r),
+        key(k),
+        found(false)
+    {}
+
+    template <typename S, typename T>
+    void leaf(S const& sym, T& v)     { bind(sym, v); }
+
+    template <typename S, typename T>
+    void record(S const& sym, T& v)   { bind(sym, v); }
+
+    template <typename S, typename T>
+    void sequence(S const& sym, T& v) { bind(sym, v); }
+
+private:
+    template <typename S, typename T>
+    void bind(S const& sym, T& v)
+    {
+        if( found || !(key == sym) )
+            return;
+        found = true;
+        reader.next_or_fail();
+        json_mo_binder binder(reader);
+        tinfra::mutate(sym, v, binder);
+    }
+};
+
+template <typename S, typename T>
+void json_mo_binder::record(S const&, T& v)
+{
+    if( reader.is_null() )
+        return;
+    reader.expect(json_reader::OBJECT_BEGIN);
+    while( true ) {
+        reader.next_or_fail();
+        if( reader.type() == json_reader::OBJECT_END )
+            break;
+        json_mo_field_binder field_binder(reader, reader.value());
+        tinfra::mo_mutate(v, field_binder);
+        if( !field_binder.found )
+            reader.skip_value();
+    }
+}
+
+} // end namespace detail
+
+template <typename T>
+void json_read(json_reader& reader, T& target)
+{
+    detail::json_mo_binder binder(reader);
+    tinfra::mutate(static_cast<const char*>(0), target, binder);
+}
+
+template <typename T>
+void json_read(tstring const& input, T& target)
+{
+    json_reader reader(input);
+    if( !reader.next() )
+        reader.fail("empty document");
+    json_read(reader, target);
+    if( reader.next() )
+        reader.fail("expected end of input after value");
+}
+
+} // end namespace tinfra
+
+#endif // tinfra_json_reader_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,225 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "platform.h"
+
+#include "json_scan.h" // we implement this
+
+#ifdef TINFRA_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef TINFRA_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace tinfra {
+
+//
+// scalar
+//
+
+static inline bool json_is_whitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static const char* scalar_find_quote_or_escape(const char* p, const char* end)
+{
+    while( p < end && *p != '"' && *p != '\\' )
+        ++p;
+    return p;
+}
+
+static const char* scalar_skip_whitespace(const char* p, const char* end)
+{
+    while( p < end && json_is_whitespace(*p) )
+        ++p;
+    return p;
+}
+
+//
+// SSE2, 16-byte blocks
+//
+
+#ifdef TINFRA_SSE2
+
+static inline unsigned json_scan_ctz(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long r;
+    _BitScanForward(&r, mask);
+    return r;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static const char* sse2_find_quote_or_escape(const char* p, const char* end)
+{
+    const __m128i quote     = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while( end - p >= 16 ) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                                             _mm_cmpeq_epi8(block, backslash)));
+        if( mask != 0 )
+            return p + json_scan_ctz(mask);
+        p += 16;
+    }
+    return scalar_find_quote_or_escape(p, end);
+}
+
+static const char* sse2_skip_whitespace(const char* p, const char* end)
+{
+    // most of whitespace runs in JSON are single spaces
+    if( p < end && !json_is_whitespace(*p) )
+        return p;
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i nl    = _mm_set1_epi8('\n');
+    const __m128i cr    = _mm_set1_epi8('\r');
+    const __m128i tab   = _mm_set1_epi8('\t');
+    while( end - p >= 16 ) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, nl)),
+                                        _mm_or_si128(_mm_cmpeq_epi8(block, cr),    _mm_cmpeq_epi8(block, tab)));
+        const unsigned mask = ~_mm_movemask_epi8(ws) & 0xffff;
+        if( mask != 0 )
+            return p + json_scan_ctz(mask);
+        p += 16;
+    }
+    return scalar_skip_whitespace(p, end);
+}
+
+#endif // TINFRA_SSE2
+
+//
+// AVX2, 32-byte blocks, selected at runtime
+//
+
+#ifdef TINFRA_AVX2_DISPATCH
+
+// Note, rest of program is legacy SSE code, which is heavily
+// penalized when executed with dirty upper halves of ymm registers,
+// so avx2 functions clear them explicitly (compilers don't always
+// emit vzeroupper) and don't call sse2 functions.
+
+__attribute__((target("avx2")))
+static const char* avx2_find_quote_or_escape(const char* p, const char* end)
+{
+    if( end - p >= 32 ) {
+        const __m256i quote     = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        do {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            const unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, quote),
+                                                                       _mm256_cmpeq_epi8(block, backslash)));
+            if( mask != 0 ) {
+                _mm256_zeroupper();
+                return p + json_scan_ctz(mask);
+            }
+            p += 32;
+        } while( end - p >= 32 );
+        _mm256_zeroupper();
+    }
+    if( end - p >= 16 ) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+                                                             _mm_cmpeq_epi8(block, _mm_set1_epi8('\\'))));
+        if( mask != 0 )
+            return p + json_scan_ctz(mask);
+        p += 16;
+    }
+    while( p < end && *p != '"' && *p != '\\' )
+        ++p;
+    return p;
+}
+
+__attribute__((target("avx2")))
+static const char* avx2_skip_whitespace(const char* p, const char* end)
+{
+    // most of whitespace runs in JSON are single spaces
+    if( p < end && !json_is_whitespace(*p) )
+        return p;
+    if( end - p >= 32 ) {
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i nl    = _mm256_set1_epi8('\n');
+        const __m256i cr    = _mm256_set1_epi8('\r');
+        const __m256i tab   = _mm256_set1_epi8('\t');
+        do {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            const __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, nl)),
+                                               _mm256_or_si256(_mm256_cmpeq_epi8(block, cr),    _mm256_cmpeq_epi8(block, tab)));
+            const unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+            if( mask != 0 ) {
+                _mm256_zeroupper();
+                return p + json_scan_ctz(mask);
+            }
+            p += 32;
+        } while( end - p >= 32 );
+        _mm256_zeroupper();
+    }
+    while( p < end && json_is_whitespace(*p) )
+        ++p;
+    return p;
+}
+
+static bool cpu_has_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // TINFRA_AVX2_DISPATCH
+
+//
+// dispatch
+//
+
+static const json_scanner* init_available_scanners()
+{
+    static json_scanner scanners[4];
+    int n = 0;
+    const json_scanner scalar = { "scalar", &scalar_find_quote_or_escape, &scalar_skip_whitespace };
+    scanners[n++] = scalar;
+#ifdef TINFRA_SSE2
+    const json_scanner sse2 = { "sse2", &sse2_find_quote_or_escape, &sse2_skip_whitespace };
+    scanners[n++] = sse2;
+#endif
+#ifdef TINFRA_AVX2_DISPATCH
+    if( cpu_has_avx2() ) {
+        const json_scanner avx2 = { "avx2", &avx2_find_quote_or_escape, &avx2_skip_whitespace };
+        scanners[n++] = avx2;
+    }
+#endif
+    const json_scanner terminator = { 0, 0, 0 };
+    scanners[n] = terminator;
+    return scanners;
+}
+
+// initialized during static initialization, so before any thread
+// is started
+static const json_scanner* available_scanners = init_available_scanners();
+
+json_scanner const* json_available_scanners()
+{
+    if( !available_scanners )
+        available_scanners = init_available_scanners();
+    return available_scanners;
+}
+
+json_scanner const& json_default_scanner()
+{
+    json_scanner const* s = json_available_scanners();
+    while( s[1].name != 0 )
+        ++s;
+    return *s;
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
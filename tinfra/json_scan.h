@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_json_scan_h_included
+#define tinfra_json_scan_h_included
+
+namespace tinfra {
+
+/// Block scanner of UTF-8 JSON text.
+///
+/// Used by JSON lexers to find ends of string runs and whitespace
+/// runs in 16 or 32 byte blocks instead of byte by byte.
+///
+/// Each function returns pointer to first matching byte in
+/// [begin, end) or end if there is none; it never reads outside
+/// of [begin, end).
+struct json_scanner {
+    const char* name;
+
+    /// Find first '"' or '\\'.
+    const char* (*find_quote_or_escape)(const char* begin, const char* end);
+
+    /// Find first byte that is not JSON whitespace (' ', \t, \r, \n).
+    const char* (*skip_whitespace)(const char* begin, const char* end);
+};
+
+/// Best scanner supported by current CPU.
+///
+/// Selected once, on first use.
+json_scanner const& json_default_scanner();
+
+/// All scanners supported by current CPU, terminated by scanner with
+/// name == 0; first one is always scalar (portable) implementation.
+json_scanner const* json_available_scanners();
+
+} // end namespace tinfra
+
+#endif // tinfra_json_scan_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -25,6 +25,7 @@ void lazy_protocol::wait_for_bytes(size_t count, step_method method)
 void lazy_protocol::wait_for_delimiter(tstring const& delim, step_method method)
 {
     waiter_delim_.assign(delim.data(), delim.size());
+    waiter_scan_offset_ = 0;
     waiter_method_ = method;
     next(make_step_method(&lazy_protocol::maybe_have_delim));
 }
@@ -32,11 +33,17 @@ void lazy_protocol::wait_for_delimiter(tstring const& delim, step_method method)
 
 int lazy_protocol::maybe_have_delim(tstring const& input)
 {
-    size_t pos =  input.find_first_of(waiter_delim_.data(), waiter_delim_.size());
+    // input is guaranteed to start at the same place as in
+    // previous call, so resume scanning where previous scan ended
+    // (minus possible partial delimiter)
+    const size_t pos = input.find(tstring(waiter_delim_), waiter_scan_offset_);
     if( pos == tstring::npos ) {
+        const size_t partial = waiter_delim_.size() - 1;
+        waiter_scan_offset_ = input.size() > partial ? input.size() - partial : 0;
         again();
         return 0;
     }
+    waiter_scan_offset_ = 0;
     return call(waiter_method_, tstring(input.data(), pos));
 }
 
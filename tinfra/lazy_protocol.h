@@ -16,19 +16,39 @@
 
 namespace tinfra {
 
+/// Resumable protocol parser.
+///
+/// Protocol is written as sequence of step methods. Each step
+/// receives all unconsumed input and returns number of bytes
+/// it consumed. Driver (see protocol_connection) calls process()
+/// with unconsumed input until step calls again(), then it waits
+/// for more data and calls process() with the same unconsumed
+/// input extended with new bytes.
 class lazy_protocol: public interruptible<int, tstring> {
 public:
     lazy_protocol():
-        waiter_count_(0)
+        waiter_count_(0),
+        waiter_scan_offset_(0)
     {
     }
 protected:
+    /// Call method when at least count bytes are available.
+    ///
+    /// Method receives exactly count bytes.
     void wait_for_bytes(size_t count, step_method method);
+
+    /// Call method when delimiter is available in input.
+    ///
+    /// Method receives input preceding delimiter and should
+    /// return number of bytes consumed including delimiter.
+    /// Already scanned input is not scanned again, when
+    /// waiting for more data.
     void wait_for_delimiter(tstring const& delim, step_method method);
 private:
     step_method waiter_method_;
     size_t      waiter_count_;
     std::string waiter_delim_;
+    size_t      waiter_scan_offset_;
 
     int maybe_have_delim(tstring const& input);
     
@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "linear_buffer.h" // we implement this
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace tinfra {
+
+linear_buffer::linear_buffer(size_t initial_capacity, size_t max_capacity):
+    data_(0),
+    capacity_(0),
+    initial_capacity_(initial_capacity > 0 ? initial_capacity : 1),
+    max_capacity_(max_capacity < initial_capacity_ ? initial_capacity_ : max_capacity),
+    read_pos_(0),
+    write_pos_(0)
+{
+}
+
+linear_buffer::~linear_buffer()
+{
+    std::free(data_);
+}
+
+char* linear_buffer::prepare(size_t min_size, size_t& available)
+{
+    if( capacity_ - write_pos_ < min_size && read_pos_ > 0 ) {
+        // move partial data to front
+        const size_t used = size();
+        std::memmove(data_, data_ + read_pos_, used);
+        read_pos_ = 0;
+        write_pos_ = used;
+    }
+    if( capacity_ - write_pos_ < min_size && capacity_ < max_capacity_ ) {
+        size_t new_capacity = capacity_ == 0 ? initial_capacity_ : capacity_;
+        while( new_capacity - write_pos_ < min_size && new_capacity < max_capacity_ ) {
+            new_capacity *= 2;
+        }
+        if( new_capacity > max_capacity_ )
+            new_capacity = max_capacity_;
+        reallocate(new_capacity);
+    }
+    available = capacity_ - write_pos_;
+    return data_ + write_pos_;
+}
+
+void linear_buffer::release_if_empty()
+{
+    if( !empty() || data_ == 0 )
+        return;
+    std::free(data_);
+    data_ = 0;
+    capacity_ = 0;
+    read_pos_ = 0;
+    write_pos_ = 0;
+}
+
+void linear_buffer::reallocate(size_t new_capacity)
+{
+    void* p = std::realloc(data_, new_capacity);
+    if( p == 0 )
+        throw std::bad_alloc();
+    data_ = static_cast<char*>(p);
+    capacity_ = new_capacity;
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
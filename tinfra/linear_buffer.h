@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_linear_buffer_h_included
+#define tinfra_linear_buffer_h_included
+
+#include "tstring.h"
+
+#include <cassert>
+
+namespace tinfra {
+
+/// Linear byte buffer for incremental parsing.
+///
+/// Data is appended at tail (prepare() & commit()) and consumed from
+/// head (readable() & consume()). Buffer doesn't wrap, so readable
+/// region is always contiguous and parsers can work on it in place.
+/// When all data is consumed, buffer rewinds to its start without
+/// copying; otherwise unconsumed tail (usually a partial message) is
+/// moved to front (memmove) only when there is no more room at the
+/// end.
+///
+/// Storage is allocated lazily and may be released with
+/// release_if_empty(), so idle connections don't keep buffers.
+class linear_buffer {
+public:
+    explicit linear_buffer(size_t initial_capacity = 4096, size_t max_capacity = 1024*1024);
+    ~linear_buffer();
+
+    /// Data available for reading.
+    ///
+    /// Valid until next prepare() or release_if_empty().
+    tstring readable() const { return tstring(data_ + read_pos_, write_pos_ - read_pos_); }
+
+    size_t  size() const  { return write_pos_ - read_pos_; }
+    bool    empty() const { return write_pos_ == read_pos_; }
+
+    size_t  capacity() const { return capacity_; }
+    size_t  max_capacity() const { return max_capacity_; }
+
+    /// Remove n bytes from head of buffer.
+    void    consume(size_t n);
+
+    /// Get writable area.
+    ///
+    /// Returns area of at least min_size bytes at tail of buffer,
+    /// compacting or growing buffer as needed. Actual size is stored
+    /// in available. If max_capacity is reached, area may be smaller
+    /// than min_size (even empty).
+    char*   prepare(size_t min_size, size_t& available);
+
+    /// Append n bytes written to area returned by prepare().
+    void    commit(size_t n);
+
+    /// Release storage if buffer is empty.
+    void    release_if_empty();
+
+private:
+    void    reallocate(size_t new_capacity);
+
+    char*  data_;
+    size_t capacity_;
+    size_t initial_capacity_;
+    size_t max_capacity_;
+    size_t read_pos_;
+    size_t write_pos_;
+
+    // noncopyable
+    linear_buffer(linear_buffer const&);
+    linear_buffer& operator=(linear_buffer const&);
+};
+
+//
+// linear_buffer (inline) implementation
+//
+
+inline
+void linear_buffer::consume(size_t n)
+{
+    assert( n <= size() );
+    read_pos_ += n;
+    if( read_pos_ == write_pos_ ) {
+        read_pos_ = 0;
+        write_pos_ = 0;
+    }
+}
+
+inline
+void linear_buffer::commit(size_t n)
+{
+    assert( write_pos_ + n <= capacity_ );
+    write_pos_ += n;
+}
+
+} // end namespace tinfra
+
+#endif // tinfra_linear_buffer_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -137,7 +137,7 @@ void logger::fail(tstring const& message, tinfra::source_location const& loc)
     this->log(tinfra::LL_FAIL, message, loc);
 }
 
-static const char* log_level_to_string(log_level level)
+const char* log_level_to_string(log_level level)
 {
     switch( level ) {
     case LL_FATAL:   return "FATAL";
@@ -170,21 +170,20 @@ static int getpid() {
 #else
 static int getpid() { return -1; }
 #endif
-static void print_log_header(std::ostream& formatter, log_record const& record)
+std::string log_line_prefix(time_t timestamp)
 {
     using tinfra::path::basename;
     using tinfra::get_exepath;
-        // well hardcoded, but why not
-    // YYYY-MM-DD HH:MM:SS name[pid] level(component::func:source:line): message
+    std::ostringstream formatter;
     
     // date
     {
         const char* LOG_TIME_FORMAT = "%Y-%m-%d %H:%M:%S";
         struct tm exploded_time;
 #ifdef HAVE_LOCALTIME_R
-        localtime_r(&record.timestamp, &exploded_time);
+        localtime_r(&timestamp, &exploded_time);
 #else
-        struct tm* exploded_time2 = localtime(&record.timestamp);
+        struct tm* exploded_time2 = localtime(&timestamp);
         exploded_time = *exploded_time2;
 #endif
         char strtime_buf[256];
@@ -208,6 +207,15 @@ static void print_log_header(std::ostream& formatter, log_record const& record)
             formatter << "tid=" << tinfra::thread::thread::current().to_number();
         formatter << "] ";
     }
+    return formatter.str();
+}
+
+static void print_log_header(std::ostream& formatter, log_record const& record)
+{
+    // well hardcoded, but why not
+    // YYYY-MM-DD HH:MM:SS name[pid] level(component::func:source:line): message
+    
+    formatter << log_line_prefix(record.timestamp);
     
     // level
     formatter << log_level_to_string(record.level);
@@ -149,6 +149,15 @@ struct log_handler {
     static void         set_default(log_handler*);
 };
 
+/// Name of log level as printed in log ("ERROR", "INFO", ...).
+const char*  log_level_to_string(log_level level);
+
+/// Format constant part of log line header.
+///
+/// Returns "YYYY-MM-DD HH:MM:SS name[pid] ". It changes at most once
+/// per second, so handlers may cache it.
+std::string  log_line_prefix(time_t timestamp);
+
 class generic_log_handler: public tinfra::log_handler {
     tinfra::output_stream& out;
 public:
@@ -0,0 +1,201 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "platform.h"
+#include "config-priv.h"
+
+#include "mapped_file.h" // we implement this
+
+#include "tinfra/file.h"
+#include "tinfra/fmt.h"
+#include "tinfra/os_common.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace tinfra {
+
+//
+// mapped_file
+//
+
+mapped_file::mapped_file():
+    open_(false),
+    flags_(0),
+    data_(""),
+    size_(0),
+    mapping_(0)
+{
+}
+
+mapped_file::mapped_file(tstring const& name, int flags):
+    open_(false),
+    flags_(0),
+    data_(""),
+    size_(0),
+    mapping_(0)
+{
+    open(name, flags);
+}
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+void mapped_file::open(tstring const& name, int flags, size_t size)
+{
+    close();
+    map_or_read(name, flags, size);
+    flags_ = flags;
+    open_ = true;
+}
+
+void mapped_file::map_or_read(tstring const& name, int flags, size_t size)
+{
+    const bool writable = (flags & MFM_WRITE) == MFM_WRITE;
+    tinfra::file f(name, writable ? (FOM_READ | FOM_WRITE) : FOM_READ);
+#ifdef HAVE_SYS_MMAN_H
+    const int fd = static_cast<int>(f.native());
+    if( writable && size > 0 && ::ftruncate(fd, static_cast<off_t>(size)) < 0 )
+        throw_errno_error(errno, tsprintf("unable to resize '%s'", name));
+
+    struct stat st;
+    if( ::fstat(fd, &st) < 0 )
+        throw_errno_error(errno, tsprintf("unable to stat '%s'", name));
+    // regular files that report size 0 when opened for reading may
+    // have content anyway (procfs, sysfs), they're read below
+    if( S_ISREG(st.st_mode) && (st.st_size > 0 || writable) ) {
+        const size_t file_size = static_cast<size_t>(st.st_size);
+        if( static_cast<off_t>(file_size) != st.st_size )
+            throw std::runtime_error(tsprintf("mapped_file: '%s' too big to map", name));
+        if( file_size == 0 )
+            return; // empty file can't be mapped, but it has empty content
+        int map_flags = writable ? MAP_SHARED : MAP_PRIVATE;
+#ifdef MAP_POPULATE
+        if( (flags & MFM_POPULATE) == MFM_POPULATE )
+            map_flags |= MAP_POPULATE;
+#endif
+        const int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        void* m = ::mmap(0, file_size, prot, map_flags, fd, 0);
+        if( m == MAP_FAILED )
+            throw_errno_error(errno, tsprintf("unable to map '%s'", name));
+        mapping_ = m;
+        data_ = static_cast<const char*>(m);
+        size_ = file_size;
+        advise(flags);
+        return;
+    }
+#else
+    (void)size;
+#endif
+    if( writable )
+        throw std::runtime_error(tsprintf("mapped_file: unable to map '%s' for writing", name));
+    // pipes, special files & platforms without mmap
+    buffer_ = read_all(f);
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+
+void mapped_file::close()
+{
+#ifdef HAVE_SYS_MMAN_H
+    if( mapping_ )
+        ::munmap(mapping_, size_);
+#endif
+    mapping_ = 0;
+    std::string().swap(buffer_);
+    data_ = "";
+    size_ = 0;
+    flags_ = 0;
+    open_ = false;
+}
+
+char* mapped_file::writable_data()
+{
+    if( (flags_ & MFM_WRITE) != MFM_WRITE )
+        throw std::logic_error("mapped_file: not opened for writing");
+    return static_cast<char*>(mapping_);
+}
+
+void mapped_file::advise(int flags)
+{
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_NORMAL)
+    if( !mapping_ )
+        return;
+    int advice = MADV_NORMAL;
+    if( (flags & MFM_SEQUENTIAL) == MFM_SEQUENTIAL )
+        advice = MADV_SEQUENTIAL;
+    else if( (flags & MFM_RANDOM) == MFM_RANDOM )
+        advice = MADV_RANDOM;
+    // just a hint, failure doesn't matter
+    ::madvise(mapping_, size_, advice);
+#else
+    (void)flags;
+#endif
+}
+
+void mapped_file::sync()
+{
+    if( (flags_ & MFM_WRITE) != MFM_WRITE )
+        throw std::logic_error("mapped_file: not opened for writing");
+#ifdef HAVE_SYS_MMAN_H
+    if( mapping_ && ::msync(mapping_, size_, MS_SYNC) < 0 )
+        throw_errno_error(errno, "msync failed");
+#endif
+}
+
+//
+// mapped_input_stream
+//
+
+namespace {
+
+class mapped_input_stream: public input_stream {
+public:
+    mapped_input_stream(tstring const& name, int flags):
+        file_(name, flags),
+        position_(0)
+    {
+    }
+
+    void close()
+    {
+        file_.close();
+        position_ = 0;
+    }
+
+    int read(char* dest, int size)
+    {
+        const size_t remaining = file_.size() - position_;
+        const size_t n = std::min(remaining, static_cast<size_t>(size));
+        std::memcpy(dest, file_.data() + position_, n);
+        position_ += n;
+        return static_cast<int>(n);
+    }
+private:
+    mapped_file file_;
+    size_t      position_;
+};
+
+} // end anonymous namespace
+
+std::auto_ptr<input_stream> create_mapped_input_stream(tstring const& name, int flags)
+{
+    return std::auto_ptr<input_stream>(new mapped_input_stream(name, flags & ~MFM_WRITE));
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
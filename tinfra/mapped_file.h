@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_mapped_file_h_included
+#define tinfra_mapped_file_h_included
+
+#include "stream.h"
+#include "tstring.h"
+
+#include <memory>
+#include <string>
+
+namespace tinfra {
+
+enum mapped_file_flags {
+    MFM_READ       = 0x01, ///< read only, private mapping
+    MFM_WRITE      = 0x02, ///< read-write, changes are written to file
+    MFM_SEQUENTIAL = 0x04, ///< hint: will be read sequentially
+    MFM_RANDOM     = 0x08, ///< hint: will be accessed randomly
+    MFM_POPULATE   = 0x10  ///< load whole file into memory when mapping
+};
+
+/// Memory mapped file.
+///
+/// Maps whole file into memory and exposes its contents as tstring.
+/// Where mmap is not available, or file can't be mapped (pipes,
+/// special files, files reporting size 0 like in procfs), read-only
+/// file is read into buffer instead, so content() works always.
+///
+/// Note, if mapped file is truncated while mapped, accessing content
+/// past new end raises SIGBUS; use read_file() for files that may be
+/// modified concurrently.
+///
+/// Usage:
+/// <pre>
+///   tinfra::mapped_file m("catalog.json", MFM_READ | MFM_SEQUENTIAL);
+///   variant v = json_parse(m.content());
+/// </pre>
+///
+/// Errors are reported as std::runtime_error (from
+/// throw_errno_error), misuse as std::logic_error.
+class mapped_file {
+public:
+    mapped_file();
+    explicit mapped_file(tstring const& name, int flags = MFM_READ);
+    ~mapped_file();
+
+    /// Map file.
+    ///
+    /// With MFM_WRITE and size > 0, file is created or resized to
+    /// size before mapping.
+    void        open(tstring const& name, int flags = MFM_READ, size_t size = 0);
+
+    /// Unmap file (and forget buffer).
+    void        close();
+
+    bool        is_open() const   { return open_; }
+    /// true if content is really mapped, not read into buffer
+    bool        is_mapped() const { return mapping_ != 0; }
+
+    size_t      size() const      { return size_; }
+    const char* data() const      { return data_; }
+    tstring     content() const   { return tstring(data_, size_); }
+
+    /// Writable view, only for MFM_WRITE.
+    char*       writable_data();
+
+    /// Change access pattern hint (MFM_SEQUENTIAL, MFM_RANDOM or 0 for normal).
+    void        advise(int flags);
+
+    /// Write changes to file (MFM_WRITE only), waits for completion.
+    void        sync();
+
+private:
+    void        map_or_read(tstring const& name, int flags, size_t size);
+
+    bool        open_;
+    int         flags_;
+    const char* data_;
+    size_t      size_;
+    void*       mapping_;
+    std::string buffer_;  // used when file can't be mapped
+
+    // noncopyable
+    mapped_file(mapped_file const&);
+    mapped_file& operator=(mapped_file const&);
+};
+
+/// Open file as input stream reading directly from mapped memory.
+///
+/// No read() syscalls are made, read() just copies from mapping.
+std::auto_ptr<input_stream> create_mapped_input_stream(tstring const& name, int flags = MFM_READ | MFM_SEQUENTIAL);
+
+} // end namespace tinfra
+
+#endif // tinfra_mapped_file_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -49,6 +49,16 @@
 #define TINFRA_NOEXCEPT
 #endif
 
+//
+// thread local storage for POD values
+//
+#if defined(TINFRA_CXX11) && !defined(__APPLE__)
+#define TINFRA_THREAD_LOCAL thread_local
+#elif defined(__GNUC__)
+#define TINFRA_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define TINFRA_THREAD_LOCAL __declspec(thread)
+#endif
 
 //
 // standard sizes in tinfra
@@ -80,5 +90,21 @@ namespace tinfra {
 
 #endif
 
+//
+// SIMD
+//
+// TINFRA_SSE2          - SSE2 is available at compile time (all x86_64)
+// TINFRA_AVX2_DISPATCH - compiler can build avx2 functions without
+//                        -mavx2 and detect cpu support at runtime
+//
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TINFRA_SSE2
+#endif
+
+#if defined(TINFRA_SSE2) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define TINFRA_AVX2_DISPATCH
+#endif
+
 #endif // tinfra_platform_h_included
 
@@ -3,20 +3,31 @@
 // This software licensed under terms described in LICENSE.txt
 //
 
-#include "tinfra/file.h" // we implement this
+// before any system header, may define _FILE_OFFSET_BITS
+#include "../config-priv.h"
+
 #include "../platform.h"
 #ifdef TINFRA_POSIX
 
+#include "tinfra/file.h" // we implement this
+
 #include "tinfra/fmt.h"
 #include "tinfra/os_common.h"
 #include "tinfra/runtime.h"
 #include <stdexcept>
+#include <algorithm>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sys/uio.h>
+#include <limits.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
 
 namespace tinfra {
 
@@ -81,7 +92,7 @@ void file::close()
     this->handle_ = -1;
 }
 
-int file::seek(int pos, seek_origin origin)
+file::offset_type file::seek(offset_type pos, seek_origin origin)
 {
     int whence;
     switch( origin ) {
@@ -99,10 +110,10 @@ int file::seek(int pos, seek_origin origin)
         // TODO, it should be TINFRA_HARD_ASSERT or what ?
         throw std::logic_error("bad seek_origin");
     }
-    off_t e = lseek(handle_, pos, whence);
+    const off_t e = lseek(handle_, static_cast<off_t>(pos), whence);
     if( e == (off_t)-1 )
 	throw_errno_error(errno, "seek failed");
-    return (int)e;
+    return e;
 }
 
 int file::read(char* data, int size)
@@ -133,6 +144,110 @@ int file::write(char const* data, int size)
     }
 }
 
+int file::pread(char* data, int size, offset_type offset)
+{
+    while( true ) {
+        const ssize_t r = ::pread(handle_, data, size, static_cast<off_t>(offset));
+        if( r < 0 && errno == EINTR ) {
+            tinfra::test_interrupt();
+            continue;
+        }
+        if( r < 0 ) 
+            throw_errno_error(errno, "pread failed");
+        return r;
+    }
+}
+
+int file::pwrite(char const* data, int size, offset_type offset)
+{
+    while( true ) {
+        const ssize_t w = ::pwrite(handle_, data, size, static_cast<off_t>(offset));
+        if( w < 0 && errno == EINTR ) {
+            tinfra::test_interrupt();
+            continue;
+        }
+        if( w < 0 ) 
+            throw_errno_error(errno, "pwrite failed");
+        return w;
+    }
+}
+
+// struct iovec is { void* iov_base; size_t iov_len; } on all posix
+// systems, but order of fields is not specified, so we copy
+
+int file::readv(mutable_buffer const* buffers, size_t count)
+{
+    struct iovec iov[IOV_MAX];
+    const size_t n = std::min<size_t>(count, IOV_MAX);
+    for( size_t i = 0; i < n; ++i ) {
+        iov[i].iov_base = buffers[i].data;
+        iov[i].iov_len = buffers[i].size;
+    }
+    while( true ) {
+        const ssize_t r = ::readv(handle_, iov, n);
+        if( r < 0 && errno == EINTR ) {
+            tinfra::test_interrupt();
+            continue;
+        }
+        if( r < 0 ) 
+            throw_errno_error(errno, "readv failed");
+        return r;
+    }
+}
+
+int file::writev(tstring const* fragments, size_t count)
+{
+    struct iovec iov[IOV_MAX];
+    const size_t n = std::min<size_t>(count, IOV_MAX);
+    for( size_t i = 0; i < n; ++i ) {
+        iov[i].iov_base = const_cast<char*>(fragments[i].data());
+        iov[i].iov_len = fragments[i].size();
+    }
+    while( true ) {
+        const ssize_t w = ::writev(handle_, iov, n);
+        if( w < 0 && errno == EINTR ) {
+            tinfra::test_interrupt();
+            continue;
+        }
+        if( w < 0 ) 
+            throw_errno_error(errno, "writev failed");
+        return w;
+    }
+}
+
+void file::allocate(offset_type offset, offset_type size)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+    const int r = ::posix_fallocate(handle_, static_cast<off_t>(offset), static_cast<off_t>(size));
+    // returns error code, doesn't set errno
+    if( r != 0 && r != EINVAL && r != EOPNOTSUPP )
+        throw_errno_error(r, "posix_fallocate failed");
+#else
+    (void)offset;
+    (void)size;
+#endif
+}
+
+void file::advise(offset_type offset, offset_type size, file_access_advice advice)
+{
+#ifdef HAVE_POSIX_FADVISE
+    int native = POSIX_FADV_NORMAL;
+    switch( advice ) {
+    case FA_NORMAL:     native = POSIX_FADV_NORMAL;     break;
+    case FA_SEQUENTIAL: native = POSIX_FADV_SEQUENTIAL; break;
+    case FA_RANDOM:     native = POSIX_FADV_RANDOM;     break;
+    case FA_WILLNEED:   native = POSIX_FADV_WILLNEED;   break;
+    case FA_DONTNEED:   native = POSIX_FADV_DONTNEED;   break;
+    }
+    // just a hint, failure doesn't matter
+    ::posix_fadvise(handle_, static_cast<off_t>(offset), static_cast<off_t>(size), native);
+#else
+    (void)offset;
+    (void)size;
+    (void)advice;
+#endif
+}
+
 fs::file_info file::stat()
 {
     throw std::logic_error("file::stat() not implemented");   
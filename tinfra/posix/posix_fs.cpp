@@ -37,6 +37,9 @@
 #ifdef HAVE_OPENDIR
 #include <dirent.h>
 #endif
+#ifdef HAVE_FSTATAT
+#include <fcntl.h> // for AT_SYMLINK_NOFOLLOW
+#endif
     
 #include "tinfra/trace.h"
 
@@ -45,6 +48,71 @@ namespace fs {
 
 tinfra::module_tracer fs_tracer(tinfra::tinfra_tracer, "fs");
 
+static file_info make_file_info(struct stat const& st)
+{
+    file_info result;
+    
+    int file_type = st.st_mode & S_IFMT; 
+    if ( file_type == S_IFLNK )
+    	result.type = SYMBOLIC_LINK;
+    else if( file_type == S_IFDIR )
+    	result.type = DIRECTORY;    
+    else if( (file_type == S_IFCHR)  || 
+    	     (file_type == S_IFBLK) )
+    	result.type = DEVICE;
+    else if ( file_type == S_IFIFO )
+    	result.type = FIFO;
+    else if ( file_type == S_IFSOCK) 
+        result.type = SOCKET;
+    else
+    	result.type = REGULAR_FILE;
+
+    result.is_dir = (result.type == DIRECTORY);
+    
+    result.modification_time = st.st_mtime;
+    result.access_time = st.st_atime;
+    result.size = st.st_size;
+    return result;
+}
+
+/// Get file type without stat, if filesystem provides it in d_type.
+static bool file_type_from_dirent(dirent const& entry, file_type& result)
+{
+#ifdef DT_UNKNOWN
+    switch( entry.d_type ) {
+    case DT_REG:  result = REGULAR_FILE; return true;
+    case DT_DIR:  result = DIRECTORY;    return true;
+    case DT_LNK:  result = SYMBOLIC_LINK; return true;
+    case DT_CHR:
+    case DT_BLK:  result = DEVICE;       return true;
+    case DT_FIFO: result = FIFO;         return true;
+    case DT_SOCK: result = SOCKET;       return true;
+    default:      return false;
+    }
+#else
+    (void)entry;
+    (void)result;
+    return false;
+#endif
+}
+
+/// lstat() entry of directory being listed.
+static void stat_entry(DIR* dir, std::string const& base_path, const char* name, struct stat& st)
+{
+#if defined(HAVE_FSTATAT) && defined(HAVE_DIRFD)
+    // relative to open directory, kernel doesn't resolve whole path
+    if( ::fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0 ) {
+        tinfra::fail(fmt("unable stat file '%s'") % path::join(base_path, name), errno_to_string(errno));
+    }
+#else
+    (void)dir;
+    const std::string path = path::join(base_path, name);
+    if( ::lstat(path.c_str(), &st) != 0 ) {
+        tinfra::fail(fmt("unable stat file '%s'") % path, errno_to_string(errno));
+    }
+#endif
+}
+
 struct lister::internal_data {
     std::string base_path;
     DIR* handle;
@@ -94,17 +162,17 @@ bool lister::fetch_next(directory_entry& result)
         result.name = entry->d_name;
         TINFRA_TRACE_VAR(fs_tracer, result.name);
         
-        if( data_->need_stat ) {
-            std::string path = path::join(data_->base_path, result.name);
-            result.info = stat(path);
-            result.info.is_dir = (result.info.type == DIRECTORY);
+        const bool have_type = file_type_from_dirent(*entry, result.info.type);
+        if( data_->need_stat || !have_type ) {
+            struct stat st;
+            stat_entry(data_->handle, data_->base_path, entry->d_name, st);
+            result.info = make_file_info(st);
         } else {
-            result.info.is_dir = false;
             result.info.size = 0;
-            result.info.type = REGULAR_FILE; // as fallback
             result.info.modification_time = 0;
             result.info.access_time = 0;
         }
+        result.info.is_dir = (result.info.type == DIRECTORY);
         return true;
     }
 }
@@ -116,32 +184,10 @@ file_info stat(tstring const& name)
     if( ::lstat(name.c_str(temporary_context), &st) != 0 ) {
         tinfra::fail(fmt("unable stat file '%s'") % name, errno_to_string(errno));
     }
-    
-    file_info result;
-    
-    int file_type = st.st_mode & S_IFMT; 
-    if ( file_type == S_IFLNK )
-    	result.type = SYMBOLIC_LINK;
-    else if( file_type == S_IFDIR )
-    	result.type = DIRECTORY;    
-    else if( (file_type == S_IFCHR)  || 
-    	     (file_type == S_IFBLK) )
-    	result.type = DEVICE;
-    else if ( file_type == S_IFIFO )
-    	result.type = FIFO;
-    else if ( file_type == S_IFSOCK) 
-        result.type = SOCKET;
-    else
-    	result.type = REGULAR_FILE;
-
-    result.is_dir = (result.type == DIRECTORY);
-    
-    result.modification_time = st.st_mtime;
-    result.access_time = st.st_atime;
-    result.size = st.st_size;
-    return result;
+    return make_file_info(st);
 }
 
+
 bool exists(tstring const& name)
 {
     string_pool temporary_context;
@@ -38,6 +38,8 @@ public:
 	// input_stream implementation
 	void close();
 	int read(char* dest, int size);
+
+	file_descriptor::handle_type handle() const { return fd.handle(); }
 private:
 	file_descriptor fd;
 };
@@ -52,6 +54,8 @@ public:
 	void close();
 	int write(const char* data, int size);
     	void sync();
+
+	file_descriptor::handle_type handle() const { return fd.handle(); }
 private:
 	file_descriptor fd;
 };
@@ -62,6 +66,8 @@ struct standard_handle_input: public tinfra::input_stream {
 
     void close();
     int read(char* dest, int size);
+
+    int handle() const { return 0; }
 };
 
 struct standard_handle_output: public tinfra::output_stream {
@@ -73,6 +79,8 @@ struct standard_handle_output: public tinfra::output_stream {
     void close();
     int write(const char* data, int size);
     void sync();
+
+    int handle() const { return fd_; }
 private:
     const int fd_;
 };
@@ -0,0 +1,182 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "../platform.h"
+#ifdef TINFRA_POSIX
+
+#include "../config-priv.h"
+
+#include "tinfra/stream.h" // we implement this
+
+#include "tinfra/file.h"
+#include "tinfra/socket.h"
+#include "tinfra/os_common.h"
+#include "tinfra/runtime.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+namespace tinfra {
+namespace detail {
+
+//
+// native handle discovery
+//
+
+static int native_input_handle(input_stream& input)
+{
+    if( tinfra::file* f = dynamic_cast<tinfra::file*>(&input) )
+        return static_cast<int>(f->native());
+    if( posix::native_input_stream* n = dynamic_cast<posix::native_input_stream*>(&input) )
+        return n->handle();
+    if( client_stream_socket* s = dynamic_cast<client_stream_socket*>(&input) )
+        return static_cast<int>(s->handle());
+    if( posix::standard_handle_input* s = dynamic_cast<posix::standard_handle_input*>(&input) )
+        return s->handle();
+    return -1;
+}
+
+static int native_output_handle(output_stream& out)
+{
+    if( tinfra::file* f = dynamic_cast<tinfra::file*>(&out) )
+        return static_cast<int>(f->native());
+    if( posix::native_output_stream* n = dynamic_cast<posix::native_output_stream*>(&out) )
+        return n->handle();
+    if( client_stream_socket* s = dynamic_cast<client_stream_socket*>(&out) )
+        return static_cast<int>(s->handle());
+    if( posix::standard_handle_output* s = dynamic_cast<posix::standard_handle_output*>(&out) )
+        return s->handle();
+    return -1;
+}
+
+//
+// kernel copy loops
+//
+// Each returns true if input was copied until EOF, false if method
+// is not supported for this pair of descriptors. Data already copied
+// is consumed from input (descriptor offsets are used), so caller may
+// continue with another method.
+//
+
+// max bytes per one syscall, sendfile & co. transfer at most ~2GB
+static const size_t KERNEL_COPY_CHUNK = 1 << 30;
+
+// errors meaning "not for these descriptors", not real failures
+static bool kernel_copy_unsupported(int error)
+{
+    return error == EINVAL
+        || error == ENOSYS
+        || error == EXDEV
+        || error == EOPNOTSUPP
+#if defined(ENOTSUP) && ENOTSUP != EOPNOTSUPP
+        || error == ENOTSUP
+#endif
+        || error == EAGAIN
+#if EWOULDBLOCK != EAGAIN
+        || error == EWOULDBLOCK
+#endif
+        || error == EBADF;  // copy_file_range on O_APPEND output
+}
+
+template <typename F>
+static bool kernel_copy_loop(F transfer, const char* name)
+{
+    while( true ) {
+        const ssize_t r = transfer();
+        if( r > 0 )
+            continue;
+        if( r == 0 )
+            return true;
+        if( errno == EINTR ) {
+            tinfra::test_interrupt();
+            continue;
+        }
+        if( kernel_copy_unsupported(errno) )
+            return false;
+        throw_errno_error(errno, name);
+    }
+}
+
+#ifdef HAVE_COPY_FILE_RANGE
+struct copy_file_range_transfer {
+    int in, out;
+    ssize_t operator()() const {
+        return ::copy_file_range(in, 0, out, 0, KERNEL_COPY_CHUNK, 0);
+    }
+};
+#endif
+
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+struct sendfile_transfer {
+    int in, out;
+    ssize_t operator()() const {
+        return ::sendfile(out, in, 0, KERNEL_COPY_CHUNK);
+    }
+};
+#endif
+
+#ifdef HAVE_SPLICE
+struct splice_transfer {
+    int in, out;
+    ssize_t operator()() const {
+        return ::splice(in, 0, out, 0, KERNEL_COPY_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE);
+    }
+};
+#endif
+
+bool native_stream_copy(input_stream& input, output_stream& out)
+{
+    const int in_fd = native_input_handle(input);
+    const int out_fd = native_output_handle(out);
+    if( in_fd < 0 || out_fd < 0 )
+        return false;
+
+    struct stat in_st, out_st;
+    if( ::fstat(in_fd, &in_st) != 0 || ::fstat(out_fd, &out_st) != 0 )
+        return false;
+    const bool in_regular = S_ISREG(in_st.st_mode);
+    const bool out_regular = S_ISREG(out_st.st_mode);
+
+#ifdef HAVE_COPY_FILE_RANGE
+    // file -> file, may be reflink or server side copy
+    if( in_regular && out_regular ) {
+        const copy_file_range_transfer t = { in_fd, out_fd };
+        if( kernel_copy_loop(t, "copy_file_range failed") )
+            return true;
+    }
+#endif
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+    // file -> anything (socket, pipe, file)
+    if( in_regular ) {
+        const sendfile_transfer t = { in_fd, out_fd };
+        if( kernel_copy_loop(t, "sendfile failed") )
+            return true;
+    }
+#endif
+#ifdef HAVE_SPLICE
+    // pipe -> anything or anything -> pipe
+    if( S_ISFIFO(in_st.st_mode) || S_ISFIFO(out_st.st_mode) ) {
+        const splice_transfer t = { in_fd, out_fd };
+        if( kernel_copy_loop(t, "splice failed") )
+            return true;
+    }
+#endif
+    (void)in_regular;
+    (void)out_regular;
+    return false;
+}
+
+} } // end namespace tinfra::detail
+
+#endif // TINFRA_POSIX
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -23,6 +23,7 @@
 #include <stdexcept>
 
 #include <pthread.h>
+#include <unistd.h> // for sysconf
 
 #ifdef HAVE_NANOSLEEP
 #include <time.h>
@@ -179,6 +180,16 @@ size_t thread::to_number() const
 	return *a;
 }
 
+int hardware_concurrency()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    const long n = ::sysconf(_SC_NPROCESSORS_ONLN);
+    if( n > 0 )
+        return (int)n;
+#endif
+    return 1;
+}
+
 } } // end namespace tinfra::thread
 
 #endif // TINFRA_POSIX
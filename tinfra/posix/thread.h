@@ -67,7 +67,7 @@ public:
         const time_stamp ts = d.get_absolute();
         
         tspec.tv_sec = ts.to_seconds();
-        tspec.tv_sec = ( ts.to_milliseconds() % 1000 ) * 1000*1000;
+        tspec.tv_nsec = ( ts.to_milliseconds() % 1000 ) * 1000*1000;
         
         const int r = ::pthread_cond_timedwait(&cond_, mutex.get_native(), &tspec);
         switch( r ) {
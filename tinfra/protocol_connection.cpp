@@ -0,0 +1,116 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "protocol_connection.h" // we implement this
+
+#include "tinfra/fmt.h"
+
+#include <stdexcept>
+
+namespace tinfra {
+namespace net {
+
+/// minimal free space requested for each recv() call
+static const size_t PROTOCOL_MIN_READ_SIZE = 1024;
+
+protocol_connection::protocol_connection(reactor& r,
+                                         std::auto_ptr<tcp_client_socket> client,
+                                         lazy_protocol& protocol,
+                                         size_t buffer_size,
+                                         size_t max_buffer_size):
+    reactor_connection(r, client),
+    protocol_(protocol),
+    input_(buffer_size, max_buffer_size)
+{
+}
+
+protocol_connection::~protocol_connection()
+{
+}
+
+void protocol_connection::send(tstring const& data)
+{
+    if( closed() )
+        throw std::logic_error("protocol_connection: send() after close()");
+    if( output_.empty() ) {
+        size_t written = 0;
+        while( written < data.size() ) {
+            const int w = socket().try_write(data.data() + written, data.size() - written);
+            if( w < 0 )
+                break;
+            written += w;
+        }
+        if( written == data.size() )
+            return;
+        output_.append(data.data() + written, data.size() - written);
+    } else {
+        output_.append(data.data(), data.size());
+    }
+}
+
+void protocol_connection::on_readable()
+{
+    while( !closed() ) {
+        size_t available;
+        char* area = input_.prepare(PROTOCOL_MIN_READ_SIZE, available);
+        if( available == 0 ) {
+            throw std::runtime_error(tsprintf("protocol_connection: input exceeds %i bytes", input_.max_capacity()));
+        }
+        const int r = socket().try_read(area, available);
+        if( r < 0 )
+            break;
+        if( r == 0 ) {
+            // peer closed connection
+            close();
+            return;
+        }
+        input_.commit(r);
+        process_input();
+    }
+    // idle connections don't keep buffers
+    input_.release_if_empty();
+}
+
+void protocol_connection::on_writable()
+{
+    flush_output();
+    maybe_finish();
+}
+
+void protocol_connection::process_input()
+{
+    while( !protocol_.is_finished() ) {
+        const tstring input = input_.readable();
+        const int consumed = protocol_.process(input);
+        if( consumed < 0 || static_cast<size_t>(consumed) > input.size() )
+            throw std::logic_error(tsprintf("protocol_connection: bad consumed byte count %i", consumed));
+        input_.consume(consumed);
+        if( protocol_.again_requested() )
+            break;
+    }
+    maybe_finish();
+}
+
+void protocol_connection::flush_output()
+{
+    size_t written = 0;
+    while( written < output_.size() ) {
+        const int w = socket().try_write(output_.data() + written, output_.size() - written);
+        if( w < 0 )
+            break;
+        written += w;
+    }
+    output_.erase(0, written);
+}
+
+void protocol_connection::maybe_finish()
+{
+    if( !closed() && protocol_.is_finished() && output_.empty() )
+        close();
+}
+
+} } // end namespace tinfra::net
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_protocol_connection_h_included
+#define tinfra_protocol_connection_h_included
+
+#include "reactor.h"
+#include "lazy_protocol.h"
+#include "linear_buffer.h"
+
+#include <string>
+
+namespace tinfra {
+namespace net {
+
+/// Reactor connection driving lazy_protocol.
+///
+/// Reads from non-blocking socket directly into per-connection
+/// linear_buffer and feeds protocol with unconsumed part of it, so
+/// input is never copied. Bytes consumed by protocol steps are
+/// dropped from buffer.
+///
+/// Protocol usually is member of derived class and writes
+/// responses with send():
+/// @code
+///   class echo_protocol: public tinfra::lazy_protocol {
+///       protocol_connection& conn_;
+///   public:
+///       echo_protocol(protocol_connection& c): conn_(c) {
+///           wait_for_delimiter("\n", make_step_method(&echo_protocol::line));
+///       }
+///       int line(tstring const& input) {
+///           conn_.send(input);
+///           wait_for_delimiter("\n", make_step_method(&echo_protocol::line));
+///           return input.size() + 1;
+///       }
+///   };
+///   class echo_connection: public protocol_connection {
+///       echo_protocol protocol_;
+///   public:
+///       echo_connection(reactor& r, std::auto_ptr<tcp_client_socket> c):
+///           protocol_connection(r, c, protocol_),
+///           protocol_(*this)
+///       {}
+///   };
+/// @endcode
+///
+/// Connection is closed when peer closes connection or when protocol
+/// finishes and all output is sent.
+class protocol_connection: public reactor_connection {
+public:
+    /// Create connection.
+    ///
+    /// protocol reference is not used in constructor, so it may
+    /// refer to not yet constructed member of derived class.
+    protocol_connection(reactor& r,
+                        std::auto_ptr<tcp_client_socket> client,
+                        lazy_protocol& protocol,
+                        size_t buffer_size = 4096,
+                        size_t max_buffer_size = 1024*1024);
+    ~protocol_connection();
+
+    /// Send data to peer.
+    ///
+    /// Data is written immediately if possible, otherwise it's
+    /// queued and written when socket becomes writable.
+    void send(tstring const& data);
+
+    /// Size of output waiting for socket.
+    size_t pending_output() const { return output_.size(); }
+
+    // reactor_handler implementation
+    void on_readable();
+    void on_writable();
+
+private:
+    void process_input();
+    void flush_output();
+    void maybe_finish();
+
+    lazy_protocol& protocol_;
+    linear_buffer  input_;
+    std::string    output_;
+};
+
+} } // end namespace tinfra::net
+
+#endif // tinfra_protocol_connection_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,426 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "platform.h"
+#include "config-priv.h"
+
+#include "reactor.h" // we implement this
+
+#include "tinfra/thread.h"
+#include "tinfra/fmt.h"
+#include "tinfra/os_common.h"
+#include "tinfra/trace.h"
+#include "tinfra/logger.h"
+#include "tinfra/runtime.h" // for test_interrupt
+
+#include <stdexcept>
+#include <algorithm>
+#include <cassert>
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+#define TINFRA_REACTOR_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h> // for SOMAXCONN
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifndef SOMAXCONN
+#define SOMAXCONN 128
+#endif
+
+namespace tinfra {
+namespace net {
+
+#ifdef TINFRA_REACTOR_EPOLL
+
+/// number of events fetched by one epoll_wait call
+static const int REACTOR_MAX_EVENTS = 256;
+
+#endif
+
+//
+// reactor_handler
+//
+
+reactor_handler::reactor_handler():
+    prev_(0),
+    next_(0),
+    owned_(false)
+{
+}
+
+reactor_handler::~reactor_handler()
+{
+}
+
+void reactor_handler::on_error()
+{
+    on_readable();
+}
+
+//
+// reactor
+//
+
+#ifdef TINFRA_REACTOR_EPOLL
+
+reactor::reactor():
+    epoll_fd_(-1),
+    wakeup_fd_(-1),
+    stopped_(false),
+    owned_(0),
+    owned_count_(0)
+{
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if( epoll_fd_ == -1 )
+        throw_errno_error(errno, "reactor: epoll_create1 failed");
+
+    wakeup_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if( wakeup_fd_ == -1 ) {
+        const int e = errno;
+        ::close(epoll_fd_);
+        throw_errno_error(e, "reactor: eventfd failed");
+    }
+
+    ::epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = 0; // null handler marks wakeup event
+    if( ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &ev) == -1 ) {
+        const int e = errno;
+        ::close(wakeup_fd_);
+        ::close(epoll_fd_);
+        throw_errno_error(e, "reactor: unable to register wakeup descriptor");
+    }
+}
+
+reactor::~reactor()
+{
+    delete_disposed();
+    while( owned_ != 0 ) {
+        reactor_handler* h = owned_;
+        unlink(h);
+        delete h;
+    }
+    ::close(wakeup_fd_);
+    ::close(epoll_fd_);
+}
+
+void reactor::add(socket::handle_type h, reactor_handler* handler)
+{
+    assert(handler != 0);
+    ::epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = handler;
+    if( ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, (int)h, &ev) == -1 )
+        throw_errno_error(errno, fmt("reactor: unable to register socket %i") % h);
+}
+
+void reactor::adopt(socket::handle_type h, reactor_handler* handler)
+{
+    std::auto_ptr<reactor_handler> holder(handler);
+    add(h, handler);
+    link(holder.release());
+}
+
+void reactor::remove(socket::handle_type h)
+{
+    // event argument is ignored, but kernels before 2.6.9 required non-null
+    ::epoll_event ev;
+    ev.events = 0;
+    ev.data.ptr = 0;
+    if( ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, (int)h, &ev) == -1 )
+        throw_errno_error(errno, fmt("reactor: unable to unregister socket %i") % h);
+}
+
+void reactor::dispose(socket::handle_type h, reactor_handler* handler)
+{
+    if( h != -1 ) {
+        remove(h);
+    }
+    if( handler->owned_ ) {
+        unlink(handler);
+    }
+    disposed_.push_back(handler);
+}
+
+void reactor::run()
+{
+    while( !stopped_ ) {
+        run_once(-1);
+    }
+}
+
+int reactor::run_once(int timeout_ms)
+{
+    ::epoll_event events[REACTOR_MAX_EVENTS];
+    int n;
+    while( true ) {
+        n = ::epoll_wait(epoll_fd_, events, REACTOR_MAX_EVENTS, timeout_ms);
+        if( n == -1 && errno == EINTR ) {
+            tinfra::test_interrupt();
+            continue;
+        }
+        if( n == -1 )
+            throw_errno_error(errno, "reactor: epoll_wait failed");
+        break;
+    }
+
+    int dispatched = 0;
+    for( int i = 0; i < n; ++i ) {
+        reactor_handler* handler = static_cast<reactor_handler*>(events[i].data.ptr);
+        const uint32_t e = events[i].events;
+        if( handler == 0 ) {
+            uint64_t value;
+            while( ::read(wakeup_fd_, &value, sizeof(value)) > 0 ) {}
+            continue;
+        }
+        // handler might have been disposed by other handler in this round
+        if( std::find(disposed_.begin(), disposed_.end(), handler) != disposed_.end() )
+            continue;
+
+        try {
+            if( (e & (EPOLLERR | EPOLLHUP)) != 0 ) {
+                handler->on_error();
+            } else {
+                if( (e & (EPOLLIN | EPOLLRDHUP)) != 0 )
+                    handler->on_readable();
+                if( (e & EPOLLOUT) != 0 &&
+                    std::find(disposed_.begin(), disposed_.end(), handler) == disposed_.end() )
+                {
+                    handler->on_writable();
+                }
+            }
+        } catch( std::exception& ex ) {
+            // in edge-triggered mode we can't abandon rest of events, so
+            // failed handler is dropped and loop goes on
+            TINFRA_LOG_ERROR(fmt("reactor: handler failed: %s, handler dropped") % ex.what());
+            if( handler->owned_ ) {
+                unlink(handler);
+                disposed_.push_back(handler);
+            }
+        }
+        dispatched += 1;
+    }
+    delete_disposed();
+    return dispatched;
+}
+
+void reactor::stop()
+{
+    stopped_ = true;
+    const uint64_t value = 1;
+    while( ::write(wakeup_fd_, &value, sizeof(value)) == -1 && errno == EINTR ) {}
+}
+
+#else // TINFRA_REACTOR_EPOLL
+
+reactor::reactor():
+    epoll_fd_(-1),
+    wakeup_fd_(-1),
+    stopped_(false),
+    owned_(0),
+    owned_count_(0)
+{
+    throw std::logic_error("reactor: not supported on this platform");
+}
+
+reactor::~reactor()
+{
+}
+
+void reactor::add(socket::handle_type, reactor_handler*) {}
+void reactor::adopt(socket::handle_type, reactor_handler*) {}
+void reactor::remove(socket::handle_type) {}
+void reactor::dispose(socket::handle_type, reactor_handler*) {}
+void reactor::run() {}
+int  reactor::run_once(int) { return 0; }
+void reactor::stop() {}
+
+#endif // TINFRA_REACTOR_EPOLL
+
+void reactor::link(reactor_handler* handler)
+{
+    handler->owned_ = true;
+    handler->prev_ = 0;
+    handler->next_ = owned_;
+    if( owned_ )
+        owned_->prev_ = handler;
+    owned_ = handler;
+    owned_count_ += 1;
+}
+
+void reactor::unlink(reactor_handler* handler)
+{
+    if( handler->prev_ )
+        handler->prev_->next_ = handler->next_;
+    else
+        owned_ = handler->next_;
+    if( handler->next_ )
+        handler->next_->prev_ = handler->prev_;
+    handler->prev_ = 0;
+    handler->next_ = 0;
+    handler->owned_ = false;
+    owned_count_ -= 1;
+}
+
+void reactor::delete_disposed()
+{
+    for( std::vector<reactor_handler*>::const_iterator i = disposed_.begin(); i != disposed_.end(); ++i ) {
+        delete *i;
+    }
+    disposed_.clear();
+}
+
+//
+// reactor_connection
+//
+
+reactor_connection::reactor_connection(reactor& r, std::auto_ptr<tcp_client_socket> client):
+    reactor_(r),
+    socket_(client),
+    closed_(false)
+{
+}
+
+reactor_connection::~reactor_connection()
+{
+}
+
+void reactor_connection::close()
+{
+    if( closed_ )
+        return;
+    closed_ = true;
+    // close() of descriptor removes it from epoll set, so
+    // explicit EPOLL_CTL_DEL is not needed
+    reactor_.dispose(-1, this);
+    socket_->close();
+}
+
+//
+// reactor_server
+//
+
+class reactor_server::loop: public reactor_handler {
+public:
+    loop(reactor_server& server, tstring const& address, int port, int flags):
+        server_(server),
+        listener_(address, port, flags, SOMAXCONN)
+    {
+        listener_.set_blocking(false);
+        reactor_.add(listener_.handle(), this);
+    }
+
+    ~loop()
+    {
+        reactor_.remove(listener_.handle());
+    }
+
+    void on_readable()
+    {
+        while( !reactor_.stopped() ) {
+            std::string peer_address;
+            std::auto_ptr<tcp_client_socket> client(listener_.accept(peer_address));
+            if( client.get() == 0 )
+                break;
+            client->set_blocking(false);
+            const socket::handle_type h = client->handle();
+            reactor_connection* connection = server_.on_accept(reactor_, client, peer_address);
+            if( connection == 0 )
+                continue;
+            reactor_.adopt(h, connection);
+        }
+    }
+
+    void on_writable()
+    {
+    }
+
+    reactor& get_reactor() { return reactor_; }
+private:
+    reactor_server&   server_;
+    reactor           reactor_;
+    tcp_server_socket listener_;
+};
+
+reactor_server::reactor_server():
+    stopped_(false),
+    bound_port_(0)
+{
+}
+
+reactor_server::~reactor_server()
+{
+    clear_loops();
+}
+
+void reactor_server::clear_loops()
+{
+    for( std::vector<loop*>::const_iterator i = loops_.begin(); i != loops_.end(); ++i ) {
+        delete *i;
+    }
+    loops_.clear();
+}
+
+void reactor_server::bind(const char* address, int port, int loop_count)
+{
+    clear_loops();
+    if( loop_count <= 0 )
+        loop_count = tinfra::thread::hardware_concurrency();
+    const int flags = loop_count > 1 ? TSF_REUSE_PORT : 0;
+    const tstring actual_address = address ? tstring(address) : tstring();
+    for( int i = 0; i < loop_count; ++i ) {
+        std::auto_ptr<loop> l(new loop(*this, actual_address, port, flags));
+        loops_.push_back(l.get());
+        l.release();
+    }
+    if( address ) {
+        bound_address_ = address;
+    }
+    bound_port_ = port;
+}
+
+void* reactor_server::loop_thread_func(void* p)
+{
+    loop* l = static_cast<loop*>(p);
+    l->get_reactor().run();
+    return 0;
+}
+
+void reactor_server::run()
+{
+    if( loops_.empty() )
+        throw std::logic_error("reactor_server: run() called before bind()");
+    TINFRA_GLOBAL_TRACE(fmt("reactor_server %s:%s: running %i loops")
+        % bound_address_ % bound_port_ % loops_.size());
+    {
+        tinfra::thread::thread_set threads;
+        for( size_t i = 1; i < loops_.size(); ++i ) {
+            threads.start(&reactor_server::loop_thread_func, loops_[i]);
+        }
+        try {
+            loops_[0]->get_reactor().run();
+        } catch( ... ) {
+            stop();
+            throw;
+        }
+        // threads are joined here
+    }
+    stopped_ = true;
+}
+
+void reactor_server::stop()
+{
+    TINFRA_GLOBAL_TRACE(fmt("stopping reactor_server %s:%s") % bound_address_ % bound_port_);
+    for( std::vector<loop*>::const_iterator i = loops_.begin(); i != loops_.end(); ++i ) {
+        (*i)->get_reactor().stop();
+    }
+}
+
+} } // end namespace tinfra::net
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_reactor_h_included
+#define tinfra_reactor_h_included
+
+#include "socket.h"
+#include "tcp_socket.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tinfra {
+namespace net {
+
+class reactor;
+
+/// Receiver of readiness notifications.
+///
+/// Handlers are registered in edge-triggered mode, so each
+/// notification must be served until operation would block
+/// (try_read()/try_write() return -1).
+class reactor_handler {
+public:
+    reactor_handler();
+    virtual ~reactor_handler();
+
+    /// Socket has data to read or peer closed its side.
+    virtual void on_readable() = 0;
+
+    /// Socket is ready for write.
+    virtual void on_writable() = 0;
+
+    /// Error or hangup occured on socket.
+    ///
+    /// Default implementation calls on_readable(), so
+    /// the handler discovers condition from failing read.
+    virtual void on_error();
+
+private:
+    friend class reactor;
+
+    // reactor maintains intrusive list of owned handlers
+    // so there is no per connection allocation in reactor
+    reactor_handler* prev_;
+    reactor_handler* next_;
+    bool             owned_;
+
+    // noncopyable
+    reactor_handler(reactor_handler const&);
+    reactor_handler& operator=(reactor_handler const&);
+};
+
+/// Single threaded event loop.
+///
+/// Linux epoll based event loop. It's not thread safe except
+/// for stop() which may be called from any thread.
+class reactor {
+public:
+    reactor();
+    ~reactor();
+
+    /// Register handler for socket.
+    ///
+    /// reactor doesn't own handler, it must be removed before
+    /// destruction.
+    void add(socket::handle_type h, reactor_handler* handler);
+
+    /// Register owned handler for socket.
+    ///
+    /// Handler will be deleted by dispose() or in reactor
+    /// destructor.
+    void adopt(socket::handle_type h, reactor_handler* handler);
+
+    /// Unregister socket.
+    void remove(socket::handle_type h);
+
+    /// Unregister socket and delete handler.
+    ///
+    /// Deletion is deferred until current dispatch round ends,
+    /// so it's safe to dispose handler from its own callback.
+    void dispose(socket::handle_type h, reactor_handler* handler);
+
+    /// Run event loop until stop() is called.
+    void run();
+
+    /// Wait for events and dispatch them.
+    ///
+    /// Waits at most timeout_ms (-1 means infinity) milliseconds.
+    /// Returns number of dispatched events.
+    int  run_once(int timeout_ms);
+
+    /// Stop event loop.
+    ///
+    /// Thread safe, wakes up reactor if it's waiting for events.
+    void stop();
+
+    bool stopped() const { return stopped_; }
+
+    /// Number of handlers owned by this reactor.
+    size_t owned_count() const { return owned_count_; }
+
+private:
+    void link(reactor_handler* handler);
+    void unlink(reactor_handler* handler);
+    void delete_disposed();
+
+    int  epoll_fd_;
+    int  wakeup_fd_;
+    volatile bool stopped_;
+
+    reactor_handler*              owned_;
+    size_t                        owned_count_;
+    std::vector<reactor_handler*> disposed_;
+
+    // noncopyable
+    reactor(reactor const&);
+    reactor& operator=(reactor const&);
+};
+
+/// Base for connections served by reactor_server.
+///
+/// Owns non-blocking client socket. Derived classes implement
+/// protocol in on_readable() and on_writable() and call close()
+/// when connection is finished.
+class reactor_connection: public reactor_handler {
+public:
+    reactor_connection(reactor& r, std::auto_ptr<tcp_client_socket> client);
+    ~reactor_connection();
+
+    tcp_client_socket& socket() { return *socket_; }
+    reactor&           get_reactor() { return reactor_; }
+
+    /// Close connection.
+    ///
+    /// Connection object is deleted after current
+    /// dispatch round.
+    void close();
+    bool closed() const { return closed_; }
+
+private:
+    reactor&                         reactor_;
+    std::auto_ptr<tcp_client_socket> socket_;
+    bool                             closed_;
+};
+
+/// Event-driven multiplexing TCP server.
+///
+/// Runs one reactor loop per thread (by default one per processor),
+/// each with its own SO_REUSEPORT listener. Accepted connections
+/// are served by reactor_connection objects created by on_accept()
+/// and live in the loop that accepted them.
+class reactor_server {
+public:
+    reactor_server();
+    virtual ~reactor_server();
+
+    /// Bind listeners.
+    ///
+    /// loop_count == 0 means one loop per processor.
+    void bind(const char* address, int port, int loop_count = 0);
+
+    /// Run all loops.
+    ///
+    /// Blocks until stop() is called.
+    void run();
+
+    /// Stop all loops.
+    ///
+    /// Thread safe, may be called from connection callback.
+    void stop();
+
+    bool stopped() const { return stopped_; }
+
+    int  loop_count() const { return static_cast<int>(loops_.size()); }
+
+protected:
+    /// Create connection for newly accepted socket.
+    ///
+    /// Called in loop thread, socket is already non-blocking.
+    /// Returning 0 closes the socket.
+    virtual reactor_connection* on_accept(reactor& r, std::auto_ptr<tcp_client_socket> client, std::string const& peer_address) = 0;
+
+private:
+    class loop;
+    friend class loop;
+
+    static void* loop_thread_func(void* p);
+    void clear_loops();
+
+    std::vector<loop*> loops_;
+    volatile bool      stopped_;
+    std::string        bound_address_;
+    int                bound_port_;
+
+    // noncopyable
+    reactor_server(reactor_server const&);
+    reactor_server& operator=(reactor_server const&);
+};
+
+} } // end namespace tinfra::net
+
+#endif // tinfra_reactor_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
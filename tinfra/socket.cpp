@@ -33,10 +33,24 @@ typedef int socklen_t;
 #include <netdb.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/uio.h>
+#include <string.h>
+#include <limits.h>
+#include <algorithm>
+
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
 
 #define TS_BSD
 #endif
 
+#ifdef MSG_NOSIGNAL
+#define TS_NONBLOCK_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define TS_NONBLOCK_SEND_FLAGS 0
+#endif
+
 namespace tinfra {
 
 namespace detail {
@@ -79,6 +93,17 @@ bool last_socket_error_is_interruption()
     return e == EINTR;
 #endif
 }
+
+bool last_socket_error_is_would_block()
+{
+#ifdef TS_WINSOCK
+    int e = WSAGetLastError();
+    return e == WSAEWOULDBLOCK;
+#else
+    int e = errno;
+    return e == EAGAIN || e == EWOULDBLOCK;
+#endif
+}
 } // end namespace tinfra::detail
 
 
@@ -200,6 +225,77 @@ client_stream_socket::write(const char* data, int size)
     }
 }
 
+int
+client_stream_socket::writev(tstring const* fragments, size_t count)
+{
+#ifdef TS_BSD
+    TINFRA_INVARIANT( handle() != -1 );
+    struct iovec iov[IOV_MAX];
+    const size_t n = std::min<size_t>(count, IOV_MAX);
+    for( size_t i = 0; i < n; ++i ) {
+        iov[i].iov_base = const_cast<char*>(fragments[i].data());
+        iov[i].iov_len = fragments[i].size();
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = n;
+    while( true ) {
+        int result = ::sendmsg(handle(), &msg, TS_NONBLOCK_SEND_FLAGS);
+        if( result == -1 && detail::last_socket_error_is_interruption() ) {
+            tinfra::test_interrupt();
+            continue;
+        }
+        if( result == -1 ) {
+            detail::throw_socket_error("sendmsg() failed when writing socket");
+        }
+        return result;
+    }
+#else
+    return output_stream::writev(fragments, count);
+#endif
+}
+
+int 
+client_stream_socket::try_read(char* dest, int size)
+{
+    TINFRA_INVARIANT( handle() != -1 );
+    while( true ) {
+        int result = ::recv(handle(), dest ,size, 0);
+        if( result == -1 && detail::last_socket_error_is_interruption() ) {
+            tinfra::test_interrupt();
+            continue;
+        }
+        if( result == -1 && detail::last_socket_error_is_would_block() ) {
+            return -1;
+        }
+        if( result == -1 ) {
+            detail::throw_socket_error("recv() failed when reading socket");
+        }
+        return result;
+    }
+}
+
+int 
+client_stream_socket::try_write(const char* data, int size)
+{
+    TINFRA_INVARIANT( handle() != -1 );
+    while( true ) {
+        int result = ::send(handle(), data, size, TS_NONBLOCK_SEND_FLAGS);
+        if( result == -1 && detail::last_socket_error_is_interruption() ) {
+            tinfra::test_interrupt();
+            continue;
+        }
+        if( result == -1 && detail::last_socket_error_is_would_block() ) {
+            return -1;
+        }
+        if( result == -1 ) {
+            detail::throw_socket_error("send() failed when writing socket");
+        }
+        return result;
+    }
+}
+
 void 
 client_stream_socket::sync()
 {
@@ -63,8 +63,23 @@ public:
 
     // output_stream interface
     int write(const char* data, int size);
+    int writev(tstring const* fragments, size_t count);
     void sync();
     
+    /// Non-blocking read.
+    ///
+    /// Works like read(), but when socket is in non-blocking
+    /// mode and no data is available returns -1 instead of
+    /// throwing.
+    int try_read(char* dest, int size);
+    
+    /// Non-blocking write.
+    ///
+    /// Works like write(), but when socket is in non-blocking
+    /// mode and send buffer is full returns -1 instead of
+    /// throwing.
+    int try_write(const char* data, int size);
+    
     // shared interface
     void close();
 };
@@ -78,6 +93,7 @@ int  close_socket_nothrow(socket::handle_type socket);
 void throw_socket_error(const char* message);
 void throw_socket_error(int error_code, const char* message);
 bool last_socket_error_is_interruption();
+bool last_socket_error_is_would_block();
 }
 
 } // end namespace tinfra
@@ -0,0 +1,197 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "static_fmt.h"
+
+#include "basic_int_to_string.h"
+#include "stream.h"
+
+#include <algorithm>
+#include <ostream>
+#include <cstdio>
+
+namespace tinfra {
+
+//
+// fmt_output
+//
+
+fmt_output::fmt_output(char* buffer, size_t size):
+    str_(0),
+    str_start_(0),
+    begin_(buffer),
+    pos_(buffer),
+    end_(buffer + size),
+    dropped_(0)
+{
+}
+
+fmt_output::fmt_output(std::string& out):
+    str_(&out),
+    str_start_(out.size()),
+    begin_(0),
+    pos_(0),
+    end_(0),
+    dropped_(0)
+{
+    grow_string(0);
+}
+
+fmt_output::~fmt_output()
+{
+    finish();
+}
+
+void fmt_output::append(size_t count, char c)
+{
+    if( count > size_t(end_ - pos_) ) {
+        if( str_ ) {
+            grow_string(count);
+        } else {
+            dropped_ += count - (end_ - pos_);
+            count = end_ - pos_;
+        }
+    }
+    std::memset(pos_, c, count);
+    pos_ += count;
+}
+
+void fmt_output::finish()
+{
+    if( str_ ) {
+        str_->resize(str_start_ + (pos_ - begin_));
+        end_ = pos_;
+    }
+}
+
+void fmt_output::overflow(const char* data, size_t size)
+{
+    if( str_ ) {
+        grow_string(size);
+    } else {
+        const size_t fits = end_ - pos_;
+        dropped_ += size - fits;
+        size = fits;
+    }
+    std::memcpy(pos_, data, size);
+    pos_ += size;
+}
+
+void fmt_output::grow_string(size_t needed)
+{
+    // use whole capacity, at least doubling output
+    const size_t used = pos_ - begin_;
+    const size_t new_size = std::max(std::max(str_->capacity(), str_start_ + 64),
+                                     str_start_ + std::max(used * 2, used + needed));
+    str_->resize(new_size);
+    begin_ = &(*str_)[0] + str_start_;
+    pos_ = begin_ + used;
+    end_ = &(*str_)[0] + new_size;
+}
+
+//
+// parsing
+//
+
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+bool fmt_next_directive(tstring const& format, size_t& pos, fmt_output& out, fmt_spec& spec)
+{
+    const char*  f = format.data();
+    const size_t n = format.size();
+    while( pos < n ) {
+        const char* percent = static_cast<const char*>(std::memchr(f + pos, '%', n - pos));
+        if( !percent ) {
+            out.append(f + pos, n - pos);
+            pos = n;
+            break;
+        }
+        out.append(f + pos, percent - (f + pos));
+        size_t i = (percent - f) + 1;
+        if( i == n )
+            throw format_exception("bad format: '%' at the end");
+        if( f[i] == '%' ) {
+            // %% sequence is an escape
+            out.append("%", 1);
+            pos = i + 1;
+            continue;
+        }
+        spec.command = '?';
+        spec.fill = ' ';
+        spec.width = 0;
+        spec.precision = 0;
+        if( f[i] == '0' ) {
+            spec.fill = '0';
+            ++i;
+        }
+        bool in_precision = false;
+        for( ; i < n; ++i ) {
+            const char c = f[i];
+            if( c == '.' ) {
+                in_precision = true;
+            } else if( is_digit(c) ) {
+                int& v = in_precision ? spec.precision : spec.width;
+                v = v*10 + (c - '0');
+            } else if( c == 's' || c == 'i' || c == 'd' || c == 'x' ) {
+                spec.command = c;
+                pos = i + 1;
+                return true;
+            } else {
+                throw format_exception(std::string("bad format command ") + c);
+            }
+        }
+        throw format_exception("bad format: unterminated directive");
+    }
+    return false;
+}
+
+//
+// builtin formatters
+//
+
+void fmt_format_signed(fmt_output& out, fmt_spec const& spec, long long value)
+{
+    char buffer[32];
+    const int len = signed_integer_to_string_dec(value, buffer, sizeof(buffer));
+    out.append_padded(spec, buffer, len);
+}
+
+void fmt_format_unsigned(fmt_output& out, fmt_spec const& spec, unsigned long long value)
+{
+    char buffer[32];
+    const int len = (spec.command == 'x')
+        ? unsigned_integer_to_string_hex(value, buffer, sizeof(buffer))
+        : unsigned_integer_to_string_dec(value, buffer, sizeof(buffer));
+    out.append_padded(spec, buffer, len);
+}
+
+void fmt_format_double(fmt_output& out, fmt_spec const& spec, double value)
+{
+    // same as std::ostream with default floatfield
+    char buffer[64];
+    const int precision = spec.precision > 0 ? std::min(spec.precision, 40) : 6;
+    const int len = std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+    out.append_padded(spec, buffer, std::min(size_t(len), sizeof(buffer)-1));
+}
+
+void fmt_setup_ostream(std::ostream& formatter, fmt_spec const& spec)
+{
+    formatter.fill(spec.fill);
+    if( spec.width )
+        formatter.width(spec.width);
+    if( spec.precision )
+        formatter.precision(spec.precision);
+    if( spec.command == 'x' )
+        std::hex(formatter);
+}
+
+void fmt_write(tinfra::output_stream& out, const char* data, size_t size)
+{
+    write_all(out, tstring(data, size));
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,352 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_static_fmt_h_included
+#define tinfra_static_fmt_h_included
+
+#include "platform.h"
+#include "tstring.h"
+
+#include <cstring>
+#include <string>
+#include <sstream>   // for std::ostringstream, fallback for other types
+#include <stdexcept> // for std::logic_error
+
+namespace tinfra {
+
+class output_stream;
+
+class format_exception: public std::logic_error {
+public:
+    format_exception(const std::string& message): std::logic_error("format exception: " + message) {}
+};
+
+/// Parsed format directive: %[0][width][.precision]command.
+struct fmt_spec {
+    char command;   ///< s, i, d or x
+    char fill;
+    int  width;
+    int  precision; ///< 0 means default
+};
+
+/// Output of formatting engine.
+///
+/// Either appends to std::string (growing it as needed) or writes
+/// to fixed buffer; in the latter case output is truncated, but
+/// size() counts all formatted characters.
+class fmt_output {
+public:
+    fmt_output(char* buffer, size_t size);
+    explicit fmt_output(std::string& out);
+    ~fmt_output();
+
+    void append(const char* data, size_t size)
+    {
+        if( TINFRA_LIKELY(size <= size_t(end_ - pos_)) ) {
+            std::memcpy(pos_, data, size);
+            pos_ += size;
+        } else {
+            overflow(data, size);
+        }
+    }
+    void append(tstring const& s) { append(s.data(), s.size()); }
+    void append(std::string const& s) { append(s.data(), s.size()); }
+    void append(size_t count, char c);
+
+    /// Append value padded to spec.width with spec.fill.
+    void append_padded(fmt_spec const& spec, const char* data, size_t size)
+    {
+        if( size_t(spec.width) > size )
+            append(spec.width - size, spec.fill);
+        append(data, size);
+    }
+
+    /// Number of formatted characters.
+    size_t size() const { return (pos_ - begin_) + dropped_; }
+
+    /// Trim string output to formatted size.
+    void   finish();
+
+private:
+    void overflow(const char* data, size_t size);
+    void grow_string(size_t needed);
+
+    std::string* str_;
+    size_t       str_start_;
+    char*        begin_;
+    char*        pos_;
+    char*        end_;
+    size_t       dropped_;
+
+    // noncopyable
+    fmt_output(fmt_output const&);
+    fmt_output& operator=(fmt_output const&);
+};
+
+/// Copy literal text until next directive into out.
+///
+/// Returns false when format ends; throws format_exception on
+/// malformed directive.
+bool fmt_next_directive(tstring const& format, size_t& pos, fmt_output& out, fmt_spec& spec);
+
+void fmt_format_signed(fmt_output& out, fmt_spec const& spec, long long value);
+void fmt_format_unsigned(fmt_output& out, fmt_spec const& spec, unsigned long long value);
+void fmt_format_double(fmt_output& out, fmt_spec const& spec, double value);
+void fmt_setup_ostream(std::ostream& formatter, fmt_spec const& spec);
+
+/// Formats one value, specialized for builtin types.
+///
+/// Formatting rules are the same as in basic_fmt (which uses
+/// iostreams): chars are printed as characters, bools as 1/0, %x
+/// prints integers as unsigned hex, doubles are printed as %g with
+/// spec precision (default 6). Other types are printed using
+/// operator<<.
+template <typename T>
+struct fmt_formatter {
+    static void format(fmt_output& out, fmt_spec const& spec, T const& value)
+    {
+        std::ostringstream formatter;
+        fmt_setup_ostream(formatter, spec);
+        formatter << value;
+        out.append(formatter.str());
+    }
+};
+
+#define TINFRA_FMT_SIGNED_FORMATTER(T)                                     \
+template <> struct fmt_formatter<T> {                                      \
+    static void format(fmt_output& out, fmt_spec const& spec, T value)     \
+    {                                                                      \
+        if( spec.command == 'x' )                                          \
+            fmt_format_unsigned(out, spec, static_cast<unsigned T>(value)); \
+        else                                                               \
+            fmt_format_signed(out, spec, value);                           \
+    }                                                                      \
+}
+
+#define TINFRA_FMT_UNSIGNED_FORMATTER(T)                                   \
+template <> struct fmt_formatter<T> {                                      \
+    static void format(fmt_output& out, fmt_spec const& spec, T value)     \
+    {                                                                      \
+        fmt_format_unsigned(out, spec, value);                             \
+    }                                                                      \
+}
+
+TINFRA_FMT_SIGNED_FORMATTER(short);
+TINFRA_FMT_SIGNED_FORMATTER(int);
+TINFRA_FMT_SIGNED_FORMATTER(long);
+TINFRA_FMT_SIGNED_FORMATTER(long long);
+TINFRA_FMT_UNSIGNED_FORMATTER(unsigned short);
+TINFRA_FMT_UNSIGNED_FORMATTER(unsigned int);
+TINFRA_FMT_UNSIGNED_FORMATTER(unsigned long);
+TINFRA_FMT_UNSIGNED_FORMATTER(unsigned long long);
+
+#undef TINFRA_FMT_SIGNED_FORMATTER
+#undef TINFRA_FMT_UNSIGNED_FORMATTER
+
+#define TINFRA_FMT_CHAR_FORMATTER(T)                                       \
+template <> struct fmt_formatter<T> {                                      \
+    static void format(fmt_output& out, fmt_spec const& spec, T value)     \
+    {                                                                      \
+        const char c = static_cast<char>(value);                           \
+        out.append_padded(spec, &c, 1);                                    \
+    }                                                                      \
+}
+
+TINFRA_FMT_CHAR_FORMATTER(char);
+TINFRA_FMT_CHAR_FORMATTER(signed char);
+TINFRA_FMT_CHAR_FORMATTER(unsigned char);
+
+#undef TINFRA_FMT_CHAR_FORMATTER
+
+template <> struct fmt_formatter<bool> {
+    static void format(fmt_output& out, fmt_spec const& spec, bool value)
+    {
+        out.append_padded(spec, value ? "1" : "0", 1);
+    }
+};
+
+template <> struct fmt_formatter<double> {
+    static void format(fmt_output& out, fmt_spec const& spec, double value)
+    {
+        fmt_format_double(out, spec, value);
+    }
+};
+
+template <> struct fmt_formatter<float> {
+    static void format(fmt_output& out, fmt_spec const& spec, float value)
+    {
+        fmt_format_double(out, spec, value);
+    }
+};
+
+template <> struct fmt_formatter<tstring> {
+    static void format(fmt_output& out, fmt_spec const& spec, tstring const& value)
+    {
+        out.append_padded(spec, value.data(), value.size());
+    }
+};
+
+template <> struct fmt_formatter<std::string> {
+    static void format(fmt_output& out, fmt_spec const& spec, std::string const& value)
+    {
+        out.append_padded(spec, value.data(), value.size());
+    }
+};
+
+template <> struct fmt_formatter<const char*> {
+    static void format(fmt_output& out, fmt_spec const& spec, const char* value)
+    {
+        // null is printed as nothing, same as iostreams do
+        if( value )
+            out.append_padded(spec, value, std::strlen(value));
+    }
+};
+
+template <> struct fmt_formatter<char*>: public fmt_formatter<const char*> {};
+
+template <size_t N> struct fmt_formatter<char[N]>: public fmt_formatter<const char*> {};
+
+//
+// formatting engine
+//
+
+#ifdef TINFRA_HAS_VARIADIC_TEMPLATES
+
+namespace detail {
+
+/// Count directives in format at compile time.
+///
+/// Malformed format isn't a constant expression (throws), so it's
+/// reported as compile error.
+constexpr size_t fmt_count_directives(const char* f);
+
+constexpr size_t fmt_count_directive_tail(const char* f)
+{
+    return (*f == '0' || *f == '.' || (*f >= '1' && *f <= '9'))
+        ? fmt_count_directive_tail(f+1)
+        : (*f == 's' || *f == 'i' || *f == 'd' || *f == 'x')
+            ? 1 + fmt_count_directives(f+1)
+            : throw format_exception("bad format command");
+}
+
+constexpr size_t fmt_count_directives(const char* f)
+{
+    return *f == 0
+        ? 0
+        : *f != '%'
+            ? fmt_count_directives(f+1)
+            : f[1] == '%'
+                ? fmt_count_directives(f+2)
+                : fmt_count_directive_tail(f+1);
+}
+
+inline void fmt_apply(tstring const& format, size_t& pos, fmt_output& out)
+{
+    fmt_spec spec;
+    if( fmt_next_directive(format, pos, out, spec) )
+        throw format_exception("not all arguments realized");
+}
+
+template <typename T, typename... Args>
+void fmt_apply(tstring const& format, size_t& pos, fmt_output& out, T const& value, Args const&... args)
+{
+    fmt_spec spec;
+    if( !fmt_next_directive(format, pos, out, spec) )
+        throw format_exception("too many actual arguments");
+    fmt_formatter<T>::format(out, spec, value);
+    fmt_apply(format, pos, out, args...);
+}
+
+} // end namespace detail
+
+/// Format string checked at compile time.
+///
+/// Created by TINFRA_FMT("literal") which counts directives
+/// and validates format at compile time; functions taking
+/// static_fmt<N> fail to compile if number of arguments is not N.
+///
+/// Usage:
+/// <pre>
+///   std::string s = tsprintf(TINFRA_FMT("%s: %08x"), name, crc);
+///   tprintf(out, TINFRA_FMT("%i items\n"), count);
+/// </pre>
+template <size_t N>
+class static_fmt {
+public:
+    explicit TINFRA_CONSTEXPR static_fmt(tstring const& format): format_(format) {}
+
+    tstring const& str() const { return format_; }
+
+private:
+    tstring format_;
+};
+
+#define TINFRA_FMT(literal) \
+    ::tinfra::static_fmt< ::tinfra::detail::fmt_count_directives(literal) >(::tinfra::tstring(literal, sizeof(literal)-1, true))
+
+/// Append formatted arguments to out.
+///
+/// Runtime checked version, throws format_exception if format
+/// doesn't match arguments.
+template <typename... Args>
+void fmt_append(std::string& out, tstring const& format, Args const&... args)
+{
+    fmt_output output(out);
+    size_t pos = 0;
+    detail::fmt_apply(format, pos, output, args...);
+    output.finish();
+}
+
+template <size_t N, typename... Args>
+std::string tsprintf(static_fmt<N> const& format, Args const&... args)
+{
+    static_assert(sizeof...(Args) == N, "number of arguments doesn't match format");
+    std::string result;
+    fmt_append(result, format.str(), args...);
+    return result;
+}
+
+/// snprintf like formatting into fixed buffer.
+///
+/// Output is truncated to size-1 characters and null terminated;
+/// returns length of whole formatted output (without terminator).
+template <size_t N, typename... Args>
+size_t tsnprintf(char* buffer, size_t size, static_fmt<N> const& format, Args const&... args)
+{
+    static_assert(sizeof...(Args) == N, "number of arguments doesn't match format");
+    fmt_output output(buffer, size > 0 ? size-1 : 0);
+    size_t pos = 0;
+    detail::fmt_apply(format.str(), pos, output, args...);
+    if( size > 0 )
+        buffer[output.size() < size ? output.size() : size-1] = 0;
+    return output.size();
+}
+
+void fmt_write(tinfra::output_stream& out, const char* data, size_t size);
+
+template <size_t N, typename... Args>
+void tprintf(tinfra::output_stream& out, static_fmt<N> const& format, Args const&... args)
+{
+    static_assert(sizeof...(Args) == N, "number of arguments doesn't match format");
+    char buffer[512];
+    fmt_output output(buffer, sizeof(buffer));
+    size_t pos = 0;
+    detail::fmt_apply(format.str(), pos, output, args...);
+    if( output.size() <= sizeof(buffer) ) {
+        fmt_write(out, buffer, output.size());
+    } else {
+        std::string tmp;
+        fmt_append(tmp, format.str(), args...);
+        fmt_write(out, tmp.data(), tmp.size());
+    }
+}
+
+#endif // TINFRA_HAS_VARIADIC_TEMPLATES
+
+} // end namespace tinfra
+
+#endif // tinfra_static_fmt_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -13,6 +13,7 @@
 #include "memory_stream.h"
 
 #include <memory>             // for auto_ptr
+#include <vector>
 #include <algorithm>          // for std::min
 #include <stdlib.h>           // for ::memmove
 namespace tinfra {
@@ -27,11 +28,39 @@ output_stream::~output_stream()
 {
 }
 
+int input_stream::readv(mutable_buffer const* buffers, size_t count)
+{
+    int total = 0;
+    for( size_t i = 0; i < count; ++i ) {
+        if( buffers[i].size == 0 )
+            continue;
+        const int r = this->read(buffers[i].data, buffers[i].size);
+        total += r;
+        if( r < static_cast<int>(buffers[i].size) )
+            break;
+    }
+    return total;
+}
+
 int output_stream::write(tstring const& data)
 {
     return this->write(data.data(), data.size());
 }
 
+int output_stream::writev(tstring const* fragments, size_t count)
+{
+    int total = 0;
+    for( size_t i = 0; i < count; ++i ) {
+        if( fragments[i].size() == 0 )
+            continue;
+        const int w = this->write(fragments[i].data(), fragments[i].size());
+        total += w;
+        if( w < static_cast<int>(fragments[i].size()) )
+            break;
+    }
+    return total;
+}
+
 auto_ptr<input_stream>  create_memory_input_stream(const void* buffer, size_t size, memory_strategy buffer_strategy)
 {
     const void* buffer2 = buffer;
@@ -54,16 +83,20 @@ std::string read_all(input_stream& input)
 {
     static const int COPY_BUFFER_SIZE = 65536;
 
-    char buffer[COPY_BUFFER_SIZE];
-    std::vector<char> tmp;
-    int readed;
-    
-    while( (readed = input.read(buffer, sizeof(buffer))) > 0 ) {
-        tmp.insert(tmp.end(),
-            buffer, buffer + readed);
+    // read directly into result, growing it geometrically
+    std::string result(COPY_BUFFER_SIZE, '\0');
+    size_t used = 0;
+    while( true ) {
+        if( used == result.size() )
+            result.resize(result.size() * 2);
+        const size_t space = std::min(result.size() - used, size_t(1) << 30);
+        const int readed = input.read(&result[used], static_cast<int>(space));
+        if( readed <= 0 )
+            break;
+        used += readed;
     }
-    
-    return std::string(tmp.begin(), tmp.end());
+    result.resize(used);
+    return result;
 }
 
 void        write_all(output_stream& output, tstring const& data)
@@ -85,8 +118,39 @@ void        write_all(output_stream& output, tstring const& data)
     }
 }
 
+void        write_all(output_stream& output, tstring const* fragments, size_t count)
+{
+    using tinfra::fail;
+    using tinfra::tsprintf;
+
+    // after partial write, first remaining fragment is replaced
+    // by its unwritten part, so we need own copy
+    std::vector<tstring> remaining(fragments, fragments + count);
+    size_t first = 0;
+    while( first < remaining.size() ) {
+        if( remaining[first].size() == 0 ) {
+            ++first;
+            continue;
+        }
+        size_t w = output.writev(&remaining[first], remaining.size() - first);
+        if( w == 0 ) {
+            fail(tsprintf("unable to save data, %i fragments left", remaining.size() - first),
+                 "writev() unexpectedly returned 0");
+        }
+        while( w > 0 && w >= remaining[first].size() ) {
+            w -= remaining[first].size();
+            ++first;
+        }
+        if( w > 0 )
+            remaining[first] = remaining[first].substr(w);
+    }
+}
+
 void        stream_copy(input_stream& input, output_stream& out)
 {
+    if( detail::native_stream_copy(input, out) )
+        return;
+
     static const int COPY_BUFFER_SIZE = 65536;
     char buffer[COPY_BUFFER_SIZE];
     int readed;
@@ -11,6 +11,12 @@
 
 namespace tinfra {
 
+/// Writable memory region, for scatter reads.
+struct mutable_buffer {
+    char*  data;
+    size_t size;
+};
+
 class input_stream {
 public:
     virtual ~input_stream();
@@ -18,6 +24,14 @@ public:
     virtual void close() = 0;
 
     virtual int read(char* dest, int size) = 0;
+
+    /// Scatter read.
+    ///
+    /// Read into consecutive buffers as if it was one read() of
+    /// their total size; returns number of bytes read, 0 on EOF.
+    /// Default implementation calls read() for each buffer until
+    /// one is not filled completely.
+    virtual int readv(mutable_buffer const* buffers, size_t count);
 };
 
 class output_stream {
@@ -31,6 +45,15 @@ public:
     virtual void close() = 0;    
     virtual int write(const char* data, int size) = 0;
     virtual void sync() = 0;
+
+    /// Gather write.
+    ///
+    /// Write fragments as if it was one write() of their
+    /// concatenation; returns number of bytes written, which (as
+    /// for write()) may be less than total size. Default
+    /// implementation calls write() for each fragment until one is
+    /// written partially.
+    virtual int writev(tstring const* fragments, size_t count);
 };
 
 #if 0
@@ -100,8 +123,39 @@ std::string read_all(input_stream& input);
 ///    std::runtime_error if output.write() returns 0
 void        write_all(output_stream& output, tstring const& data);
 
+/// write all fragments to stream
+///
+/// Write fragments (retrying with remaining parts as necessary) with
+/// output.writev(), so native streams write them with one syscall.
+///
+/// throws/failures:
+///    will rethrow, any error occured in output.writev()
+///    std::runtime_error if output.writev() returns 0
+void        write_all(output_stream& output, tstring const* fragments, size_t count);
+
+/// copy all data from input to output
+///
+/// If both streams are backed by native OS handles (file,
+/// native streams, sockets) copy is done by kernel
+/// (copy_file_range, sendfile, splice) without passing data
+/// through user space; otherwise data is copied through
+/// 64KB buffer.
+///
+/// throws/failures:
+///    will rethrow, any error occured in input.read(), output.write()
+///    std::runtime_error on kernel copy failure
 void        stream_copy(input_stream& input, output_stream& out);
 
+namespace detail {
+/// copy input to output by OS, if possible
+///
+/// Returns true if whole input was copied, false if it's not possible
+/// for these streams. In latter case some data might have already
+/// been copied and consumed from input, caller shall continue with
+/// ordinary copy.
+bool native_stream_copy(input_stream& input, output_stream& out);
+}
+
 } // end namespace tinfra
 
 // native_file is defined "per"
@@ -120,83 +120,59 @@ std::vector<std::string> split(tstring const& in, char delimiter)
     return split_strict(in, delimiter);
 }
 
+namespace {
+template <typename T>
+struct split_appender {
+    std::vector<T>* result;
+    void operator()(tstring const& s) { result->push_back(T(s.data(), s.size())); }
+};
+}
+
 std::vector<std::string> split_strict(tstring const& in, char delimiter)
 {
     std::vector<std::string> result;
-    std::size_t start = 0;
-    do {
-        std::size_t pos = in.find_first_of(delimiter, start);
-        if( pos == tstring::npos ) {
-            size_t remaining_length = in.size()-start;
-            result.push_back(std::string(in.begin(), start, remaining_length));
-            break;
-        }
-                             
-        result.push_back(std::string(in.begin(), start, pos-start));
-        
-        start = pos+1;
-        
-        
-    } while( start != std::string::npos );
-        
+    split_appender<std::string> appender = { &result };
+    split_strict_each(in, delimiter, appender);
     return result;
 }
 
 std::vector<std::string> split_skip_empty(tstring const& in, char delimiter)
 {
     std::vector<std::string> result;
-    std::size_t start = 0;
-    std::size_t pos = in.find_first_of(delimiter, start);
-    while( true ) {
-        if( pos == tstring::npos ) {
-            size_t remaining_length = in.size()-start;
-            result.push_back(std::string(in.begin(), start, remaining_length));
-            break;
-        }
-                             
-        result.push_back(std::string(in.begin(), start, pos-start));
-        
-        start = in.find_first_not_of(delimiter, pos+1);
-        if( start  == tstring::npos ) { // if we have nothing more that a
-                                        // empty value after separator must
-                                        // be realized. and we're done.
-            result.push_back(std::string());
-            break;
-        }
-        pos = in.find_first_of(delimiter, start);
-    } 
-            
+    split_appender<std::string> appender = { &result };
+    split_skip_empty_each(in, delimiter, appender);
     return result;
 }
 
 std::vector<std::string> split_lines(tstring const& in)
 {
     std::vector<std::string> result;
-    std::size_t start = 0;
-    int line_number = 0;
-    do {
-        std::size_t pos = in.find_first_of("\n", start);
-        if( pos == tstring::npos ) {
-            size_t remaining_length = in.size()-start;
-            if( line_number == 0 || remaining_length > 0) {
-                result.push_back(std::string(in.begin(), start, in.size()-start));
-            }
-            break;
-        }
-        
-        size_t text_line_length = pos-start;
-        if(text_line_length > 0 && in[pos-1] == '\r' )
-            text_line_length -= 1;
-        
-        result.push_back(std::string(in.begin(), start, text_line_length));
-        
-        start = pos+1;
-        line_number++;
-        
-    } while( start != std::string::npos );
+    split_appender<std::string> appender = { &result };
+    split_lines_each(in, appender);
     return result;
 }
 
+void split_strict(tstring const& in, char delimiter, std::vector<tstring>& result)
+{
+    result.clear();
+    split_appender<tstring> appender = { &result };
+    split_strict_each(in, delimiter, appender);
+}
+
+void split_skip_empty(tstring const& in, char delimiter, std::vector<tstring>& result)
+{
+    result.clear();
+    split_appender<tstring> appender = { &result };
+    split_skip_empty_each(in, delimiter, appender);
+}
+
+void split_lines(tstring const& in, std::vector<tstring>& result)
+{
+    result.clear();
+    split_appender<tstring> appender = { &result };
+    split_lines_each(in, appender);
+}
+
 std::string before_first(tstring const& delimiters, tstring const& input)
 {
     tstring::size_type delim_pos = input.find_first_of(delimiters);
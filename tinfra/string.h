@@ -46,6 +46,40 @@ std::vector<std::string> split(tstring const& in, char delimiter); // DEPRECATED
 /// (CR alone is not detected!)
 std::vector<std::string> split_lines(tstring const& in);
 
+/// strict string splitter, views
+///
+/// as split_strict, but result contains views of input; result is
+/// cleared first, so reused vector doesn't allocate
+void split_strict(tstring const& in, char delimiter, std::vector<tstring>& result);
+
+/// string splitter skipping empty strings, views
+///
+/// as split_skip_empty, but result contains views of input
+void split_skip_empty(tstring const& in, char delimiter, std::vector<tstring>& result);
+
+/// line splitting, views
+///
+/// as split_lines, but result contains views of input
+void split_lines(tstring const& in, std::vector<tstring>& result);
+
+/// strict string splitter, visitor
+///
+/// calls f(tstring) for each substring that split_strict would return
+template <typename Functor>
+Functor split_strict_each(tstring const& in, char delimiter, Functor f);
+
+/// string splitter skipping empty strings, visitor
+///
+/// calls f(tstring) for each substring that split_skip_empty would return
+template <typename Functor>
+Functor split_skip_empty_each(tstring const& in, char delimiter, Functor f);
+
+/// line splitting, visitor
+///
+/// calls f(tstring) for each line that split_lines would return
+template <typename Functor>
+Functor split_lines_each(tstring const& in, Functor f);
+
 /// extract first token
 ///
 /// extracts first token from string delimited by @param any char contained
@@ -76,6 +110,68 @@ int         compare_no_case(tstring const& a, tstring const& b);
 /// @return less than 0 when a appears to be "less" than b, 0 if they're equal, greater than 0 otherwise
 int         compare_no_case(tstring const& a, tstring const& b, size_t upto);
 
+//
+// split_*_each implementation
+//
+
+template <typename Functor>
+Functor split_strict_each(tstring const& in, char delimiter, Functor f)
+{
+    size_t start = 0;
+    while( true ) {
+        const size_t pos = in.find_first_of(delimiter, start);
+        if( pos == tstring::npos ) {
+            f(tstring(in.data() + start, in.size() - start));
+            return f;
+        }
+        f(tstring(in.data() + start, pos - start));
+        start = pos+1;
+    }
+}
+
+template <typename Functor>
+Functor split_skip_empty_each(tstring const& in, char delimiter, Functor f)
+{
+    size_t start = 0;
+    size_t pos = in.find_first_of(delimiter, start);
+    while( true ) {
+        if( pos == tstring::npos ) {
+            f(tstring(in.data() + start, in.size() - start));
+            return f;
+        }
+        f(tstring(in.data() + start, pos - start));
+        start = in.find_first_not_of(delimiter, pos+1);
+        if( start == tstring::npos ) {
+            // empty value after last separator is realized
+            f(tstring(in.data() + in.size(), 0));
+            return f;
+        }
+        pos = in.find_first_of(delimiter, start);
+    }
+}
+
+template <typename Functor>
+Functor split_lines_each(tstring const& in, Functor f)
+{
+    size_t start = 0;
+    bool first = true;
+    while( true ) {
+        const size_t pos = in.find_first_of('\n', start);
+        if( pos == tstring::npos ) {
+            const size_t remaining_length = in.size() - start;
+            if( first || remaining_length > 0 )
+                f(tstring(in.data() + start, remaining_length));
+            return f;
+        }
+        size_t text_line_length = pos - start;
+        if( text_line_length > 0 && in[pos-1] == '\r' )
+            text_line_length -= 1;
+        f(tstring(in.data() + start, text_line_length));
+        start = pos+1;
+        first = false;
+    }
+}
+
 
 }
 
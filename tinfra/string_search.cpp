@@ -0,0 +1,370 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "platform.h"
+
+#include "string_search.h" // we implement this
+
+#include <cstring>
+
+#ifdef TINFRA_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef TINFRA_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace tinfra {
+
+//
+// byte_set
+//
+
+byte_set::byte_set(const char* chars, size_t n):
+    count(0)
+{
+    std::memset(bitmap, 0, sizeof(bitmap));
+    std::memset(low_nibble_lo, 0, sizeof(low_nibble_lo));
+    std::memset(low_nibble_hi, 0, sizeof(low_nibble_hi));
+    for( size_t i = 0; i < n; ++i ) {
+        const unsigned char u = static_cast<unsigned char>(chars[i]);
+        if( contains(chars[i]) )
+            continue;
+        bitmap[u >> 5] |= 1u << (u & 31);
+        if( count < MAX_LISTED )
+            listed[count] = u;
+        ++count;
+        const unsigned hi = u >> 4;
+        if( hi < 8 )
+            low_nibble_lo[u & 15] |= 1u << hi;
+        else
+            low_nibble_hi[u & 15] |= 1u << (hi - 8);
+    }
+}
+
+//
+// scalar
+//
+
+static const char* scalar_find(const char* p, const char* end, const char* needle, size_t n)
+{
+    if( size_t(end - p) < n )
+        return end;
+    const char* const last = end - n;
+    while( p <= last ) {
+        p = static_cast<const char*>(std::memchr(p, needle[0], last - p + 1));
+        if( !p )
+            return end;
+        if( std::memcmp(p + 1, needle + 1, n - 1) == 0 )
+            return p;
+        ++p;
+    }
+    return end;
+}
+
+static const char* scalar_find_of(const char* p, const char* end, byte_set const& set, bool negate)
+{
+    while( p < end && set.contains(*p) == negate )
+        ++p;
+    return p;
+}
+
+static const char* scalar_rfind_of(const char* begin, const char* end, byte_set const& set, bool negate)
+{
+    const char* p = end;
+    while( p > begin ) {
+        --p;
+        if( set.contains(*p) != negate )
+            return p;
+    }
+    return end;
+}
+
+#if defined(TINFRA_SSE2) || defined(TINFRA_AVX2_DISPATCH)
+
+static inline unsigned search_ctz(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long r;
+    _BitScanForward(&r, mask);
+    return r;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+static inline unsigned search_last_bit(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long r;
+    _BitScanReverse(&r, mask);
+    return r;
+#else
+    return 31 - __builtin_clz(mask);
+#endif
+}
+
+#endif
+
+//
+// SSE2, 16-byte blocks
+//
+
+#ifdef TINFRA_SSE2
+
+// matches of first and last needle byte are checked together, only
+// candidates are compared with memcmp
+static const char* sse2_find(const char* p, const char* end, const char* needle, size_t n)
+{
+    if( n >= 2 ) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last  = _mm_set1_epi8(needle[n-1]);
+        while( size_t(end - p) >= n - 1 + 16 ) {
+            const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i block_last  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n - 1));
+            unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                            _mm_cmpeq_epi8(block_last, last)));
+            while( mask != 0 ) {
+                const unsigned bit = search_ctz(mask);
+                if( std::memcmp(p + bit + 1, needle + 1, n - 2) == 0 )
+                    return p + bit;
+                mask &= mask - 1;
+            }
+            p += 16;
+        }
+    }
+    return scalar_find(p, end, needle, n);
+}
+
+static inline unsigned sse2_set_mask(__m128i block, byte_set const& set)
+{
+    __m128i m = _mm_setzero_si128();
+    for( size_t i = 0; i < set.count; ++i )
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(block, _mm_set1_epi8(static_cast<char>(set.listed[i]))));
+    return _mm_movemask_epi8(m);
+}
+
+static const char* sse2_find_of(const char* p, const char* end, byte_set const& set, bool negate)
+{
+    if( set.count > byte_set::MAX_LISTED )
+        return scalar_find_of(p, end, set, negate);
+    const unsigned invert = negate ? 0xffff : 0;
+    while( end - p >= 16 ) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const unsigned mask = sse2_set_mask(block, set) ^ invert;
+        if( mask != 0 )
+            return p + search_ctz(mask);
+        p += 16;
+    }
+    return scalar_find_of(p, end, set, negate);
+}
+
+static const char* sse2_rfind_of(const char* begin, const char* end, byte_set const& set, bool negate)
+{
+    if( set.count > byte_set::MAX_LISTED )
+        return scalar_rfind_of(begin, end, set, negate);
+    const unsigned invert = negate ? 0xffff : 0;
+    const char* p = end;
+    while( p - begin >= 16 ) {
+        p -= 16;
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const unsigned mask = sse2_set_mask(block, set) ^ invert;
+        if( mask != 0 )
+            return p + search_last_bit(mask);
+    }
+    const char* r = scalar_rfind_of(begin, p, set, negate);
+    return r == p ? end : r;
+}
+
+#endif // TINFRA_SSE2
+
+//
+// AVX2, 32-byte blocks, selected at runtime
+//
+
+#ifdef TINFRA_AVX2_DISPATCH
+
+// Note, as in json_scan.cpp, avx2 functions clear upper halves of
+// ymm registers explicitly and don't call sse2 functions.
+
+__attribute__((target("avx2")))
+static const char* avx2_find(const char* p, const char* end, const char* needle, size_t n)
+{
+    if( n >= 2 && size_t(end - p) >= n - 1 + 32 ) {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last  = _mm256_set1_epi8(needle[n-1]);
+        do {
+            const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            const __m256i block_last  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + n - 1));
+            unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                                                  _mm256_cmpeq_epi8(block_last, last)));
+            while( mask != 0 ) {
+                const unsigned bit = search_ctz(mask);
+                if( std::memcmp(p + bit + 1, needle + 1, n - 2) == 0 ) {
+                    _mm256_zeroupper();
+                    return p + bit;
+                }
+                mask &= mask - 1;
+            }
+            p += 32;
+        } while( size_t(end - p) >= n - 1 + 32 );
+        _mm256_zeroupper();
+    }
+    // short haystacks and tails: one 16-byte step (VEX encoded, so no
+    // transition penalty)
+    if( n >= 2 && size_t(end - p) >= n - 1 + 16 ) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last  = _mm_set1_epi8(needle[n-1]);
+        do {
+            const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i block_last  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n - 1));
+            unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                                                            _mm_cmpeq_epi8(block_last, last)));
+            while( mask != 0 ) {
+                const unsigned bit = search_ctz(mask);
+                if( std::memcmp(p + bit + 1, needle + 1, n - 2) == 0 )
+                    return p + bit;
+                mask &= mask - 1;
+            }
+            p += 16;
+        } while( size_t(end - p) >= n - 1 + 16 );
+    }
+    return scalar_find(p, end, needle, n);
+}
+
+/// Nibble tables of byte_set broadcast to both lanes.
+struct avx2_set_tables {
+    __m256i low_nibble_lo;
+    __m256i low_nibble_hi;
+    __m256i high_nibble_lo;
+    __m256i high_nibble_hi;
+};
+
+__attribute__((target("avx2")))
+static inline void avx2_load_tables(byte_set const& set, avx2_set_tables& t)
+{
+    static const unsigned char high_lo[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0, 0 };
+    static const unsigned char high_hi[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, 128 };
+    t.low_nibble_lo  = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(set.low_nibble_lo)));
+    t.low_nibble_hi  = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(set.low_nibble_hi)));
+    t.high_nibble_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(high_lo)));
+    t.high_nibble_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(high_hi)));
+}
+
+// byte b is in set if low_nibble_X[b & 15] has bit for b >> 4
+__attribute__((target("avx2")))
+static inline unsigned avx2_set_mask(__m256i block, avx2_set_tables const& t)
+{
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+    const __m256i lo = _mm256_and_si256(block, nibble_mask);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble_mask);
+    const __m256i in_lo = _mm256_and_si256(_mm256_shuffle_epi8(t.low_nibble_lo, lo), _mm256_shuffle_epi8(t.high_nibble_lo, hi));
+    const __m256i in_hi = _mm256_and_si256(_mm256_shuffle_epi8(t.low_nibble_hi, lo), _mm256_shuffle_epi8(t.high_nibble_hi, hi));
+    const __m256i none = _mm256_cmpeq_epi8(_mm256_or_si256(in_lo, in_hi), _mm256_setzero_si256());
+    return ~static_cast<unsigned>(_mm256_movemask_epi8(none));
+}
+
+__attribute__((target("avx2")))
+static const char* avx2_find_of(const char* p, const char* end, byte_set const& set, bool negate)
+{
+    if( end - p >= 32 ) {
+        avx2_set_tables t;
+        avx2_load_tables(set, t);
+        const unsigned invert = negate ? ~0u : 0;
+        do {
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            const unsigned mask = avx2_set_mask(block, t) ^ invert;
+            if( mask != 0 ) {
+                _mm256_zeroupper();
+                return p + search_ctz(mask);
+            }
+            p += 32;
+        } while( end - p >= 32 );
+        _mm256_zeroupper();
+    }
+    return scalar_find_of(p, end, set, negate);
+}
+
+__attribute__((target("avx2")))
+static const char* avx2_rfind_of(const char* begin, const char* end, byte_set const& set, bool negate)
+{
+    const char* p = end;
+    if( p - begin >= 32 ) {
+        avx2_set_tables t;
+        avx2_load_tables(set, t);
+        const unsigned invert = negate ? ~0u : 0;
+        do {
+            p -= 32;
+            const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            const unsigned mask = avx2_set_mask(block, t) ^ invert;
+            if( mask != 0 ) {
+                _mm256_zeroupper();
+                return p + search_last_bit(mask);
+            }
+        } while( p - begin >= 32 );
+        _mm256_zeroupper();
+    }
+    const char* r = scalar_rfind_of(begin, p, set, negate);
+    return r == p ? end : r;
+}
+
+static bool cpu_has_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // TINFRA_AVX2_DISPATCH
+
+//
+// dispatch
+//
+
+static const string_searcher* init_available_searchers()
+{
+    static string_searcher searchers[4];
+    int n = 0;
+    const string_searcher scalar = { "scalar", &scalar_find, &scalar_find_of, &scalar_rfind_of };
+    searchers[n++] = scalar;
+#ifdef TINFRA_SSE2
+    const string_searcher sse2 = { "sse2", &sse2_find, &sse2_find_of, &sse2_rfind_of };
+    searchers[n++] = sse2;
+#endif
+#ifdef TINFRA_AVX2_DISPATCH
+    if( cpu_has_avx2() ) {
+        const string_searcher avx2 = { "avx2", &avx2_find, &avx2_find_of, &avx2_rfind_of };
+        searchers[n++] = avx2;
+    }
+#endif
+    const string_searcher terminator = { 0, 0, 0, 0 };
+    searchers[n] = terminator;
+    return searchers;
+}
+
+// initialized during static initialization, so before any thread
+// is started
+static const string_searcher* available_searchers = init_available_searchers();
+
+string_searcher const* string_available_searchers()
+{
+    if( !available_searchers )
+        available_searchers = init_available_searchers();
+    return available_searchers;
+}
+
+string_searcher const& string_default_searcher()
+{
+    string_searcher const* s = string_available_searchers();
+    while( s[1].name != 0 )
+        ++s;
+    return *s;
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_string_search_h_included
+#define tinfra_string_search_h_included
+
+#include "platform.h"
+
+namespace tinfra {
+
+/// Set of bytes prepared for block search.
+///
+/// Keeps bitmap for scalar lookups, list of bytes for SSE2 compares
+/// (if there are at most 16 of them) and nibble tables for
+/// pshufb-based lookups.
+struct byte_set {
+    byte_set(const char* chars, size_t n);
+
+    bool contains(char c) const
+    {
+        const unsigned char u = static_cast<unsigned char>(c);
+        return (bitmap[u >> 5] >> (u & 31)) & 1;
+    }
+
+    enum { MAX_LISTED = 16 };
+
+    uint32_t      bitmap[8];
+    size_t        count;              ///< number of distinct bytes
+    unsigned char listed[MAX_LISTED]; ///< valid if count <= MAX_LISTED
+    unsigned char low_nibble_lo[16];  ///< bit h set if (h << 4 | l) in set, h < 8
+    unsigned char low_nibble_hi[16];  ///< bit h-8 set if (h << 4 | l) in set, h >= 8
+};
+
+/// Block searcher of byte strings.
+///
+/// Used by tstring find functions. Each function searches in
+/// [begin, end) and returns pointer to match or end if there is
+/// none; it never reads outside of [begin, end).
+struct string_searcher {
+    const char* name;
+
+    /// Find first occurrence of needle (size n > 0).
+    const char* (*find)(const char* begin, const char* end, const char* needle, size_t n);
+
+    /// Find first byte in set (or not in set if negate).
+    const char* (*find_of)(const char* begin, const char* end, byte_set const& set, bool negate);
+
+    /// Find last byte in set (or not in set if negate).
+    const char* (*rfind_of)(const char* begin, const char* end, byte_set const& set, bool negate);
+};
+
+/// Best searcher supported by current CPU.
+///
+/// Selected once, on first use.
+string_searcher const& string_default_searcher();
+
+/// All searchers supported by current CPU, terminated by searcher
+/// with name == 0; first one is always scalar (portable)
+/// implementation.
+string_searcher const* string_available_searchers();
+
+} // end namespace tinfra
+
+#endif // tinfra_string_search_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -6,75 +6,244 @@
 #include "tinfra/symbol.h"
 #include "tinfra/mutex.h"
 #include "tinfra/guard.h"
+#include "tinfra/atomic.h"
+#include "tinfra/assert.h"
+#include "tinfra/fmt.h"
 
 #include <string>
-#include <list>
-#include <map>
 #include <vector>
 #include <ostream>
+#include <stdexcept>
 
 namespace tinfra {
 
+//
+// symbol hash
+//
+
+static inline uint32_t symbol_hash(tstring const& name, uint32_t seed)
+{
+    // FNV-1a with murmur3 finalizer, so low bits are usable
+    // directly as table index
+    uint32_t h = 2166136261u ^ seed;
+    const char* p = name.data();
+    const char* end = p + name.size();
+    for( ; p != end; ++p ) {
+        h ^= static_cast<unsigned char>(*p);
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+//
+// symbol_registry
+//
+// Readers never lock:
+//  - id -> name: append-only table of fixed size chunks, chunks and
+//    entries are published with release stores and never move
+//  - name -> id: SHARDS open addressing hash tables; table is
+//    replaced (not resized in place) when it grows, old tables are
+//    kept until registry is destroyed, so readers that still probe
+//    them see consistent, if stale, content
+//
+// Writers (new symbol) lock only one shard.
+//
+
 class symbol_registry {
 public:
     typedef symbol::id_type id_type;
-    
+
     symbol_registry()
         : next_symbol_id_(0)
-    {        
+    {
+        for( int i = 0; i < MAX_CHUNKS; ++i )
+            chunks_[i].store(0, MO_RELAXED);
+        for( int i = 0; i < SHARDS; ++i ) {
+            shards_[i].count = 0;
+            shards_[i].table.store(new_table(INITIAL_TABLE_SIZE, 0), MO_RELAXED);
+        }
         get_id_for_name("null");
     }
-    
+
+    ~symbol_registry()
+    {
+        for( int i = 0; i < SHARDS; ++i ) {
+            hash_table* t = shards_[i].table.load(MO_RELAXED);
+            while( t ) {
+                hash_table* previous = t->previous;
+                delete [] t->slots;
+                delete t;
+                t = previous;
+            }
+        }
+        const id_type count = next_symbol_id_.load(MO_RELAXED);
+        for( id_type id = 0; id < count; ++id )
+            delete entry_for_id(id);
+        for( int i = 0; i < MAX_CHUNKS; ++i )
+            delete [] chunks_[i].load(MO_RELAXED);
+    }
+
     id_type get_id_for_name(tstring const& name)
     {
-        tinfra::guard instance_guard(instance_lock_);
-        
-        name_to_id_mapping_t::const_iterator i =  name_map_.find(name);
-	if( i == name_map_.end() ) 
-	{		
-		id_type result_id = next_symbol_id_++;
-		name_storage_t::const_iterator istr = name_storage_.insert(name_storage_.end(), name.str());
-                
-                tstring name_allocated(*istr);
-		name_index_.push_back(istr);                
-		name_map_[name_allocated] = result_id;
-		return result_id;
-	} 
-	else 
-	{
-		return i->second;
-	}
+        const uint32_t h = symbol_hash(name, 0);
+        const id_type existing = find(shard_for(h), name, h);
+        if( existing >= 0 )
+            return existing;
+
+        shard& s = shard_for(h);
+        tinfra::guard shard_guard(s.lock);
+        // someone might have added it before we locked
+        const id_type raced = find(s, name, h);
+        if( raced >= 0 )
+            return raced;
+
+        const id_type id = next_symbol_id_.fetch_add(1);
+        if( id >= MAX_CHUNKS * CHUNK_SIZE )
+            throw std::runtime_error(tsprintf("symbol: registry full (%i symbols)", id));
+
+        symbol_entry* e = new symbol_entry;
+        e->name.assign(name.data(), name.size());
+        e->hash = h;
+        e->id = id;
+
+        chunk_for_id(id)[id & CHUNK_MASK].store(e, MO_RELEASE);
+        insert(s, e);
+        return id;
     }
-    
+
     id_type find_no_create(tstring const& name)
     {
-        tinfra::guard instance_guard(instance_lock_);
-        name_to_id_mapping_t::const_iterator i =  name_map_.find(name);
-        if( i == name_map_.end() ) {
-            return 0;             
-        } else {
-            return i->second;
-        }
+        const uint32_t h = symbol_hash(name, 0);
+        const id_type id = find(shard_for(h), name, h);
+        return id >= 0 ? id : 0;
     }
+
     std::string const& name_for_id(id_type const& id)
     {
-        tinfra::guard instance_guard(instance_lock_);
-        
-        return * (name_index_[id] );
+        symbol_entry* e = entry_for_id(id);
+        TINFRA_ASSERT(e != 0);
+        return e->name;
     }
+
 private:
-    typedef std::map<tstring, id_type> name_to_id_mapping_t;
-    typedef std::list<std::string>     name_storage_t;
-    typedef std::vector<name_storage_t::const_iterator> name_index_t;
-    
-    
-    id_type               next_symbol_id_;
-    
-    name_to_id_mapping_t name_map_;
-    name_index_t         name_index_;
-    name_storage_t       name_storage_;
-    
-    tinfra::mutex instance_lock_;
+    enum {
+        SHARD_BITS = 4,
+        SHARDS = 1 << SHARD_BITS,
+        INITIAL_TABLE_SIZE = 64,
+
+        CHUNK_BITS = 10,
+        CHUNK_SIZE = 1 << CHUNK_BITS,
+        CHUNK_MASK = CHUNK_SIZE - 1,
+        MAX_CHUNKS = 4096             // 4M symbols
+    };
+
+    struct symbol_entry {
+        std::string name;
+        uint32_t    hash;
+        id_type     id;
+    };
+
+    typedef tinfra::atomic<symbol_entry*> entry_slot;
+
+    struct hash_table {
+        size_t       mask;
+        entry_slot*  slots;
+        hash_table*  previous;  // retired, still may be read
+    };
+
+    struct shard {
+        tinfra::atomic<hash_table*> table;
+        size_t                      count; // guarded by lock
+        tinfra::mutex               lock;
+        char padding_[CACHE_LINE_SIZE];
+    };
+
+    static hash_table* new_table(size_t size, hash_table* previous)
+    {
+        hash_table* t = new hash_table;
+        t->mask = size - 1;
+        t->slots = new entry_slot[size];
+        t->previous = previous;
+        return t;
+    }
+
+    shard& shard_for(uint32_t h)
+    {
+        return shards_[h >> (32 - SHARD_BITS)];
+    }
+
+    static id_type find(shard const& s, tstring const& name, uint32_t h)
+    {
+        hash_table const* t = s.table.load(MO_ACQUIRE);
+        for( size_t i = h & t->mask; ; i = (i + 1) & t->mask ) {
+            symbol_entry const* e = t->slots[i].load(MO_ACQUIRE);
+            if( e == 0 )
+                return -1;
+            if( e->hash == h && name == e->name )
+                return e->id;
+        }
+    }
+
+    // shard lock held
+    static void insert(shard& s, symbol_entry* e)
+    {
+        hash_table* t = s.table.load(MO_RELAXED);
+        if( (s.count + 1) * 2 > t->mask + 1 ) {
+            // keep load factor <= 0.5, build new table aside and
+            // publish it when complete
+            hash_table* bigger = new_table((t->mask + 1) * 2, t);
+            for( size_t i = 0; i <= t->mask; ++i ) {
+                symbol_entry* old = t->slots[i].load(MO_RELAXED);
+                if( old )
+                    place(bigger, old, MO_RELAXED);
+            }
+            s.table.store(bigger, MO_RELEASE);
+            t = bigger;
+        }
+        place(t, e, MO_RELEASE);
+        s.count += 1;
+    }
+
+    static void place(hash_table* t, symbol_entry* e, memory_order mo)
+    {
+        size_t i = e->hash & t->mask;
+        while( t->slots[i].load(MO_RELAXED) != 0 )
+            i = (i + 1) & t->mask;
+        t->slots[i].store(e, mo);
+    }
+
+    entry_slot* chunk_for_id(id_type id)
+    {
+        tinfra::atomic<entry_slot*>& chunk = chunks_[id >> CHUNK_BITS];
+        entry_slot* c = chunk.load(MO_ACQUIRE);
+        if( c )
+            return c;
+        // writers from different shards may race for new chunk
+        entry_slot* fresh = new entry_slot[CHUNK_SIZE];
+        if( chunk.compare_exchange(c, fresh, MO_ACQ_REL) )
+            return fresh;
+        delete [] fresh;
+        return c;
+    }
+
+    symbol_entry* entry_for_id(id_type id)
+    {
+        if( id < 0 || id >= MAX_CHUNKS * CHUNK_SIZE )
+            return 0;
+        entry_slot* c = chunks_[id >> CHUNK_BITS].load(MO_ACQUIRE);
+        if( c == 0 )
+            return 0;
+        return c[id & CHUNK_MASK].load(MO_ACQUIRE);
+    }
+
+    tinfra::atomic<id_type>     next_symbol_id_;
+    shard                       shards_[SHARDS];
+    tinfra::atomic<entry_slot*> chunks_[MAX_CHUNKS];
 };
 
 symbol_registry& global_register() {
@@ -83,7 +252,7 @@ symbol_registry& global_register() {
 }
 
 symbol::id_type symbol::get_id_for_name(tstring const& str)
-{    
+{
     return global_register().get_id_for_name(str);
 }
 
@@ -115,7 +284,61 @@ std::ostream& operator <<(std::ostream& dest, symbol const& s)
     return dest << s.str();
 }
 
+//
+// symbol_set
+//
+
+void symbol_set::init(const char* const* names, size_t count)
+{
+    symbols_.reserve(count);
+    names_.reserve(count);
+    for( size_t i = 0; i < count; ++i ) {
+        const symbol s = symbol::get(names[i]);
+        for( size_t j = 0; j < symbols_.size(); ++j )
+            if( symbols_[j] == s )
+                throw std::logic_error(tsprintf("symbol_set: duplicate name '%s'", names[i]));
+        symbols_.push_back(s);
+        names_.push_back(tstring(s.str()));
+    }
+
+    // search for seed that gives no collisions with load factor
+    // <= 0.5; if there is none in reasonable number of tries, use
+    // bigger table
+    size_t size = 1;
+    while( size < count * 2 )
+        size *= 2;
+    for( ;; size *= 2 ) {
+        mask_ = size - 1;
+        for( seed_ = 1; seed_ < 1000; ++seed_ ) {
+            table_.assign(size, -1);
+            bool collision = false;
+            for( size_t i = 0; i < count && !collision; ++i ) {
+                const size_t slot = symbol_hash(names_[i], seed_) & mask_;
+                if( table_[slot] != -1 )
+                    collision = true;
+                else
+                    table_[slot] = static_cast<int>(i);
+            }
+            if( !collision )
+                return;
+        }
+    }
+}
+
+int symbol_set::index_of(tstring const& name) const
+{
+    const int index = table_[symbol_hash(name, seed_) & mask_];
+    if( index < 0 || names_[index] != name )
+        return -1;
+    return index;
+}
+
+symbol symbol_set::find(tstring const& name) const
+{
+    const int index = index_of(name);
+    return index < 0 ? symbol::null : symbols_[index];
+}
+
 } // end namespace tinfra
 
 // jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
-
@@ -9,6 +9,7 @@
 #include "tinfra/tstring.h"
 
 #include <string>
+#include <vector>
 #include <iosfwd>
 
 namespace tinfra {
@@ -62,6 +63,42 @@ private:
 
 std::ostream& operator <<(std::ostream& dest, symbol const& s);
 
+/// Fixed set of symbols with perfect hash lookup.
+///
+/// Names are registered as symbols when set is constructed and
+/// then hashed without collisions, so find() costs one hash, one
+/// probe and one compare and never touches global registry.
+///
+/// Usage:
+///    static const char* const http_methods[] = { "GET", "PUT", "POST" };
+///    static const tinfra::symbol_set http_method_set(http_methods);
+///    ...
+///    int m = http_method_set.index_of(token); // 0..2 or -1
+class symbol_set {
+public:
+	template <int N>
+	explicit symbol_set(const char* const (&names)[N]) { init(names, N); }
+	symbol_set(const char* const* names, size_t count) { init(names, count); }
+
+	size_t size() const                { return symbols_.size(); }
+	symbol at(size_t index) const      { return symbols_[index]; }
+
+	/// Position of name in set or -1 if name is not in set.
+	int    index_of(tstring const& name) const;
+
+	/// Symbol for name or symbol::null if name is not in set.
+	symbol find(tstring const& name) const;
+
+private:
+	void init(const char* const* names, size_t count);
+
+	std::vector<symbol>  symbols_;
+	std::vector<tstring> names_;  // point to registry storage
+	std::vector<int>     table_;  // hash slot -> index or -1
+	unsigned             seed_;
+	unsigned             mask_;
+};
+
 }
 
 #endif // tinfra_symbol_h_included
@@ -177,6 +177,17 @@ tcp_client_socket::~tcp_client_socket()
 //
 tcp_server_socket::tcp_server_socket(tstring const& address, int port):
     socket(create_tcp_socket())
+{
+    listen(address, port, 0, 5);
+}
+
+tcp_server_socket::tcp_server_socket(tstring const& address, int port, int flags, int backlog):
+    socket(create_tcp_socket())
+{
+    listen(address, port, flags, backlog);
+}
+
+void tcp_server_socket::listen(tstring const& address, int port, int flags, int backlog)
 {
     ::sockaddr_in sock_addr;
     std::memset(&sock_addr,0,sizeof(sock_addr));
@@ -195,12 +206,22 @@ tcp_server_socket::tcp_server_socket(tstring const& address, int port):
             // TODO: it should be warning
             TINFRA_LOG_ERROR("unable to set SO_REUSEADDR=1 on socket");
         }
-    }   
+    }
+    if( (flags & TSF_REUSE_PORT) == TSF_REUSE_PORT ) {
+#ifdef SO_REUSEPORT
+        int r = 1;
+        if( ::setsockopt(handle(), SOL_SOCKET, SO_REUSEPORT, (char*)(void*)&r, sizeof(r)) ) {
+            throw_socket_error("unable to set SO_REUSEPORT=1 on socket");
+        }
+#else
+        throw std::logic_error("SO_REUSEPORT not supported on this platform");
+#endif
+    }
     if( ::bind(handle(),(struct sockaddr*)&sock_addr, sizeof(sock_addr)) != 0 ) {
         throw_socket_error(fmt("bind to '%s:%i' failed") % actual_address % port );
     }
 
-    if( ::listen(handle(),5) != 0 ) {
+    if( ::listen(handle(), backlog) != 0 ) {
         throw_socket_error("listen failed");
     }
 }
@@ -225,6 +246,10 @@ tcp_server_socket::accept(std::string& address)
             continue;
         }
         
+        if( accept_sock == -1 && detail::last_socket_error_is_would_block()) {
+            return std::auto_ptr<tcp_client_socket>();
+        }
+        
         if( accept_sock == -1 ) {
             throw_socket_error("accept failed");
         }
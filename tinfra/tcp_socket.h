@@ -21,10 +21,17 @@ public:
     ~tcp_client_socket();
 };
 
+enum tcp_server_flags {
+    /// Set SO_REUSEPORT, so several listeners may share one port
+    /// and kernel balances incoming connections between them.
+    TSF_REUSE_PORT = 0x01
+};
+
 class tcp_server_socket: public socket {
 public:
     tcp_server_socket(handle_type h);
     tcp_server_socket(tstring const& address, int port);
+    tcp_server_socket(tstring const& address, int port, int flags, int backlog);
     ~tcp_server_socket();
 
     /// Accepts new connections.
@@ -33,6 +40,8 @@ public:
     /// By default this operation is blocking, with non-blocking
     /// socket, this operation may return non-initialized pointer.
     std::auto_ptr<tcp_client_socket> accept(std::string& address);
+private:
+    void listen(tstring const& address, int port, int flags, int backlog);
 };
 
 } // end namespace tinfra
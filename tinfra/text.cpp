@@ -6,11 +6,23 @@
 #include "platform.h"
 
 #include "tinfra/text.h"
+#include "tinfra/buffered_stream.h"
 
 namespace tinfra {
 
 static bool readline(tinfra::input_stream& in, std::string& result)
 {
+    // buffered stream can find whole line in its buffer, otherwise
+    // we have to read byte by byte not to read beyond line end
+    if( tinfra::buffered_input_stream* bin = dynamic_cast<tinfra::buffered_input_stream*>(&in) ) {
+        tstring line;
+        if( !bin->read_until('\n', line) ) {
+            result.clear();
+            return false;
+        }
+        result.assign(line.data(), line.size());
+        return true;
+    }
     int readed = 0;
     result.clear();
     while( true ) {
@@ -75,6 +75,12 @@ public:
     void broadcast() { m.broadcast(); }
 };
 
+/// Number of processors available
+///
+/// Returns number of online processors or 1 if it
+/// cannot be determined.
+int hardware_concurrency();
+
 class thread_set {
     std::vector<thread> threads_;
 
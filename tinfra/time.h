@@ -220,6 +220,9 @@ time_duration::minute(time_int tv) { return time_duration::second(60*tv); }
 inline time_duration
 time_duration::hour(time_int tv) { return time_duration::minute(60*tv); }
 
+inline time_duration
+time_duration::millisecond(time_int tv) { return time_duration((tv*time_traits::RESOLUTION)/1000); }
+
 inline time_duration
 time_duration::from_raw(time_int tv) { return time_duration(tv); }
 
@@ -239,6 +242,9 @@ time_duration::seconds() const { return this->dt/time_traits::RESOLUTION; }
 inline time_int
 time_duration::milliseconds() const { return (this->dt*1000)/time_traits::RESOLUTION; }
 
+inline time_int
+time_duration::microseconds() const { return (this->dt*1000000)/time_traits::RESOLUTION; }
+
 inline time_int
 time_duration::to_raw() const { return this->dt; }
 
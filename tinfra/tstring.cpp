@@ -6,12 +6,14 @@
 #include "tstring.h"
 
 #include "tinfra/assert.h"
+#include "tinfra/string_search.h"
 
 #include <stdexcept>
 #include <cstdlib>
 #include <algorithm>
 #include <cassert>
 #include <ostream>
+#include <new>
 
 #include <cstdlib>
 #include <cassert>
@@ -46,60 +48,83 @@ tstring tstring::substr(size_type pos, size_type n) const
     return tstring(data() + pos, len, sub_is_null_terminated);
 }
 
+//
+// search functions use string_searcher (SIMD when available) for
+// longer inputs; short ones are scanned directly, as preparing
+// byte_set would cost more than search
+//
+
+static const size_t SHORT_SEARCH = 16;
+
+static string_searcher const& searcher()
+{
+    static string_searcher const& s = string_default_searcher();
+    return s;
+}
+
 tstring::size_type
 tstring::find(char_type const* s, size_type pos, size_type n) const
-{    
-	if( size() == 0 ) {
-		if( n == 0 )
-			return 0;
-		else
-			return npos;
-	}
-
+{
     if( pos > this->size() ) {
         return npos;
     }
-
-    tstring const other = tstring(s, n, false);
-    const_iterator result = std::search(
-        begin()+pos,
-        end(),
-        other.begin(),
-        other.end());
-    if( result == end() )
+    if( n == 0 ) {
+        return pos;
+    }
+    if( n > this->size() - pos ) {
         return npos;
-    else
-        return result - begin(); 
+    }
+    const char* const b = data() + pos;
+    const char* const e = data() + size();
+    const char* r;
+    if( n == 1 ) {
+        r = static_cast<const char*>(std::memchr(b, *s, e - b));
+        if( !r )
+            return npos;
+    } else {
+        r = searcher().find(b, e, s, n);
+        if( r == e )
+            return npos;
+    }
+    return r - data();
+}
+
+// forward search for byte (not) in s
+static tstring::size_type
+tstring_find_of(tstring const& subject, const char* s, size_t pos, size_t n, bool negate)
+{
+    if( pos >= subject.size() ) {
+        return tstring::npos;
+    }
+    const char* const b = subject.data() + pos;
+    const char* const e = subject.data() + subject.size();
+    const char* r = b;
+    if( size_t(e - b) < SHORT_SEARCH ) {
+        while( r != e && (std::memchr(s, *r, n) != 0) == negate )
+            ++r;
+    } else {
+        r = searcher().find_of(b, e, byte_set(s, n), negate);
+    }
+    return r == e ? tstring::npos : r - subject.data();
 }
 
 // find first of
 tstring::size_type 
 tstring::find_first_of(char_type const* s, size_type pos, size_type n) const
 {
-    if( pos > this->size() ) {
-        return npos;
-    }
-    if( tstring::size() > 0 ) {
-        for( const_iterator i = begin()+pos; i != end(); ++i ) {
-            if( std::memchr(s, *i, n) != 0 ) // 'not in S' so return
-                return i - begin();
-        }
-    }
-    return npos;
+    if( n == 1 )
+        return find_first_of(*s, pos);
+    return tstring_find_of(*this, s, pos, n, false);
 }
+
 tstring::size_type 
 tstring::find_first_of(char_type c, size_type pos) const
 {
-    if( pos > this->size() ) {
+    if( pos >= this->size() ) {
         return npos;
     }
-    if( tstring::size() > 0 ) {
-        for( const_iterator i = begin()+pos; i != end(); ++i ) {
-            if( *i == c ) // '== C' so return
-                return i - begin();
-        }
-    }
-    return npos;
+    const char* r = static_cast<const char*>(std::memchr(data() + pos, c, size() - pos));
+    return r ? r - data() : npos;
 }
 
 // find first not of
@@ -107,129 +132,67 @@ tstring::find_first_of(char_type c, size_type pos) const
 tstring::size_type
 tstring::find_first_not_of(char_type const* s, size_type pos, size_type n) const
 {
-    if( pos > this->size() ) {
-        return npos;
-    }
-    if( tstring::size() > 0 ) {
-        for( const_iterator i = begin()+pos; i != end(); ++i ) {
-            if( std::memchr(s, *i, n) == 0 ) // 'not in S' so return
-                return i - begin();
-        }
-    }
-    return npos;
+    return tstring_find_of(*this, s, pos, n, true);
 }
 
 tstring::size_type
 tstring::find_first_not_of(char_type c, size_type pos) const
 {
-    if( pos > this->size() ) {
-        return npos;
-    }
-    if( tstring::size() > 0 ) {
-        for( const_iterator i = begin()+pos; i != end(); ++i ) {
-            if( *i != c )
-                return i - begin();
-        }
-    }
-    return npos;
+    return tstring_find_of(*this, &c, pos, 1, true);
 }
 
-template <typename Predicate>
-tstring::size_type
-tstring_find_last(tstring const& subject, Predicate p, size_t pos)
+// backward search for byte (not) in s, starting at pos
+static tstring::size_type
+tstring_find_last_of(tstring const& subject, const char* s, size_t pos, size_t n, bool negate)
 {
-	const size_t npos = tstring::npos;
-
-	if( subject.size() == 0 ) 
-		return npos;
-
-	if( pos != npos && pos > subject.size() )
-		pos = subject.size()-1;
-
-	TINFRA_ASSERT(pos == npos || pos < subject.size() );
-
-	const  tstring::const_iterator begin = subject.begin();
-	tstring::const_iterator i = 
-			(pos == npos) ? subject.end()-1
-		                  : subject.begin() + pos;
-
-	do {
-        if( p(*i)  ) // predicate true, then found
-            return i - begin;
-	} while( i-- != begin );
-	return npos;
+    if( subject.size() == 0 ) 
+        return tstring::npos;
+
+    if( pos >= subject.size() )
+        pos = subject.size()-1;
+
+    const char* const b = subject.data();
+    const char* const e = subject.data() + pos + 1;
+    if( size_t(e - b) < SHORT_SEARCH ) {
+        const char* r = e;
+        while( r != b ) {
+            --r;
+            if( (std::memchr(s, *r, n) != 0) != negate )
+                return r - b;
+        }
+        return tstring::npos;
+    }
+    const char* r = searcher().rfind_of(b, e, byte_set(s, n), negate);
+    return r == e ? tstring::npos : r - b;
 }
-// find last of
-
 
-
-struct last_of_str_predicate {
-	const char* pattern;
-	size_t      pattern_len;
-
-	bool operator()(char c) {
-		return std::memchr(this->pattern, c, this->pattern_len) != 0;
-	}
-};
+// find last of
 
 tstring::size_type
 tstring::find_last_of(char_type const* s, size_type pos, size_type n) const
 {
-	last_of_str_predicate pred;
-	pred.pattern = s;
-	pred.pattern_len = (n == npos) ? std::strlen(s) : n;
-	return tstring_find_last(*this, pred, pos);
+    return tstring_find_last_of(*this, s, pos, (n == npos) ? std::strlen(s) : n, false);
 }
 
-struct last_of_char_predicate {
-	char expected;
-	bool operator()(char c) {
-		return (c == expected);
-	}
-};
-
 tstring::size_type
 tstring::find_last_of(char_type c, size_type pos) const
 {
-    last_of_char_predicate pred;
-	pred.expected = c;
-	return tstring_find_last(*this, pred, pos);
+    return tstring_find_last_of(*this, &c, pos, 1, false);
 }
 
 // find last not of
-struct last_not_of_str_predicate {
-	const char* pattern;
-	size_t      pattern_len;
-
-	bool operator()(char c) {
-		return std::memchr(this->pattern, c, this->pattern_len) == 0;
-	}
-};
 
 tstring::size_type
 tstring::find_last_not_of(char_type const* s, size_type pos, size_type n) const
 {
-	last_not_of_str_predicate pred;
-	pred.pattern = s;
-	pred.pattern_len = (n == npos) ? std::strlen(s) : n;
-	return tstring_find_last(*this, pred, pos);
+    return tstring_find_last_of(*this, s, pos, (n == npos) ? std::strlen(s) : n, true);
 }
 
-struct last_not_of_char_predicate {
-	char expected;
-	bool operator()(char c) {
-		return (c != expected);
-	}
-};
-
 tstring::size_type
 tstring::find_last_not_of(char_type c, size_type pos) const
 {
-    last_not_of_char_predicate pred;
-	pred.expected = c;
-	return tstring_find_last(*this, pred, pos);
+    return tstring_find_last_of(*this, &c, pos, 1, true);
 }
-    
 
 std::ostream& operator<<(std::ostream& out, tstring const& s)
 {
@@ -241,33 +204,130 @@ const char* tstring::temporary_alloc(string_pool& pool, tstring const& s)
     return pool.create(s);
 }
 
+//
+// string_pool
+//
+
+string_pool::string_pool(size_t initial_size):
+    current_(0),
+    next_(0),
+    limit_(0),
+    initial_size_(initial_size > 0 ? initial_size : 1),
+    capacity_(0),
+    interned_count_(0),
+    generation_(1)
+{
+}
+
+string_pool::~string_pool()
+{
+    for( size_t i = 0; i < chunks_.size(); ++i )
+        std::free(chunks_[i].data);
+}
+
+char* string_pool::allocate(size_t n)
+{
+    if( size_t(limit_ - next_) < n ) {
+        // move to next kept chunk that is big enough
+        // (skipped chunks stay unused until clear())
+        size_t i = chunks_.empty() ? 0 : current_ + 1;
+        while( i < chunks_.size() && chunks_[i].size < n )
+            ++i;
+        if( i == chunks_.size() ) {
+            size_t size = chunks_.empty() ? initial_size_
+                                          : std::min(chunks_.back().size * 2, size_t(MAX_CHUNK_SIZE));
+            size = std::max(size, n);
+            chunk c;
+            c.data = static_cast<char*>(std::malloc(size));
+            if( !c.data )
+                throw std::bad_alloc();
+            c.size = size;
+            chunks_.push_back(c);
+            capacity_ += size;
+        }
+        current_ = i;
+        next_ = chunks_[i].data;
+        limit_ = next_ + chunks_[i].size;
+    }
+    char* result = next_;
+    next_ += n;
+    return result;
+}
+
 const char* string_pool::create(tstring const& src)
 {
-    strings.push_back(0);
-    size_t len = src.size();
-    char* result = reinterpret_cast<char*>( std::malloc(len+1) );
-    strings[strings.size()-1] = result;
-    
+    const size_t len = src.size();
+    char* result = allocate(len+1);
     std::memcpy(result, src.data(), len);
     result[len] = 0;
     return result;
 }
 
-void string_pool::clear()
+static size_t string_pool_hash(tstring const& s)
 {
-    for( size_t i = 0; i < strings.size(); ++i ) {
-        std::free(strings[i]);
-        strings[i] = 0;
+    // FNV-1a
+    size_t h = 2166136261u;
+    for( size_t i = 0; i < s.size(); ++i ) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 16777619u;
     }
-    strings.clear();
+    return h;
 }
-string_pool::string_pool(size_t)
+
+tstring string_pool::intern(tstring const& in)
 {
+    if( (interned_count_ + 1) * 2 > interned_.size() )
+        grow_interned();
+
+    const size_t hash = string_pool_hash(in);
+    const size_t mask = interned_.size() - 1;
+    size_t i = hash & mask;
+    while( interned_[i].generation == generation_ ) {
+        interned_entry const& e = interned_[i];
+        if( e.hash == hash && e.length == in.size() && std::memcmp(e.str, in.data(), in.size()) == 0 )
+            return tstring(e.str, e.length, true);
+        i = (i + 1) & mask;
+    }
+    interned_entry& e = interned_[i];
+    e.str = create(in);
+    e.length = in.size();
+    e.hash = hash;
+    e.generation = generation_;
+    ++interned_count_;
+    return tstring(e.str, e.length, true);
 }
 
-string_pool::~string_pool()
+void string_pool::grow_interned()
+{
+    std::vector<interned_entry> old;
+    old.swap(interned_);
+    interned_entry empty = { 0, 0, 0, 0 };
+    interned_.resize(old.empty() ? 64 : old.size() * 2, empty);
+    const size_t mask = interned_.size() - 1;
+    for( size_t k = 0; k < old.size(); ++k ) {
+        if( old[k].generation != generation_ )
+            continue;
+        size_t i = old[k].hash & mask;
+        while( interned_[i].generation == generation_ )
+            i = (i + 1) & mask;
+        interned_[i] = old[k];
+    }
+}
+
+void string_pool::clear()
 {
-    clear();
+    current_ = 0;
+    if( !chunks_.empty() ) {
+        next_ = chunks_[0].data;
+        limit_ = next_ + chunks_[0].size;
+    }
+    // interned entries of older generations are treated as empty
+    interned_count_ = 0;
+    if( ++generation_ == 0 ) {
+        for( size_t i = 0; i < interned_.size(); ++i )
+            interned_[i].generation = 0;
+        generation_ = 1;
+    }
 }
 
 } // end namespace tinfra
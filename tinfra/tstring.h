@@ -337,19 +337,71 @@ inline bool operator==(std::string const& a, tstring const& b)
 /// Use this utility in contexts when you need null-terminated strings
 /// like system calls.
 
+/// Pool of null-terminated string copies.
+///
+/// Strings are copied into chunks with bump pointer and live until
+/// clear() or destruction of pool. clear() doesn't free chunks, they
+/// are reused, so pool that is cleared in loop doesn't touch heap after
+/// first iterations.
+///
+/// intern() returns same copy for equal strings (until clear()), it's
+/// meant for names repeated in many places (tag names, keys).
 class string_pool {
-	std::vector<char*> strings;
 public:
-	const char* create(tstring const& s);
-        tstring     alloc(tstring const& in) {
-            const char* s = create(in);
-            return tstring(s, in.size(), true);
-        }
+    /// initial_size is size of first chunk, next chunks grow up to
+    /// MAX_CHUNK_SIZE
+    string_pool(size_t initial_size = 128);
+    ~string_pool();
 
-	string_pool(size_t initial_size = 128);
-	~string_pool();
-        
-        void clear();
+    enum { MAX_CHUNK_SIZE = 64*1024 };
+
+    /// Copy s into pool.
+    const char* create(tstring const& s);
+
+    /// Copy in into pool.
+    tstring     alloc(tstring const& in) {
+        const char* s = create(in);
+        return tstring(s, in.size(), true);
+    }
+
+    /// Copy in into pool, unless equal string was already interned.
+    tstring     intern(tstring const& in);
+
+    /// Invalidate all strings, O(1), chunks are kept for reuse.
+    void clear();
+
+    /// Number of bytes held in chunks.
+    size_t capacity() const { return capacity_; }
+
+private:
+    char* allocate(size_t n);
+    void  grow_interned();
+
+    struct chunk {
+        char*  data;
+        size_t size;
+    };
+    struct interned_entry {
+        const char* str;
+        size_t      length;
+        size_t      hash;
+        unsigned    generation; ///< entry valid if equal to generation_
+    };
+
+    std::vector<chunk> chunks_;
+    size_t             current_; ///< index of chunk in use
+    char*              next_;
+    char*              limit_;
+    size_t             initial_size_;
+    size_t             capacity_;
+
+    std::vector<interned_entry> interned_; ///< open addressing, size is power of 2
+    size_t                      interned_count_;
+    unsigned                    generation_;
+
+    // noncopyable
+    string_pool(string_pool const&);
+    string_pool& operator=(string_pool const&);
 };
 
 } // end of namespace tinfra
@@ -1,6 +1,9 @@
 #include "variant.h" // we implement this
 
 #include <ostream>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
 
 namespace tinfra {
 
@@ -8,6 +11,169 @@ namespace tinfra {
 // variant
 //
 
+// check assumption about std::vector size, see STORAGE_SIZE
+typedef char variant_array_fits_storage[sizeof(variant::array_type) <= sizeof(std::vector<void*>) ? 1 : -1];
+
+variant::variant(tinfra::any const& v):
+    kind_(K_NONE)
+{
+    std::type_info const& t = v.type();
+    if(        t == typeid(none_type) ) {
+        // none
+    } else if( t == typeid(integer_type) ) {
+        set_integer(v.get<integer_type>());
+    } else if( t == typeid(double) ) {
+        set_double(v.get<double>());
+    } else if( t == typeid(bool) ) {
+        set_bool(v.get<bool>());
+    } else if( t == typeid(string_type) ) {
+        set_string(v.get<string_type>());
+    } else if( t == typeid(array_type) ) {
+        set_array(v.get<array_type>());
+    } else if( t == typeid(dict_type) ) {
+        set_dict(v.get<dict_type>());
+    } else {
+        throw std::logic_error("variant: unsupported type in any");
+    }
+}
+
+variant::variant(variant const& other):
+    kind_(K_NONE)
+{
+    copy_from(other);
+}
+
+variant& variant::operator=(variant const& other)
+{
+    if( this != &other ) {
+        variant tmp(other);
+        swap(tmp);
+    }
+    return *this;
+}
+
+#ifdef TINFRA_CXX11
+variant::variant(variant&& other) TINFRA_NOEXCEPT:
+    kind_(K_NONE)
+{
+    take(other);
+}
+
+variant& variant::operator=(variant&& other) TINFRA_NOEXCEPT
+{
+    if( this != &other ) {
+        // other may be owned by this (v = std::move(v["child"])), so
+        // take it out before destroying current value
+        variant tmp(std::move(other));
+        destroy();
+        take(tmp);
+    }
+    return *this;
+}
+#endif
+
+void variant::destroy()
+{
+    switch( kind_ ) {
+    case K_STRING:
+        str().~string_type();
+        break;
+    case K_ARRAY:
+        arr().~array_type();
+        break;
+    case K_DICT:
+        delete u_.dict;
+        break;
+    default:
+        break;
+    }
+    kind_ = K_NONE;
+}
+
+void variant::reset(kind_type k)
+{
+    if( kind_ >= K_STRING )
+        destroy();
+    kind_ = k;
+}
+
+void variant::copy_from(variant const& other)
+{
+    TINFRA_ASSERT(kind_ == K_NONE);
+    switch( other.kind_ ) {
+    case K_STRING:
+        new (u_.raw) string_type(other.str());
+        break;
+    case K_ARRAY:
+        new (u_.raw) array_type(other.arr());
+        break;
+    case K_DICT:
+        u_.dict = new variant_dict(*other.u_.dict);
+        break;
+    default:
+        u_ = other.u_;
+        break;
+    }
+    kind_ = other.kind_;
+}
+
+/// move value of other to this (which must be none), other becomes none
+void variant::take(variant& other)
+{
+    TINFRA_ASSERT(kind_ == K_NONE);
+    switch( other.kind_ ) {
+    case K_STRING:
+        new (u_.raw) string_type();
+        str().swap(other.str());
+        other.destroy();
+        kind_ = K_STRING;
+        break;
+    case K_ARRAY:
+        new (u_.raw) array_type();
+        arr().swap(other.arr());
+        other.destroy();
+        kind_ = K_ARRAY;
+        break;
+    default:
+        // scalars and dict pointer, just take over
+        u_ = other.u_;
+        kind_ = other.kind_;
+        other.kind_ = K_NONE;
+        break;
+    }
+}
+
+void variant::set_dict()
+{
+    variant_dict* d = new variant_dict();
+    reset(K_NONE);
+    u_.dict = d;
+    kind_ = K_DICT;
+}
+
+void variant::set_dict(dict_type const& v)
+{
+    variant tmp;
+    tmp.u_.dict = new variant_dict(v);
+    tmp.kind_ = K_DICT;
+    swap(tmp);
+}
+
+void variant::set_array()
+{
+    reset(K_NONE);
+    new (u_.raw) array_type();
+    kind_ = K_ARRAY;
+}
+
+void variant::set_array(array_type const& v)
+{
+    variant tmp;
+    new (tmp.u_.raw) array_type(v);
+    tmp.kind_ = K_ARRAY;
+    swap(tmp);
+}
+
 variant& variant::operator[](std::string const& key) {
     return this->get_dict()[key];
 }
@@ -64,14 +230,16 @@ std::vector<variant::key_type> variant::dict_keys() const
 
 bool operator==(variant const& a, variant const& b)
 {
-    if( a.is_none() && b.is_none() )
-        return true;
+    if( a.is_none() )
+        return b.is_none();
     else if ( a.is_string() ) {
         return b.is_string() && a.get_string() == b.get_string();
     } else if( a.is_integer() ) {
         return b.is_integer() && a.get_integer() == b.get_integer();
     } else if( a.is_double() ) {
         return b.is_double() && a.get_double() == b.get_double();
+    } else if( a.is_bool() ) {
+        return b.is_bool() && a.get_bool() == b.get_bool();
     } else if( a.is_dict() ) {
         if( b.is_dict() ) {
             variant::dict_type const& ad = a.get_dict();
@@ -108,6 +276,8 @@ std::ostream& operator <<(std::ostream& s, variant const& node)
         return s << node.get_integer();
     } else if( node.is_double() ) {
         return s << node.get_double();
+    } else if( node.is_bool() ) {
+        return s << (node.get_bool() ? "true" : "false");
     } else if( node.is_dict() ) {
         return s << "<dictionary>";
     } else if( node.is_array() ) {
@@ -117,6 +287,141 @@ std::ostream& operator <<(std::ostream& s, variant const& node)
     }
 }
 
+//
+// variant_dict
+//
+
+variant_dict::variant_dict(variant_dict const& other)
+{
+    // copy is compacted, entries_ in key order
+    order_.reserve(other.order_.size());
+    for( size_t i = 0; i < other.order_.size(); ++i ) {
+        entries_.push_back(*other.order_[i]);
+        order_.push_back(&entries_.back());
+    }
+}
+
+variant_dict& variant_dict::operator=(variant_dict const& other)
+{
+    if( this != &other ) {
+        variant_dict tmp(other);
+        swap(tmp);
+    }
+    return *this;
+}
+
+void variant_dict::clear()
+{
+    order_.clear();
+    free_.clear();
+    entries_.clear();
+}
+
+void variant_dict::swap(variant_dict& other)
+{
+    // deque swap doesn't move elements, pointers stay valid
+    entries_.swap(other.entries_);
+    free_.swap(other.free_);
+    order_.swap(other.order_);
+}
+
+void variant_dict::reserve(size_t n)
+{
+    order_.reserve(n);
+}
+
+size_t variant_dict::lower_bound_position(key_type const& key) const
+{
+    size_t first = 0;
+    size_t count = order_.size();
+    while( count > 0 ) {
+        const size_t step = count / 2;
+        const size_t middle = first + step;
+        if( order_[middle]->first < key ) {
+            first = middle + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+variant_dict::iterator variant_dict::find(key_type const& key)
+{
+    const size_t pos = lower_bound_position(key);
+    if( pos < order_.size() && order_[pos]->first == key )
+        return iterator(order_begin() + pos);
+    return end();
+}
+
+variant_dict::const_iterator variant_dict::find(key_type const& key) const
+{
+    const size_t pos = lower_bound_position(key);
+    if( pos < order_.size() && order_[pos]->first == key )
+        return const_iterator(order_begin() + pos);
+    return end();
+}
+
+variant& variant_dict::insert_at(size_t position, key_type const& key)
+{
+    if( order_.size() == order_.capacity() )
+        order_.reserve(order_.empty() ? 4 : order_.size() * 2);
+    value_type* entry;
+    if( !free_.empty() ) {
+        entry = free_.back();
+        entry->first = key;
+        free_.pop_back();
+    } else {
+        entries_.push_back(value_type(key, variant()));
+        entry = &entries_.back();
+    }
+    // can't throw, capacity is reserved
+    order_.insert(order_.begin() + position, entry);
+    return entry->second;
+}
+
+variant& variant_dict::operator[](key_type const& key)
+{
+    // fast path, keys often come sorted
+    if( !order_.empty() && order_.back()->first < key )
+        return insert_at(order_.size(), key);
+
+    const size_t pos = lower_bound_position(key);
+    if( pos < order_.size() && order_[pos]->first == key )
+        return order_[pos]->second;
+    return insert_at(pos, key);
+}
+
+std::pair<variant_dict::iterator, bool> variant_dict::insert(value_type const& v)
+{
+    const size_t pos = lower_bound_position(v.first);
+    if( pos < order_.size() && order_[pos]->first == v.first )
+        return std::make_pair(iterator(order_begin() + pos), false);
+    insert_at(pos, v.first) = v.second;
+    return std::make_pair(iterator(order_begin() + pos), true);
+}
+
+void variant_dict::erase(iterator i)
+{
+    const size_t pos = i.position() - order_begin();
+    value_type* entry = order_[pos];
+    // slot is kept for reuse, other entries must not move
+    free_.reserve(free_.size() + 1);
+    std::string().swap(entry->first);
+    entry->second = variant();
+    free_.push_back(entry);
+    order_.erase(order_.begin() + pos);
+}
+
+size_t variant_dict::erase(key_type const& key)
+{
+    iterator i = find(key);
+    if( i == end() )
+        return 0;
+    erase(i);
+    return 1;
+}
 
 } // end namespace tinfra
 
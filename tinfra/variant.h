@@ -6,45 +6,74 @@
 #ifndef tinfra_variant_h_included
 #define tinfra_variant_h_included
 
+#include "platform.h"
 #include "any.h"
+#include "assert.h"
+
 #include <string>
-#include <map>
 #include <vector>
+#include <deque>
+#include <utility>
+#include <iterator>
+#include <limits>
 #include <iosfwd>
+#include <new>
 
 namespace tinfra {
 
+class variant_dict;
+
+/// Dynamically typed value, same model as JSON.
+///
+/// Value is one of none, bool, integer, double, string, array or
+/// dict. Scalars, strings and arrays are stored inline in tagged
+/// union (short strings don't allocate thanks to small string
+/// optimization of std::string), dicts are flat sorted containers
+/// (see variant_dict).
+///
+/// Variant has value semantics: copy is deep.
 class variant {
-    tinfra::any value;
-    
 public:
     struct none_type {};
     typedef std::string                 key_type;
     typedef std::string                 index_type;
-    
-    typedef std::map<key_type, variant> dict_type;
+
+    typedef variant_dict                dict_type;
     typedef std::vector<variant>        array_type;
     typedef std::string                 string_type;
     typedef long long                   integer_type;
-    
+
 public:
-    variant(): value(tinfra::any::from_copy(none_type())) {} // TBD, fix it!
-    explicit variant(int v): value(tinfra::any::from_copy<integer_type>(v)) {}
-    explicit variant(long v): value(tinfra::any::from_copy<integer_type>(v)) {}
+    variant(): kind_(K_NONE) {}
+    explicit variant(int v): kind_(K_INTEGER) { u_.i = v; }
+    explicit variant(long v): kind_(K_INTEGER) { u_.i = v; }
     explicit variant(unsigned int v);
     explicit variant(unsigned long v);
-    explicit variant(integer_type v): value(tinfra::any::from_copy(v)) {}
-    explicit variant(double v): value(tinfra::any::from_copy(v)) {}
-    explicit variant(string_type const& v): value(tinfra::any::from_copy(v)) {}
-    
-    explicit variant(tinfra::any const& v): value(v) {}
-    
+    explicit variant(integer_type v): kind_(K_INTEGER) { u_.i = v; }
+    explicit variant(double v): kind_(K_DOUBLE) { u_.d = v; }
+    explicit variant(string_type const& v);
+
+    /// Variant from any holding one of variant types.
+    ///
+    /// Throws std::logic_error for other types.
+    explicit variant(tinfra::any const& v);
+
+    variant(variant const& other);
+    variant& operator=(variant const& other);
+#ifdef TINFRA_CXX11
+    variant(variant&& other) TINFRA_NOEXCEPT;
+    variant& operator=(variant&& other) TINFRA_NOEXCEPT;
+#endif
+    ~variant() { destroy(); }
+
+    void swap(variant& other);
+
     static variant none();
     static variant array();
     static variant dict();
-    
+
     // type checkers
-    
+
     bool is_array() const;
     bool is_dict() const;
     bool is_string() const;
@@ -53,215 +82,371 @@ public:
     bool is_double() const;
     bool is_bool() const;
     bool is_none() const;
-    
+
     // cast getters
     dict_type&       get_dict();
     dict_type const& get_dict() const;
-    
+
     array_type&       get_array();
     array_type const& get_array() const;
-    
+
     string_type&       get_string();
     string_type const& get_string() const;
-    
+
     integer_type&       get_integer();
     integer_type const& get_integer() const;
 
     integer_type&       get_int(); // deprecated
     integer_type const& get_int() const; // deprecated
-    
+
     double&       get_double();
     double const& get_double() const;
 
     bool&       get_bool();
     bool const& get_bool() const;
-    
+
     // forcing setters getters
-    void set_dict(dict_type const& = dict_type());
-    void set_array(array_type const& = array_type());
+    void set_dict();
+    void set_dict(dict_type const&);
+    void set_array();
+    void set_array(array_type const&);
     void set_string(string_type const&);
-    
+
     void set_int(integer_type);
     void set_integer(integer_type);
     void set_double(double);
     void set_bool(bool);
-    
+
     // general query
-    // valid for dicts, arrays and strings 
+    // valid for dicts, arrays and strings
     size_t size() const;
-    
+
     // dict query
     variant& operator[](key_type const& key);
     variant const& operator[](key_type const& key) const;
     std::vector<key_type> dict_keys() const;
-    
+
     // array query
     variant& operator[](int index);
     variant const& operator[](int index) const;
-    
+
     bool has_key(key_type const& k) const;
     bool has_key(int index) const;
+
+private:
+    enum kind_type {
+        K_NONE,
+        K_BOOL,
+        K_INTEGER,
+        K_DOUBLE,
+        K_STRING,
+        K_ARRAY,
+        K_DICT
+    };
+    enum {
+        // std::vector has same size regardless of element type
+        STORAGE_SIZE = sizeof(std::string) > sizeof(std::vector<void*>)
+                     ? sizeof(std::string) : sizeof(std::vector<void*>)
+    };
+
+    string_type&       str()       { return *reinterpret_cast<string_type*>(u_.raw); }
+    string_type const& str() const { return *reinterpret_cast<string_type const*>(u_.raw); }
+    array_type&        arr()       { return *reinterpret_cast<array_type*>(u_.raw); }
+    array_type const&  arr() const { return *reinterpret_cast<array_type const*>(u_.raw); }
+
+    void destroy();
+    void reset(kind_type k);
+    void copy_from(variant const& other);
+    void take(variant& other);
+
+    union storage {
+        bool          b;
+        integer_type  i;
+        double        d;
+        variant_dict* dict;
+        void*         align;
+        char          raw[STORAGE_SIZE];
+    };
+
+    unsigned char kind_;
+    storage       u_;
 };
 
+/// Dict of variant, used as variant::dict_type.
+///
+/// Subset of std::map interface; iteration is in key order. Entries
+/// are stored in insertion order in deque blocks (few allocations per
+/// dict, not one per entry) and sorted vector of pointers to them is
+/// used for lookups and iteration, so lookups are binary searches over
+/// contiguous array and inserting moves only pointers. Slots of erased
+/// entries are reused.
+///
+/// As with std::map, references to values stay valid until their
+/// entry is erased (deque doesn't move elements when it grows);
+/// iterators are invalidated by insertion and removal.
+class variant_dict {
+public:
+    typedef std::string                     key_type;
+    typedef variant                         mapped_type;
+    typedef std::pair<std::string, variant> value_type;
+    typedef size_t                          size_type;
+
+    template <typename V>
+    class basic_iterator {
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef V                               value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef V*                              pointer;
+        typedef V&                              reference;
+
+        basic_iterator(): pos_(0) {}
+        explicit basic_iterator(variant_dict::value_type* const* pos): pos_(pos) {}
+        template <typename V2>
+        basic_iterator(basic_iterator<V2> const& other): pos_(other.position()) {}
+
+        V& operator*() const  { return **pos_; }
+        V* operator->() const { return *pos_; }
+
+        basic_iterator& operator++() { ++pos_; return *this; }
+        basic_iterator& operator--() { --pos_; return *this; }
+        basic_iterator  operator++(int) { basic_iterator r(*this); ++pos_; return r; }
+        basic_iterator  operator--(int) { basic_iterator r(*this); --pos_; return r; }
+
+        template <typename V2>
+        bool operator==(basic_iterator<V2> const& other) const { return pos_ == other.position(); }
+        template <typename V2>
+        bool operator!=(basic_iterator<V2> const& other) const { return pos_ != other.position(); }
+
+        variant_dict::value_type* const* position() const { return pos_; }
+    private:
+        variant_dict::value_type* const* pos_;
+    };
+
+    typedef basic_iterator<value_type>       iterator;
+    typedef basic_iterator<value_type const> const_iterator;
+
+    variant_dict() {}
+    variant_dict(variant_dict const& other);
+    variant_dict& operator=(variant_dict const& other);
+
+    iterator       begin()       { return iterator(order_begin()); }
+    iterator       end()         { return iterator(order_begin() + order_.size()); }
+    const_iterator begin() const { return const_iterator(order_begin()); }
+    const_iterator end() const   { return const_iterator(order_begin() + order_.size()); }
+
+    size_t         size() const  { return order_.size(); }
+    bool           empty() const { return order_.empty(); }
+    void           clear();
+    void           swap(variant_dict& other);
+    void           reserve(size_t n);
+
+    iterator       find(key_type const& key);
+    const_iterator find(key_type const& key) const;
+    size_t         count(key_type const& key) const { return find(key) != end() ? 1 : 0; }
+
+    variant&       operator[](key_type const& key);
+
+    std::pair<iterator, bool> insert(value_type const& v);
+    size_t         erase(key_type const& key);
+    void           erase(iterator i);
+
+private:
+    /// Index in order_ of first key not less than key.
+    size_t            lower_bound_position(key_type const& key) const;
+    /// Insert new entry at order_ position.
+    variant&          insert_at(size_t position, key_type const& key);
+
+    value_type* const* order_begin() const { return order_.empty() ? 0 : &order_[0]; }
+
+    std::deque<value_type>   entries_; // insertion order, with erased slots
+    std::vector<value_type*> free_;    // erased slots in entries_
+    std::vector<value_type*> order_;   // live entries, sorted by key
+};
+
+//
+// variant inline implementation
+//
 
 inline
 variant::variant(unsigned int v):
-    value(tinfra::any::from_copy(variant::none_type()))
+    kind_(K_INTEGER)
 {
-    TINFRA_ASSERT(v < std::numeric_limits<integer_type>::max());
-    value = tinfra::any::from_copy<integer_type>(v);
+    u_.i = v;
 }
 inline
 variant::variant(unsigned long v):
-    value(tinfra::any::from_copy(variant::none_type()))
+    kind_(K_INTEGER)
 {
-    TINFRA_ASSERT(v < std::numeric_limits<integer_type>::max());
-    value = tinfra::any::from_copy<integer_type>(v);
+    TINFRA_ASSERT(v < static_cast<unsigned long long>(std::numeric_limits<integer_type>::max()));
+    u_.i = static_cast<integer_type>(v);
+}
+inline
+variant::variant(string_type const& v):
+    kind_(K_STRING)
+{
+    new (u_.raw) string_type(v);
 }
 inline
 variant variant::none()
 {
-    return variant(tinfra::any::from_copy(variant::none_type()));
+    return variant();
 }
 inline
 variant variant::array()
 {
-    return variant(tinfra::any::from_copy(variant::array_type()));
+    variant r;
+    r.set_array();
+    return r;
 }
 
 inline
 variant variant::dict()
 {
-    return variant(tinfra::any::from_copy(variant::dict_type()));
+    variant r;
+    r.set_dict();
+    return r;
+}
+
+inline void variant::swap(variant& other)
+{
+    if( kind_ == other.kind_ && kind_ != K_STRING && kind_ != K_ARRAY ) {
+        std::swap(u_, other.u_);
+        return;
+    }
+    variant tmp;
+    tmp.take(*this);
+    this->take(other);
+    other.take(tmp);
 }
 
 inline bool variant::is_none() const {
-    return this->value.type() == typeid(none_type);
+    return kind_ == K_NONE;
 }
 
 inline bool variant::is_array() const {
-    return this->value.type() == typeid(array_type);
+    return kind_ == K_ARRAY;
 }
 
 inline bool variant::is_dict() const
 {
-    return this->value.type() == typeid(dict_type);
+    return kind_ == K_DICT;
 }
 
 inline bool variant::is_string() const
 {
-    return this->value.type() == typeid(string_type);
+    return kind_ == K_STRING;
 }
 
 inline bool variant::is_integer() const
 {
-    return this->value.type() == typeid(integer_type);
+    return kind_ == K_INTEGER;
 }
 
 inline bool variant::is_int() const
 {
-    return this->value.type() == typeid(integer_type);
+    return kind_ == K_INTEGER;
 }
 
 inline bool variant::is_double() const
 {
-    return this->value.type() == typeid(double);
+    return kind_ == K_DOUBLE;
 }
 
 inline bool variant::is_bool() const
 {
-    return this->value.type() == typeid(bool);
+    return kind_ == K_BOOL;
 }
 
 inline variant::dict_type&       variant::get_dict() {
     TINFRA_ASSERT(is_dict());
-    return this->value.get<dict_type>();
+    return *u_.dict;
 }
 inline variant::dict_type const& variant::get_dict() const {
     TINFRA_ASSERT(is_dict());
-    return this->value.get<dict_type>();
+    return *u_.dict;
 }
 
 inline variant::array_type&       variant::get_array() {
     TINFRA_ASSERT(is_array());
-    return this->value.get<array_type>();
+    return arr();
 }
 inline variant::array_type const& variant::get_array() const {
     TINFRA_ASSERT(is_array());
-    return this->value.get<array_type>();
+    return arr();
 }
 
 inline variant::string_type&       variant::get_string() {
     TINFRA_ASSERT(is_string());
-    return this->value.get<string_type>();
+    return str();
 }
 inline variant::string_type const& variant::get_string() const {
     TINFRA_ASSERT(is_string());
-    return this->value.get<string_type>();
+    return str();
 }
 
 inline variant::integer_type&       variant::get_integer() {
     TINFRA_ASSERT(is_integer());
-    return this->value.get<integer_type>();
+    return u_.i;
 }
 inline variant::integer_type const& variant::get_integer() const {
     TINFRA_ASSERT(is_integer());
-    return this->value.get<integer_type>();
+    return u_.i;
 }
 
 
 inline variant::integer_type&       variant::get_int() { // deprecated
-    return this->get_int();
+    return this->get_integer();
 }
 inline variant::integer_type const& variant::get_int() const { // deprecated
-    return this->get_int();
+    return this->get_integer();
 }
 
 
 inline double&       variant::get_double() {
     TINFRA_ASSERT(is_double());
-    return this->value.get<double>();
+    return u_.d;
 }
 inline double const& variant::get_double() const {
     TINFRA_ASSERT(is_double());
-    return this->value.get<double>();
+    return u_.d;
 }
 
 inline bool&       variant::get_bool() {
     TINFRA_ASSERT(is_bool());
-    return this->value.get<bool>();
+    return u_.b;
 }
 inline bool const& variant::get_bool() const {
     TINFRA_ASSERT(is_bool());
-    return this->value.get<bool>();
-}
-
-
-inline void variant::set_dict(dict_type const& v) {
-    this->value = tinfra::any::from_copy(v);
-}
-
-inline void variant::set_array(array_type const& v) {
-    this->value = tinfra::any::from_copy(v);
+    return u_.b;
 }
 
 inline void variant::set_string(string_type const& v) {
-    this->value = tinfra::any::from_copy(v);
+    if( kind_ == K_STRING ) {
+        str() = v;
+        return;
+    }
+    // v may live in our subtree, copy it before destroying
+    variant tmp(v);
+    swap(tmp);
 }
 
 inline void variant::set_integer(integer_type v) {
-    this->value = tinfra::any::from_copy(v);
+    reset(K_INTEGER);
+    u_.i = v;
 }
 
 inline void variant::set_int(integer_type v) {
-    this->value = tinfra::any::from_copy(v);
+    set_integer(v);
 }
 
 inline void variant::set_double(double v) {
-    this->value = tinfra::any::from_copy(v);
+    reset(K_DOUBLE);
+    u_.d = v;
 }
 inline void variant::set_bool(bool v) {
-    this->value = tinfra::any::from_copy(v);
+    reset(K_BOOL);
+    u_.b = v;
 }
 
 inline bool variant::has_key(key_type const& k) const
@@ -279,8 +464,7 @@ inline bool variant::has_key(int idx) const
     return this->is_array() && idx >= 0 && size_t(idx) < this->size();
 }
 
-// operator == 
-// TBD, bools ints etc
+// operator ==
 bool operator==(variant const& a, variant const& b);
 bool operator!=(variant const& a, variant const& b);
 
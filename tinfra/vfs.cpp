@@ -8,6 +8,11 @@
 #include "tinfra/path.h"
 #include "tinfra/file.h"
 #include "tinfra/tstring.h"
+#include "tinfra/fmt.h"
+#include "tinfra/work_stealing_runner.h"
+#include "tinfra/atomic.h"
+#include "tinfra/mutex.h"
+#include "tinfra/guard.h"
 
 #include <stdexcept>
 #include <memory>
@@ -247,7 +252,7 @@ void default_copy(vfs& sfs, tstring const& src,
 
 void default_recursive_rm(tinfra::vfs& fs, tstring const& name)
 {
-    // note: symlinks are trated as generic files (just removed)
+    // note: symlinks are treated as generic files (just removed)
     tinfra::fs::file_info fi = fs.stat(name);
     if( fi.type == tinfra::fs::DIRECTORY ) {
         std::vector<std::string> files;
@@ -262,6 +267,311 @@ void default_recursive_rm(tinfra::vfs& fs, tstring const& name)
         fs.rm(name);
     }
 }
+
+//
+// parallel tree operations
+//
+
+tree_operation_monitor::~tree_operation_monitor()
+{
+}
+
+/// metadata operations are latency bound, so use more threads than cores
+static const int TREE_OPERATION_DEFAULT_THREADS = 8;
+
+tree_operation_options::tree_operation_options():
+    thread_count(0),
+    monitor(0)
+{
+}
+
+static std::string describe_tree_errors(std::vector<std::string> const& errors)
+{
+    if( errors.empty() )
+        return "tree operation failed";
+    if( errors.size() == 1 )
+        return errors[0];
+    return tsprintf("%s (and %i more errors)", errors[0], errors.size() - 1);
+}
+
+tree_operation_error::tree_operation_error(std::vector<std::string> const& errors):
+    std::runtime_error(describe_tree_errors(errors)),
+    errors_(errors)
+{
+}
+
+tree_operation_error::~tree_operation_error() throw()
+{
+}
+
+namespace {
+
+struct tree_entry {
+    std::string name;
+    bool        is_dir;
+};
+
+/// List directory with entry types.
+///
+/// For local filesystem types come from lister (d_type, no stat).
+static void list_tree_entries(vfs& fs, std::string const& path, bool follow_links, std::vector<tree_entry>& result)
+{
+    tree_entry e;
+    if( &fs == &local_fs() ) {
+        tinfra::fs::lister files(path);
+        tinfra::fs::directory_entry de;
+        while( files.fetch_next(de) ) {
+            e.name = de.name.str();
+            e.is_dir = (de.info.type == tinfra::fs::DIRECTORY);
+            if( de.info.type == tinfra::fs::SYMBOLIC_LINK && follow_links )
+                e.is_dir = tinfra::fs::is_dir(path::join(path, e.name));
+            result.push_back(e);
+        }
+        return;
+    }
+    std::vector<std::string> names;
+    list_files(fs, path, names);
+    for( std::vector<std::string>::const_iterator i = names.begin(); i != names.end(); ++i ) {
+        const std::string entry_path = path::join(path, *i);
+        e.name = *i;
+        e.is_dir = follow_links ? fs.is_dir(entry_path)
+                                : fs.stat(entry_path).type == tinfra::fs::DIRECTORY;
+        result.push_back(e);
+    }
+}
+
+struct tree_operation {
+    tree_operation(tree_operation_options const& options):
+        runner(options.thread_count > 0 ? options.thread_count : TREE_OPERATION_DEFAULT_THREADS),
+        monitor(options.monitor),
+        cancelled_(0)
+    {}
+
+    bool cancelled() const { return cancelled_.load(MO_RELAXED) != 0; }
+
+    void done(tstring const& path)
+    {
+        if( monitor && !monitor->progress(path) )
+            cancelled_.store(1);
+    }
+
+    void failed(tstring const& path, std::exception const& e)
+    {
+        tinfra::guard g(errors_mutex);
+        errors.push_back(tsprintf("%s: %s", path, e.what()));
+    }
+
+    /// Wait for all jobs, throw collected errors.
+    bool finish()
+    {
+        runner.wait_idle();
+        if( !errors.empty() )
+            throw tree_operation_error(errors);
+        return !cancelled();
+    }
+
+    tinfra::work_stealing_runner runner;
+    tree_operation_monitor*      monitor;
+    tinfra::mutex                errors_mutex;
+    std::vector<std::string>     errors;
+private:
+    tinfra::atomic<int>          cancelled_;
+};
+
+//
+// copy
+//
+
+struct tree_copy_job {
+    tree_operation* op;
+    vfs*            sfs;
+    vfs*            dfs;
+    std::string     src;
+    std::string     dest;
+
+    void operator()()
+    {
+        if( op->cancelled() )
+            return;
+        std::vector<tree_entry> entries;
+        try {
+            list_tree_entries(*sfs, src, true, entries);
+        } catch( std::exception& e ) {
+            op->failed(src, e);
+            return;
+        }
+        // first create subdirectories and let other workers
+        // descend into them ...
+        for( std::vector<tree_entry>::const_iterator i = entries.begin(); i != entries.end(); ++i ) {
+            if( !i->is_dir )
+                continue;
+            const tree_copy_job child = { op, sfs, dfs, path::join(src, i->name), path::join(dest, i->name) };
+            try {
+                dfs->mkdir(child.dest);
+            } catch( std::exception& e ) {
+                op->failed(child.dest, e);
+                continue;
+            }
+            op->done(child.dest);
+            op->runner(child);
+        }
+        // ... then copy files
+        for( std::vector<tree_entry>::const_iterator i = entries.begin(); i != entries.end(); ++i ) {
+            if( i->is_dir )
+                continue;
+            if( op->cancelled() )
+                return;
+            const std::string file_src = path::join(src, i->name);
+            const std::string file_dest = path::join(dest, i->name);
+            try {
+                copy_file(file_src, file_dest);
+            } catch( std::exception& e ) {
+                op->failed(file_dest, e);
+                continue;
+            }
+            op->done(file_dest);
+        }
+    }
+
+    void copy_file(std::string const& file_src, std::string const& file_dest)
+    {
+        if( sfs != &local_fs() || dfs != &local_fs() ) {
+            copy(*sfs, file_src, *dfs, file_dest);
+            return;
+        }
+        // types are known, skip default_copy checks;
+        // stream_copy offloads copy to kernel
+        tinfra::file in(file_src, FOM_READ);
+        tinfra::file out(file_dest, FOM_WRITE | FOM_CREATE | FOM_TRUNC);
+        stream_copy(in, out);
+        out.close();
+    }
+};
+
+//
+// rm
+//
+
+/// Directory being removed, removed when pending drops to 0.
+struct tree_rm_node {
+    tree_rm_node*       parent;
+    std::string         path;
+    tinfra::atomic<int> pending;  // subdirectories + 1 for own job
+    tinfra::atomic<int> failed;
+
+    tree_rm_node(tree_rm_node* parent, std::string const& path):
+        parent(parent),
+        path(path),
+        pending(1),
+        failed(0)
+    {}
+};
+
+struct tree_rm_job {
+    tree_operation* op;
+    vfs*            fs;
+    tree_rm_node*   node;
+
+    void operator()()
+    {
+        if( !op->cancelled() ) {
+            try {
+                remove_contents();
+            } catch( std::exception& e ) {
+                op->failed(node->path, e);
+                node->failed.store(1);
+            }
+        }
+        release(node);
+    }
+
+    void remove_contents()
+    {
+        std::vector<tree_entry> entries;
+        list_tree_entries(*fs, node->path, false, entries);
+        for( std::vector<tree_entry>::const_iterator i = entries.begin(); i != entries.end(); ++i ) {
+            if( op->cancelled() )
+                break;
+            const std::string entry_path = path::join(node->path, i->name);
+            if( i->is_dir ) {
+                tree_rm_node* child = new tree_rm_node(node, entry_path);
+                node->pending.fetch_add(1);
+                const tree_rm_job job = { op, fs, child };
+                op->runner(job);
+                continue;
+            }
+            try {
+                fs->rm(entry_path);
+            } catch( std::exception& e ) {
+                op->failed(entry_path, e);
+                node->failed.store(1);
+                continue;
+            }
+            op->done(entry_path);
+        }
+    }
+
+    /// Drop reference to n, last one removes directory and releases parent.
+    void release(tree_rm_node* n)
+    {
+        while( n != 0 && n->pending.fetch_sub(1) == 1 ) {
+            bool ok = n->failed.load() == 0 && !op->cancelled();
+            if( ok ) {
+                try {
+                    fs->rmdir(n->path);
+                    op->done(n->path);
+                } catch( std::exception& e ) {
+                    op->failed(n->path, e);
+                    ok = false;
+                }
+            }
+            tree_rm_node* parent = n->parent;
+            if( !ok && parent != 0 )
+                parent->failed.store(1);
+            delete n;
+            n = parent;
+        }
+    }
+};
+
+} // end anonymous namespace
+
+bool parallel_recursive_copy(vfs& sfs, tstring const& src,
+                             vfs& dfs, tstring const& dest,
+                             tree_operation_options const& options)
+{
+    if( dfs.is_dir(dest) ) {
+        const std::string new_dest = path::join(dest, path::basename(src));
+        return parallel_recursive_copy(sfs, src, dfs, new_dest, options);
+    }
+    if( !sfs.is_dir(src) ) {
+        copy(sfs, src, dfs, dest);
+        return options.monitor == 0 || options.monitor->progress(dest);
+    }
+    dfs.mkdir(dest);
+
+    tree_operation op(options);
+    op.done(dest);
+    const tree_copy_job root = { &op, &sfs, &dfs, src.str(), dest.str() };
+    op.runner(root);
+    return op.finish();
+}
+
+bool parallel_recursive_rm(vfs& fs, tstring const& name,
+                           tree_operation_options const& options)
+{
+    // note: symlinks are treated as generic files (just removed)
+    if( fs.stat(name).type != tinfra::fs::DIRECTORY ) {
+        fs.rm(name);
+        return options.monitor == 0 || options.monitor->progress(name);
+    }
+
+    tree_operation op(options);
+    const tree_rm_job root = { &op, &fs, new tree_rm_node(0, name.str()) };
+    op.runner(root);
+    return op.finish();
+}
+
 } // end namespace tinfra
 
 // jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -9,6 +9,10 @@
 #include "tinfra/fs.h"
 #include "tinfra/file.h"
 
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 namespace tinfra {
 
 typedef base_file vfs_file;
@@ -113,6 +117,70 @@ void default_copy(tinfra::vfs& sfs, tstring const& src,
 /// Use only FS primitive calls (is_dir, list_files, rmdir, rm). 
 void default_recursive_rm(tinfra::vfs& fs, tstring const& name);
 
+//
+// parallel tree operations
+//
+
+/// Progress and cancellation of parallel tree operation.
+class tree_operation_monitor {
+public:
+    virtual ~tree_operation_monitor();
+
+    /// Called after entry (destination path for copy) is processed.
+    ///
+    /// Called concurrently from many threads. Return false to cancel
+    /// operation; entries already in progress are finished.
+    virtual bool progress(tstring const& path) = 0;
+};
+
+struct tree_operation_options {
+    tree_operation_options();
+
+    /// Pool size, 0 means default (8); metadata operations are
+    /// latency bound, so it's worth using more threads than processors.
+    int                     thread_count;
+    /// May be 0.
+    tree_operation_monitor* monitor;
+};
+
+/// Failure of parallel tree operation.
+///
+/// Operation continues after errors, so all of them are collected;
+/// what() describes first one.
+class tree_operation_error: public std::runtime_error {
+public:
+    explicit tree_operation_error(std::vector<std::string> const& errors);
+    ~tree_operation_error() throw();
+
+    std::vector<std::string> const& errors() const { return errors_; }
+private:
+    std::vector<std::string> errors_;
+};
+
+/// Recursive copy, directories processed in parallel.
+///
+/// Same semantics as default_recursive_copy. Each directory is
+/// listed by separate job on thread pool; its subdirectories are
+/// created before its files are copied, so jobs for them start as
+/// soon as possible. Files between local_fs() paths are copied by
+/// stream_copy (in kernel where possible).
+///
+/// Returns false if cancelled by monitor. Throws
+/// tree_operation_error if any entry failed.
+bool parallel_recursive_copy(tinfra::vfs& sfs, tstring const& src,
+                             tinfra::vfs& dfs, tstring const& dest,
+                             tree_operation_options const& options = tree_operation_options());
+
+/// Recursive remove, directories processed in parallel.
+///
+/// Same semantics as default_recursive_rm. Directory is removed after
+/// all its children, directories with failed children are left.
+///
+/// Returns false if cancelled by monitor. Throws
+/// tree_operation_error if any entry failed.
+bool parallel_recursive_rm(tinfra::vfs& fs, tstring const& name,
+                           tree_operation_options const& options = tree_operation_options());
+
 } // end namespace tinfra
 
 #endif
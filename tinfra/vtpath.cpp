@@ -1,6 +1,7 @@
 #include "vtpath.h" // we implement this
 
 #include "tinfra/tstring.h"
+#include "tinfra/json_document.h"
 #include "tinfra/any.h"
 #include "tinfra/trace.h"
 
@@ -10,6 +11,7 @@
 #include <iterator>
 #include <string>
 #include <stdexcept>
+#include <cstdlib>
 
 namespace tinfra {
 
@@ -369,5 +371,93 @@ bool vtpath_visitor::fetch_next(variant*& r)
     return true;
 }
 
+//
+// vtpath_visit(json_cursor)
+//
+
+static bool vtpath_array_index(std::string const& token, size_t& index)
+{
+    if( token.empty() || token.find_first_not_of("0123456789") != std::string::npos )
+        return false;
+    index = std::strtoul(token.c_str(), 0, 10);
+    return true;
+}
+
+static void vtpath_match_cursor(json_cursor const& node,
+                                std::vector<vtpath_command>::const_iterator icommand,
+                                std::vector<vtpath_command>::const_iterator iend,
+                                std::vector<json_cursor>& result)
+{
+    if( icommand == iend ) {
+        result.push_back(node);
+        return;
+    }
+    if( !node.is_object() && !node.is_array() )
+        return;
+    if( icommand->type == WILDCARD_ALL ) {
+        // CURRENT[*], selector directly after token
+        for( json_cursor c = node.first(); c; c = c.next() )
+            vtpath_match_cursor(c, icommand+1, iend, result);
+        return;
+    }
+    const bool recursive = (icommand->type == RECURSIVE_CHILD);
+    if( (icommand->type != CHILD && !recursive) || icommand+1 == iend )
+        return;
+
+    vtpath_command const& child_match = *(icommand+1);
+    std::vector<vtpath_command>::const_iterator inext_command = icommand+2;
+    const bool is_token = (child_match.type == TOKEN && child_match.expr.is_string());
+
+    if( !recursive && is_token ) {
+        // CURRENT.TOKEN, non-recursive
+        //  -> direct lookup
+        std::string const& token = child_match.expr.get_string();
+        size_t index;
+        json_cursor match;
+        if( node.is_object() )
+            match = node[tstring(token)];
+        else if( vtpath_array_index(token, index) )
+            match = node[index];
+        if( match )
+            vtpath_match_cursor(match, inext_command, iend, result);
+        return;
+    }
+
+    size_t current_index = 0;
+    for( json_cursor c = node.first(); c; c = c.next(), ++current_index ) {
+        if( child_match.type == WILDCARD_ALL ) {
+            vtpath_match_cursor(c, inext_command, iend, result);
+        } else if( is_token ) {
+            std::string const& token = child_match.expr.get_string();
+            size_t index;
+            if( node.is_object() ? (c.key() == token)
+                                 : (vtpath_array_index(token, index) && index == current_index) )
+            {
+                vtpath_match_cursor(c, inext_command, iend, result);
+            }
+        }
+        if( recursive ) {
+            // in recursive must reapply all rules from now on all containers
+            vtpath_match_cursor(c, icommand, iend, result);
+        }
+    }
+}
+
+std::vector<json_cursor> vtpath_visit(json_cursor const& root, tstring const& expression)
+{
+    std::vector<vtpath_command> commands;
+    vtpath_parse(expression, commands);
+    if( commands.size() == 0 ) {
+        vtpath_parse_fail("empty predicate");
+    }
+    if( commands[0].type != ROOT ) {
+        vtpath_parse_fail("first element shall be root");
+    }
+    std::vector<json_cursor> result;
+    if( root )
+        vtpath_match_cursor(root, commands.begin()+1, commands.end(), result);
+    return result;
+}
+
 } // end namespace tinfra
 
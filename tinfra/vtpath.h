@@ -40,6 +40,14 @@ private:
 std::vector<const variant*> vtpath_visit(variant const& v, tstring const& expression);
 std::vector<variant*> vtpath_visit(variant& v, tstring const& expression);
 
+class json_cursor;
+
+/// Evaluate expression on json_document subtree.
+///
+/// Same language as for variants; additionally, numeric token
+/// selects array item by index (e.g $.books.0.name).
+std::vector<json_cursor> vtpath_visit(json_cursor const& root, tstring const& expression);
+
 } // end namespace tinfra
 
 #endif
@@ -12,6 +12,7 @@
 #include "tinfra/win32.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <windows.h>
 
 namespace tinfra {
@@ -107,7 +108,7 @@ void file::close()
     release();
 }
 
-int file::seek(int pos, base_file::seek_origin origin)
+file::offset_type file::seek(offset_type pos, base_file::seek_origin origin)
 {
     DWORD native_origin = 0;
     
@@ -122,14 +123,64 @@ int file::seek(int pos, base_file::seek_origin origin)
         native_origin = FILE_END;
         break;
     }
-    DWORD r = SetFilePointer((HANDLE)this->handle_, (LONG) pos, NULL, native_origin);
-    if( r != 0xffffffff ) {
-        return (int)r;
-    } else {
+    LARGE_INTEGER distance;
+    LARGE_INTEGER result;
+    distance.QuadPart = pos;
+    if( SetFilePointerEx((HANDLE)this->handle_, distance, &result, native_origin) == 0 ) {
         throw_get_last_error("seek failed");
         // doesn't return
         return -1;
     }
+    return result.QuadPart;
+}
+
+int file::pread(char* data, int size, offset_type offset)
+{
+    // note, on synchronous handle, file pointer is moved anyway
+    OVERLAPPED position;
+    memset(&position, 0, sizeof(position));
+    position.Offset     = (DWORD)(offset & 0xffffffff);
+    position.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD readed;
+    if( ReadFile((HANDLE)this->handle_, (LPVOID)data, (DWORD)size, &readed, &position) == 0 ) {
+        if( GetLastError() == ERROR_HANDLE_EOF )
+            return 0;
+        throw_get_last_error("pread failed");
+    }
+    return readed;
+}
+
+int file::pwrite(const char* data, int size, offset_type offset)
+{
+    OVERLAPPED position;
+    memset(&position, 0, sizeof(position));
+    position.Offset     = (DWORD)(offset & 0xffffffff);
+    position.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD written;
+    if( WriteFile((HANDLE)this->handle_, (LPCVOID)data, (DWORD)size, &written, &position) == 0 ) {
+        throw_get_last_error("pwrite failed");
+    }
+    return written;
+}
+
+int file::readv(mutable_buffer const* buffers, size_t count)
+{
+    return input_stream::readv(buffers, count);
+}
+
+int file::writev(tstring const* fragments, size_t count)
+{
+    return output_stream::writev(fragments, count);
+}
+
+void file::allocate(offset_type offset, offset_type size)
+{
+    base_file::allocate(offset, size);
+}
+
+void file::advise(offset_type offset, offset_type size, file_access_advice advice)
+{
+    base_file::advise(offset, size, advice);
 }
 
 int file::read(char* data, int size)
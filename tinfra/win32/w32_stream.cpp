@@ -219,6 +219,16 @@ void standard_handle_output::sync()
 }
 
 } // end namespace tinfra::win32
+
+namespace detail {
+
+bool native_stream_copy(input_stream&, output_stream&)
+{
+    // no kernel copy on win32, stream_copy always uses buffered loop
+    return false;
+}
+
+} // end namespace tinfra::detail
 } // end namespace tinfra
 
 #endif // TINFRA_W32
@@ -331,6 +331,15 @@ size_t thread::to_number() const
     return static_cast<size_t>(thread_id_);
 }
 
+int hardware_concurrency()
+{
+    SYSTEM_INFO si;
+    ::GetSystemInfo(&si);
+    if( si.dwNumberOfProcessors > 0 )
+        return static_cast<int>(si.dwNumberOfProcessors);
+    return 1;
+}
+
 } } // end namespace tinfra::thread
 
 #endif // TINFRA_W32
@@ -0,0 +1,182 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_work_stealing_deque_h_included
+#define tinfra_work_stealing_deque_h_included
+
+#include "atomic.h"
+
+#include <vector>
+#include <cstddef>
+
+namespace tinfra {
+
+/// Chase-Lev work stealing deque of pointers.
+///
+/// Owner thread pushes and takes at bottom (LIFO), any other
+/// thread may steal from top (FIFO). Lock-free, grows on demand.
+///
+/// Implementation follows "Correct and Efficient Work-Stealing for
+/// Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli, 2013).
+/// Arrays replaced by growth are kept until deque is destroyed,
+/// because concurrent thieves may still read them.
+template <typename T>
+class work_stealing_deque {
+public:
+    explicit work_stealing_deque(size_t initial_capacity = 256);
+    ~work_stealing_deque();
+
+    /// Push item at bottom.
+    ///
+    /// Owner thread only.
+    void push(T* item);
+
+    /// Take item from bottom.
+    ///
+    /// Owner thread only. Returns 0 if deque is empty.
+    T*   take();
+
+    /// Steal item from top.
+    ///
+    /// Any thread. Returns 0 if deque is empty or if lost race
+    /// with other thief or owner (caller may retry).
+    T*   steal();
+
+    /// Approximate number of items.
+    size_t size() const;
+
+    bool   empty() const { return size() == 0; }
+private:
+    struct array {
+        explicit array(ptrdiff_t c):
+            capacity(c),
+            mask(c-1),
+            items(new atomic<T*>[c])
+        {}
+        ~array() { delete[] items; }
+
+        T* get(ptrdiff_t i) const      { return items[i & mask].load(MO_RELAXED); }
+        void put(ptrdiff_t i, T* v)    { items[i & mask].store(v, MO_RELAXED); }
+
+        ptrdiff_t const capacity;
+        ptrdiff_t const mask;
+        atomic<T*>*     items;
+    };
+
+    array* grow(array* a, ptrdiff_t bottom, ptrdiff_t top);
+
+    // top and bottom are written by different threads,
+    // keep them in separate cache lines
+    atomic<ptrdiff_t> top_;
+    char              pad0_[CACHE_LINE_SIZE - sizeof(atomic<ptrdiff_t>)];
+    atomic<ptrdiff_t> bottom_;
+    char              pad1_[CACHE_LINE_SIZE - sizeof(atomic<ptrdiff_t>)];
+    atomic<array*>    array_;
+    std::vector<array*> retired_;
+
+    // noncopyable
+    work_stealing_deque(work_stealing_deque const&);
+    work_stealing_deque& operator=(work_stealing_deque const&);
+};
+
+//
+// work_stealing_deque implementation
+//
+
+template <typename T>
+work_stealing_deque<T>::work_stealing_deque(size_t initial_capacity):
+    top_(0),
+    bottom_(0)
+{
+    ptrdiff_t c = 2;
+    while( c < static_cast<ptrdiff_t>(initial_capacity) )
+        c *= 2;
+    array_.store(new array(c), MO_RELAXED);
+}
+
+template <typename T>
+work_stealing_deque<T>::~work_stealing_deque()
+{
+    delete array_.load(MO_RELAXED);
+    for( typename std::vector<array*>::const_iterator i = retired_.begin(); i != retired_.end(); ++i )
+        delete *i;
+}
+
+template <typename T>
+void work_stealing_deque<T>::push(T* item)
+{
+    const ptrdiff_t b = bottom_.load(MO_RELAXED);
+    const ptrdiff_t t = top_.load(MO_ACQUIRE);
+    array* a = array_.load(MO_RELAXED);
+    if( b - t > a->capacity - 1 ) {
+        a = grow(a, b, t);
+    }
+    a->put(b, item);
+    atomic_thread_fence(MO_RELEASE);
+    bottom_.store(b + 1, MO_RELAXED);
+}
+
+template <typename T>
+T* work_stealing_deque<T>::take()
+{
+    const ptrdiff_t b = bottom_.load(MO_RELAXED) - 1;
+    array* a = array_.load(MO_RELAXED);
+    bottom_.store(b, MO_RELAXED);
+    atomic_thread_fence(MO_SEQ_CST);
+    ptrdiff_t t = top_.load(MO_RELAXED);
+    if( t > b ) {
+        // empty
+        bottom_.store(b + 1, MO_RELAXED);
+        return 0;
+    }
+    T* result = a->get(b);
+    if( t == b ) {
+        // last item, race with thieves
+        if( !top_.compare_exchange(t, t + 1, MO_SEQ_CST) )
+            result = 0;
+        bottom_.store(b + 1, MO_RELAXED);
+    }
+    return result;
+}
+
+template <typename T>
+T* work_stealing_deque<T>::steal()
+{
+    ptrdiff_t t = top_.load(MO_ACQUIRE);
+    atomic_thread_fence(MO_SEQ_CST);
+    const ptrdiff_t b = bottom_.load(MO_ACQUIRE);
+    if( t >= b )
+        return 0;
+    array* a = array_.load(MO_ACQUIRE);
+    T* result = a->get(t);
+    if( !top_.compare_exchange(t, t + 1, MO_SEQ_CST) )
+        return 0;
+    return result;
+}
+
+template <typename T>
+size_t work_stealing_deque<T>::size() const
+{
+    const ptrdiff_t b = bottom_.load(MO_RELAXED);
+    const ptrdiff_t t = top_.load(MO_RELAXED);
+    return b > t ? static_cast<size_t>(b - t) : 0;
+}
+
+template <typename T>
+typename work_stealing_deque<T>::array* work_stealing_deque<T>::grow(array* a, ptrdiff_t bottom, ptrdiff_t top)
+{
+    array* n = new array(a->capacity * 2);
+    for( ptrdiff_t i = top; i < bottom; ++i )
+        n->put(i, a->get(i));
+    retired_.push_back(a);
+    array_.store(n, MO_RELEASE);
+    return n;
+}
+
+} // end namespace tinfra
+
+#endif // tinfra_work_stealing_deque_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
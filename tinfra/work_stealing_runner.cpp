@@ -0,0 +1,210 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#include "work_stealing_runner.h" // we implement this
+
+#include "tinfra/work_stealing_deque.h"
+#include "tinfra/futex.h"
+#include "tinfra/guard.h"
+#include "tinfra/fmt.h"
+#include "tinfra/logger.h"
+
+#include <memory>
+#include <stdexcept>
+
+namespace tinfra {
+
+/// number of cpu_relax() rounds before idle worker parks
+static const int WORKER_SPIN_COUNT = 64;
+
+namespace detail {
+
+struct work_stealing_worker {
+    work_stealing_worker(work_stealing_runner& r, size_t i):
+        runner(r),
+        index(i),
+        random_state(static_cast<unsigned>(i) * 2654435761u + 1)
+    {}
+
+    /// xorshift, good enough for victim selection
+    unsigned next_random()
+    {
+        unsigned x = random_state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        random_state = x;
+        return x;
+    }
+
+    work_stealing_runner&         runner;
+    size_t                        index;
+    unsigned                      random_state;
+    work_stealing_deque<runnable> jobs;
+};
+
+} // end namespace detail
+
+static TINFRA_THREAD_LOCAL detail::work_stealing_worker* current_worker = 0;
+
+work_stealing_runner::work_stealing_runner(int thread_count):
+    injected_count_(0),
+    pending_(0),
+    sleepers_(0),
+    wake_epoch_(0),
+    stopping_(0)
+{
+    if( thread_count <= 0 )
+        thread_count = tinfra::thread::hardware_concurrency();
+    for( int i = 0; i < thread_count; ++i ) {
+        workers_.push_back(new worker(*this, i));
+    }
+    for( int i = 0; i < thread_count; ++i ) {
+        threads_.start(&work_stealing_runner::worker_thread_func, workers_[i]);
+    }
+}
+
+work_stealing_runner::~work_stealing_runner()
+{
+    wait_idle();
+    stopping_.store(1);
+    wake_epoch_.fetch_add(1);
+    futex_wake_all(wake_epoch_);
+    threads_.join();
+    for( std::vector<worker*>::const_iterator i = workers_.begin(); i != workers_.end(); ++i ) {
+        delete *i;
+    }
+}
+
+void work_stealing_runner::wait_idle()
+{
+    if( current_worker != 0 && &current_worker->runner == this )
+        throw std::logic_error("work_stealing_runner: wait_idle() called from worker thread");
+    while( true ) {
+        const int p = pending_.load(MO_ACQUIRE);
+        if( p == 0 )
+            break;
+        futex_wait(pending_, p);
+    }
+}
+
+void work_stealing_runner::do_run(runnable_ptr const& p)
+{
+    std::auto_ptr<runnable> job(new runnable(p));
+    pending_.fetch_add(1, MO_RELAXED);
+
+    worker* w = current_worker;
+    if( w != 0 && &w->runner == this ) {
+        w->jobs.push(job.release());
+    } else {
+        tinfra::guard g(injected_mutex_);
+        injected_.push_back(job.get());
+        job.release();
+        injected_count_.fetch_add(1, MO_RELEASE);
+    }
+
+    // pairs with fence in worker_main: either we see sleeper
+    // or sleeper sees our job
+    atomic_thread_fence(MO_SEQ_CST);
+    if( sleepers_.load(MO_RELAXED) > 0 )
+        wake_one();
+}
+
+void work_stealing_runner::wake_one()
+{
+    wake_epoch_.fetch_add(1, MO_RELEASE);
+    futex_wake(wake_epoch_, 1);
+}
+
+void* work_stealing_runner::worker_thread_func(void* p)
+{
+    worker* w = static_cast<worker*>(p);
+    w->runner.worker_main(*w);
+    return 0;
+}
+
+void work_stealing_runner::worker_main(worker& w)
+{
+    current_worker = &w;
+    while( true ) {
+        runnable* job = find_work(w);
+        for( int i = 0; job == 0 && i < WORKER_SPIN_COUNT; ++i ) {
+            cpu_relax();
+            job = find_work(w);
+        }
+        if( job == 0 ) {
+            const int epoch = wake_epoch_.load(MO_ACQUIRE);
+            sleepers_.fetch_add(1, MO_SEQ_CST);
+            atomic_thread_fence(MO_SEQ_CST);
+            job = find_work(w);
+            if( job == 0 && stopping_.load() == 0 )
+                futex_wait(wake_epoch_, epoch);
+            sleepers_.fetch_sub(1, MO_RELAXED);
+        }
+        if( job != 0 ) {
+            execute(job);
+        } else if( stopping_.load() != 0 ) {
+            break;
+        }
+    }
+    current_worker = 0;
+}
+
+runnable* work_stealing_runner::find_work(worker& w)
+{
+    runnable* job = w.jobs.take();
+    if( job != 0 )
+        return job;
+    job = pop_injected();
+    if( job != 0 )
+        return job;
+
+    const size_t n = workers_.size();
+    if( n < 2 )
+        return 0;
+    for( size_t attempt = 0; attempt < 2*n; ++attempt ) {
+        const size_t victim = w.next_random() % n;
+        if( victim == w.index )
+            continue;
+        job = workers_[victim]->jobs.steal();
+        if( job != 0 )
+            return job;
+    }
+    return 0;
+}
+
+runnable* work_stealing_runner::pop_injected()
+{
+    if( injected_count_.load(MO_ACQUIRE) == 0 )
+        return 0;
+    tinfra::guard g(injected_mutex_);
+    if( injected_.empty() )
+        return 0;
+    runnable* job = injected_.front();
+    injected_.pop_front();
+    injected_count_.fetch_sub(1, MO_RELAXED);
+    return job;
+}
+
+void work_stealing_runner::execute(runnable* job)
+{
+    try {
+        std::auto_ptr<runnable> holder(job);
+        runnable_base& current_job = holder->get();
+        current_job();
+        // current_job is released
+    } catch( std::exception& e ) {
+        TINFRA_LOG_ERROR(fmt("work_stealing_runner: job failed with uncaught exception: %s") % e.what());
+    } catch( ... ) {
+        // job must be accounted anyway, or wait_idle() never returns
+        TINFRA_LOG_ERROR("work_stealing_runner: job failed with unknown exception");
+    }
+    if( pending_.fetch_sub(1, MO_ACQ_REL) == 1 )
+        futex_wake_all(pending_);
+}
+
+} // end namespace tinfra
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
@@ -0,0 +1,79 @@
+//
+// Copyright (c) 2013, Zbigniew Zagorski
+// This software licensed under terms described in LICENSE.txt
+//
+
+#ifndef tinfra_work_stealing_runner_h_included
+#define tinfra_work_stealing_runner_h_included
+
+#include "runner.h"
+#include "thread.h"
+#include "atomic.h"
+#include "mutex.h"
+
+#include <deque>
+#include <vector>
+
+namespace tinfra {
+
+namespace detail {
+struct work_stealing_worker;
+}
+
+/// Thread pool with per-worker work stealing deques.
+///
+/// Jobs submitted from inside of running job go to the local deque
+/// of current worker (no locking, LIFO for cache locality). Jobs
+/// submitted from other threads go to shared injection queue. Idle
+/// workers steal from random victims, spin for a while and then
+/// park on futex until new job arrives.
+///
+/// Destructor waits until all jobs (including those spawned
+/// by jobs) are finished.
+class work_stealing_runner: public runner {
+public:
+    /// Create pool.
+    ///
+    /// thread_count == 0 means one worker per processor.
+    explicit work_stealing_runner(int thread_count = 0);
+    ~work_stealing_runner();
+
+    /// Wait until all submitted jobs are finished.
+    void wait_idle();
+
+    int thread_count() const { return static_cast<int>(workers_.size()); }
+
+private:
+    typedef detail::work_stealing_worker worker;
+
+    void do_run(runnable_ptr const& p);
+
+    static void* worker_thread_func(void* p);
+    void     worker_main(worker& w);
+    runnable* find_work(worker& w);
+    runnable* pop_injected();
+    void     execute(runnable* job);
+    void     wake_one();
+
+    std::vector<worker*>       workers_;
+    tinfra::thread::thread_set threads_;
+
+    tinfra::mutex              injected_mutex_;
+    std::deque<runnable*>      injected_;
+    atomic<int>                injected_count_;
+
+    atomic<int>                pending_;
+    atomic<int>                sleepers_;
+    atomic<int>                wake_epoch_;
+    atomic<int>                stopping_;
+
+    // noncopyable
+    work_stealing_runner(work_stealing_runner const&);
+    work_stealing_runner& operator=(work_stealing_runner const&);
+};
+
+} // end namespace tinfra
+
+#endif // tinfra_work_stealing_runner_h_included
+
+// jedit: :tabSize=8:indentSize=4:noTabs=true:mode=c++:
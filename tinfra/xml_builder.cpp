@@ -27,7 +27,8 @@ void xml_builder::close()
 xml_builder& xml_builder::start(tstring const& name)
 {
 	flush_opened_tag();
-	this->opened_tag = name;
+	this->opened_tag = this->names_.intern(name);
+	this->event_.attributes.clear();
 	state = TAG_OPENED;
 	return *this;
 }
@@ -35,7 +36,10 @@ xml_builder& xml_builder::start(tstring const& name)
 xml_builder& xml_builder::attr(tstring const& name, tstring const& value)
 {
 	assert( state == TAG_OPENED );
-	this->current_attrs.push_back( std::make_pair( name.str(), value.str() ));
+	xml_event_arg arg;
+	arg.name = this->names_.intern(name);
+	arg.value = this->values_.alloc(value);
+	this->event_.attributes.push_back(arg);
 	return *this;
 }
 
@@ -44,7 +48,7 @@ xml_builder& xml_builder::end()
 	flush_opened_tag();
 	assert( this->element_stack.size() > 0 );
 	
-	std::string name = this->element_stack.top();
+	const tstring name = this->element_stack.back();
 	
 	end_element(name);
 	return *this;
@@ -54,39 +58,32 @@ xml_builder& xml_builder::start_element(tstring const& name, xml_event_arg_list
 {
 	flush_opened_tag();
 	
-	xml_event ev;
-	ev.type = xml_event::START_ELEMENT;
-	ev.content = name;
-	ev.attributes = args;
-	out_.write(ev);
-	
-	// setup internal state, we've inside new, currently empty tag
-	state = NO_CONTENT;
-	this->element_stack.push(name.str());
-	
+	this->event_.attributes = args;
+	write_start_element(this->names_.intern(name));
 	return *this;
 }
 
 xml_builder& xml_builder::start_element(tstring const& name)
 {
-	xml_event_arg_list empty_args;
-	return start_element(name, empty_args);
+	flush_opened_tag();
+	
+	this->event_.attributes.clear();
+	write_start_element(this->names_.intern(name));
+	return *this;
 }
 	
 xml_builder& xml_builder::end_element(tstring const& name)
 {
 	assert( this->element_stack.size() > 0 );
-	assert( name == this->element_stack.top());
+	assert( name == this->element_stack.back());
 	
-	{
-		xml_event ev;
-		ev.type = xml_event::END_ELEMENT;
-		ev.content = name;
-		out_.write(ev);
-	}
+	this->event_.type = xml_event::END_ELEMENT;
+	this->event_.content = name;
+	this->event_.attributes.clear();
+	out_.write(this->event_);
 	
 	state = IN_NON_EMPTY_TAG;
-	this->element_stack.pop();
+	this->element_stack.pop_back();
 	
 	return *this;
 }
@@ -95,34 +92,34 @@ xml_builder& xml_builder::cdata(tstring const& content)
 {
 	flush_opened_tag();
 	
-	{
-		xml_event ev;
-		ev.type = xml_event::CDATA;
-		ev.content = content;
-		out_.write(ev);
-	}
+	this->event_.type = xml_event::CDATA;
+	this->event_.content = content;
+	this->event_.attributes.clear();
+	out_.write(this->event_);
 	
 	state = IN_NON_EMPTY_TAG;
 	return *this;
 }
 
+void xml_builder::write_start_element(tstring const& name)
+{
+	this->event_.type = xml_event::START_ELEMENT;
+	this->event_.content = name;
+	out_.write(this->event_);
+	
+	// setup internal state, we've inside new, currently empty tag
+	state = NO_CONTENT;
+	this->element_stack.push_back(name);
+	this->values_.clear();
+}
+
 void xml_builder::flush_opened_tag()
 {
 	if( state == TAG_OPENED ) {
-		// convert into xml_event_arg_list and
-		xml_event_arg_list args;
-		args.reserve( this->current_attrs.size() );
-		for( unsigned i = 0; i < this->current_attrs.size(); ++i ) {
-			xml_event_arg arg;
-			arg.name = this->current_attrs[i].first;
-			arg.value = this->current_attrs[i].second;
-			args.push_back(arg); 
-		}
-		// officially flush
+		// officially flush, attributes are already in event_
 		state = NO_CONTENT;
-		start_element( this->opened_tag, args );
-		this->opened_tag = "";
-		this->current_attrs.clear();
+		write_start_element(this->opened_tag);
+		this->opened_tag = tstring();
 	}
 }
 
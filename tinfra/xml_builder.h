@@ -6,9 +6,6 @@
 #include "tinfra/tstring.h"
 
 #include <vector>
-#include <string>
-#include <utility>
-#include <stack>
 
 namespace tinfra {
 
@@ -40,10 +37,17 @@ private:
 		IN_NON_EMPTY_TAG
 	} state;
 	
-	std::string opened_tag;
-	std::stack<std::string>    element_stack;
-	std::vector<std::pair<std::string, std::string> > current_attrs;
+	// element and attribute names are interned (pool grows only with
+	// distinct names), attribute values of opened tag live in values_
+	// until start event is written, so building doesn't allocate per
+	// element
+	string_pool            names_;
+	string_pool            values_;
+	tstring                opened_tag;
+	std::vector<tstring>   element_stack;
+	xml_event              event_; ///< reused, attributes of opened tag
 	
+	void write_start_element(tstring const& name);
 	void flush_opened_tag();
 };
 
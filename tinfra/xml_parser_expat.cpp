@@ -9,19 +9,32 @@
 #include <tinfra/fmt.h>
 
 #include <expat.h>
-#include <deque>
+#include <vector>
+#include <string>
 #include <stdexcept>
 
 namespace tinfra {
 
+// Events of one parsed buffer are kept in recycled slots (with
+// attribute vectors keeping their capacity) and strings are copied to
+// string_pool that is cleared when all events were read, so after
+// warm-up reading doesn't allocate. Adjacent character data is
+// coalesced into one CDATA event.
 class xml_stream_reader_expat: public xml_input_stream {
     tinfra::input_stream* input_;
     XML_Parser parser;
-    std::deque<xml_event> queue;
+    std::vector<xml_event> events_; ///< recycled slots, events_count_ used
+    size_t      events_count_;
+    size_t      next_event_;
+    std::string text_;              ///< character data not yet emitted
+    bool        finished_;
     string_pool pool;
 public:    
     xml_stream_reader_expat(tinfra::input_stream* input):
-        input_(input)
+        input_(input),
+        events_count_(0),
+        next_event_(0),
+        finished_(false)
     {
         parser = XML_ParserCreate("UTF-8");        
         XML_SetStartElementHandler(parser, &xml_stream_reader_expat::startElementHandler);
@@ -38,23 +51,35 @@ public:
     // implementation of xml_input_stream IF
     //
     virtual xml_event read() {
-        if( queue.empty() ) 
+        xml_event result;
+        read_into(result);
+        return result;
+    }
+
+    virtual void read_into(xml_event& ev) {
+        if( next_event_ == events_count_ ) 
             parse();
         
-        xml_event result = queue.front();
-        queue.pop_front();
-        return result;
-    };
+        xml_event const& e = events_[next_event_++];
+        ev.type = e.type;
+        ev.content = e.content;
+        ev.attributes.assign(e.attributes.begin(), e.attributes.end());
+    }
     
     // 
     // parser main
     //
     
     void parse() {
-        queue.clear();
+        events_count_ = 0;
+        next_event_ = 0;
         pool.clear();
         
-        while( queue.empty() ) {
+        while( events_count_ == 0 ) {
+            if( finished_ ) {
+                new_event(xml_event::END);
+                return;
+            }
             int BUFF_SIZE = 16384;
             
             char *buff = (char*)XML_GetBuffer(parser, BUFF_SIZE);
@@ -70,10 +95,8 @@ public:
             }
             
             if( is_final ) {
-                xml_event eof;
-                eof.type = xml_event::END;
-                queue.push_back(eof);
-                return;
+                flush_text();
+                finished_ = true;
             }
         }
     }
@@ -96,46 +119,56 @@ public:
         }
         return result;
     }
+
+    xml_event& new_event(xml_event::xml_event_type type)
+    {
+        if( events_count_ == events_.size() )
+            events_.push_back(xml_event());
+        xml_event& event = events_[events_count_++];
+        event.type = type;
+        event.attributes.clear();
+        return event;
+    }
+
+    void flush_text()
+    {
+        if( text_.empty() )
+            return;
+        xml_event& event = new_event(xml_event::CDATA);
+        event.content = pool.alloc(text_);
+        text_.clear();
+    }
+
     //
     // handlers - instance methods
     //
     void startElement(const char* name, const char** attributes)
     {
-        xml_event event;
-        
-        event.type = xml_event::START_ELEMENT;
-        event.content = pool.alloc(name);
+        flush_text();
+        xml_event& event = new_event(xml_event::START_ELEMENT);
+        event.content = pool.intern(name);
         
         int count = attributes_count(attributes);
-        event.attributes.reserve(count);
+        event.attributes.resize(count);
         
         for(int i = 0; i < count ; ++i ) {
             const char* name =  attributes[i*2];
             const char* value = attributes[i*2+1];
-            event.attributes[i].name = pool.alloc(name);
+            event.attributes[i].name = pool.intern(name);
             event.attributes[i].value = pool.alloc(value);
         }
-        queue.push_back(event);
     }
     
     void endElement(const char* name)
     {
-        xml_event event;
-        
-        event.type = xml_event::END_ELEMENT;
-        event.content = pool.alloc(name);
-        
-        queue.push_back(event);
+        flush_text();
+        xml_event& event = new_event(xml_event::END_ELEMENT);
+        event.content = pool.intern(name);
     }
     
     void characterData(const char* data, int len)
     {
-        xml_event event;
-        
-        event.type = xml_event::CDATA;
-        event.content = pool.alloc(tstring(data,len));
-        
-        queue.push_back(event);
+        text_.append(data, len);
     }
     
     //
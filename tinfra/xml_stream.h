@@ -34,12 +34,23 @@ struct xml_input_stream {
     virtual ~xml_input_stream() {}
     
     virtual xml_event read() = 0;
+
+    /// Read next event into ev.
+    ///
+    /// Strings in ev may point into storage owned by stream and are
+    /// valid until next read. Capacity of ev.attributes is reused, so
+    /// reading into same event in loop doesn't allocate (if stream
+    /// supports it; default implementation copies result of read()).
+    virtual void read_into(xml_event& ev) { ev = read(); }
 };
 
 struct xml_output_stream {
     virtual ~xml_output_stream() {}
     
     virtual void write(xml_event const& ev) = 0;
+
+    /// Write buffered data to underlying stream, if any.
+    virtual void flush() {}
 };
 
 
@@ -1,7 +1,13 @@
 #include "xml_writer.h" // we implement this
 
+#include "tinfra/string_search.h"
+#include "tinfra/memory_stream.h"
+#include "tinfra/buffered_stream.h"
+
 #include <algorithm>
-#include <limits>
+#include <cstring>
+#include <string>
+#include <stdexcept>
 
 namespace tinfra {
 
@@ -10,11 +16,15 @@ xml_event xml_event::make_copy(tinfra::string_pool& pool) const
 {
     xml_event result;
     result.type = this->type;
-    result.content = pool.alloc(this->content);
+    // element and attribute names repeat, so they are interned
+    if( this->type == CDATA )
+        result.content = pool.alloc(this->content);
+    else
+        result.content = pool.intern(this->content);
     result.attributes.reserve(this->attributes.size());
     for( unsigned i = 0; i < this->attributes.size(); ++i ) {
         xml_event_arg arg;
-        arg.name = pool.alloc( this->attributes[i].name );
+        arg.name = pool.intern( this->attributes[i].name );
         arg.value = pool.alloc( this->attributes[i].value );
         result.attributes.push_back(arg);
     }
@@ -28,47 +38,38 @@ xml_writer_options::xml_writer_options()
     short_string_inline = true;
     indentation_size = 4;
     indentation_character = ' ';
+    buffer_size = 64*1024;
 }
 
-class xml_content_encoder {
-    tstring data;
-    tstring pattern;
-    const tstring* replacement;
-    int position;
+// Escapes data by copying runs of bytes that don't need escaping in
+// bulk; specials are found with (vectorized) string_searcher.
+class xml_escaper {
+    byte_set    specials_;
+    const char* replacements_[256];
 public:
-    xml_content_encoder(tstring const& _data, tstring const& _pattern, const tstring* _replacement):
-        data(_data),
-        pattern(_pattern),
-        replacement(_replacement),
-        position(0)
+    xml_escaper(tstring const& specials, const char* const* replacements):
+        specials_(specials.data(), specials.size())
     {
-        assert(_data.size() < size_t(std::numeric_limits<int>::max()));
-    }
-
-    bool has_next() const {
-        return this->position < int(this->data.size());
+        std::fill(replacements_, replacements_ + 256, static_cast<const char*>(0));
+        for( size_t i = 0; i < specials.size(); ++i )
+            replacements_[static_cast<unsigned char>(specials[i])] = replacements[i];
     }
 
-    tstring next() {
-        tstring current = this->data.substr(this->position);
-        typedef tstring::size_type size_type;
-        const size_type first_replacement_pos = current.find_first_of(this->pattern);
-        if( first_replacement_pos == tstring::npos ) {
-            this->position = this->data.size();
-            return current;
-        } else if ( first_replacement_pos == 0 ) {
-            // find replacement
-            this->position++;
-            const char* which = std::find(this->pattern.begin(), this->pattern.end(), current[0]);
-            assert(which != this->pattern.end());
-            int index = (which - this->pattern.data());
-            assert(index < int(this->pattern.size()));
-            const tstring found_replacement = this->replacement[index];
-            return found_replacement;
-        } else {
-            tstring result = current.substr(0, first_replacement_pos);
-            this->position += first_replacement_pos;
-            return result;
+    template <typename Writer>
+    void escape(tstring const& data, Writer& writer) const
+    {
+        string_searcher const& searcher = string_default_searcher();
+        const char* p = data.data();
+        const char* const end = p + data.size();
+        while( p != end ) {
+            const char* special = searcher.find_of(p, end, specials_, false);
+            if( special != p )
+                writer.write_bytes(p, special - p);
+            if( special == end )
+                break;
+            const char* replacement = replacements_[static_cast<unsigned char>(*special)];
+            writer.write_bytes(replacement, std::strlen(replacement));
+            p = special + 1;
         }
     }
 };
@@ -83,10 +84,29 @@ public:
         xml_document_started_(false),
         options(opts)
     {
+        // target buffers already, don't hold output from it
+        if( dynamic_cast<tinfra::memory_output_stream*>(out) != 0 ||
+            dynamic_cast<tinfra::buffered_output_stream*>(out) != 0 )
+            options.buffer_size = 0;
+        buffer_.reserve(options.buffer_size);
     }
 
     ~xml_streamer()
     {
+        // errors can't be reported from here, flush() explicitly to
+        // get them
+        try {
+            flush();
+        } catch( ... ) {
+        }
+    }
+
+    void flush()
+    {
+        if( !buffer_.empty() ) {
+            write_all(buffer_.data(), buffer_.size());
+            buffer_.clear();
+        }
     }
 
     // xml_output_stream interface
@@ -113,6 +133,7 @@ private:
     bool             in_start_tag_;
     bool             xml_document_started_;
     xml_writer_options options;
+    std::string      buffer_;
 
 
     void start_document()
@@ -179,6 +200,9 @@ private:
             write_character('>');
         }
         maybe_newline();
+        // document is complete, don't keep it in buffer
+        if( tag_nest_ == 0 )
+            flush();
     }
 
     void ensure_tag_start_closed()
@@ -210,7 +234,12 @@ private:
 
     void make_indentation(int level, int indent_size)
     {
-        for(int i = 0; i < indent_size*level; ++i )
+        const size_t n = size_t(indent_size*level);
+        if( buffer_.size() + n <= options.buffer_size ) {
+            buffer_.append(n, options.indentation_character);
+            return;
+        }
+        for( size_t i = 0; i < n; ++i )
             write_character(options.indentation_character);
     }
 
@@ -218,15 +247,11 @@ private:
     {
         // http://www.w3.org/TR/REC-xml/#NT-AttValue
         // says that in att value, we escape " ' < and &
-        static const tstring patterns = "\"'<&";
-        static const tstring replacements[] = {
+        static const char* const replacements[] = {
             "&quot;", "&apos;", "&lt;", "&amp;"
         };
-        xml_content_encoder encoder(data, patterns, replacements);
-        while( encoder.has_next() ) {
-            tinfra::tstring chunk = encoder.next();
-            out_->write(chunk.data(), chunk.size());
-        }
+        static const xml_escaper escaper("\"'<&", replacements);
+        escaper.escape(data, *this);
     }
 
     void write_content_bytes(tstring const& data)
@@ -234,24 +259,49 @@ private:
         // http://www.w3.org/TR/REC-xml/#dt-chardata
         // says that only < and & are escaped
         // in normal text
-        static const tstring patterns = "<&";
-        static const tstring replacements[] = {
+        static const char* const replacements[] = {
             "&lt;", "&amp;"
         };
-        xml_content_encoder encoder(data, patterns, replacements);
-        while( encoder.has_next() ) {
-            tinfra::tstring chunk = encoder.next();
-            out_->write(chunk.data(), chunk.size());
+        static const xml_escaper escaper("<&", replacements);
+        escaper.escape(data, *this);
+    }
+
+    friend class xml_escaper;
+
+    void write_bytes(const char* data, size_t size)
+    {
+        if( buffer_.size() + size > options.buffer_size ) {
+            flush();
+            if( size >= options.buffer_size ) {
+                write_all(data, size);
+                return;
+            }
         }
+        buffer_.append(data, size);
     }
 
     void write_bytes(tstring const& data)
     {
-        out_->write(data.data(), data.size());
+        write_bytes(data.data(), data.size());
     }
     void write_character(char c)
     {
-        out_->write(&c, 1);
+        if( buffer_.size() < options.buffer_size )
+            buffer_ += c;
+        else
+            write_bytes(&c, 1);
+    }
+
+    void write_all(const char* data, size_t size)
+    {
+        while( size > 0 ) {
+            const int chunk = int(std::min(size, size_t(1) << 30));
+            const int written = out_->write(data, chunk);
+            if( written <= 0 )
+                throw std::runtime_error("xml_stream_writer: unable to write output");
+            data += written;
+            size -= written;
+        }
     }
 
 };
@@ -18,10 +18,29 @@ struct xml_writer_options {
     int  indentation_size;
     char indentation_character;
 
+    /// output is collected in buffer of this size and written to
+    /// output_stream in large blocks, on flush() and when root element
+    /// is closed; 0 writes directly
+    ///
+    /// ignored for memory_output_stream and buffered_output_stream,
+    /// which are written directly, so their own buffering and flush
+    /// policy applies
+    size_t buffer_size;
+
     /// initialize defaults;
     xml_writer_options();
 };
 
+/// Create XML writer writing to output_stream.
+///
+/// Unless target is memory_output_stream or buffered_output_stream,
+/// output is kept in writer buffer (options.buffer_size) until buffer
+/// is full, root element is closed, xml_output_stream::flush() is
+/// called or writer is destroyed. So, e.g. partial document written
+/// to socket or log file is not visible to reader before flush().
+///
+/// Write errors are reported with std::runtime_error, except from
+/// destructor; call flush() before destroying writer to get them.
 std::auto_ptr<xml_output_stream> xml_stream_writer(tinfra::output_stream* in, xml_writer_options const& options);
 
 } // end namespace tinfra